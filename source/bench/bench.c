@@ -0,0 +1,212 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+/**
+ * type_c_bench: times lexing, parsing and type inference of synthetic programs.
+ * Usage: type_c_bench [scale] [--dump <dir>] [--lazy] [--jobs <n>]
+ * scale multiplies the size of every generated program, defaults to 1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "generators.h"
+#include "../compiler/lexer.h"
+#include "../compiler/parser.h"
+#include "../compiler/ast.h"
+#include "../compiler/ast_walk.h"
+#include "../compiler/tokens.h"
+#include "../compiler/type_inference.h"
+#include "../compiler/parser_parallel.h"
+
+typedef struct BenchResult {
+    uint64_t bytes;
+    uint64_t tokens;
+    uint64_t nodes;
+    uint32_t errors;
+    double lexSeconds;
+    double parseSeconds;
+    double inferSeconds;
+    ParserParallelStats split;
+}BenchResult;
+
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static AstWalkAction bench_countExpr(AstWalker* walker, Expr* expr) {
+    (*(uint64_t*)walker->data)++;
+    return AWA_CONTINUE;
+}
+
+static AstWalkAction bench_countStatement(AstWalker* walker, Statement* stmt) {
+    (*(uint64_t*)walker->data)++;
+    return AWA_CONTINUE;
+}
+
+static uint64_t bench_countProgram(ASTProgramNode* program) {
+    // declarations which are not statements
+    uint64_t count = 0;
+    map_iter_t iter = map_iter(&program->scope->dataTypes);
+    while(map_next(&program->scope->dataTypes, &iter)) {
+        count++;
+    }
+    iter = map_iter(&program->scope->externDecls);
+    while(map_next(&program->scope->externDecls, &iter)) {
+        count++;
+    }
+
+    // every node, walked without recursion as some programs are very deep
+    AstWalkCallbacks callbacks;
+    uint32_t i = 0;
+    for(; i < AST_WALK_EXPR_TYPES; i++) {
+        callbacks.enterExpr[i] = bench_countExpr;
+        callbacks.leaveExpr[i] = NULL;
+    }
+    for(i = 0; i < AST_WALK_STATEMENT_TYPES; i++) {
+        callbacks.enterStatement[i] = bench_countStatement;
+        callbacks.leaveStatement[i] = NULL;
+    }
+    AstWalker walker;
+    ast_walker_init(&walker);
+    Statement* stmt;
+    vec_foreach(&program->stmts, stmt, i) {
+        ast_walk_statement(&walker, &callbacks, &count, program->scope, stmt);
+    }
+    ast_walker_deinit(&walker);
+    return count;
+}
+
+static BenchResult bench_run(const char* name, sds source, uint8_t lazyBodies, ThreadPool* pool) {
+    BenchResult result;
+    memset(&result, 0, sizeof(BenchResult));
+    result.bytes = sdslen(source);
+
+    // lexing alone
+    double start = bench_now();
+    LexerState* lex = lexer_init(name, source, sdslen(source));
+    Lexeme lexeme;
+    do {
+        lexeme = lexer_lexCurrent(lex);
+        result.tokens++;
+    } while(lexeme.type != TOK_EOF);
+    result.lexSeconds = bench_now() - start;
+
+    // lexing and parsing
+    start = bench_now();
+    lex = lexer_init(name, source, sdslen(source));
+    Parser* parser = parser_init(lex);
+    parser->lazyBodies = lazyBodies;
+    ASTProgramNode* program = ast_makeProgramNode();
+    parser->programNode = program;
+    result.split = parser_parallel_parseProgram(parser, program, pool);
+    result.parseSeconds = bench_now() - start;
+
+    // inference
+    start = bench_now();
+    ti_runProgram(parser, program);
+    result.inferSeconds = bench_now() - start;
+
+    result.nodes = bench_countProgram(program);
+    result.errors = parser->diagnostics.errorCount;
+    if(result.errors > 0) {
+        parser_reportDiagnostics(parser);
+    }
+
+    return result;
+}
+
+static double bench_rate(uint64_t count, double seconds) {
+    return seconds > 0 ? (double)count / seconds : 0;
+}
+
+static void bench_report(const char* name, BenchResult* r) {
+    printf("%-12s %9.1fK %9"PRIu64" %9"PRIu64" %9.2f %9.2f %9.2f %12.0f %12.0f %6"PRIu32"\n",
+           name, (double)r->bytes / 1024.0, r->tokens, r->nodes,
+           r->lexSeconds * 1000, r->parseSeconds * 1000, r->inferSeconds * 1000,
+           bench_rate(r->tokens, r->lexSeconds), bench_rate(r->nodes, r->parseSeconds), r->errors);
+}
+
+static void bench_dump(const char* dir, const char* name, sds source) {
+    sds path = sdscatprintf(sdsempty(), "%s/%s.tc", dir, name);
+    FILE* f = fopen(path, "w");
+    if(f != NULL) {
+        fwrite(source, 1, sdslen(source), f);
+        fclose(f);
+    }
+    else {
+        fprintf(stderr, "Could not write '%s'\n", path);
+    }
+    sdsfree(path);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t scale = 1;
+    const char* dumpDir = NULL;
+    uint8_t lazyBodies = 0;
+    // large programs are parsed in chunks by this many workers, none by default
+    uint32_t jobs = 0;
+    int i = 1;
+    for(; i < argc; i++) {
+        if(strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dumpDir = argv[++i];
+        }
+        else if(strcmp(argv[i], "--lazy") == 0) {
+            // function bodies are skipped, as when loading the interface of an import
+            lazyBodies = 1;
+        }
+        else if(strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            scale = (uint32_t)strtoul(argv[i], NULL, 10);
+            if(scale == 0) {
+                fprintf(stderr, "Usage: %s [scale] [--dump <dir>] [--lazy] [--jobs <n>]\n", argv[0]);
+                return 1;
+            }
+        }
+    }
+
+    struct {
+        const char* name;
+        sds source;
+    } programs[] = {
+            {"types",       bench_gen_types(500 * scale)},
+            {"hierarchy",   bench_gen_hierarchy(50 * scale, 20)},
+            {"expressions", bench_gen_expressions(200 * scale, 64)},
+            {"generics",    bench_gen_generics(500 * scale)},
+            {"externs",     bench_gen_externs(100 * scale, 20)},
+            {"library",     bench_gen_library(200 * scale, 20)},
+            {"deep",        bench_gen_deep(scale, 100000)},
+    };
+
+    printf("%-12s %10s %9s %9s %9s %9s %9s %12s %12s %6s\n",
+           "program", "size", "tokens", "nodes", "lex ms", "parse ms", "infer ms", "tokens/s", "nodes/s", "errors");
+
+    ThreadPool* pool = jobs > 0 ? threadpool_make(jobs) : NULL;
+    uint32_t failures = 0;
+    size_t p = 0;
+    for(; p < sizeof(programs)/sizeof(programs[0]); p++) {
+        if(dumpDir != NULL) {
+            bench_dump(dumpDir, programs[p].name, programs[p].source);
+        }
+        BenchResult result = bench_run(programs[p].name, programs[p].source, lazyBodies, pool);
+        bench_report(programs[p].name, &result);
+        if(result.split.chunks > 1) {
+            printf("%-12s split into %"PRIu32" chunks, %"PRIu32" parsed again\n", "",
+                   result.split.chunks, result.split.reparsed);
+        }
+        failures += result.errors;
+        sdsfree(programs[p].source);
+    }
+
+    if(pool != NULL) {
+        threadpool_free(pool);
+    }
+    return failures > 0;
+}
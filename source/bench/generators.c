@@ -0,0 +1,168 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include "generators.h"
+
+static const char* bench_primitives[] = {"u8", "u16", "u32", "u64", "i8", "i16", "i32", "i64", "f32", "f64", "bool", "string"};
+#define BENCH_PRIMITIVES_COUNT (sizeof(bench_primitives)/sizeof(bench_primitives[0]))
+
+sds bench_gen_types(uint32_t count) {
+    sds src = sdsempty();
+    uint32_t i = 0;
+    for(; i < count; i++) {
+        src = sdscatprintf(src,
+                           "type Point%u = struct {\n"
+                           "    x: %s,\n"
+                           "    y: %s,\n"
+                           "    label: string,\n"
+                           "    tags: string[]\n"
+                           "}\n\n",
+                           i, bench_primitives[i % BENCH_PRIMITIVES_COUNT], bench_primitives[(i + 1) % BENCH_PRIMITIVES_COUNT]);
+
+        src = sdscatprintf(src,
+                           "type Color%u = enum {\n"
+                           "    Red, Green, Blue, Alpha\n"
+                           "}\n\n", i);
+
+        src = sdscatprintf(src,
+                           "type Shape%u = interface {\n"
+                           "    fn area() -> f32\n"
+                           "    fn scale(factor: f32, origin: Point%u) -> Point%u\n"
+                           "    fn color() -> Color%u\n"
+                           "}\n\n", i, i, i, i);
+
+        src = sdscatprintf(src,
+                           "type Tree%u = variant {\n"
+                           "    Leaf(value: u32),\n"
+                           "    Node(lhs: Tree%u, rhs: Tree%u)\n"
+                           "}\n\n", i, i, i);
+    }
+    return src;
+}
+
+sds bench_gen_hierarchy(uint32_t depth, uint32_t width) {
+    sds src = sdsempty();
+    uint32_t w = 0;
+    for(; w < width; w++) {
+        src = sdscatprintf(src, "type Base%u_0 = interface {\n    fn m%u_0() -> u32\n}\n\n", w, w);
+
+        uint32_t d = 1;
+        for(; d < depth; d++) {
+            src = sdscatprintf(src,
+                               "type Base%u_%u = interface(Base%u_%u) {\n"
+                               "    fn m%u_%u() -> u32\n"
+                               "    fn n%u_%u(x: u32) -> Base%u_%u\n"
+                               "}\n\n", w, d, w, d - 1, w, d, w, d, w, d - 1);
+        }
+
+        src = sdscatprintf(src,
+                           "type Impl%u = class(Base%u_%u) {\n"
+                           "    let counter: u32 = 0\n"
+                           "    let name: string = \"impl\"\n"
+                           "    fn run(x: u32) -> u32 = x\n"
+                           "}\n\n", w, w, depth - 1);
+
+        src = sdscatprintf(src, "let impl%u: Impl%u = new Impl%u()\nimpl%u as Base%u_0\n\n", w, w, w, w, w);
+    }
+    return src;
+}
+
+sds bench_gen_expressions(uint32_t count, uint32_t length) {
+    static const char* operators[] = {"+", "*", "-", "<<", "|", "&", "^", "/", "%", ">>"};
+    sds src = sdsempty();
+    uint32_t i = 0;
+    for(; i < count; i++) {
+        src = sdscatprintf(src, "fn expr%u(a: u32, b: u32) -> u32 = a", i);
+        uint32_t j = 1;
+        for(; j < length; j++) {
+            const char* op = operators[(i + j) % (sizeof(operators)/sizeof(operators[0]))];
+            if(j % 3 == 0) {
+                src = sdscatprintf(src, " %s (b %s %u)", op, operators[j % 3], j);
+            }
+            else {
+                src = sdscatprintf(src, " %s %u", op, j);
+            }
+        }
+        src = sdscat(src, "\n");
+        // comparisons and calls
+        src = sdscatprintf(src, "fn cmp%u(a: u32, b: u32) -> bool = (a < b) && (a + 1 > b - %u) || a <= b\n", i, i);
+        src = sdscatprintf(src, "expr%u(%u, %u)\n\n", i, i, i + 1);
+    }
+    return src;
+}
+
+sds bench_gen_library(uint32_t count, uint32_t statements) {
+    sds src = sdsempty();
+    uint32_t i = 0;
+    for(; i < count; i++) {
+        src = sdscatprintf(src, "fn lib%u(a: u32, b: u32) -> u32 {\n    let v0: u32 = a + b\n", i);
+        uint32_t j = 1;
+        for(; j < statements; j++) {
+            src = sdscatprintf(src, "    let v%u: u32 = v%u * %u + (a - b)\n", j, j - 1, j);
+        }
+        src = sdscatprintf(src, "    if v%u > a {\n        return v%u\n    }\n    else {\n        return a\n    }\n}\n\n",
+                           statements - 1, statements - 1);
+    }
+    return src;
+}
+
+sds bench_gen_generics(uint32_t count) {
+    sds src = sdsempty();
+    uint32_t i = 0;
+    for(; i < count; i++) {
+        src = sdscatprintf(src,
+                           "type Box%u<T> = struct {\n"
+                           "    value: T,\n"
+                           "    values: T[]\n"
+                           "}\n\n"
+                           "type Pair%u<K, V> = struct {\n"
+                           "    key: K,\n"
+                           "    value: Box%u<V>\n"
+                           "}\n\n", i, i, i);
+
+        src = sdscatprintf(src,
+                           "fn identity%u<T>(x: T) -> T = x\n"
+                           "fn first%u<K, V>(p: Pair%u<K, V>) -> K = p\n", i, i, i);
+
+        src = sdscatprintf(src,
+                           "identity%u<u32>(%u)\n"
+                           "identity%u<Box%u<f32> >(identity%u<u32>(%u))\n\n", i, i, i, i, i, i);
+    }
+    return src;
+}
+
+sds bench_gen_externs(uint32_t count, uint32_t methods) {
+    sds src = sdsempty();
+    uint32_t i = 0;
+    for(; i < count; i++) {
+        src = sdscatprintf(src, "extern \"C\" Lib%u {\n", i);
+        uint32_t j = 0;
+        for(; j < methods; j++) {
+            src = sdscatprintf(src, "    fn fun%u_%u(x: %s, y: ptr<u8>, n: u64) -> %s%s\n", i, j,
+                               bench_primitives[j % BENCH_PRIMITIVES_COUNT],
+                               bench_primitives[(i + j) % BENCH_PRIMITIVES_COUNT],
+                               j + 1 < methods ? "," : "");
+        }
+        src = sdscat(src, "}\n\n");
+    }
+    return src;
+}
+
+sds bench_gen_deep(uint32_t count, uint32_t depth) {
+    // precedence levels alternate, so every level of the parser is chained
+    static const char* operators[] = {"+", "*", "-", "&&", "|", "==", "<<", "&", "^", "||"};
+    sds src = sdsempty();
+    uint32_t i = 0;
+    for(; i < count; i++) {
+        sds chain = sdsempty();
+        uint32_t j = 1;
+        for(; j <= depth; j++) {
+            chain = sdscatprintf(chain, " %s %u", operators[j % (sizeof(operators)/sizeof(operators[0]))], j);
+        }
+        src = sdscatprintf(src, "fn deep%u(a: u32) -> u32 = a%s\n", i, chain);
+        src = sdscatprintf(src, "let a%u: u32 = %u\na%u%s\n\n", i, i, i, chain);
+        sdsfree(chain);
+    }
+    return src;
+}
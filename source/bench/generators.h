@@ -0,0 +1,63 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_GENERATORS_H
+#define TYPE_C_GENERATORS_H
+
+#include <stdint.h>
+#include "../utils/sds.h"
+
+/**
+ * Synthetic programs used by type_c_bench.
+ * Every generator returns a new sds string holding a valid program.
+ */
+
+/**
+ * Struct, enum, interface and variant declarations
+ * @param count number of each kind
+ */
+sds bench_gen_types(uint32_t count);
+
+/**
+ * `width` interface chains, each `depth` deep, and a class implementing every level
+ * @param depth
+ * @param width
+ */
+sds bench_gen_hierarchy(uint32_t depth, uint32_t width);
+
+/**
+ * Functions whose bodies are long arithmetic/comparison chains, each followed by a call
+ * @param count number of functions
+ * @param length number of operands per expression
+ */
+sds bench_gen_expressions(uint32_t count, uint32_t length);
+
+/**
+ * Generic types and functions, with generic calls
+ * @param count
+ */
+sds bench_gen_generics(uint32_t count);
+
+/**
+ * Functions with block bodies, each a sequence of lets and an if/else chain
+ * @param count number of functions
+ * @param statements statements per body
+ */
+sds bench_gen_library(uint32_t count, uint32_t statements);
+
+/**
+ * extern "C" blocks
+ * @param count number of blocks
+ * @param methods methods per block
+ */
+sds bench_gen_externs(uint32_t count, uint32_t methods);
+
+/**
+ * Single expressions `depth` operations deep, as function bodies and top-level statements
+ * @param count number of functions
+ * @param depth number of operations per expression
+ */
+sds bench_gen_deep(uint32_t count, uint32_t depth);
+
+#endif //TYPE_C_GENERATORS_H
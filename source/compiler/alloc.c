@@ -0,0 +1,134 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+// this file calls the C library itself
+#define TYPE_C_ALLOC_IMPL
+#include "alloc.h"
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+#undef strdup
+#undef strndup
+
+static __thread AllocArena* alloc_currentArena = NULL;
+
+AllocArena* alloc_arena_make(void) {
+    AllocArena* arena = malloc(sizeof(AllocArena));
+    pthread_mutex_init(&arena->lock, NULL);
+    arena->blocks.prev = &arena->blocks;
+    arena->blocks.next = &arena->blocks;
+    arena->blocks.arena = arena;
+    arena->count = 0;
+    arena->bytes = 0;
+    return arena;
+}
+
+void alloc_arena_free(AllocArena* arena) {
+    AllocBlock* block = arena->blocks.next;
+    while(block != &arena->blocks) {
+        AllocBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    pthread_mutex_destroy(&arena->lock);
+    free(arena);
+}
+
+AllocArena* alloc_enter(AllocArena* arena) {
+    AllocArena* previous = alloc_currentArena;
+    alloc_currentArena = arena;
+    return previous;
+}
+
+AllocArena* alloc_current(void) {
+    return alloc_currentArena;
+}
+
+static void alloc_link(AllocBlock* block, AllocArena* arena, size_t size) {
+    block->arena = arena;
+    block->size = size;
+    if(arena == NULL) {
+        block->prev = block->next = NULL;
+        return;
+    }
+    pthread_mutex_lock(&arena->lock);
+    block->prev = &arena->blocks;
+    block->next = arena->blocks.next;
+    arena->blocks.next->prev = block;
+    arena->blocks.next = block;
+    arena->count++;
+    arena->bytes += size;
+    pthread_mutex_unlock(&arena->lock);
+}
+
+static void alloc_unlink(AllocBlock* block) {
+    AllocArena* arena = block->arena;
+    if(arena == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&arena->lock);
+    block->prev->next = block->next;
+    block->next->prev = block->prev;
+    arena->count--;
+    arena->bytes -= block->size;
+    pthread_mutex_unlock(&arena->lock);
+}
+
+void* alloc_malloc(size_t size) {
+    AllocBlock* block = malloc(sizeof(AllocBlock) + size);
+    if(block == NULL) {
+        return NULL;
+    }
+    alloc_link(block, alloc_currentArena, size);
+    return block + 1;
+}
+
+void* alloc_calloc(size_t count, size_t size) {
+    void* ptr = alloc_malloc(count * size);
+    if(ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void* alloc_realloc(void* ptr, size_t size) {
+    if(ptr == NULL) {
+        return alloc_malloc(size);
+    }
+    // the block stays with its arena, whichever thread grows it
+    AllocBlock* block = (AllocBlock*)ptr - 1;
+    AllocArena* arena = block->arena;
+    alloc_unlink(block);
+    AllocBlock* grown = realloc(block, sizeof(AllocBlock) + size);
+    if(grown == NULL) {
+        alloc_link(block, arena, block->size);
+        return NULL;
+    }
+    alloc_link(grown, arena, size);
+    return grown + 1;
+}
+
+void alloc_free(void* ptr) {
+    if(ptr == NULL) {
+        return;
+    }
+    AllocBlock* block = (AllocBlock*)ptr - 1;
+    alloc_unlink(block);
+    free(block);
+}
+
+char* alloc_strdup(const char* s) {
+    return alloc_strndup(s, strlen(s));
+}
+
+char* alloc_strndup(const char* s, size_t n) {
+    size_t len = strnlen(s, n);
+    char* copy = alloc_malloc(len + 1);
+    if(copy != NULL) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
@@ -0,0 +1,83 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_ALLOC_H
+#define TYPE_C_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * Allocation arenas, which own every block allocated while they are entered on a thread.
+ * The AST has no destructor and its nodes are shared freely, so an embedder compiling many
+ * files in one process releases a whole compilation at once, with alloc_arena_free.
+ * Blocks are still released one by one by the code which frees them.
+ *
+ * Sources are routed through here when built with TYPE_C_ARENA, with this header included
+ * first. Other builds use the C library directly, and nothing ever enters an arena.
+ */
+
+typedef struct AllocBlock {
+    struct AllocBlock* prev;
+    struct AllocBlock* next;
+    struct AllocArena* arena;
+    // keeps the payload aligned on 16 bytes
+    size_t size;
+}AllocBlock;
+
+typedef struct AllocArena {
+    // several workers of a compilation may allocate at once
+    pthread_mutex_t lock;
+    // sentinel of the list of live blocks
+    AllocBlock blocks;
+    uint64_t count;
+    uint64_t bytes;
+}AllocArena;
+
+AllocArena* alloc_arena_make(void);
+
+/**
+ * Releases the arena and every block it still owns
+ * @param arena
+ */
+void alloc_arena_free(AllocArena* arena);
+
+/**
+ * Makes the arena own what the calling thread allocates from now on
+ * @param arena NULL to leave any arena
+ * @return the arena entered before, to be restored
+ */
+AllocArena* alloc_enter(AllocArena* arena);
+
+/**
+ * @return the arena entered on the calling thread, NULL if none
+ */
+AllocArena* alloc_current(void);
+
+void* alloc_malloc(size_t size);
+void* alloc_calloc(size_t count, size_t size);
+void* alloc_realloc(void* ptr, size_t size);
+void alloc_free(void* ptr);
+char* alloc_strdup(const char* s);
+char* alloc_strndup(const char* s, size_t n);
+
+#if defined(TYPE_C_ARENA) && !defined(TYPE_C_ALLOC_IMPL)
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+#undef strdup
+#undef strndup
+#define malloc(size) alloc_malloc(size)
+#define calloc(count, size) alloc_calloc(count, size)
+#define realloc(ptr, size) alloc_realloc(ptr, size)
+#define free(ptr) alloc_free(ptr)
+#define strdup(s) alloc_strdup(s)
+#define strndup(s, n) alloc_strndup(s, n)
+#endif
+
+#endif //TYPE_C_ALLOC_H
@@ -76,6 +76,7 @@ PtrType * ast_type_makePtr() {
 ReferenceType* ast_type_makeReference() {
     ALLOC(ref, ReferenceType);
     ref->ref = NULL;
+    ref->pkg = NULL;
 
     return ref;
 }
@@ -84,6 +85,8 @@ JoinType* ast_type_makeJoin() {
     ALLOC(join, JoinType);
     join->left = NULL;
     join->right = NULL;
+    vec_small_init(&join->members);
+    join->kinds = 0;
 
     return join;
 }
@@ -92,14 +95,15 @@ UnionType* ast_type_makeUnion() {
     ALLOC(uni, UnionType);
     uni->left = NULL;
     uni->right = NULL;
+    vec_small_init(&uni->members);
+    uni->kinds = 0;
 
     return uni;
 }
 
 VariantType* ast_type_makeVariant(struct ASTScope* parentScope){
     ALLOC(data, VariantType);
-    map_init(&data->constructors);
-    vec_init(&data->constructorNames);
+    omap_init(&data->constructors);
     data->scope = ast_scope_makeScope(parentScope);
 
     return data;
@@ -108,9 +112,8 @@ VariantType* ast_type_makeVariant(struct ASTScope* parentScope){
 InterfaceType* ast_type_makeInterface(ASTScope* parentScope) {
     ALLOC(interface, InterfaceType);
     interface->scope = ast_scope_makeScope(parentScope);
-    map_init(&interface->methods);
-    vec_init(&interface->methodNames);
-    vec_init(&interface->extends);
+    omap_init(&interface->methods);
+    vec_small_init(&interface->extends);
 
     return interface;
 }
@@ -121,20 +124,19 @@ ClassType* ast_type_makeClass(ASTScope* parentScope, DataType * classType) {
     class->scope->withinClass = 1;
     class->scope->classRef = classType;
 
-    map_init(&class->methods);
+    omap_init(&class->methods);
     //map_init(&class->attributes);
-    //vec_init(&class->attributeNames);
-    vec_init(&class->methodNames);
     vec_init(&class->letList);
+    vec_small_init(&class->extends);
 
     return class;
 }
 
 FnType* ast_type_makeFn() {
     ALLOC(fn, FnType);
-    map_init(&fn->args);
-    vec_init(&fn->argNames);
+    omap_init(&fn->args);
     fn->returnType = NULL;
+    fn->header = NULL;
 
     return fn;
 }
@@ -142,9 +144,8 @@ FnType* ast_type_makeFn() {
 StructType* ast_type_makeStruct(ASTScope* parentScope) {
     ALLOC(struct_, StructType);
     struct_->scope = ast_scope_makeScope(parentScope);
-    map_init(&struct_->attributes);
-    vec_init(&struct_->attributeNames);
-    vec_init(&struct_->extends);
+    omap_init(&struct_->attributes);
+    vec_small_init(&struct_->extends);
 
     return struct_;
 }
@@ -158,10 +159,11 @@ DataType* ast_type_makeType(struct ASTScope* parentScope, Lexeme lexeme, DataTyp
     type->isNullable = 0;
     type->kind = kind;
     type->classType = NULL;
-    vec_init(&type->genericRefs);
-    vec_init(&type->genericNames);
+    vec_small_init(&type->genericRefs);
+    vec_small_init(&type->genericNames);
     map_init(&type->generics);
     type->lexeme = lexeme;
+    type->description = NULL;
 
     return type;
 }
@@ -192,8 +194,7 @@ VariantConstructorArgument * ast_type_makeVariantConstructorArgument() {
 
 VariantConstructor* ast_type_makeVariantConstructor(){
     ALLOC(constructor, VariantConstructor);
-    map_init(&constructor->args);
-    vec_init(&constructor->argNames);
+    omap_init(&constructor->args);
 
     return constructor;
 }
@@ -205,7 +206,7 @@ FnHeader*  ast_makeFnHeader(){
     header->isGeneric = 0;
 
     // init vec and map
-    vec_init(&header->genericNames);
+    vec_small_init(&header->genericNames);
     map_init(&header->generics);
 
     return header;
@@ -237,8 +238,7 @@ GenericParam* ast_make_genericParam() {
 
 ProcessType* ast_type_makeProcess(){
     ALLOC(process, ProcessType);
-    vec_init(&process->argNames);
-    map_init(&process->args);
+    omap_init(&process->args);
     process->inputType = NULL;
     process->outputType = NULL;
     process->body = NULL;
@@ -273,7 +273,7 @@ BinaryExpr* ast_expr_makeBinaryExpr(BinaryExprType type, struct Expr *left, stru
 NewExpr* ast_expr_makeNewExpr(DataType *type){
     ALLOC(new, NewExpr);
     new->type = type;
-    vec_init(&new->args);
+    vec_small_init(&new->args);
 
     return new;
 }
@@ -281,9 +281,9 @@ NewExpr* ast_expr_makeNewExpr(DataType *type){
 CallExpr* ast_expr_makeCallExpr(struct Expr *lhs){
     ALLOC(call, CallExpr);
     call->lhs = lhs;
-    vec_init(&call->args);
+    vec_small_init(&call->args);
     call->hasGenerics = 0;
-    vec_init(&call->generics);
+    vec_small_init(&call->generics);
 
     return call;
 }
@@ -356,6 +356,7 @@ LetExpr* ast_expr_makeLetExpr(ASTScope* parentScope){
 
 ArrayConstructionExpr * ast_expr_makeArrayConstructionExpr(){
     ALLOC(array, ArrayConstructionExpr);
+    array->expectedType = NULL;
     vec_init(&array->args);
 
     return array;
@@ -364,8 +365,7 @@ ArrayConstructionExpr * ast_expr_makeArrayConstructionExpr(){
 NamedStructConstructionExpr * ast_expr_makeNamedStructConstructionExpr(){
 ALLOC(struct_, NamedStructConstructionExpr);
     struct_->type = NULL;
-    map_init(&struct_->args);
-    vec_init(&struct_->argNames);
+    omap_init(&struct_->args);
 
     return struct_;
 }
@@ -382,8 +382,7 @@ UnnamedStructConstructionExpr * ast_expr_makeUnnamedStructConstructionExpr(){
 LetExprDecl* ast_expr_makeLetExprDecl(){
     ALLOC(decls, LetExprDecl);
     decls->initializerType = LIT_NONE;
-    vec_init(&decls->variableNames);
-    map_init(&decls->variables);
+    omap_init(&decls->variables);
     decls->initializer = NULL;
 
     return decls;
@@ -459,6 +458,7 @@ Expr* ast_expr_makeExpr(ExpressionType type, Lexeme lexeme){
     expr->type = type;
     expr->literalExpr = NULL;
     expr->dataType = NULL;
+    expr->inferred = 0;
     expr->lexeme = lexeme;
 
     return expr;
@@ -466,6 +466,9 @@ Expr* ast_expr_makeExpr(ExpressionType type, Lexeme lexeme){
 
 ASTScope * ast_scope_makeScope(ASTScope* parentScope){
     ALLOC(scope, ASTScope);
+    scope->isFn = 0;
+    scope->fnHeader = NULL;
+    scope->classRef = NULL;
     scope->isSafe = (parentScope == NULL) ? 1 : parentScope->isSafe;
     scope->withinClass = (parentScope == NULL) ? 0 : parentScope->withinClass;
     scope->withinSync = (parentScope == NULL) ? 0 : parentScope->withinSync;
@@ -481,7 +484,7 @@ ASTScope * ast_scope_makeScope(ASTScope* parentScope){
 
 
     map_init(&scope->generics);
-    vec_init(&scope->genericNames);
+    vec_small_init(&scope->genericNames);
     return scope;
 }
 
@@ -489,8 +492,7 @@ ExternDecl* ast_externdecl_make(){
     ALLOC(externDecl, ExternDecl);
     externDecl->name = NULL;
     externDecl->linkage = "C";
-    vec_init(&externDecl->methodNames);
-    map_init(&externDecl->methods);
+    omap_init(&externDecl->methods);
 
     return externDecl;
 }
@@ -518,6 +520,7 @@ FnDeclStatement* ast_stmt_makeFnDeclStatement(ASTScope* parentScope){
     fnDecl->scope = ast_scope_makeScope(parentScope);
     fnDecl->bodyType = FBT_BLOCK;
     fnDecl->expr = NULL;
+    fnDecl->deferredBody = NULL;
     fnDecl->scope->isFn = 1;
     fnDecl->scope->withinFn = 1;
     fnDecl->scope->fnHeader = fnDecl->header;
@@ -581,7 +584,7 @@ ForStatement* ast_stmt_makeForStatement(ASTScope* parentScope){
     forStmt->block = NULL;
     forStmt->scope->withinLoop = 1;
     // init increments
-    vec_init(&forStmt->increments);
+    vec_small_init(&forStmt->increments);
     forStmt->label = NULL;
 
     return forStmt;
@@ -7,6 +7,7 @@
 
 #include "../utils/vec.h"
 #include "../utils/map.h"
+#include "../utils/omap.h"
 #include "tokens.h"
 #include "lexer.h"
 
@@ -30,6 +31,7 @@ struct StructAttribute;
 struct FnArgument;
 struct GenericParam;
 struct UnresolvedType;
+struct UnresolvedParent;
 struct LetExprDecl;
 struct FnHeader;
 
@@ -60,9 +62,19 @@ typedef map_t(struct FnHeader*) mat_fnheader_t;
 typedef map_t(struct ExternDecl*) map_externdecl_t;
 typedef map_t(struct GenericParam*) map_genericparam_t;
 
+// members and arguments, in declaration order
+typedef omap_t(struct FnHeader*) omap_interfacemethod_t;
+typedef omap_t(struct ClassMethod*) omap_classmethod_t;
+typedef omap_t(struct StructAttribute*) omap_structattribute_t;
+typedef omap_t(struct FnArgument*) omap_fnargument_t;
+typedef omap_t(struct VariantConstructorArgument*) omap_variantconstructorarg_t;
+typedef omap_t(struct VariantConstructor*) omap_variantconstructor_t;
+typedef omap_t(struct Expr*) omap_expr_t;
+
 typedef vec_t(struct GenericParam*) vec_genericparam_t;
 typedef vec_t(struct DataType*) vec_dtype_t;
 typedef vec_t(struct UnresolvedType) vec_unresolvedtype_t;
+typedef vec_t(struct UnresolvedParent) vec_unresolvedparent_t;
 
 /* Expressions */
 typedef vec_t(struct Expr*) vec_expr_t;
@@ -73,6 +85,11 @@ typedef vec_t(struct BlockStatement*) vec_blockstatement_t;
 typedef vec_t(struct CaseStatement*) vec_casestatement_t;
 typedef vec_t(struct ExternDecl*) vec_externdecl_t;
 
+// lists which rarely hold more than a few elements, kept inline until they do
+typedef vec_small_t(struct DataType*, 2) vec_dtype_small_t;
+typedef vec_small_t(char*, 2) vec_str_small_t;
+typedef vec_small_t(struct Expr*, 4) vec_expr_small_t;
+
 
 /**
  * Enums of all possible type categories
@@ -98,6 +115,10 @@ typedef enum DataTypeKind {
     DT_INVALID // Used only for type checking
 }DataTypeKind;
 
+#define TYPE_KIND_BIT(kind) (1ULL << (kind))
+// i8 to char
+#define TYPE_KIND_PRIMITIVES (TYPE_KIND_BIT(DT_CHAR + 1) - 1)
+
 /** Array data type structure e.g u32[] */
 typedef struct ArrayType {
     uint64_t len;
@@ -123,59 +144,66 @@ typedef struct ReferenceType {
 }ReferenceType;
 ReferenceType* ast_type_makeReference();
 
+/**
+ * Joins and unions share the same layout, and are flattened the same way
+ * once both sides are known, see tc_flattenUnion
+ */
 typedef struct JoinType {
     struct DataType* left;
     struct DataType* right;
+    // nested joins spread, sorted by kind and without duplicates
+    vec_dtype_small_t members;
+    // one bit per DataTypeKind of the members, see TYPE_KIND_BIT
+    uint64_t kinds;
 }JoinType;
 JoinType* ast_type_makeJoin();
 
 typedef struct UnionType {
     struct DataType* left;
     struct DataType* right;
+    // nested unions spread, sorted by kind and without duplicates
+    vec_dtype_small_t members;
+    // one bit per DataTypeKind of the members, see TYPE_KIND_BIT
+    uint64_t kinds;
 }UnionType;
 UnionType* ast_type_makeUnion();
 
 typedef struct VariantType {
-    map_variantconstructor_t constructors;
-    vec_str_t  constructorNames;
+    omap_variantconstructor_t constructors;
     struct ASTScope* scope;
 }VariantType;
 VariantType* ast_type_makeVariant(struct ASTScope* parentScope);
 
 typedef struct InterfaceType {
-    map_interfacemethod_t methods;
-    vec_str_t  methodNames;
-    vec_dtype_t extends;
+    omap_interfacemethod_t methods;
+    vec_dtype_small_t extends;
     struct ASTScope* scope;
 }InterfaceType;
 InterfaceType* ast_type_makeInterface(struct ASTScope* parentScope);
 
 typedef struct ClassType {
     //map_classattribute_t attributes;
-    map_classmethod_t methods;
+    // ordered, important for layout management
+    omap_classmethod_t methods;
 
-    // important for layout management
-    //vec_str_t attributeNames;
-    vec_str_t methodNames;
-
-    vec_dtype_t extends;
+    vec_dtype_small_t extends;
     vec_letexprlist_t letList;
     struct ASTScope* scope;
 }ClassType;
 ClassType* ast_type_makeClass(struct ASTScope* parentScope, struct DataType * classType);
 
 typedef struct FnType {
-    map_fnargument_t args;
-    vec_str_t argNames;
+    omap_fnargument_t args;
     struct DataType* returnType;
+    // declaration it was made from, NULL for a function type written as such
+    struct FnHeader* header;
 }FnType;
 FnType* ast_type_makeFn();
 
 typedef struct StructType {
-    map_structattribute_t attributes;
-    // important for layout management
-    vec_str_t attributeNames;
-    vec_dtype_t extends;
+    // ordered, important for layout management
+    omap_structattribute_t attributes;
+    vec_dtype_small_t extends;
     struct ASTScope* scope;
 }StructType;
 StructType* ast_type_makeStruct(struct ASTScope* parentScope);
@@ -188,8 +216,7 @@ typedef struct GenericParam {
 GenericParam* ast_make_genericParam();
 
 typedef struct ProcessType {
-    vec_str_t argNames;
-    map_fnargument_t args;
+    omap_fnargument_t args;
     struct DataType* inputType;
     struct DataType* outputType;
     struct Statement* body;
@@ -204,11 +231,11 @@ typedef struct DataType {
     uint8_t isNullable;
 
     // when hasGeneric = true
-    vec_dtype_t genericRefs;
+    vec_dtype_small_t genericRefs;
 
     // when isGeneric = true
     map_genericparam_t generics;
-    vec_str_t genericNames;
+    vec_str_small_t genericNames;
 
     union {
         ClassType * classType;
@@ -226,6 +253,8 @@ typedef struct DataType {
     };
     struct ASTScope* scope;
     Lexeme lexeme;
+    // set once described, see describeType
+    char* description;
 }DataType;
 DataType* ast_type_makeType(struct ASTScope* parentScope, Lexeme lexeme, DataTypeKind kind);
 
@@ -237,8 +266,7 @@ VariantConstructorArgument * ast_type_makeVariantConstructorArgument();
 
 typedef struct VariantConstructor {
     char* name;
-    vec_str_t argNames;
-    map_variantconstructorarg_t args;
+    omap_variantconstructorarg_t args;
 }VariantConstructor;
 VariantConstructor* ast_type_makeVariantConstructor();
 
@@ -261,7 +289,7 @@ typedef struct FnHeader {
 
     // when isGeneric = true
     map_genericparam_t generics;
-    vec_str_t genericNames;
+    vec_str_small_t genericNames;
 } FnHeader;
 FnHeader*  ast_makeFnHeader();
 
@@ -308,8 +336,7 @@ typedef vec_t(ImportStmt*) import_stmt_vec;
 typedef struct ExternDecl {
     char* name;
     char* linkage;
-    map_interfacemethod_t methods;
-    vec_str_t  methodNames;
+    omap_interfacemethod_t methods;
 }ExternDecl;
 ExternDecl* ast_externdecl_make();
 
@@ -326,7 +353,7 @@ typedef struct ASTScope {
     map_dtype_t dataTypes;                   // data types declared in this scope
     map_externdecl_t externDecls;            // extern declarations
 
-    vec_str_t genericNames;                  // generic names declared in this scope
+    vec_str_small_t genericNames;            // generic names declared in this scope
     map_genericparam_t generics;             // generic parameters declared in this scope
 
     FnHeader* fnHeader;                      // function header, if is a function
@@ -342,6 +369,17 @@ typedef struct UnresolvedType{
     ASTScope* scope;
 }UnresolvedType;
 
+// a parent in the extends list of a type. it may be declared later, in another chunk or in
+// another module, so it is checked and added to the type once references can be bound
+typedef struct UnresolvedParent{
+    DataType* child;
+    DataType* parent;
+    ASTScope* scope;
+    DataTypeKind kind;
+    // first token of the parent, where errors are reported
+    Lexeme lexeme;
+}UnresolvedParent;
+
 typedef struct ASTProgramNode {
     ASTScope * scope;
     vec_statement_t stmts;
@@ -432,16 +470,16 @@ BinaryExpr* ast_expr_makeBinaryExpr(BinaryExprType type, struct Expr *left, stru
 // new x()
 typedef struct NewExpr {
     DataType *type;
-    vec_expr_t args;
+    vec_expr_small_t args;
 }NewExpr;
 NewExpr* ast_expr_makeNewExpr(DataType *type);
 
 // x()
 typedef struct CallExpr {
     struct Expr *lhs;
-    vec_expr_t args;
+    vec_expr_small_t args;
     uint8_t hasGenerics;
-    vec_dtype_t generics;
+    vec_dtype_small_t generics;
 }CallExpr;
 CallExpr* ast_expr_makeCallExpr(struct Expr *lhs);
 
@@ -503,8 +541,7 @@ typedef enum LetInitializerType {
 
 typedef struct LetExprDecl {
     LetInitializerType initializerType;
-    vec_str_t variableNames;
-    map_fnargument_t variables;
+    omap_fnargument_t variables;
     struct Expr *initializer;
 }LetExprDecl;
 LetExprDecl* ast_expr_makeLetExprDecl();
@@ -518,15 +555,15 @@ typedef struct LetExpr {
 LetExpr* ast_expr_makeLetExpr(ASTScope* parentScope);
 
 typedef struct ArrayConstructionExpr {
-    //DataType *type;
+    // type the array is checked against, set before it is inferred, see ti_check_expr
+    DataType* expectedType;
     vec_expr_t args;
 }ArrayConstructionExpr;
 ArrayConstructionExpr * ast_expr_makeArrayConstructionExpr();
 
 typedef struct NamedStructConstructionExpr {
     DataType *type;
-    vec_str_t argNames;
-    mat_expr_t args;
+    omap_expr_t args;
 }NamedStructConstructionExpr;
 NamedStructConstructionExpr * ast_expr_makeNamedStructConstructionExpr();
 
@@ -612,6 +649,8 @@ typedef enum ExpressionType {
 typedef struct Expr {
     ExpressionType type;
     DataType* dataType;
+    // query revision + 1 at which dataType was inferred, 0 if it was not, see query_typeOf
+    uint32_t inferred;
     union {
         ArrayConstructionExpr * arrayConstructionExpr;
         NamedStructConstructionExpr * namedStructConstructionExpr;
@@ -652,6 +691,16 @@ typedef struct VarDeclStatement {
 }VarDeclStatement;
 VarDeclStatement* ast_stmt_makeVarDeclStatement(ASTScope* parentScope);
 
+// text of a block body whose parsing was deferred, see parser_parseFnBody
+typedef struct FnBodySource {
+    char* filename;
+    // from `{` to the matching `}`
+    char* text;
+    // position of the `{`
+    uint32_t line;
+    uint32_t col;
+}FnBodySource;
+
 typedef struct FnDeclStatement {
     FnHeader * header;
     FnBodyType bodyType;
@@ -659,6 +708,8 @@ typedef struct FnDeclStatement {
         struct Expr *expr;
         struct Statement *block;
     };
+    // set instead of block when the body was skipped
+    FnBodySource* deferredBody;
     ASTScope * scope;
     DataType* dataType;
 }FnDeclStatement;
@@ -704,7 +755,7 @@ typedef struct ForStatement {
     char* label;
     struct Statement *initializer;
     struct Expr *condition;
-    vec_expr_t increments;
+    vec_expr_small_t increments;
     struct Statement *block;
     ASTScope * scope;
 }ForStatement;
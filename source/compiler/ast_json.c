@@ -2,13 +2,16 @@
 // Created by praisethemoon on 05.05.23.
 //
 
+#include <string.h>
 #include "ast_json.h"
 #include "ast.h"
+#include "ast_walk.h"
 #include "../utils/parson.h"
 #include "../utils/vec.h"
 #include "../utils/map.h"
 #include "../utils/sds.h"
 #include "error.h"
+#include "parser_utils.h"
 
 char* ast_stringifyUnaryExprType(UnaryExprType type){
     switch (type) {
@@ -136,6 +139,7 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
         json_object_set_string(root_object, "name", type->name);
     else
         json_object_set_null(root_object, "name");
+    json_object_set_string(root_object, "description", describeType(type));
     // set isNullable
     json_object_set_boolean(root_object, "isNullable", type->isNullable);
     // set hasGeneric
@@ -305,8 +309,8 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
             char* methodName;
             // iterate over the methods
 
-            vec_foreach(&type->classType->methodNames, methodName, i){
-                ClassMethod ** function = map_get(&type->classType->methods, methodName);
+            omap_foreach_key(&type->classType->methods, methodName, i){
+                ClassMethod ** function = omap_get(&type->classType->methods, methodName);
                 FnDeclStatement* fnDecl = (*function)->decl;
                 // create the object to hold method decl
                 JSON_Value* method_value = json_value_init_object();
@@ -354,8 +358,8 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
                 JSON_Array * args_array = json_value_get_array(args_value);
                 // iterate over the args
                 char * argName;
-                vec_foreach(&fnDecl->header->type->argNames, argName, i) {
-                        FnArgument** arg = map_get(&fnDecl->header->type->args, argName);
+                omap_foreach_key(&fnDecl->header->type->args, argName, i) {
+                        FnArgument** arg = omap_get(&fnDecl->header->type->args, argName);
                         // create an arg object
                         JSON_Value * arg_value = json_value_init_object();
                         JSON_Object * arg_object = json_value_get_object(arg_value);
@@ -376,6 +380,9 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
                 // if body type is expression we set expr
                 if (fnDecl->bodyType == FBT_EXPR)
                     json_object_set_value(method_object, "expr", ast_json_serializeExprRecursive(fnDecl->expr));
+                // skipped by a lazy parse
+                else if (fnDecl->deferredBody != NULL)
+                    json_object_set_boolean(method_object, "deferred", 1);
                 else
                     json_object_set_value(method_object, "block", ast_json_serializeStatementRecursive(fnDecl->block));
 
@@ -406,7 +413,7 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
             JSON_Array* methods_array = json_value_get_array(methods_value);
             // iterate over the methods
             char * methodName;
-            vec_foreach(&type->interfaceType->methodNames, methodName, i){
+            omap_foreach_key(&type->interfaceType->methods, methodName, i){
                 // we want to create an object {"name": <name>, "args": [<args>], "returnType": <returnType>}
                 JSON_Value* method_value = json_value_init_object();
                 JSON_Object* method_object = json_value_get_object(method_value);
@@ -416,10 +423,10 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
                 JSON_Value* args_value = json_value_init_array();
                 JSON_Array* args_array = json_value_get_array(args_value);
                 // iterate over the args
-                FnHeader ** function = map_get(&type->interfaceType->methods, methodName);
+                FnHeader ** function = omap_get(&type->interfaceType->methods, methodName);
                 uint32_t j; char* argName;
-                vec_foreach(&(*function)->type->argNames, argName, j) {
-                    FnArgument ** argType = map_get(&(*function)->type->args, argName);
+                omap_foreach_key(&(*function)->type->args, argName, j) {
+                    FnArgument ** argType = omap_get(&(*function)->type->args, argName);
                     // we want to create an object {"name": <name>, "type": <type>}
                     JSON_Value* arg_value = json_value_init_object();
                     JSON_Object* arg_object = json_value_get_object(arg_value);
@@ -454,14 +461,14 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
             // iterate over the fields
             char *fieldName;
             uint32_t i;
-            vec_foreach(&type->structType->attributeNames, fieldName, i) {
+            omap_foreach_key(&type->structType->attributes, fieldName, i) {
                     // we want to create an object {"name": <name>, "type": <type>}
                     JSON_Value *field_value = json_value_init_object();
                     JSON_Object *field_object = json_value_get_object(field_value);
                     // add the name
                     json_object_set_string(field_object, "name", fieldName);
                     // add the type
-                    StructAttribute ** att = map_get(&type->structType->attributes, fieldName);
+                    StructAttribute ** att = omap_get(&type->structType->attributes, fieldName);
                     json_object_set_value(field_object, "type",
                                           ast_json_serializeDataTypeRecursive((*att)->type));
                     // add the field
@@ -507,22 +514,22 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
             // iterate over the fields
             char *variantName;
             uint32_t i;
-            vec_foreach(&type->variantType->constructorNames, variantName, i) {
+            omap_foreach_key(&type->variantType->constructors, variantName, i) {
                     // we want to create an object {"name": <name>, "type": <type>}
                     JSON_Value *variant_value = json_value_init_object();
                     JSON_Object *variant_object = json_value_get_object(variant_value);
                     // add the name
                     json_object_set_string(variant_object, "name", variantName);
                     // add the type
-                    VariantConstructor **variant = map_get(&type->variantType->constructors, variantName);
+                    VariantConstructor **variant = omap_get(&type->variantType->constructors, variantName);
                     // each constructor has args
                     JSON_Value *args_value = json_value_init_array();
                     JSON_Array *args_array = json_value_get_array(args_value);
                     // iterate over the args
                     char *argName;
                     uint32_t j;
-                    vec_foreach(&(*variant)->argNames, argName, j) {
-                            VariantConstructorArgument **argType = map_get(&(*variant)->args, argName);
+                    omap_foreach_key(&(*variant)->args, argName, j) {
+                            VariantConstructorArgument **argType = omap_get(&(*variant)->args, argName);
                             // we want to create an object {"name": <name>, "type": <type>}
                             JSON_Value *arg_value = json_value_init_object();
                             JSON_Object *arg_object = json_value_get_object(arg_value);
@@ -572,14 +579,14 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
             // iterate over the args
             char *argName;
             uint32_t i = 0;
-            vec_foreach(&type->fnType->argNames, argName, i) {
+            omap_foreach_key(&type->fnType->args, argName, i) {
                 // we want to create an object {"name": <name>, "type": <type>}
                 JSON_Value *arg_value = json_value_init_object();
                 JSON_Object *arg_object = json_value_get_object(arg_value);
                 // add the name
                 json_object_set_string(arg_object, "name", argName);
                 // add the type
-                FnArgument ** arg = map_get(&type->fnType->args, argName);
+                FnArgument ** arg = omap_get(&type->fnType->args, argName);
                 json_object_set_value(arg_object, "type",
                                       ast_json_serializeDataTypeRecursive((*arg)->type));
                 // add isMutable
@@ -657,8 +664,8 @@ JSON_Value* ast_json_serializeDataTypeRecursive(DataType* type) {
             // iterate over the args
             char *argName;
             uint32_t i;
-            vec_foreach(&pt->argNames, argName, i) {
-                FnArgument ** arg = map_get(&pt->args, argName);
+            omap_foreach_key(&pt->args, argName, i) {
+                FnArgument ** arg = omap_get(&pt->args, argName);
                 // we want to create an object {"name": <name>, "type": <type>}
                 JSON_Value *arg_value = json_value_init_object();
                 JSON_Object *arg_object = json_value_get_object(arg_value);
@@ -709,7 +716,53 @@ char* literalTypeToString(LiteralType lt){
     }
 }
 
-JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
+/**
+ * Expressions and statements are serialized over ast_walk, so the depth of the tree does not grow
+ * the C stack. A node is serialized once left, from the values of its children, left before it.
+ */
+typedef struct AstJsonEntry {
+    void* node;
+    // NULL once taken by the parent
+    JSON_Value* value;
+}AstJsonEntry;
+
+typedef vec_t(AstJsonEntry) vec_jsonentry_t;
+
+typedef struct AstJsonSerializer {
+    // values of the nodes left whose parent is not left yet, in source order
+    vec_jsonentry_t values;
+    // length of values when each node being walked was entered, its children follow
+    vec_int_t marks;
+    // children of the node being left, see ast_json_take
+    int cursor;
+    int end;
+}AstJsonSerializer;
+
+/**
+ * Takes the value of a child of the node being left, children are taken in source order,
+ * those which are not serialized are skipped
+ * @return the value, a JSON null if the child is NULL
+ */
+static JSON_Value* ast_json_take(AstJsonSerializer* serializer, void* node) {
+    if(node == NULL) {
+        return json_value_init_null();
+    }
+    while(serializer->cursor < serializer->end) {
+        AstJsonEntry* entry = &serializer->values.data[serializer->cursor++];
+        if(entry->node == node) {
+            JSON_Value* value = entry->value;
+            entry->value = NULL;
+            return value;
+        }
+    }
+    ASSERT(0, "Child node was not walked before its parent");
+    return NULL;
+}
+
+#define ast_json_takeExpr(serializer, expr) ast_json_take(serializer, expr)
+#define ast_json_takeStatement(serializer, stmt) ast_json_take(serializer, stmt)
+
+static JSON_Value* ast_json_makeExpr(AstJsonSerializer* serializer, Expr* expr) {
     // create the root object
     JSON_Value * root_value = json_value_init_object();
     JSON_Object * root_object = json_value_get_object(root_value);
@@ -745,7 +798,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             int i; Expr * arg;
             ArrayConstructionExpr * arrayConstruction = expr->arrayConstructionExpr;
             vec_foreach(&arrayConstruction->args, arg, i) {
-                JSON_Value * v = ast_json_serializeExprRecursive(arg);
+                JSON_Value * v = ast_json_takeExpr(serializer, arg);
                 json_array_append_value(values_array, v);
             }
             // add the values
@@ -763,8 +816,8 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             int i;
             char *argName;
             NamedStructConstructionExpr *namedStructConstruction = expr->namedStructConstructionExpr;
-            vec_foreach(&namedStructConstruction->argNames, argName, i) {
-                Expr** arg = map_get(&namedStructConstruction->args, argName);
+            omap_foreach_key(&namedStructConstruction->args, argName, i) {
+                Expr** arg = omap_get(&namedStructConstruction->args, argName);
 
                 // for each arg, serialize it and add it to the fields object
                 JSON_Value *arg_value = json_value_init_object();
@@ -773,7 +826,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
                 // set the name
                 json_object_set_string(arg_object, "name", argName);
                 // set the value
-                json_object_set_value(arg_object, "value", ast_json_serializeExprRecursive(*arg));
+                json_object_set_value(arg_object, "value", ast_json_takeExpr(serializer, *arg));
                 // add to the array of fields
                 json_array_append_value(fields_array, arg_value);
             }
@@ -793,7 +846,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             Expr *arg;
             UnnamedStructConstructionExpr *unnamedStructConstruction = expr->unnamedStructConstructionExpr;
             vec_foreach(&unnamedStructConstruction->args, arg, i) {
-                    JSON_Value *v = ast_json_serializeExprRecursive(arg);
+                    JSON_Value *v = ast_json_takeExpr(serializer, arg);
                     json_array_append_value(values_array, v);
                 }
             // add the values
@@ -813,7 +866,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             int i;
             Expr *arg;
             vec_foreach(&expr->newExpr->args, arg, i) {
-                    JSON_Value *v = ast_json_serializeExprRecursive(arg);
+                    JSON_Value *v = ast_json_takeExpr(serializer, arg);
                     json_array_append_value(args_array, v);
                 }
             // add the args
@@ -839,14 +892,14 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             json_object_set_value(root_object, "generics", generics_value);
 
             // add the lhs
-            json_object_set_value(root_object, "lhs", ast_json_serializeExprRecursive(expr->callExpr->lhs));
+            json_object_set_value(root_object, "lhs", ast_json_takeExpr(serializer, expr->callExpr->lhs));
             // add the args
             JSON_Value * args_value = json_value_init_array();
             JSON_Array * args_array = json_value_get_array(args_value);
             // iterate over the args
             int i; Expr * arg;
             vec_foreach(&expr->callExpr->args, arg, i) {
-                JSON_Value * v = ast_json_serializeExprRecursive(arg);
+                JSON_Value * v = ast_json_takeExpr(serializer, arg);
                 json_array_append_value(args_array, v);
             }
             // add the args
@@ -858,9 +911,9 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // category = memberAccess
             json_object_set_string(root_object, "category", "memberAccess");
             // add the lhs
-            json_object_set_value(root_object, "lhs", ast_json_serializeExprRecursive(expr->memberAccessExpr->lhs));
+            json_object_set_value(root_object, "lhs", ast_json_takeExpr(serializer, expr->memberAccessExpr->lhs));
             // add the rhs
-            json_object_set_value(root_object, "rhs", ast_json_serializeExprRecursive(expr->memberAccessExpr->rhs));
+            json_object_set_value(root_object, "rhs", ast_json_takeExpr(serializer, expr->memberAccessExpr->rhs));
 
             break;
         }
@@ -868,14 +921,14 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // category = indexAccess
             json_object_set_string(root_object, "category", "indexAccess");
             // add the lhs
-            json_object_set_value(root_object, "lhs", ast_json_serializeExprRecursive(expr->indexAccessExpr->expr));
+            json_object_set_value(root_object, "lhs", ast_json_takeExpr(serializer, expr->indexAccessExpr->expr));
             // add the indexes
             JSON_Value * indexes_value = json_value_init_array();
             JSON_Array * indexes_array = json_value_get_array(indexes_value);
             // iterate over the indexes
             int i; Expr * index;
             vec_foreach(&expr->indexAccessExpr->indexes, index, i) {
-                JSON_Value * v = ast_json_serializeExprRecursive(index);
+                JSON_Value * v = ast_json_takeExpr(serializer, index);
                 json_array_append_value(indexes_array, v);
             }
             // add the indexes
@@ -889,7 +942,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // add the type
             json_object_set_value(root_object, "type", ast_json_serializeDataTypeRecursive(expr->castExpr->type));
             // add the expr
-            json_object_set_value(root_object, "expr", ast_json_serializeExprRecursive(expr->castExpr->expr));
+            json_object_set_value(root_object, "expr", ast_json_takeExpr(serializer, expr->castExpr->expr));
 
             break;
         }
@@ -899,7 +952,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // add the type
             json_object_set_value(root_object, "type", ast_json_serializeDataTypeRecursive(expr->instanceCheckExpr->type));
             // add the expr
-            json_object_set_value(root_object, "expr", ast_json_serializeExprRecursive(expr->instanceCheckExpr->expr));
+            json_object_set_value(root_object, "expr", ast_json_takeExpr(serializer, expr->instanceCheckExpr->expr));
 
             break;
         }
@@ -909,7 +962,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // add the op
             json_object_set_string(root_object, "op", ast_stringifyUnaryExprType(expr->unaryExpr->type));
             // add the expr
-            json_object_set_value(root_object, "uhs", ast_json_serializeExprRecursive(expr->unaryExpr->uhs));
+            json_object_set_value(root_object, "uhs", ast_json_takeExpr(serializer, expr->unaryExpr->uhs));
 
             break;
         }
@@ -919,20 +972,20 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // add the op
             json_object_set_string(root_object, "op", ast_stringifyBinaryExprType(expr->binaryExpr->type));
             // add the lhs
-            json_object_set_value(root_object, "lhs", ast_json_serializeExprRecursive(expr->binaryExpr->lhs));
+            json_object_set_value(root_object, "lhs", ast_json_takeExpr(serializer, expr->binaryExpr->lhs));
             // add the rhs
-            json_object_set_value(root_object, "rhs", ast_json_serializeExprRecursive(expr->binaryExpr->rhs));
+            json_object_set_value(root_object, "rhs", ast_json_takeExpr(serializer, expr->binaryExpr->rhs));
             break;
         }
         case ET_IF_ELSE: {
             // category = ifElse
             json_object_set_string(root_object, "category", "ifElse");
             // add the condition
-            json_object_set_value(root_object, "condition", ast_json_serializeExprRecursive(expr->ifElseExpr->condition));
+            json_object_set_value(root_object, "condition", ast_json_takeExpr(serializer, expr->ifElseExpr->condition));
             // add the thenExpr
-            json_object_set_value(root_object, "ifExpr", ast_json_serializeExprRecursive(expr->ifElseExpr->ifExpr));
+            json_object_set_value(root_object, "ifExpr", ast_json_takeExpr(serializer, expr->ifElseExpr->ifExpr));
             // add the elseExpr
-            json_object_set_value(root_object, "elseExpr", ast_json_serializeExprRecursive(expr->ifElseExpr->elseExpr));
+            json_object_set_value(root_object, "elseExpr", ast_json_takeExpr(serializer, expr->ifElseExpr->elseExpr));
 
             break;
         }
@@ -940,7 +993,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // category = match
             json_object_set_string(root_object, "category", "match");
             // add the expr
-            json_object_set_value(root_object, "expr", ast_json_serializeExprRecursive(expr->matchExpr->expr));
+            json_object_set_value(root_object, "expr", ast_json_takeExpr(serializer, expr->matchExpr->expr));
             // add the cases
             JSON_Value * cases_value = json_value_init_array();
             JSON_Array * cases_array = json_value_get_array(cases_value);
@@ -951,10 +1004,10 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
                 JSON_Value * case_value = json_value_init_object();
                 JSON_Object * case_object = json_value_get_object(case_value);
                 // add the condition
-                JSON_Value * v = ast_json_serializeExprRecursive(matchCase->condition);
+                JSON_Value * v = ast_json_takeExpr(serializer, matchCase->condition);
                 json_object_set_value(case_object, "condition", v);
                 // add the action
-                v = ast_json_serializeExprRecursive(matchCase->expr);
+                v = ast_json_takeExpr(serializer, matchCase->expr);
                 json_object_set_value(case_object, "expr", v);
                 // add the case to the cases array
                 json_array_append_value(cases_array, case_value);
@@ -987,9 +1040,9 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
 
                 // iterate over the variables
                 int j; char * var;
-                vec_foreach(&letDecl->variableNames, var, j) {
+                omap_foreach_key(&letDecl->variables, var, j) {
                     // get the variable var from the map
-                    FnArgument **varDecl = map_get(&letDecl->variables, var);
+                    FnArgument **varDecl = omap_get(&letDecl->variables, var);
                     // create a variable object
                     JSON_Value * variable_value = json_value_init_object();
                     JSON_Object * variable_object = json_value_get_object(variable_value);
@@ -1007,14 +1060,14 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
                 json_object_set_value(assignmentGroup_object, "variables", variables_value);
                 // add the assigned value of that group
                 json_object_set_string(assignmentGroup_object, "initializerType", letDecl->initializerType==LIT_STRUCT_DECONSTRUCTION?"structDeconstruction":(letDecl->initializerType==LIT_NONE?"none":"arrayDestruction"));
-                json_object_set_value(assignmentGroup_object, "initializer", ast_json_serializeExprRecursive(letDecl->initializer));
+                json_object_set_value(assignmentGroup_object, "initializer", ast_json_takeExpr(serializer, letDecl->initializer));
                 // add the group to the groups array
                 json_array_append_value(assignmentGroups_array, assignmentGroup_value);
             }
             // add the groups array to the root object
             json_object_set_value(root_object, "assignmentGroups", assignmentGroups_value);
             // add "in" expression
-            json_object_set_value(root_object, "in", ast_json_serializeExprRecursive(let->inExpr));
+            json_object_set_value(root_object, "in", ast_json_takeExpr(serializer, let->inExpr));
 
             break;
         }
@@ -1031,8 +1084,8 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // iterate over the args
             int i;
             char *argName;
-            vec_foreach(&lambda->header->type->argNames, argName, i) {
-                FnArgument ** arg = map_get(&lambda->header->type->args, argName);
+            omap_foreach_key(&lambda->header->type->args, argName, i) {
+                FnArgument ** arg = omap_get(&lambda->header->type->args, argName);
                 // create new obj to hold arg name and type
                 JSON_Value *arg_value = json_value_init_object();
                 JSON_Object *arg_object = json_value_get_object(arg_value);
@@ -1051,11 +1104,11 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             json_object_set_value(root_object, "args", args_value);
             // add the body
             if(lambda->bodyType == FBT_EXPR){
-                json_object_set_value(root_object, "body", ast_json_serializeExprRecursive(lambda->expr));
+                json_object_set_value(root_object, "body", ast_json_takeExpr(serializer, lambda->expr));
             }
             else {
                 // add statement body
-                json_object_set_value(root_object, "body", ast_json_serializeStatementRecursive(lambda->block));
+                json_object_set_value(root_object, "body", ast_json_takeStatement(serializer, lambda->block));
             }
 
         // TODO: print lambda body
@@ -1065,14 +1118,14 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             // category = unsafe
             json_object_set_string(root_object, "category", "unsafe");
             // add the unsafe expression
-            json_object_set_value(root_object, "expr", ast_json_serializeExprRecursive(expr->unsafeExpr->expr));
+            json_object_set_value(root_object, "expr", ast_json_takeExpr(serializer, expr->unsafeExpr->expr));
             break;
         }
         case ET_SYNC: {
             // category = unsafe
             json_object_set_string(root_object, "category", "sync");
             // add the unsafe expression
-            json_object_set_value(root_object, "expr", ast_json_serializeExprRecursive(expr->syncExpr->expr));
+            json_object_set_value(root_object, "expr", ast_json_takeExpr(serializer, expr->syncExpr->expr));
             break;
         }
         case ET_SPAWN: {
@@ -1080,22 +1133,23 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
             json_object_set_string(root_object, "category", "spawn");
             // add the callback expr if exists else null
             if(expr->spawnExpr->callback != NULL)
-                json_object_set_value(root_object, "callback", ast_json_serializeExprRecursive(expr->spawnExpr->callback));
+                json_object_set_value(root_object, "callback", ast_json_takeExpr(serializer, expr->spawnExpr->callback));
             else
                 json_object_set_null(root_object, "callback");
             // add the process
-            json_object_set_value(root_object, "process", ast_json_serializeExprRecursive(expr->spawnExpr->expr));
+            json_object_set_value(root_object, "process", ast_json_takeExpr(serializer, expr->spawnExpr->expr));
+            break;
         }
         case ET_EMIT: {
             // category = emit
             json_object_set_string(root_object, "category", "emit");
             // add the process if not null
             if(expr->emitExpr->process != NULL)
-                json_object_set_value(root_object, "process", ast_json_serializeExprRecursive(expr->emitExpr->process));
+                json_object_set_value(root_object, "process", ast_json_takeExpr(serializer, expr->emitExpr->process));
             else
                 json_object_set_null(root_object, "process");
             // add the message
-            json_object_set_value(root_object, "message", ast_json_serializeExprRecursive(expr->emitExpr->msg));
+            json_object_set_value(root_object, "message", ast_json_takeExpr(serializer, expr->emitExpr->msg));
 
             break;
         }
@@ -1105,7 +1159,7 @@ JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
     return root_value;
 }
 
-JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
+static JSON_Value* ast_json_makeStatement(AstJsonSerializer* serializer, Statement* stmt){
     // create base object
     JSON_Value * root_value = json_value_init_object();
     JSON_Object * root_object = json_value_get_object(root_value);
@@ -1115,7 +1169,7 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             // category = expr
             json_object_set_string(root_object, "category", "expr");
             // add the expression
-            json_object_set_value(root_object, "expr", ast_json_serializeExprRecursive(stmt->expr->expr));
+            json_object_set_value(root_object, "expr", ast_json_takeExpr(serializer, stmt->expr->expr));
 
             break;
         }
@@ -1140,9 +1194,9 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
 
                 // iterate over the variables
                 int j; char * var;
-                vec_foreach(&letDecl->variableNames, var, j) {
+                omap_foreach_key(&letDecl->variables, var, j) {
                         // get the variable var from the map
-                        FnArgument **v = map_get(&letDecl->variables, var);
+                        FnArgument **v = omap_get(&letDecl->variables, var);
                         // create a variable object
                         JSON_Value * variable_value = json_value_init_object();
                         JSON_Object * variable_object = json_value_get_object(variable_value);
@@ -1160,7 +1214,7 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
                 json_object_set_value(assignmentGroup_object, "variables", variables_value);
                 // add the assigned value of that group
                 json_object_set_string(assignmentGroup_object, "initializerType", letDecl->initializerType==LIT_STRUCT_DECONSTRUCTION?"structDeconstruction":(letDecl->initializerType==LIT_NONE?"none":"arrayDestruction"));
-                json_object_set_value(assignmentGroup_object, "initializer", ast_json_serializeExprRecursive(letDecl->initializer));
+                json_object_set_value(assignmentGroup_object, "initializer", ast_json_takeExpr(serializer, letDecl->initializer));
                 // add the group to the groups array
                 json_array_append_value(assignmentGroups_array, assignmentGroup_value);
             }
@@ -1216,8 +1270,8 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             JSON_Array * args_array = json_value_get_array(args_value);
             // iterate over the args
             uint32_t i; char * argName;
-            vec_foreach(&stmt->fnDecl->header->type->argNames, argName, i) {
-                FnArgument** arg = map_get(&stmt->fnDecl->header->type->args, argName);
+            omap_foreach_key(&stmt->fnDecl->header->type->args, argName, i) {
+                FnArgument** arg = omap_get(&stmt->fnDecl->header->type->args, argName);
                 // create an arg object
                 JSON_Value * arg_value = json_value_init_object();
                 JSON_Object * arg_object = json_value_get_object(arg_value);
@@ -1237,9 +1291,12 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
 
             // if body type is expression we set expr
             if (stmt->fnDecl->bodyType == FBT_EXPR)
-                json_object_set_value(root_object, "expr", ast_json_serializeExprRecursive(stmt->fnDecl->expr));
+                json_object_set_value(root_object, "expr", ast_json_takeExpr(serializer, stmt->fnDecl->expr));
+            // skipped by a lazy parse
+            else if (stmt->fnDecl->deferredBody != NULL)
+                json_object_set_boolean(root_object, "deferred", 1);
             else
-                json_object_set_value(root_object, "block", ast_json_serializeStatementRecursive(stmt->fnDecl->block));
+                json_object_set_value(root_object, "block", ast_json_takeStatement(serializer, stmt->fnDecl->block));
 
             break;
         }
@@ -1253,7 +1310,7 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             uint32_t i; Statement * statement;
             vec_foreach(&stmt->blockStmt->stmts, statement, i) {
                 // add the statement to the statements array
-                json_array_append_value(statements_array, ast_json_serializeStatementRecursive(statement));
+                json_array_append_value(statements_array, ast_json_takeStatement(serializer, statement));
             }
             // add the statements array to the root object
             json_object_set_value(root_object, "statements", statements_value);
@@ -1273,16 +1330,16 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
                 JSON_Value * ifCondition_value = json_value_init_object();
                 JSON_Object * ifCondition_object = json_value_get_object(ifCondition_value);
                 // add the condition
-                json_object_set_value(ifCondition_object, "condition", ast_json_serializeExprRecursive(ifCondition));
+                json_object_set_value(ifCondition_object, "condition", ast_json_takeExpr(serializer, ifCondition));
                 // add the body
-                json_object_set_value(ifCondition_object, "body", ast_json_serializeStatementRecursive(stmt->ifChain->blocks.data[i]));
+                json_object_set_value(ifCondition_object, "body", ast_json_takeStatement(serializer, stmt->ifChain->blocks.data[i]));
                 // add the if condition object to the if conditions array
                 json_array_append_value(ifConditions_array, ifCondition_value);
             }
             // add the if conditions array to the root object
             json_object_set_value(root_object, "chain", ifConditions_value);
             // add else as null as its null or block
-            json_object_set_value(root_object, "else", stmt->ifChain->elseBlock==NULL?json_value_init_null():ast_json_serializeStatementRecursive(stmt->ifChain->elseBlock));
+            json_object_set_value(root_object, "else", stmt->ifChain->elseBlock==NULL?json_value_init_null():ast_json_takeStatement(serializer, stmt->ifChain->elseBlock));
 
             break;
         }
@@ -1299,16 +1356,16 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
                 JSON_Value * matchCase_value = json_value_init_object();
                 JSON_Object * matchCase_object = json_value_get_object(matchCase_value);
                 // add the condition
-                json_object_set_value(matchCase_object, "condition", ast_json_serializeExprRecursive(caseStmt->condition));
+                json_object_set_value(matchCase_object, "condition", ast_json_takeExpr(serializer, caseStmt->condition));
                 // add the body
-                json_object_set_value(matchCase_object, "body", ast_json_serializeStatementRecursive(caseStmt->block));
+                json_object_set_value(matchCase_object, "body", ast_json_takeStatement(serializer, caseStmt->block));
                 // add the match case object to the match cases array
                 json_array_append_value(matchCases_array, matchCase_value);
             }
             // add the match cases array to the root object
             json_object_set_value(root_object, "cases", matchCases_value);
             // add else as null as its null or block
-            json_object_set_value(root_object, "else", stmt->match->elseBlock==NULL?json_value_init_null():ast_json_serializeStatementRecursive(stmt->match->elseBlock));
+            json_object_set_value(root_object, "else", stmt->match->elseBlock==NULL?json_value_init_null():ast_json_takeStatement(serializer, stmt->match->elseBlock));
 
             break;
         }
@@ -1317,9 +1374,9 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             // category = while
             json_object_set_string(root_object, "category", "while");
             // add the condition
-            json_object_set_value(root_object, "condition", ast_json_serializeExprRecursive(stmt->whileLoop->condition));
+            json_object_set_value(root_object, "condition", ast_json_takeExpr(serializer, stmt->whileLoop->condition));
             // add the body
-            json_object_set_value(root_object, "body", ast_json_serializeStatementRecursive(stmt->whileLoop->block));
+            json_object_set_value(root_object, "body", ast_json_takeStatement(serializer, stmt->whileLoop->block));
 
             break;
         }
@@ -1327,9 +1384,9 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             // category = doWhile
             json_object_set_string(root_object, "category", "doWhile");
             // add the condition
-            json_object_set_value(root_object, "condition", ast_json_serializeExprRecursive(stmt->doWhileLoop->condition));
+            json_object_set_value(root_object, "condition", ast_json_takeExpr(serializer, stmt->doWhileLoop->condition));
             // add the body
-            json_object_set_value(root_object, "body", ast_json_serializeStatementRecursive(stmt->doWhileLoop->block));
+            json_object_set_value(root_object, "body", ast_json_takeStatement(serializer, stmt->doWhileLoop->block));
 
             break;
         }
@@ -1337,9 +1394,9 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             // category = for
             json_object_set_string(root_object, "category", "for");
             // add the init
-            json_object_set_value(root_object, "init", ast_json_serializeStatementRecursive(stmt->forLoop->initializer));
+            json_object_set_value(root_object, "init", ast_json_takeStatement(serializer, stmt->forLoop->initializer));
             // add the condition
-            json_object_set_value(root_object, "condition", ast_json_serializeExprRecursive(stmt->forLoop->condition));
+            json_object_set_value(root_object, "condition", ast_json_takeExpr(serializer, stmt->forLoop->condition));
             // add the increment as an array
             JSON_Value * increments_value = json_value_init_array();
             JSON_Array * increments_array = json_value_get_array(increments_value);
@@ -1347,12 +1404,12 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             uint32_t i; Expr * increment;
             vec_foreach(&stmt->forLoop->increments, increment, i) {
                 // add the increment to the increments array
-                json_array_append_value(increments_array, ast_json_serializeExprRecursive(increment));
+                json_array_append_value(increments_array, ast_json_takeExpr(serializer, increment));
             }
             // add the increments array to the root object
             json_object_set_value(root_object, "increments", increments_value);
             // add the body
-            json_object_set_value(root_object, "body", ast_json_serializeStatementRecursive(stmt->forLoop->block));
+            json_object_set_value(root_object, "body", ast_json_takeStatement(serializer, stmt->forLoop->block));
 
             break;
         }
@@ -1369,7 +1426,7 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             // category = return
             json_object_set_string(root_object, "category", "return");
             // add the return value if it exists else set it to null
-            json_object_set_value(root_object, "value", stmt->returnStmt->expr==NULL?json_value_init_null():ast_json_serializeExprRecursive(stmt->returnStmt->expr));
+            json_object_set_value(root_object, "value", stmt->returnStmt->expr==NULL?json_value_init_null():ast_json_takeExpr(serializer, stmt->returnStmt->expr));
             break;
         }
         case ST_BREAK: {
@@ -1381,14 +1438,14 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
             // category = unsafe
             json_object_set_string(root_object, "category", "unsafe");
             // add the unsafe block
-            json_object_set_value(root_object, "body", ast_json_serializeStatementRecursive(stmt->unsafeStmt->block));
+            json_object_set_value(root_object, "body", ast_json_takeStatement(serializer, stmt->unsafeStmt->block));
             break;
         }
         case ST_SYNC: {
             // category = unsafe
             json_object_set_string(root_object, "category", "sync");
             // add the unsafe block
-            json_object_set_value(root_object, "body", ast_json_serializeStatementRecursive(stmt->unsafeStmt->block));
+            json_object_set_value(root_object, "body", ast_json_takeStatement(serializer, stmt->syncStmt->block));
             break;
         }
         case ST_SPAWN: {
@@ -1402,6 +1459,96 @@ JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt){
     return root_value;
 }
 
+static AstWalkAction ast_json_enter(AstWalker* walker) {
+    AstJsonSerializer* serializer = walker->data;
+    vec_push(&serializer->marks, serializer->values.length);
+    return AWA_CONTINUE;
+}
+
+/**
+ * Replaces the values of the children of a node by its own
+ */
+static void ast_json_leave(AstJsonSerializer* serializer, void* node, JSON_Value* value) {
+    int mark = vec_pop(&serializer->marks);
+    int i;
+    for(i = mark; i < serializer->values.length; i++) {
+        if(serializer->values.data[i].value != NULL) {
+            json_value_free(serializer->values.data[i].value);
+        }
+    }
+    serializer->values.length = mark;
+    AstJsonEntry entry = {node, value};
+    vec_push(&serializer->values, entry);
+}
+
+static AstWalkAction ast_json_enterExpr(AstWalker* walker, Expr* expr) {
+    return ast_json_enter(walker);
+}
+
+static AstWalkAction ast_json_enterStatement(AstWalker* walker, Statement* stmt) {
+    return ast_json_enter(walker);
+}
+
+static AstWalkAction ast_json_leaveExpr(AstWalker* walker, Expr* expr) {
+    AstJsonSerializer* serializer = walker->data;
+    serializer->cursor = serializer->marks.data[serializer->marks.length - 1];
+    serializer->end = serializer->values.length;
+    ast_json_leave(serializer, expr, ast_json_makeExpr(serializer, expr));
+    return AWA_CONTINUE;
+}
+
+static AstWalkAction ast_json_leaveStatement(AstWalker* walker, Statement* stmt) {
+    AstJsonSerializer* serializer = walker->data;
+    serializer->cursor = serializer->marks.data[serializer->marks.length - 1];
+    serializer->end = serializer->values.length;
+    ast_json_leave(serializer, stmt, ast_json_makeStatement(serializer, stmt));
+    return AWA_CONTINUE;
+}
+
+static JSON_Value* ast_json_walk(void* node, uint8_t isStatement) {
+    if(node == NULL) {
+        return json_value_init_null();
+    }
+
+    AstWalkCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    uint32_t i;
+    for(i = 0; i < AST_WALK_EXPR_TYPES; i++) {
+        callbacks.enterExpr[i] = ast_json_enterExpr;
+        callbacks.leaveExpr[i] = ast_json_leaveExpr;
+    }
+    for(i = 0; i < AST_WALK_STATEMENT_TYPES; i++) {
+        callbacks.enterStatement[i] = ast_json_enterStatement;
+        callbacks.leaveStatement[i] = ast_json_leaveStatement;
+    }
+
+    AstJsonSerializer serializer;
+    vec_init(&serializer.values);
+    vec_init(&serializer.marks);
+    AstWalker walker;
+    ast_walker_init(&walker);
+    if(isStatement) {
+        ast_walk_statement(&walker, &callbacks, &serializer, NULL, node);
+    }
+    else {
+        ast_walk_expr(&walker, &callbacks, &serializer, NULL, node);
+    }
+    ast_walker_deinit(&walker);
+
+    JSON_Value* value = serializer.values.data[0].value;
+    vec_deinit(&serializer.values);
+    vec_deinit(&serializer.marks);
+    return value;
+}
+
+JSON_Value* ast_json_serializeExprRecursive(Expr* expr) {
+    return ast_json_walk(expr, 0);
+}
+
+JSON_Value* ast_json_serializeStatementRecursive(Statement* stmt) {
+    return ast_json_walk(stmt, 1);
+}
+
 JSON_Value* ast_json_serializeExternDeclRecursive(ExternDecl* decl) {
     // create the root object
     JSON_Value * root_value = json_value_init_object();
@@ -1415,7 +1562,7 @@ JSON_Value* ast_json_serializeExternDeclRecursive(ExternDecl* decl) {
     JSON_Array* methods_array = json_value_get_array(methods_value);
     // iterate over the methods
     char * methodName; uint32_t i;
-    vec_foreach(&decl->methodNames, methodName, i){
+    omap_foreach_key(&decl->methods, methodName, i){
             // we want to create an object {"name": <name>, "args": [<args>], "returnType": <returnType>}
             JSON_Value* method_value = json_value_init_object();
             JSON_Object* method_object = json_value_get_object(method_value);
@@ -1425,10 +1572,10 @@ JSON_Value* ast_json_serializeExternDeclRecursive(ExternDecl* decl) {
             JSON_Value* args_value = json_value_init_array();
             JSON_Array* args_array = json_value_get_array(args_value);
             // iterate over the args
-            FnHeader ** function = map_get(&decl->methods, methodName);
+            FnHeader ** function = omap_get(&decl->methods, methodName);
             uint32_t j; char* argName;
-            vec_foreach(&(*function)->type->argNames, argName, j) {
-                    FnArgument ** argType = map_get(&(*function)->type->args, argName);
+            omap_foreach_key(&(*function)->type->args, argName, j) {
+                    FnArgument ** argType = omap_get(&(*function)->type->args, argName);
                     // we want to create an object {"name": <name>, "type": <type>}
                     JSON_Value* arg_value = json_value_init_object();
                     JSON_Object* arg_object = json_value_get_object(arg_value);
@@ -1472,4 +1619,42 @@ char* ast_json_serializeStatement(Statement* stmt) {
 char* ast_json_serializeExternDecl(ExternDecl* decl){
     JSON_Value * root_val = ast_json_serializeExternDeclRecursive(decl);
     return json_serialize_to_string(root_val);
-}
\ No newline at end of file
+}
+
+char* ast_json_serializeProgram(ASTProgramNode* node) {
+    // {imports: [...], types: {name: <type>}, externs: {name: <extern>}, statements: [...]}
+    JSON_Value* root_value = json_value_init_object();
+    JSON_Object* root_object = json_value_get_object(root_value);
+
+    char* imports = ast_json_serializeImports(node);
+    json_object_set_value(root_object, "imports", json_parse_string(imports));
+    json_free_serialized_string(imports);
+
+    JSON_Value* types_value = json_value_init_object();
+    const char* key;
+    map_iter_t iter = map_iter(&node->scope->dataTypes);
+    while((key = map_next(&node->scope->dataTypes, &iter))) {
+        DataType** type = map_get(&node->scope->dataTypes, key);
+        json_object_set_value(json_value_get_object(types_value), key, ast_json_serializeDataTypeRecursive(*type));
+    }
+    json_object_set_value(root_object, "types", types_value);
+
+    JSON_Value* externs_value = json_value_init_object();
+    iter = map_iter(&node->scope->externDecls);
+    while((key = map_next(&node->scope->externDecls, &iter))) {
+        ExternDecl** decl = map_get(&node->scope->externDecls, key);
+        json_object_set_value(json_value_get_object(externs_value), key, ast_json_serializeExternDeclRecursive(*decl));
+    }
+    json_object_set_value(root_object, "externs", externs_value);
+
+    JSON_Value* statements_value = json_value_init_array();
+    uint32_t i = 0; Statement* stmt;
+    vec_foreach(&node->stmts, stmt, i) {
+        json_array_append_value(json_value_get_array(statements_value), ast_json_serializeStatementRecursive(stmt));
+    }
+    json_object_set_value(root_object, "statements", statements_value);
+
+    char* json_string = json_serialize_to_string(root_value);
+    json_value_free(root_value);
+    return json_string;
+}
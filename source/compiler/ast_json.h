@@ -22,5 +22,7 @@ char* ast_json_serializeDataType(DataType* type);
 char* ast_json_serializeExpr(Expr* expr);
 char* ast_json_serializeStatement(Statement* stmt);
 char* ast_json_serializeExternDecl(ExternDecl* decl);
+// imports, top-level types, extern blocks and statements of a program
+char* ast_json_serializeProgram(ASTProgramNode* node);
 
 #endif //TYPE_C_AST_JSON_H
@@ -0,0 +1,267 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdlib.h>
+#include "ast_walk.h"
+
+void ast_walker_init(AstWalker* walker) {
+    walker->callbacks = NULL;
+    walker->data = NULL;
+    walker->scope = NULL;
+    vec_init(&walker->stack);
+}
+
+void ast_walker_deinit(AstWalker* walker) {
+    vec_deinit(&walker->stack);
+}
+
+static void ast_walk_push(AstWalker* walker, void* node, ASTScope* scope, uint8_t isStatement) {
+    if(node == NULL) {
+        return;
+    }
+    AstWalkItem item = {node, scope, isStatement, 0};
+    vec_push(&walker->stack, item);
+}
+
+#define ast_walk_pushExpr(walker, expr, scope) ast_walk_push(walker, expr, scope, 0)
+#define ast_walk_pushStatement(walker, stmt, scope) ast_walk_push(walker, stmt, scope, 1)
+
+static void ast_walk_pushExprChildren(AstWalker* walker, Expr* expr, ASTScope* scope) {
+    uint32_t i = 0;
+    Expr* e;
+    switch (expr->type) {
+        case ET_ARRAY_CONSTRUCTION:
+            vec_foreach(&expr->arrayConstructionExpr->args, e, i) { ast_walk_pushExpr(walker, e, scope); }
+            break;
+        case ET_NAMED_STRUCT_CONSTRUCTION:
+            omap_foreach_value(&expr->namedStructConstructionExpr->args, e, i) { ast_walk_pushExpr(walker, e, scope); }
+            break;
+        case ET_UNNAMED_STRUCT_CONSTRUCTION:
+            vec_foreach(&expr->unnamedStructConstructionExpr->args, e, i) { ast_walk_pushExpr(walker, e, scope); }
+            break;
+        case ET_NEW:
+            vec_foreach(&expr->newExpr->args, e, i) { ast_walk_pushExpr(walker, e, scope); }
+            break;
+        case ET_CALL:
+            ast_walk_pushExpr(walker, expr->callExpr->lhs, scope);
+            vec_foreach(&expr->callExpr->args, e, i) { ast_walk_pushExpr(walker, e, scope); }
+            break;
+        case ET_MEMBER_ACCESS:
+            ast_walk_pushExpr(walker, expr->memberAccessExpr->lhs, scope);
+            ast_walk_pushExpr(walker, expr->memberAccessExpr->rhs, scope);
+            break;
+        case ET_INDEX_ACCESS:
+            ast_walk_pushExpr(walker, expr->indexAccessExpr->expr, scope);
+            vec_foreach(&expr->indexAccessExpr->indexes, e, i) { ast_walk_pushExpr(walker, e, scope); }
+            break;
+        case ET_CAST:
+            ast_walk_pushExpr(walker, expr->castExpr->expr, scope);
+            break;
+        case ET_INSTANCE_CHECK:
+            ast_walk_pushExpr(walker, expr->instanceCheckExpr->expr, scope);
+            break;
+        case ET_UNARY:
+            ast_walk_pushExpr(walker, expr->unaryExpr->uhs, scope);
+            break;
+        case ET_BINARY:
+            ast_walk_pushExpr(walker, expr->binaryExpr->lhs, scope);
+            ast_walk_pushExpr(walker, expr->binaryExpr->rhs, scope);
+            break;
+        case ET_IF_ELSE:
+            ast_walk_pushExpr(walker, expr->ifElseExpr->condition, scope);
+            ast_walk_pushExpr(walker, expr->ifElseExpr->ifExpr, scope);
+            ast_walk_pushExpr(walker, expr->ifElseExpr->elseExpr, scope);
+            break;
+        case ET_MATCH: {
+            CaseExpr* c;
+            ast_walk_pushExpr(walker, expr->matchExpr->expr, scope);
+            vec_foreach(&expr->matchExpr->cases, c, i) {
+                ast_walk_pushExpr(walker, c->condition, scope);
+                ast_walk_pushExpr(walker, c->expr, scope);
+            }
+            break;
+        }
+        case ET_LET: {
+            LetExprDecl* decl;
+            vec_foreach(&expr->letExpr->letList, decl, i) { ast_walk_pushExpr(walker, decl->initializer, expr->letExpr->scope); }
+            ast_walk_pushExpr(walker, expr->letExpr->inExpr, expr->letExpr->scope);
+            break;
+        }
+        case ET_LAMBDA:
+            if(expr->lambdaExpr->bodyType == FBT_EXPR) {
+                ast_walk_pushExpr(walker, expr->lambdaExpr->expr, expr->lambdaExpr->scope);
+            }
+            else {
+                ast_walk_pushStatement(walker, expr->lambdaExpr->block, expr->lambdaExpr->scope);
+            }
+            break;
+        case ET_UNSAFE:
+            ast_walk_pushExpr(walker, expr->unsafeExpr->expr, expr->unsafeExpr->scope);
+            break;
+        case ET_SYNC:
+            ast_walk_pushExpr(walker, expr->syncExpr->expr, expr->syncExpr->scope);
+            break;
+        case ET_SPAWN:
+            ast_walk_pushExpr(walker, expr->spawnExpr->callback, scope);
+            ast_walk_pushExpr(walker, expr->spawnExpr->expr, scope);
+            break;
+        case ET_EMIT:
+            ast_walk_pushExpr(walker, expr->emitExpr->process, scope);
+            ast_walk_pushExpr(walker, expr->emitExpr->msg, scope);
+            break;
+        default:
+            break;
+    }
+}
+
+static void ast_walk_pushStatementChildren(AstWalker* walker, Statement* stmt, ASTScope* scope) {
+    uint32_t i = 0;
+    Statement* s;
+    Expr* e;
+    switch (stmt->type) {
+        case ST_EXPR:
+            ast_walk_pushExpr(walker, stmt->expr->expr, scope);
+            break;
+        case ST_VAR_DECL: {
+            LetExprDecl* decl;
+            vec_foreach(&stmt->varDecl->letList, decl, i) { ast_walk_pushExpr(walker, decl->initializer, scope); }
+            break;
+        }
+        case ST_FN_DECL:
+            // NULL while the body is deferred
+            if(stmt->fnDecl->bodyType == FBT_EXPR) {
+                ast_walk_pushExpr(walker, stmt->fnDecl->expr, stmt->fnDecl->scope);
+            }
+            else {
+                ast_walk_pushStatement(walker, stmt->fnDecl->block, stmt->fnDecl->scope);
+            }
+            break;
+        case ST_BLOCK:
+            vec_foreach(&stmt->blockStmt->stmts, s, i) { ast_walk_pushStatement(walker, s, stmt->blockStmt->scope); }
+            break;
+        case ST_IF_CHAIN:
+            // a block per condition
+            vec_foreach(&stmt->ifChain->conditions, e, i) {
+                ast_walk_pushExpr(walker, e, scope);
+                if(i < (uint32_t) stmt->ifChain->blocks.length) {
+                    ast_walk_pushStatement(walker, stmt->ifChain->blocks.data[i], scope);
+                }
+            }
+            ast_walk_pushStatement(walker, stmt->ifChain->elseBlock, scope);
+            break;
+        case ST_MATCH: {
+            CaseStatement* c;
+            ast_walk_pushExpr(walker, stmt->match->expr, scope);
+            vec_foreach(&stmt->match->cases, c, i) {
+                ast_walk_pushExpr(walker, c->condition, scope);
+                ast_walk_pushStatement(walker, c->block, scope);
+            }
+            ast_walk_pushStatement(walker, stmt->match->elseBlock, scope);
+            break;
+        }
+        case ST_WHILE:
+            ast_walk_pushExpr(walker, stmt->whileLoop->condition, stmt->whileLoop->scope);
+            ast_walk_pushStatement(walker, stmt->whileLoop->block, stmt->whileLoop->scope);
+            break;
+        case ST_DO_WHILE:
+            ast_walk_pushStatement(walker, stmt->doWhileLoop->block, stmt->doWhileLoop->scope);
+            ast_walk_pushExpr(walker, stmt->doWhileLoop->condition, stmt->doWhileLoop->scope);
+            break;
+        case ST_FOR:
+            ast_walk_pushStatement(walker, stmt->forLoop->initializer, stmt->forLoop->scope);
+            ast_walk_pushExpr(walker, stmt->forLoop->condition, stmt->forLoop->scope);
+            vec_foreach(&stmt->forLoop->increments, e, i) { ast_walk_pushExpr(walker, e, stmt->forLoop->scope); }
+            ast_walk_pushStatement(walker, stmt->forLoop->block, stmt->forLoop->scope);
+            break;
+        case ST_FOREACH:
+            ast_walk_pushExpr(walker, stmt->foreachLoop->iterable, scope);
+            ast_walk_pushStatement(walker, stmt->foreachLoop->block, stmt->foreachLoop->scope);
+            break;
+        case ST_RETURN:
+            ast_walk_pushExpr(walker, stmt->returnStmt->expr, scope);
+            break;
+        case ST_UNSAFE:
+            ast_walk_pushStatement(walker, stmt->unsafeStmt->block, stmt->unsafeStmt->scope);
+            break;
+        case ST_SYNC:
+            ast_walk_pushStatement(walker, stmt->syncStmt->block, stmt->syncStmt->scope);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Calls the callback of a node, if any
+ * @param leaves set if the node has a callback for when it is left
+ * @return the action of the callback, AWA_CONTINUE without one
+ */
+static AstWalkAction ast_walk_visit(AstWalker* walker, AstWalkItem* item, uint8_t* leaves) {
+    const AstWalkCallbacks* callbacks = walker->callbacks;
+    if(item->isStatement) {
+        Statement* stmt = item->node;
+        AstWalkStatement callback = item->leaving ? callbacks->leaveStatement[stmt->type] : callbacks->enterStatement[stmt->type];
+        *leaves = callbacks->leaveStatement[stmt->type] != NULL;
+        return callback != NULL ? callback(walker, stmt) : AWA_CONTINUE;
+    }
+    Expr* expr = item->node;
+    AstWalkExpr callback = item->leaving ? callbacks->leaveExpr[expr->type] : callbacks->enterExpr[expr->type];
+    *leaves = callbacks->leaveExpr[expr->type] != NULL;
+    return callback != NULL ? callback(walker, expr) : AWA_CONTINUE;
+}
+
+static AstWalkAction ast_walk_run(AstWalker* walker, const AstWalkCallbacks* callbacks, void* data, ASTScope* scope,
+                                  void* root, uint8_t isStatement) {
+    // a walk within a callback works above the items of the outer walk
+    int base = walker->stack.length;
+    ast_walk_push(walker, root, scope, isStatement);
+
+    while(walker->stack.length > base) {
+        AstWalkItem item = vec_pop(&walker->stack);
+        int top = walker->stack.length;
+        walker->callbacks = callbacks;
+        walker->data = data;
+        walker->scope = item.scope;
+
+        uint8_t leaves = 0;
+        AstWalkAction action = ast_walk_visit(walker, &item, &leaves);
+        // drops what a walk left through an error, within the callback, might have pushed
+        walker->stack.length = top;
+        if(action == AWA_STOP) {
+            walker->stack.length = base;
+            return AWA_STOP;
+        }
+        if(item.leaving || action == AWA_SKIP) {
+            continue;
+        }
+
+        if(leaves) {
+            item.leaving = 1;
+            vec_push(&walker->stack, item);
+        }
+        uint32_t first = walker->stack.length;
+        if(item.isStatement) {
+            ast_walk_pushStatementChildren(walker, item.node, item.scope);
+        }
+        else {
+            ast_walk_pushExprChildren(walker, item.node, item.scope);
+        }
+        // pushed in source order, popped the other way around
+        uint32_t last = walker->stack.length;
+        while(first + 1 < last) {
+            vec_swap(&walker->stack, first, last - 1);
+            first++;
+            last--;
+        }
+    }
+    return AWA_CONTINUE;
+}
+
+AstWalkAction ast_walk_expr(AstWalker* walker, const AstWalkCallbacks* callbacks, void* data, ASTScope* scope, Expr* expr) {
+    return ast_walk_run(walker, callbacks, data, scope, expr, 0);
+}
+
+AstWalkAction ast_walk_statement(AstWalker* walker, const AstWalkCallbacks* callbacks, void* data, ASTScope* scope, Statement* stmt) {
+    return ast_walk_run(walker, callbacks, data, scope, stmt, 1);
+}
@@ -0,0 +1,93 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_AST_WALK_H
+#define TYPE_C_AST_WALK_H
+
+#include <stdint.h>
+#include "ast.h"
+#include "../utils/vec.h"
+
+/**
+ * Traversal of expressions and statements with an explicit work stack, so the depth
+ * of the tree is bounded by the heap and not by the C stack, i.e a chain of 100k `+`.
+ *
+ * A pass gives callbacks per ExpressionType and StatementType, called when a node is
+ * entered, before its children, and when it is left, after them. Children are visited
+ * in source order. Missing callbacks are skipped, the children are still visited.
+ *
+ * A walker may be used by a callback of its own walk, the outer walk resumes where it was.
+ * A walk left through an error, i.e PARSER_ASSERT, leaves the walker usable.
+ */
+
+#define AST_WALK_EXPR_TYPES (ET_WILDCARD + 1)
+#define AST_WALK_STATEMENT_TYPES (ST_EMIT + 1)
+
+typedef enum AstWalkAction {
+    AWA_CONTINUE = 0,
+    // the children of the node entered are not visited, nor is it left
+    AWA_SKIP,
+    // the walk ends
+    AWA_STOP
+}AstWalkAction;
+
+struct AstWalker;
+
+typedef AstWalkAction (*AstWalkExpr)(struct AstWalker* walker, Expr* expr);
+typedef AstWalkAction (*AstWalkStatement)(struct AstWalker* walker, Statement* stmt);
+
+typedef struct AstWalkCallbacks {
+    AstWalkExpr enterExpr[AST_WALK_EXPR_TYPES];
+    AstWalkExpr leaveExpr[AST_WALK_EXPR_TYPES];
+    AstWalkStatement enterStatement[AST_WALK_STATEMENT_TYPES];
+    AstWalkStatement leaveStatement[AST_WALK_STATEMENT_TYPES];
+}AstWalkCallbacks;
+
+typedef struct AstWalkItem {
+    void* node;
+    // scope the node lives in
+    ASTScope* scope;
+    uint8_t isStatement;
+    // the node is left, its children were visited
+    uint8_t leaving;
+}AstWalkItem;
+
+typedef vec_t(AstWalkItem) vec_walkitem_t;
+
+typedef struct AstWalker {
+    // of the walk in progress
+    const AstWalkCallbacks* callbacks;
+    void* data;
+    // scope of the node given to the callback, blocks, loops, let and lambdas open new ones
+    ASTScope* scope;
+    // nodes left to visit, kept between walks
+    vec_walkitem_t stack;
+}AstWalker;
+
+void ast_walker_init(AstWalker* walker);
+void ast_walker_deinit(AstWalker* walker);
+
+/**
+ * Walks an expression and everything within it
+ * @param walker
+ * @param callbacks
+ * @param data given to the callbacks as walker->data
+ * @param scope scope of the expression
+ * @param expr may be NULL
+ * @return AWA_STOP if a callback ended the walk, AWA_CONTINUE otherwise
+ */
+AstWalkAction ast_walk_expr(AstWalker* walker, const AstWalkCallbacks* callbacks, void* data, ASTScope* scope, Expr* expr);
+
+/**
+ * Walks a statement and everything within it, function bodies included
+ * @param walker
+ * @param callbacks
+ * @param data given to the callbacks as walker->data
+ * @param scope scope of the statement
+ * @param stmt may be NULL
+ * @return AWA_STOP if a callback ended the walk, AWA_CONTINUE otherwise
+ */
+AstWalkAction ast_walk_statement(AstWalker* walker, const AstWalkCallbacks* callbacks, void* data, ASTScope* scope, Statement* stmt);
+
+#endif //TYPE_C_AST_WALK_H
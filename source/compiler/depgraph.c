@@ -0,0 +1,445 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "depgraph.h"
+#include "tokens.h"
+#include "../utils/sds.h"
+
+#define DEPGRAPH_MAGIC "type-c depgraph 2"
+#define DEPGRAPH_DIAGNOSTIC "diag"
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static DepNode* depgraph_makeNode() {
+    DepNode* node = malloc(sizeof(DepNode));
+    node->kind = DNK_STATEMENT;
+    node->key = NULL;
+    node->start = 0;
+    node->end = 0;
+    node->line = 0;
+    node->col = 0;
+    node->tokenCount = 0;
+    vec_init(&node->names);
+    node->hash = FNV_OFFSET;
+    map_init(&node->refs);
+    vec_init(&node->deps);
+    node->failed = 0;
+    vec_init(&node->diagnostics);
+    node->dirty = 1;
+    return node;
+}
+
+static void depgraph_freeNode(DepNode* node) {
+    uint32_t i = 0;
+    char* str;
+    vec_foreach(&node->names, str, i) { free(str); }
+    vec_foreach(&node->deps, str, i) { free(str); }
+    DepDiagnostic* diagnostic;
+    vec_foreach_ptr(&node->diagnostics, diagnostic, i) { free(diagnostic->message); }
+    vec_deinit(&node->diagnostics);
+    vec_deinit(&node->names);
+    vec_deinit(&node->deps);
+    map_deinit(&node->refs);
+    free(node->key);
+    free(node);
+}
+
+DepGraph* depgraph_make() {
+    DepGraph* graph = malloc(sizeof(DepGraph));
+    vec_init(&graph->nodes);
+    map_init(&graph->byName);
+    vec_init(&graph->statements);
+    vec_init(&graph->previousNodes);
+    map_init(&graph->previous);
+    graph->context = 0;
+    graph->current = NULL;
+    graph->dirtyCount = 0;
+    return graph;
+}
+
+void depgraph_free(DepGraph* graph) {
+    uint32_t i = 0;
+    DepNode* node;
+    vec_foreach(&graph->nodes, node, i) { depgraph_freeNode(node); }
+    vec_foreach(&graph->previousNodes, node, i) { depgraph_freeNode(node); }
+    if(graph->current != NULL) {
+        depgraph_freeNode(graph->current);
+    }
+    vec_deinit(&graph->nodes);
+    vec_deinit(&graph->statements);
+    vec_deinit(&graph->previousNodes);
+    map_deinit(&graph->byName);
+    map_deinit(&graph->previous);
+    free(graph);
+}
+
+const char* depgraph_kindToString(DepNodeKind kind) {
+    switch (kind) {
+        case DNK_TYPE:
+            return "type";
+        case DNK_FUNCTION:
+            return "fn";
+        case DNK_FFI:
+            return "extern";
+        case DNK_VARIABLE:
+            return "let";
+        case DNK_STATEMENT:
+        default:
+            return "stmt";
+    }
+}
+
+static uint8_t depgraph_kindFromString(const char* str, DepNodeKind* kind) {
+    DepNodeKind k = DNK_TYPE;
+    for(; k <= DNK_STATEMENT; k++) {
+        if(strcmp(depgraph_kindToString(k), str) == 0) {
+            *kind = k;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Adds a saved diagnostic to the last loaded node
+ */
+static uint8_t depgraph_loadDiagnostic(DepGraph* graph, sds* fields, int fieldCount) {
+    if(fieldCount != 7 || graph->previousNodes.length == 0) {
+        return 0;
+    }
+    int argc = 0;
+    sds* message = sdssplitargs(fields[6], &argc);
+    if(message == NULL || argc != 1) {
+        sdsfreesplitres(message, argc);
+        return 0;
+    }
+
+    DepDiagnostic diagnostic;
+    diagnostic.severity = (DiagnosticSeverity) strtol(fields[1], NULL, 10);
+    diagnostic.line = (int32_t) strtol(fields[2], NULL, 10);
+    diagnostic.col = (int32_t) strtol(fields[3], NULL, 10);
+    diagnostic.pos = (int32_t) strtol(fields[4], NULL, 10);
+    diagnostic.len = (uint32_t) strtoul(fields[5], NULL, 10);
+    diagnostic.message = strdup(message[0]);
+    sdsfreesplitres(message, argc);
+    vec_push(&vec_last(&graph->previousNodes)->diagnostics, diagnostic);
+    return 1;
+}
+
+uint8_t depgraph_load(DepGraph* graph, const char* path) {
+    FILE* f = fopen(path, "r");
+    if(f == NULL) {
+        return 0;
+    }
+
+    sds content = sdsempty();
+    char buffer[4096];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        content = sdscatlen(content, buffer, n);
+    }
+    fclose(f);
+
+    int count = 0;
+    sds* lines = sdssplitlen(content, sdslen(content), "\n", 1, &count);
+    sdsfree(content);
+
+    // magic \n context \n nodes
+    uint8_t valid = count > 1 && strcmp(lines[0], DEPGRAPH_MAGIC) == 0 &&
+                    strtoull(lines[1], NULL, 16) == graph->context;
+    int i = 2;
+    for(; valid && i < count; i++) {
+        if(sdslen(lines[i]) == 0) {
+            continue;
+        }
+
+        // kind \t key \t hash \t failed \t deps
+        // followed by the node's diagnostics: diag \t severity \t line \t col \t pos \t len \t "message"
+        int fieldCount = 0;
+        sds* fields = sdssplitlen(lines[i], sdslen(lines[i]), "\t", 1, &fieldCount);
+        if(fieldCount > 0 && strcmp(fields[0], DEPGRAPH_DIAGNOSTIC) == 0) {
+            valid = depgraph_loadDiagnostic(graph, fields, fieldCount);
+            sdsfreesplitres(fields, fieldCount);
+            continue;
+        }
+
+        DepNodeKind kind;
+        if(fieldCount != 5 || !depgraph_kindFromString(fields[0], &kind)) {
+            sdsfreesplitres(fields, fieldCount);
+            valid = 0;
+            break;
+        }
+
+        DepNode* node = depgraph_makeNode();
+        node->kind = kind;
+        node->key = strdup(fields[1]);
+        node->hash = strtoull(fields[2], NULL, 16);
+        node->failed = fields[3][0] == '1';
+        if(strcmp(fields[4], "-") != 0) {
+            int depCount = 0;
+            sds* deps = sdssplitlen(fields[4], sdslen(fields[4]), ",", 1, &depCount);
+            int j = 0;
+            for(; j < depCount; j++) {
+                vec_push(&node->deps, strdup(deps[j]));
+            }
+            sdsfreesplitres(deps, depCount);
+        }
+        sdsfreesplitres(fields, fieldCount);
+
+        vec_push(&graph->previousNodes, node);
+        map_set(&graph->previous, node->key, node);
+    }
+    sdsfreesplitres(lines, count);
+
+    if(!valid) {
+        // stale or corrupted, everything is rebuilt
+        uint32_t j = 0;
+        DepNode* node;
+        vec_foreach(&graph->previousNodes, node, j) { depgraph_freeNode(node); }
+        vec_deinit(&graph->previousNodes);
+        map_deinit(&graph->previous);
+        map_init(&graph->previous);
+    }
+    return valid;
+}
+
+uint8_t depgraph_save(DepGraph* graph, const char* path) {
+    sds out = sdscatprintf(sdsempty(), DEPGRAPH_MAGIC "\n%016"PRIx64"\n", graph->context);
+    uint32_t i = 0;
+    DepNode* node;
+    vec_foreach(&graph->nodes, node, i) {
+        out = sdscatprintf(out, "%s\t%s\t%016"PRIx64"\t%d\t", depgraph_kindToString(node->kind), node->key,
+                           node->hash, node->failed);
+        if(node->deps.length == 0) {
+            out = sdscat(out, "-");
+        }
+        uint32_t j = 0;
+        char* dep;
+        vec_foreach(&node->deps, dep, j) {
+            out = sdscatprintf(out, "%s%s", j > 0 ? "," : "", dep);
+        }
+        out = sdscat(out, "\n");
+
+        DepDiagnostic* diagnostic;
+        vec_foreach_ptr(&node->diagnostics, diagnostic, j) {
+            out = sdscatprintf(out, DEPGRAPH_DIAGNOSTIC "\t%d\t%"PRId32"\t%"PRId32"\t%"PRId32"\t%"PRIu32"\t",
+                               diagnostic->severity, diagnostic->line, diagnostic->col, diagnostic->pos, diagnostic->len);
+            // quoted and escaped, it holds no tab nor new line
+            out = sdscatrepr(out, diagnostic->message, strlen(diagnostic->message));
+            out = sdscat(out, "\n");
+        }
+    }
+
+    FILE* f = fopen(path, "w");
+    if(f == NULL) {
+        sdsfree(out);
+        return 0;
+    }
+    size_t written = fwrite(out, 1, sdslen(out), f);
+    uint8_t ok = written == sdslen(out);
+    fclose(f);
+    sdsfree(out);
+    return ok;
+}
+
+void depgraph_beginDecl(DepGraph* graph, uint32_t pos) {
+    depgraph_abortDecl(graph);
+    if(graph->nodes.length > 0 && vec_last(&graph->nodes)->end == 0) {
+        vec_last(&graph->nodes)->end = pos;
+    }
+    graph->current = depgraph_makeNode();
+}
+
+void depgraph_abortDecl(DepGraph* graph) {
+    if(graph->current != NULL) {
+        depgraph_freeNode(graph->current);
+        graph->current = NULL;
+    }
+}
+
+void depgraph_feedToken(DepGraph* graph, Lexeme* lexeme) {
+    DepNode* node = graph->current;
+    if(node->tokenCount++ == 0) {
+        node->start = lexeme->pos;
+        node->line = lexeme->line;
+        node->col = lexeme->col;
+    }
+    uint64_t hash = node->hash;
+    uint32_t type = lexeme->type;
+    uint32_t i = 0;
+    for(; i < sizeof(type); i++) {
+        hash = (hash ^ ((type >> (i * 8)) & 0xFF)) * FNV_PRIME;
+    }
+    if(lexeme->string != NULL) {
+        const char* c = lexeme->string;
+        for(; *c; c++) {
+            hash = (hash ^ (uint8_t)*c) * FNV_PRIME;
+        }
+        if(lexeme->type == TOK_IDENTIFIER) {
+            map_set(&node->refs, lexeme->string, 1);
+        }
+    }
+    // token separator, so `ab` `c` and `a` `bc` differ
+    node->hash = (hash ^ 0xFF) * FNV_PRIME;
+}
+
+DepNode* depgraph_endDecl(DepGraph* graph, DepNodeKind kind) {
+    DepNode* node = graph->current;
+    graph->current = NULL;
+    node->kind = kind;
+    vec_push(&graph->nodes, node);
+    return node;
+}
+
+void depgraph_recordDiagnostic(DepNode* node, Diagnostic* diagnostic) {
+    DepDiagnostic kept;
+    kept.severity = diagnostic->severity;
+    // it may lie outside of the node, i.e on a type the node uses
+    kept.line = (int32_t) diagnostic->span.line - (int32_t) node->line;
+    kept.col = (int32_t) diagnostic->span.col - (kept.line == 0 ? (int32_t) node->col : 0);
+    kept.pos = (int32_t) diagnostic->span.pos - (int32_t) node->start;
+    kept.len = diagnostic->span.len;
+    kept.message = strdup(diagnostic->message);
+    vec_push(&node->diagnostics, kept);
+}
+
+DiagnosticSpan depgraph_diagnosticSpan(DepNode* node, DepDiagnostic* diagnostic) {
+    DiagnosticSpan span;
+    span.filename = NULL;
+    span.line = node->line + diagnostic->line;
+    span.col = diagnostic->col + (diagnostic->line == 0 ? node->col : 0);
+    span.pos = node->start + diagnostic->pos;
+    span.len = diagnostic->len;
+    return span;
+}
+
+void depgraph_declare(DepGraph* graph, DepNode* node, char* name) {
+    vec_push(&node->names, strdup(name));
+    map_set(&graph->byName, name, node);
+}
+
+static int depgraph_compareNames(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static uint8_t depgraph_sameDeps(DepNode* a, DepNode* b) {
+    if(a->deps.length != b->deps.length) {
+        return 0;
+    }
+    int i = 0;
+    for(; i < a->deps.length; i++) {
+        if(strcmp(a->deps.data[i], b->deps.data[i]) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+uint32_t depgraph_resolve(DepGraph* graph) {
+    uint32_t anonymous = 0;
+    uint32_t i = 0;
+    DepNode* node;
+
+    // keys and dependencies, references which are not top-level names are local
+    vec_foreach(&graph->nodes, node, i) {
+        sds key = sdsempty();
+        if(node->names.length == 0) {
+            key = sdscatprintf(key, "#%"PRIu32, anonymous++);
+        }
+        uint32_t j = 0;
+        char* name;
+        vec_foreach(&node->names, name, j) {
+            key = sdscatprintf(key, "%s%s", j > 0 ? "," : "", name);
+        }
+        free(node->key);
+        node->key = strdup(key);
+        sdsfree(key);
+
+        const char* ref;
+        map_iter_t iter = map_iter(&node->refs);
+        while((ref = map_next(&node->refs, &iter))) {
+            DepNode** target = map_get(&graph->byName, ref);
+            if(target != NULL && *target != node) {
+                vec_push(&node->deps, strdup(ref));
+            }
+        }
+        vec_sort(&node->deps, depgraph_compareNames);
+        map_deinit(&node->refs);
+        map_init(&node->refs);
+    }
+
+    // declarations which changed on their own
+    vec_depnode_t worklist;
+    vec_init(&worklist);
+    vec_foreach(&graph->nodes, node, i) {
+        DepNode** previous = map_get(&graph->previous, node->key);
+        node->dirty = previous == NULL || (*previous)->failed || (*previous)->kind != node->kind ||
+                      (*previous)->hash != node->hash || !depgraph_sameDeps(node, *previous);
+        if(node->dirty) {
+            vec_push(&worklist, node);
+        }
+    }
+
+    // and everything depending on them
+    map_t(vec_depnode_t) dependents;
+    map_init(&dependents);
+    vec_foreach(&graph->nodes, node, i) {
+        uint32_t j = 0;
+        char* dep;
+        vec_foreach(&node->deps, dep, j) {
+            vec_depnode_t* list = map_get(&dependents, dep);
+            if(list == NULL) {
+                vec_depnode_t empty;
+                vec_init(&empty);
+                map_set(&dependents, dep, empty);
+                list = map_get(&dependents, dep);
+            }
+            vec_push(list, node);
+        }
+    }
+
+    while(worklist.length > 0) {
+        node = vec_pop(&worklist);
+        uint32_t j = 0;
+        char* name;
+        vec_foreach(&node->names, name, j) {
+            vec_depnode_t* list = map_get(&dependents, name);
+            if(list == NULL) {
+                continue;
+            }
+            uint32_t k = 0;
+            DepNode* dependent;
+            vec_foreach(list, dependent, k) {
+                if(!dependent->dirty) {
+                    dependent->dirty = 1;
+                    vec_push(&worklist, dependent);
+                }
+            }
+        }
+    }
+
+    const char* name;
+    map_iter_t iter = map_iter(&dependents);
+    while((name = map_next(&dependents, &iter))) {
+        vec_deinit(map_get(&dependents, name));
+    }
+    map_deinit(&dependents);
+    vec_deinit(&worklist);
+
+    graph->dirtyCount = 0;
+    vec_foreach(&graph->nodes, node, i) {
+        graph->dirtyCount += node->dirty;
+        if(!node->dirty) {
+            // skipped, what its last check raised is reported again
+            DepNode* previous = *map_get(&graph->previous, node->key);
+            node->diagnostics = previous->diagnostics;
+            vec_init(&previous->diagnostics);
+        }
+    }
+    return graph->dirtyCount;
+}
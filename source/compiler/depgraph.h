@@ -0,0 +1,179 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_DEPGRAPH_H
+#define TYPE_C_DEPGRAPH_H
+
+#include <stdint.h>
+#include "lexer.h"
+#include "diagnostics.h"
+#include "../utils/vec.h"
+#include "../utils/map.h"
+
+/**
+ * Declaration dependency graph, used for incremental builds.
+ * Every top-level declaration is a node, identified by the name(s) it declares,
+ * with a hash of its tokens and the top-level names it references.
+ * The graph is persisted after a build, the next build compares against it
+ * and only rechecks declarations whose text or dependencies changed.
+ */
+
+typedef enum DepNodeKind {
+    DNK_TYPE = 0,    // registered through scope_registerType
+    DNK_FUNCTION,    // registered through scope_registerFunction
+    DNK_FFI,         // registered through scope_registerFFI
+    DNK_VARIABLE,    // top-level let
+    DNK_STATEMENT    // anything else, identified by its position among anonymous statements
+}DepNodeKind;
+
+/**
+ * Diagnostic raised while checking a declaration, kept so that it is reported again
+ * when the declaration is skipped. The location is relative to the declaration's first token,
+ * the column only on that token's line.
+ */
+typedef struct DepDiagnostic {
+    DiagnosticSeverity severity;
+    int32_t line;
+    int32_t col;
+    int32_t pos;
+    uint32_t len;
+    char* message;
+}DepDiagnostic;
+
+typedef vec_t(DepDiagnostic) vec_depdiagnostic_t;
+
+typedef struct DepNode {
+    DepNodeKind kind;
+    // declared names joined with `,`, or `#<n>` for anonymous statements. set by depgraph_resolve
+    char* key;
+    vec_str_t names;
+    // offset, line and column of its first token
+    uint32_t start;
+    // offset of the first token after it, 0 until the next declaration begins
+    uint32_t end;
+    uint32_t line;
+    uint32_t col;
+    // number of tokens it spans
+    uint32_t tokenCount;
+    // FNV-1a hash of the declaration's tokens
+    uint64_t hash;
+    // identifiers referenced by the declaration, only kept while recording
+    map_int_t refs;
+    // sorted names of the top-level declarations it depends on
+    vec_str_t deps;
+    // raised an error when it was last checked
+    uint8_t failed;
+    // diagnostics of its last check
+    vec_depdiagnostic_t diagnostics;
+    // must be rechecked
+    uint8_t dirty;
+}DepNode;
+
+typedef vec_t(DepNode*) vec_depnode_t;
+typedef map_t(DepNode*) map_depnode_t;
+
+typedef struct DepGraph {
+    vec_depnode_t nodes;
+    // declared name -> node
+    map_depnode_t byName;
+    // nodes of the top-level statements, in the same order as ASTProgramNode.stmts
+    vec_depnode_t statements;
+
+    // graph of the previous build, by key
+    vec_depnode_t previousNodes;
+    map_depnode_t previous;
+
+    // hash of what the declarations are checked against besides each other, i.e the interfaces
+    // of the imports. a graph saved under another context is not compared against
+    uint64_t context;
+
+    // declaration being recorded, NULL in between
+    DepNode* current;
+    uint32_t dirtyCount;
+}DepGraph;
+
+DepGraph* depgraph_make();
+void depgraph_free(DepGraph* graph);
+
+/**
+ * Loads the graph saved by a previous build, it becomes the reference
+ * the current build is compared against. It is ignored if it was saved under another context.
+ * @param graph
+ * @param path
+ * @return 1 on success, 0 if the file does not exist, is not a graph or has another context
+ */
+uint8_t depgraph_load(DepGraph* graph, const char* path);
+
+/**
+ * Saves the current graph, must be called after depgraph_resolve
+ * @param graph
+ * @param path
+ * @return 1 on success
+ */
+uint8_t depgraph_save(DepGraph* graph, const char* path);
+
+/**
+ * Starts recording a top-level declaration, every accepted token is fed to it
+ * until it is ended or aborted
+ * @param graph
+ * @param pos offset of the current token, which also ends the previous declaration
+ */
+void depgraph_beginDecl(DepGraph* graph, uint32_t pos);
+
+/**
+ * Drops the declaration being recorded, i.e when it failed to parse
+ * @param graph
+ */
+void depgraph_abortDecl(DepGraph* graph);
+
+/**
+ * Adds an accepted token to the declaration being recorded
+ * @param graph
+ * @param lexeme
+ */
+void depgraph_feedToken(DepGraph* graph, Lexeme* lexeme);
+
+/**
+ * Ends the declaration being recorded and adds it to the graph
+ * @param graph
+ * @param kind
+ * @return the new node, its names are added with depgraph_declare
+ */
+DepNode* depgraph_endDecl(DepGraph* graph, DepNodeKind kind);
+
+/**
+ * Binds a declared name to a node
+ * @param graph
+ * @param node
+ * @param name
+ */
+void depgraph_declare(DepGraph* graph, DepNode* node, char* name);
+
+/**
+ * Resolves dependencies between the recorded declarations and marks dirty
+ * the ones which are new, changed, failed last time, or depend on a dirty one.
+ * Clean ones take the diagnostics kept by the previous build.
+ * @param graph
+ * @return number of dirty nodes
+ */
+uint32_t depgraph_resolve(DepGraph* graph);
+
+/**
+ * Keeps a diagnostic raised while checking the node, it is saved with the graph
+ * @param node
+ * @param diagnostic
+ */
+void depgraph_recordDiagnostic(DepNode* node, Diagnostic* diagnostic);
+
+/**
+ * Location of a kept diagnostic, where the node now is
+ * @param node
+ * @param diagnostic
+ * @return the span, without a filename
+ */
+DiagnosticSpan depgraph_diagnosticSpan(DepNode* node, DepDiagnostic* diagnostic);
+
+const char* depgraph_kindToString(DepNodeKind kind);
+
+#endif //TYPE_C_DEPGRAPH_H
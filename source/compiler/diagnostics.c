@@ -0,0 +1,297 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "diagnostics.h"
+#include "../utils/parson.h"
+
+void diagnostics_init(DiagnosticsEngine* engine) {
+    vec_init(&engine->diagnostics);
+    map_init(&engine->seen);
+    engine->errorCount = 0;
+    engine->warningCount = 0;
+    engine->format = DF_HUMAN;
+}
+
+static void diagnostics_free(Diagnostic* diagnostic) {
+    free((char*)diagnostic->span.filename);
+    sdsfree(diagnostic->message);
+    sdsfree(diagnostic->snippet);
+    free(diagnostic);
+}
+
+void diagnostics_deinit(DiagnosticsEngine* engine) {
+    uint32_t i = 0;
+    Diagnostic* diagnostic;
+    vec_foreach(&engine->diagnostics, diagnostic, i) {
+        diagnostics_free(diagnostic);
+    }
+    vec_deinit(&engine->diagnostics);
+    map_deinit(&engine->seen);
+}
+
+/**
+ * Identity of a diagnostic, used to drop duplicates
+ */
+static sds diagnostics_key(Diagnostic* diagnostic) {
+    return sdscatprintf(sdsempty(), "%d:%s:%"PRIu32":%"PRIu32":%s", diagnostic->severity,
+                        diagnostic->span.filename != NULL ? diagnostic->span.filename : "",
+                        diagnostic->span.line, diagnostic->span.col, diagnostic->message);
+}
+
+Diagnostic* diagnostics_report(DiagnosticsEngine* engine, DiagnosticSeverity severity, DiagnosticSpan span, sds snippet,
+                               const char* origin, int originLine, const char* condition, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    Diagnostic* diagnostic = diagnostics_reportv(engine, severity, span, snippet, origin, originLine, condition, fmt, args);
+    va_end(args);
+    return diagnostic;
+}
+
+Diagnostic* diagnostics_reportv(DiagnosticsEngine* engine, DiagnosticSeverity severity, DiagnosticSpan span, sds snippet,
+                                const char* origin, int originLine, const char* condition, const char* fmt, va_list args) {
+    sds message = sdscatvprintf(sdsempty(), fmt, args);
+
+    // the same error is often raised again while recovering, we keep the first one only
+    Diagnostic probe = {severity, span, message};
+    sds key = diagnostics_key(&probe);
+    if(map_get(&engine->seen, key) != NULL) {
+        sdsfree(key);
+        sdsfree(message);
+        sdsfree(snippet);
+        return NULL;
+    }
+    map_set(&engine->seen, key, 1);
+    sdsfree(key);
+
+    Diagnostic* diagnostic = malloc(sizeof(Diagnostic));
+    diagnostic->severity = severity;
+    diagnostic->span = span;
+    // spans point into the lexer, which may go away before the diagnostic
+    diagnostic->span.filename = span.filename != NULL ? strdup(span.filename) : NULL;
+    diagnostic->message = message;
+    diagnostic->snippet = snippet;
+    diagnostic->origin = origin;
+    diagnostic->originLine = originLine;
+    diagnostic->condition = condition;
+    vec_push(&engine->diagnostics, diagnostic);
+
+    if(severity == DS_ERROR) {
+        engine->errorCount++;
+    }
+    else if(severity == DS_WARNING) {
+        engine->warningCount++;
+    }
+
+    return diagnostic;
+}
+
+void diagnostics_truncate(DiagnosticsEngine* engine, uint32_t count) {
+    while(engine->diagnostics.length > (int)count) {
+        Diagnostic* diagnostic = vec_pop(&engine->diagnostics);
+        sds key = diagnostics_key(diagnostic);
+        map_remove(&engine->seen, key);
+        sdsfree(key);
+
+        if(diagnostic->severity == DS_ERROR) {
+            engine->errorCount--;
+        }
+        else if(diagnostic->severity == DS_WARNING) {
+            engine->warningCount--;
+        }
+        diagnostics_free(diagnostic);
+    }
+}
+
+void diagnostics_take(DiagnosticsEngine* engine, DiagnosticsEngine* from) {
+    uint32_t i = 0;
+    Diagnostic* diagnostic;
+    vec_foreach(&from->diagnostics, diagnostic, i) {
+        sds key = diagnostics_key(diagnostic);
+        if(map_get(&engine->seen, key) != NULL) {
+            diagnostics_free(diagnostic);
+        }
+        else {
+            map_set(&engine->seen, key, 1);
+            vec_push(&engine->diagnostics, diagnostic);
+            engine->errorCount += diagnostic->severity == DS_ERROR;
+            engine->warningCount += diagnostic->severity == DS_WARNING;
+        }
+        sdsfree(key);
+    }
+    vec_clear(&from->diagnostics);
+    map_deinit(&from->seen);
+    map_init(&from->seen);
+    from->errorCount = 0;
+    from->warningCount = 0;
+}
+
+const char* diagnostics_severityToString(DiagnosticSeverity severity) {
+    switch (severity) {
+        case DS_ERROR:
+            return "error";
+        case DS_WARNING:
+            return "warning";
+        case DS_NOTE:
+            return "note";
+    }
+    return "unknown";
+}
+
+uint8_t diagnostics_formatFromString(const char* name, DiagnosticsFormat* format) {
+    if(strcmp(name, "human") == 0) {
+        *format = DF_HUMAN;
+        return 1;
+    }
+    if(strcmp(name, "json") == 0) {
+        *format = DF_JSON;
+        return 1;
+    }
+    if(strcmp(name, "sarif") == 0) {
+        *format = DF_SARIF;
+        return 1;
+    }
+    return 0;
+}
+
+static sds diagnostics_renderHuman(DiagnosticsEngine* engine) {
+    sds out = sdsempty();
+    uint32_t i = 0;
+    Diagnostic* d;
+    vec_foreach(&engine->diagnostics, d, i) {
+        out = sdscatprintf(out, "%s:%"PRIu32":%"PRIu32": %s: %s\n", d->span.filename, d->span.line, d->span.col,
+                           diagnostics_severityToString(d->severity), d->message);
+        if(d->snippet != NULL) {
+            out = sdscatprintf(out, "%s\n", d->snippet);
+        }
+        if(d->origin != NULL) {
+            out = sdscatprintf(out, "triggered from: %s:%d\n", d->origin, d->originLine);
+        }
+        if(d->condition != NULL) {
+            out = sdscatprintf(out, "Failure condition: %s\n", d->condition);
+        }
+    }
+
+    if(engine->errorCount > 0) {
+        out = sdscatprintf(out, "%"PRIu32" error%s generated.\n", engine->errorCount, engine->errorCount > 1 ? "s" : "");
+    }
+    if(engine->warningCount > 0) {
+        out = sdscatprintf(out, "%"PRIu32" warning%s generated.\n", engine->warningCount, engine->warningCount > 1 ? "s" : "");
+    }
+    return out;
+}
+
+static sds diagnostics_serialize(JSON_Value* root) {
+    char* str = json_serialize_to_string_pretty(root);
+    sds out = sdscat(sdsnew(str), "\n");
+    json_free_serialized_string(str);
+    json_value_free(root);
+    return out;
+}
+
+static sds diagnostics_renderJson(DiagnosticsEngine* engine) {
+    /*
+     * {errors: n, warnings: n, diagnostics: [{severity, file, line, column, length, message, origin}, ...]}
+     */
+    JSON_Value* root_value = json_value_init_object();
+    JSON_Object* root = json_value_get_object(root_value);
+    json_object_set_number(root, "errors", engine->errorCount);
+    json_object_set_number(root, "warnings", engine->warningCount);
+
+    JSON_Value* list_value = json_value_init_array();
+    JSON_Array* list = json_value_get_array(list_value);
+
+    uint32_t i = 0;
+    Diagnostic* d;
+    vec_foreach(&engine->diagnostics, d, i) {
+        JSON_Value* value = json_value_init_object();
+        JSON_Object* obj = json_value_get_object(value);
+        json_object_set_string(obj, "severity", diagnostics_severityToString(d->severity));
+        json_object_set_string(obj, "file", d->span.filename);
+        json_object_set_number(obj, "line", d->span.line);
+        json_object_set_number(obj, "column", d->span.col);
+        json_object_set_number(obj, "length", d->span.len);
+        json_object_set_string(obj, "message", d->message);
+        if(d->origin != NULL) {
+            json_object_set_string(obj, "origin", d->origin);
+        }
+        json_array_append_value(list, value);
+    }
+    json_object_set_value(root, "diagnostics", list_value);
+
+    return diagnostics_serialize(root_value);
+}
+
+static sds diagnostics_renderSarif(DiagnosticsEngine* engine) {
+    JSON_Value* root_value = json_value_init_object();
+    JSON_Object* root = json_value_get_object(root_value);
+    json_object_set_string(root, "$schema", "https://json.schemastore.org/sarif-2.1.0.json");
+    json_object_set_string(root, "version", "2.1.0");
+
+    JSON_Value* run_value = json_value_init_object();
+    JSON_Object* run = json_value_get_object(run_value);
+    json_object_dotset_value(run, "tool.driver.name", json_value_init_string("type-c"));
+
+    JSON_Value* results_value = json_value_init_array();
+    JSON_Array* results = json_value_get_array(results_value);
+
+    uint32_t i = 0;
+    Diagnostic* d;
+    vec_foreach(&engine->diagnostics, d, i) {
+        JSON_Value* value = json_value_init_object();
+        JSON_Object* result = json_value_get_object(value);
+        json_object_set_string(result, "level", diagnostics_severityToString(d->severity));
+        json_object_dotset_value(result, "message.text", json_value_init_string(d->message));
+
+        JSON_Value* location_value = json_value_init_object();
+        JSON_Object* location = json_value_get_object(location_value);
+        json_object_dotset_value(location, "physicalLocation.artifactLocation.uri", json_value_init_string(d->span.filename));
+        // SARIF columns are 1-based
+        JSON_Value* region_value = json_value_init_object();
+        JSON_Object* region = json_value_get_object(region_value);
+        json_object_set_number(region, "startLine", d->span.line);
+        json_object_set_number(region, "startColumn", d->span.col + 1);
+        json_object_set_number(region, "endColumn", d->span.col + 1 + d->span.len);
+        json_object_dotset_value(location, "physicalLocation.region", region_value);
+
+        JSON_Value* locations_value = json_value_init_array();
+        json_array_append_value(json_value_get_array(locations_value), location_value);
+        json_object_set_value(result, "locations", locations_value);
+
+        json_array_append_value(results, value);
+    }
+    json_object_set_value(run, "results", results_value);
+
+    JSON_Value* runs_value = json_value_init_array();
+    json_array_append_value(json_value_get_array(runs_value), run_value);
+    json_object_set_value(root, "runs", runs_value);
+
+    return diagnostics_serialize(root_value);
+}
+
+sds diagnostics_render(DiagnosticsEngine* engine, DiagnosticsFormat format) {
+    switch (format) {
+        case DF_JSON:
+            return diagnostics_renderJson(engine);
+        case DF_SARIF:
+            return diagnostics_renderSarif(engine);
+        case DF_HUMAN:
+        default:
+            return diagnostics_renderHuman(engine);
+    }
+}
+
+void diagnostics_flush(DiagnosticsEngine* engine, FILE* out) {
+    // nothing to say in human form, structured forms always produce a document
+    if(engine->format == DF_HUMAN && engine->diagnostics.length == 0) {
+        return;
+    }
+
+    sds rendered = diagnostics_render(engine, engine->format);
+    fwrite(rendered, 1, sdslen(rendered), out);
+    fflush(out);
+    sdsfree(rendered);
+}
@@ -0,0 +1,123 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_DIAGNOSTICS_H
+#define TYPE_C_DIAGNOSTICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include "../utils/vec.h"
+#include "../utils/map.h"
+#include "../utils/sds.h"
+
+typedef enum DiagnosticSeverity {
+    DS_ERROR = 0,
+    DS_WARNING,
+    DS_NOTE
+}DiagnosticSeverity;
+
+typedef enum DiagnosticsFormat {
+    DF_HUMAN = 0,
+    DF_JSON,
+    DF_SARIF
+}DiagnosticsFormat;
+
+/**
+ * Source location of a diagnostic, line is 1-based, col is 0-based.
+ * Reported diagnostics keep their own copy of the filename.
+ */
+typedef struct DiagnosticSpan {
+    const char* filename;
+    uint32_t line;
+    uint32_t col;
+    uint32_t pos;
+    uint32_t len;
+}DiagnosticSpan;
+
+typedef struct Diagnostic {
+    DiagnosticSeverity severity;
+    DiagnosticSpan span;
+    sds message;
+    // source line with a caret under the span, may be NULL
+    sds snippet;
+    // compiler function and line which raised the diagnostic
+    const char* origin;
+    int originLine;
+    // failed condition, may be NULL
+    const char* condition;
+}Diagnostic;
+
+typedef vec_t(Diagnostic*) vec_diagnostic_t;
+
+typedef struct DiagnosticsEngine {
+    vec_diagnostic_t diagnostics;
+    // severity, location and message of every diagnostic, used to drop duplicates
+    map_int_t seen;
+    uint32_t errorCount;
+    uint32_t warningCount;
+    DiagnosticsFormat format;
+}DiagnosticsEngine;
+
+void diagnostics_init(DiagnosticsEngine* engine);
+void diagnostics_deinit(DiagnosticsEngine* engine);
+
+/**
+ * Records a diagnostic. Nothing is written until diagnostics_flush.
+ * @param engine
+ * @param severity
+ * @param span
+ * @param snippet source line with caret, ownership is taken. may be NULL.
+ * @param origin compiler function raising it
+ * @param originLine
+ * @param condition failed condition, may be NULL
+ * @param fmt
+ * @return the diagnostic, or NULL if an identical one was already recorded
+ */
+Diagnostic* diagnostics_report(DiagnosticsEngine* engine, DiagnosticSeverity severity, DiagnosticSpan span, sds snippet,
+                               const char* origin, int originLine, const char* condition, const char* fmt, ...);
+Diagnostic* diagnostics_reportv(DiagnosticsEngine* engine, DiagnosticSeverity severity, DiagnosticSpan span, sds snippet,
+                                const char* origin, int originLine, const char* condition, const char* fmt, va_list args);
+
+/**
+ * Drops every diagnostic recorded after the first `count` ones,
+ * i.e to discard the results of a pass which is about to run again
+ * @param engine
+ * @param count
+ */
+void diagnostics_truncate(DiagnosticsEngine* engine, uint32_t count);
+
+/**
+ * Moves every diagnostic of `from` into `engine`, `from` is left empty
+ * @param engine
+ * @param from
+ */
+void diagnostics_take(DiagnosticsEngine* engine, DiagnosticsEngine* from);
+
+/**
+ * Renders all diagnostics in the given format
+ * @param engine
+ * @param format
+ * @return new sds string
+ */
+sds diagnostics_render(DiagnosticsEngine* engine, DiagnosticsFormat format);
+
+/**
+ * Writes all recorded diagnostics with a single write, in the engine's format.
+ * @param engine
+ * @param out
+ */
+void diagnostics_flush(DiagnosticsEngine* engine, FILE* out);
+
+const char* diagnostics_severityToString(DiagnosticSeverity severity);
+
+/**
+ * Parses "human", "json" or "sarif"
+ * @param name
+ * @param format output
+ * @return 1 on success
+ */
+uint8_t diagnostics_formatFromString(const char* name, DiagnosticsFormat* format);
+
+#endif //TYPE_C_DIAGNOSTICS_H
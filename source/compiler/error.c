@@ -7,16 +7,43 @@
 #include <assert.h>
 #include "error.h"
 
+static __thread jmp_buf* error_recovery = NULL;
+static __thread char error_message[512];
+
 void typec_assert(int cond, const char * rawcond, const char* func_name, int line, const char * fmt, ...) {
     if (cond)
         return;
-    char temp[1024];
     va_list vl;
     va_start(vl, fmt);
-    vsprintf(temp, fmt, vl);
+    int len = snprintf(error_message, sizeof(error_message), "assertion failed: `%s` in function `%s`, line %d: ",
+                       rawcond, func_name, line);
+    if(len >= 0 && (size_t)len < sizeof(error_message)) {
+        vsnprintf(error_message + len, sizeof(error_message) - len, fmt, vl);
+    }
     va_end(vl);
-    fprintf(stdout, "Fatal error, assertion failed: `%s` in function `%s`, line %d \n", rawcond, func_name, line);
-    fprintf(stdout, "%s", temp);
-    fprintf(stdout, "\n");
+    if(error_recovery != NULL) {
+        longjmp(*error_recovery, 1);
+    }
+
+    // internal errors are fatal, so they are written right away rather than collected
+    fprintf(stdout, "Fatal error, %s\n", error_message);
     assert(cond);
+}
+
+jmp_buf* error_enterRecovery(jmp_buf* recovery) {
+    jmp_buf* previous = error_recovery;
+    error_recovery = recovery;
+    return previous;
+}
+
+void error_unwind(const char* message) {
+    if(error_recovery == NULL) {
+        return;
+    }
+    snprintf(error_message, sizeof(error_message), "%s", message);
+    longjmp(*error_recovery, 1);
+}
+
+const char* error_lastMessage(void) {
+    return error_message;
 }
\ No newline at end of file
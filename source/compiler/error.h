@@ -5,6 +5,8 @@
 #ifndef TYPE_C_ERROR_H
 #define TYPE_C_ERROR_H
 
+#include <setjmp.h>
+
 #if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
 #define VM_ARCH "x64"
 #elif defined(__arm64__) || defined(__aarch64__)
@@ -39,4 +41,23 @@
 
 void typec_assert(int cond, const char * rawcond, const char* func_name, int line, const char * fmt, ...);
 
+/**
+ * Sets where failed assertions of the calling thread jump to, rather than aborting
+ * the process. Used by embedders, which must survive an internal error.
+ * @param recovery NULL to abort again
+ * @return the previous recovery point, to be restored
+ */
+jmp_buf* error_enterRecovery(jmp_buf* recovery);
+
+/**
+ * Jumps to the recovery point of the calling thread, if any, as a failed assertion would.
+ * @param message reported by error_lastMessage
+ */
+void error_unwind(const char* message);
+
+/**
+ * @return message of the last assertion which failed on the calling thread, empty if none
+ */
+const char* error_lastMessage(void);
+
 #endif //TYPE_C_ERROR_H
@@ -0,0 +1,417 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include "instance.h"
+#include "parser.h"
+#include "parser_utils.h"
+#include "type_inference.h"
+#include "type_checker.h"
+#include "../utils/sds.h"
+
+void instance_cache_init(InstanceCache* cache) {
+    map_init(&cache->byKey);
+    vec_init(&cache->instances);
+    memset(&cache->stats, 0, sizeof(InstanceStats));
+}
+
+void instance_cache_deinit(InstanceCache* cache) {
+    // the instantiated types are part of the AST
+    uint32_t i = 0;
+    Instance* instance;
+    vec_foreach(&cache->instances, instance, i) {
+        vec_deinit(&instance->typeArgs);
+        free(instance);
+    }
+    vec_deinit(&cache->instances);
+    map_deinit(&cache->byKey);
+}
+
+static int instance_compareKeys(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * Appends the canonical form of a type argument
+ */
+static sds instance_keyOf(Parser* parser, ASTScope* scope, sds key, DataType* type) {
+    if(type == NULL) {
+        return sdscat(key, "void");
+    }
+    DataType* base = ti_type_findBase(parser, scope, type);
+    if(type->isNullable || base->isNullable) {
+        key = sdscat(key, "?");
+    }
+
+    if(base->kind <= DT_CHAR) {
+        return sdscatprintf(key, "#%d", base->kind);
+    }
+
+    switch(base->kind) {
+        case DT_ARRAY:
+            key = sdscatprintf(key, "[%"PRIu64"]", base->arrayType->len);
+            return instance_keyOf(parser, scope, key, base->arrayType->arrayOf);
+        case DT_PTR:
+            key = sdscat(key, "*");
+            return instance_keyOf(parser, scope, key, base->ptrType->target);
+        case DT_TYPE_UNION:
+        case DT_TYPE_JOIN: {
+            // unions and joins have the same layout, members are keyed once resolved, so
+            // aliases and their targets sort and deduplicate together
+            vec_str_t memberKeys;
+            vec_init(&memberKeys);
+            uint32_t i = 0;
+            DataType* member;
+            vec_foreach(&base->unionType->members, member, i) {
+                vec_push(&memberKeys, instance_keyOf(parser, scope, sdsempty(), member));
+            }
+            qsort(memberKeys.data, memberKeys.length, sizeof(char*), instance_compareKeys);
+
+            key = sdscat(key, base->kind == DT_TYPE_UNION ? "(" : "&(");
+            char* memberKey;
+            vec_foreach(&memberKeys, memberKey, i) {
+                if((i == 0) || (strcmp(memberKey, memberKeys.data[i - 1]) != 0)) {
+                    key = sdscatprintf(key, "%s,", memberKey);
+                }
+            }
+            vec_foreach(&memberKeys, memberKey, i) {
+                sdsfree(memberKey);
+            }
+            vec_deinit(&memberKeys);
+            return sdscat(key, ")");
+        }
+        case DT_FN: {
+            key = sdscat(key, "fn(");
+            uint32_t i = 0;
+            FnArgument* arg;
+            omap_foreach_value(&base->fnType->args, arg, i) {
+                key = instance_keyOf(parser, scope, key, arg != NULL ? arg->type : NULL);
+                key = sdscat(key, ",");
+            }
+            key = sdscat(key, ")");
+            return instance_keyOf(parser, scope, key, base->fnType->returnType);
+        }
+        default:
+            // declarations, and their instances, are unique
+            return sdscatprintf(key, "@%p", (void*)base);
+    }
+}
+
+static DataType* instance_copyType(DataType* type) {
+    DataType* copy = malloc(sizeof(DataType));
+    *copy = *type;
+    // an instance is concrete, and owns its lists
+    copy->isGeneric = 0;
+    copy->hasGenerics = 0;
+    copy->description = NULL;
+    vec_small_init(&copy->genericRefs);
+    vec_small_init(&copy->genericNames);
+    map_init(&copy->generics);
+    return copy;
+}
+
+/**
+ * Copies a type argument, keeping the arguments of a generic reference
+ */
+static DataType* instance_copyArgument(DataType* type) {
+    DataType* copy = instance_copyType(type);
+    copy->hasGenerics = type->hasGenerics;
+    vec_extend(&copy->genericRefs, &type->genericRefs);
+    return copy;
+}
+
+/**
+ * Frees a function type copy that turned out to be identical to its original,
+ * its arguments still point to the original types
+ */
+static void instance_dropFn(FnType* fnType) {
+    uint32_t i = 0;
+    FnArgument* arg;
+    omap_foreach_value(&fnType->args, arg, i) {
+        free(arg);
+    }
+    omap_deinit(&fnType->args);
+    free(fnType);
+}
+
+/**
+ * Frees a struct type copy that turned out to be identical to its original
+ */
+static void instance_dropStruct(StructType* structType) {
+    uint32_t i = 0;
+    StructAttribute* attribute;
+    omap_foreach_value(&structType->attributes, attribute, i) {
+        free(attribute);
+    }
+    omap_deinit(&structType->attributes);
+    vec_deinit(&structType->extends);
+
+    ASTScope* scope = structType->scope;
+    map_deinit(&scope->variables);
+    map_deinit(&scope->functions);
+    map_deinit(&scope->dataTypes);
+    map_deinit(&scope->generics);
+    map_deinit(&scope->externDecls);
+    vec_deinit(&scope->genericNames);
+    free(scope);
+    free(structType);
+}
+
+static DataType* instance_substitute(map_dtype_t* params, DataType* type);
+
+static FnType* instance_substituteFn(map_dtype_t* params, FnType* fnType, uint8_t* changed) {
+    FnType* copy = ast_type_makeFn();
+    uint32_t i = 0;
+    char* argName;
+    FnArgument* arg;
+    omap_foreach(&fnType->args, argName, arg, i) {
+        FnArgument* argCopy = ast_type_makeFnArgument();
+        *argCopy = *arg;
+        argCopy->type = instance_substitute(params, arg->type);
+        *changed |= argCopy->type != arg->type;
+        omap_set(&copy->args, argName, argCopy);
+    }
+    copy->returnType = instance_substitute(params, fnType->returnType);
+    *changed |= copy->returnType != fnType->returnType;
+    return copy;
+}
+
+/**
+ * Replaces the generic parameters within a type
+ * @return a new type, or the same one if it does not use any of the parameters
+ */
+static DataType* instance_substitute(map_dtype_t* params, DataType* type) {
+    if(type == NULL) {
+        return NULL;
+    }
+
+    DataType* copy = NULL;
+    switch(type->kind) {
+        case DT_REFERENCE: {
+            if(type->refType->ref == NULL && !type->hasGenerics && type->refType->pkg->ids.length == 1) {
+                DataType** arg = map_get(params, type->refType->pkg->ids.data[0]);
+                if(arg == NULL) {
+                    return type;
+                }
+                if(type->isNullable && !(*arg)->isNullable) {
+                    copy = instance_copyArgument(*arg);
+                    copy->isNullable = 1;
+                    return copy;
+                }
+                return *arg;
+            }
+
+            // i.e Box<T> within the declaration of List<T>
+            if(type->hasGenerics) {
+                copy = instance_copyType(type);
+                copy->hasGenerics = 1;
+                uint8_t changed = 0;
+                uint32_t i = 0;
+                DataType* ref;
+                vec_foreach(&type->genericRefs, ref, i) {
+                    DataType* substituted = instance_substitute(params, ref);
+                    changed |= substituted != ref;
+                    vec_push(&copy->genericRefs, substituted);
+                }
+                if(!changed) {
+                    vec_deinit(&copy->genericRefs);
+                    free(copy);
+                    return type;
+                }
+                return copy;
+            }
+            return type;
+        }
+        case DT_ARRAY: {
+            DataType* arrayOf = instance_substitute(params, type->arrayType->arrayOf);
+            if(arrayOf == type->arrayType->arrayOf) {
+                return type;
+            }
+            copy = instance_copyType(type);
+            copy->arrayType = ast_type_makeArray();
+            copy->arrayType->len = type->arrayType->len;
+            copy->arrayType->arrayOf = arrayOf;
+            return copy;
+        }
+        case DT_PTR: {
+            DataType* target = instance_substitute(params, type->ptrType->target);
+            if(target == type->ptrType->target) {
+                return type;
+            }
+            copy = instance_copyType(type);
+            copy->ptrType = ast_type_makePtr();
+            copy->ptrType->target = target;
+            return copy;
+        }
+        case DT_TYPE_UNION:
+        case DT_TYPE_JOIN: {
+            DataType* left = instance_substitute(params, type->unionType->left);
+            DataType* right = instance_substitute(params, type->unionType->right);
+            if(left == type->unionType->left && right == type->unionType->right) {
+                return type;
+            }
+            copy = instance_copyType(type);
+            if(type->kind == DT_TYPE_UNION) {
+                copy->unionType = ast_type_makeUnion();
+                copy->unionType->left = left;
+                copy->unionType->right = right;
+            }
+            else {
+                copy->joinType = ast_type_makeJoin();
+                copy->joinType->left = left;
+                copy->joinType->right = right;
+            }
+            tc_flattenUnion(copy);
+            return copy;
+        }
+        case DT_FN: {
+            uint8_t changed = 0;
+            FnType* fnType = instance_substituteFn(params, type->fnType, &changed);
+            if(!changed) {
+                // nothing to specialize, the copy is dropped
+                instance_dropFn(fnType);
+                return type;
+            }
+            copy = instance_copyType(type);
+            copy->fnType = fnType;
+            return copy;
+        }
+        case DT_STRUCT: {
+            uint8_t changed = 0;
+            StructType* structType = ast_type_makeStruct(type->scope);
+            uint32_t i = 0;
+            char* attName;
+            StructAttribute* attribute;
+            omap_foreach(&type->structType->attributes, attName, attribute, i) {
+                StructAttribute* attributeCopy = ast_type_makeStructAttribute();
+                attributeCopy->name = attribute->name;
+                attributeCopy->type = instance_substitute(params, attribute->type);
+                changed |= attributeCopy->type != attribute->type;
+                omap_set(&structType->attributes, attName, attributeCopy);
+            }
+            DataType* parent;
+            vec_foreach(&type->structType->extends, parent, i) {
+                DataType* substituted = instance_substitute(params, parent);
+                changed |= substituted != parent;
+                vec_push(&structType->extends, substituted);
+            }
+            if(!changed) {
+                instance_dropStruct(structType);
+                return type;
+            }
+            copy = instance_copyType(type);
+            copy->structType = structType;
+            return copy;
+        }
+        default:
+            // classes, interfaces and variants keep their generic parameters
+            return type;
+    }
+}
+
+/**
+ * Finds the instance of a declaration for the given type arguments, or makes it
+ */
+static Instance* instance_get(Parser* parser, ASTScope* scope, const void* decl, vec_str_small_t* genericNames,
+                              vec_dtype_small_t* typeArgs, Lexeme lexeme, const char* declName) {
+    PARSER_ASSERT(typeArgs->length == genericNames->length, "`%s` expects %d type argument%s but %d were given",
+                  declName, genericNames->length, genericNames->length > 1 ? "s" : "", typeArgs->length);
+
+    sds key = sdscatprintf(sdsempty(), "%p", decl);
+    uint32_t i = 0;
+    DataType* arg;
+    vec_foreach(typeArgs, arg, i) {
+        key = sdscat(key, "<");
+        key = instance_keyOf(parser, scope, key, arg);
+    }
+
+    Instance** cached = map_get(&parser->instances.byKey, key);
+    if(cached != NULL) {
+        parser->instances.stats.hits++;
+        sdsfree(key);
+        return *cached;
+    }
+    parser->instances.stats.misses++;
+
+    Instance* instance = malloc(sizeof(Instance));
+    instance->decl = decl;
+    vec_init(&instance->typeArgs);
+    vec_extend(&instance->typeArgs, typeArgs);
+    instance->type = NULL;
+    map_set(&parser->instances.byKey, key, instance);
+    vec_push(&parser->instances.instances, instance);
+    sdsfree(key);
+    return instance;
+}
+
+static void instance_bindParams(map_dtype_t* params, vec_str_small_t* genericNames, vec_dtype_small_t* typeArgs) {
+    map_init(params);
+    uint32_t i = 0;
+    char* name;
+    vec_foreach(genericNames, name, i) {
+        map_set(params, name, typeArgs->data[i]);
+    }
+}
+
+DataType* instance_ofFunction(Parser* parser, ASTScope* scope, DataType* fnType, vec_dtype_small_t* typeArgs, Lexeme lexeme) {
+    FnHeader* header = fnType->fnType->header;
+    ASSERT(header != NULL && header->isGeneric, "Expected the type of a generic function");
+
+    Instance* instance = instance_get(parser, scope, header, &header->genericNames, typeArgs, lexeme,
+                                      header->name != NULL ? header->name : "anonymous function");
+    if(instance->type != NULL) {
+        return instance->type;
+    }
+
+    map_dtype_t params;
+    instance_bindParams(&params, &header->genericNames, typeArgs);
+    uint8_t changed = 0;
+    DataType* type = instance_copyType(fnType);
+    type->fnType = instance_substituteFn(&params, header->type, &changed);
+    type->fnType->header = header;
+    map_deinit(&params);
+
+    instance->type = type;
+    return type;
+}
+
+DataType* instance_ofType(Parser* parser, ASTScope* scope, DataType* decl, vec_dtype_small_t* typeArgs, Lexeme lexeme) {
+    Instance* instance = instance_get(parser, scope, decl, &decl->genericNames, typeArgs, lexeme, decl->name);
+    if(instance->type != NULL) {
+        return instance->type;
+    }
+
+    map_dtype_t params;
+    instance_bindParams(&params, &decl->genericNames, typeArgs);
+    DataType* definition = instance_substitute(&params, decl->refType->ref);
+    map_deinit(&params);
+
+    if(definition != decl->refType->ref) {
+        // i.e `type Id<T> = T`, the definition is the argument itself, which belongs to the caller
+        uint32_t i = 0;
+        DataType* arg;
+        vec_foreach(typeArgs, arg, i) {
+            if(definition == arg) {
+                definition = instance_copyArgument(definition);
+                break;
+            }
+        }
+
+        // named after its arguments, i.e in diagnostics
+        sds name = sdscatprintf(sdsempty(), "%s<", decl->name);
+        vec_foreach(typeArgs, arg, i) {
+            name = sdscatprintf(name, "%s%s", i > 0 ? ", " : "", describeType(arg));
+        }
+        name = sdscat(name, ">");
+        definition->name = strdup(name);
+        sdsfree(name);
+    }
+
+    // set before resolving, a type may refer to itself through a pointer
+    instance->type = definition;
+    instance->type = ti_type_findBase(parser, scope, definition);
+    return instance->type;
+}
@@ -0,0 +1,76 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_INSTANCE_H
+#define TYPE_C_INSTANCE_H
+
+#include <stdint.h>
+#include "ast.h"
+#include "lexer.h"
+#include "../utils/vec.h"
+#include "../utils/map.h"
+
+struct Parser;
+
+/**
+ * Instantiations of generic declarations, made once per program.
+ * A generic function or type given the same type arguments, written the same way or not,
+ * is specialized the first time and that specialization is reused by every later use,
+ * i.e `id<u32>(x)` called from a hundred places yields a single `fn(a: u32) -> u32`.
+ *
+ * Type arguments are compared by their canonical form: primitives by kind, arrays, pointers,
+ * functions by their parts, unions and joins by their set of members, and anything else by the
+ * declaration they resolve to.
+ * Instances are never invalidated: a declaration which is parsed again is a new declaration.
+ */
+
+typedef struct Instance {
+    // generic declaration, its FnHeader for a function, its type declaration for a type
+    const void* decl;
+    vec_dtype_t typeArgs;
+    // the declaration, with its generic parameters replaced by the type arguments
+    DataType* type;
+}Instance;
+
+typedef map_t(Instance*) map_instance_t;
+typedef vec_t(Instance*) vec_instance_t;
+
+typedef struct InstanceStats {
+    uint64_t hits;
+    uint64_t misses;
+}InstanceStats;
+
+typedef struct InstanceCache {
+    // by declaration and canonical type arguments, see instance_keyOf
+    map_instance_t byKey;
+    vec_instance_t instances;
+    InstanceStats stats;
+}InstanceCache;
+
+void instance_cache_init(InstanceCache* cache);
+void instance_cache_deinit(InstanceCache* cache);
+
+/**
+ * Specializes a generic function
+ * @param parser
+ * @param scope scope of the use, type arguments are resolved in it
+ * @param fnType function type made from a generic header, see FnType.header
+ * @param typeArgs
+ * @param lexeme where errors are reported
+ * @return the function type of the instance, errors are raised through the parser
+ */
+DataType* instance_ofFunction(struct Parser* parser, ASTScope* scope, DataType* fnType, vec_dtype_small_t* typeArgs, Lexeme lexeme);
+
+/**
+ * Specializes a generic type declaration
+ * @param parser
+ * @param scope scope of the use, type arguments are resolved in it
+ * @param decl type declaration with isGeneric set
+ * @param typeArgs
+ * @param lexeme where errors are reported
+ * @return the base type of the instance, errors are raised through the parser
+ */
+DataType* instance_ofType(struct Parser* parser, ASTScope* scope, DataType* decl, vec_dtype_small_t* typeArgs, Lexeme lexeme);
+
+#endif //TYPE_C_INSTANCE_H
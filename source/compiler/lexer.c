@@ -19,7 +19,7 @@
  * @return true if lexer is at end, false otherwise
  */
 uint8_t isAtEnd(LexerState* lexerState) {
-    return lexerState->buffer[lexerState->pos] == '\0';
+    return lexerState->pos >= lexerState->len || lexerState->buffer[lexerState->pos] == '\0';
 }
 
 /**
@@ -28,6 +28,9 @@ uint8_t isAtEnd(LexerState* lexerState) {
  * @return current character
  */
 char getCurrentChar(LexerState* lexerState) {
+    if (lexerState->pos >= lexerState->len){
+        return '\0';
+    }
     return lexerState->buffer[lexerState->pos];
 }
 
@@ -126,7 +129,7 @@ uint8_t match_keyword(LexerState* lexerState, const char* pattern) {
  * @return next character (or \0 on end)
  */
 char getNextChar(LexerState* lexerState) {
-    if (lexerState->pos > lexerState->len){
+    if (lexerState->pos + 1 >= lexerState->len){
         return '\0';
     }
     return lexerState->buffer[lexerState->pos+1];
@@ -187,6 +190,7 @@ void debugLexer(LexerState* lexerState) {
 LexerState* lexer_init(const char* filename, const char* buffer, uint64_t len) {
     LexerState * lexer = malloc(sizeof(LexerState));
     lexer->buffer = strdup(buffer);
+    lexer->ownsBuffer = 1;
     lexer->filename = strdup(filename);
     lexer->pos = 0;
     lexer->col = 0;
@@ -197,6 +201,20 @@ LexerState* lexer_init(const char* filename, const char* buffer, uint64_t len) {
     return lexer;
 }
 
+LexerState* lexer_initRange(const char* filename, const char* buffer, uint64_t start, uint64_t end,
+                            uint32_t line, uint32_t col) {
+    LexerState * lexer = malloc(sizeof(LexerState));
+    lexer->buffer = buffer;
+    lexer->ownsBuffer = 0;
+    lexer->filename = strdup(filename);
+    lexer->pos = start;
+    lexer->len = end;
+    lexer->line = line;
+    lexer->col = col;
+
+    return lexer;
+}
+
 Lexeme lexer_next(LexerState* lexerState) {
 
 }
@@ -206,7 +224,12 @@ Lexeme lexer_peek(LexerState* lexerState) {
 }
 
 void lexer_free(LexerState* lexerState) {
-
+    // lexemes hold their own copies, only ranges borrow their buffer
+    if(lexerState->ownsBuffer) {
+        free((char*)lexerState->buffer);
+    }
+    free((char*)lexerState->filename);
+    free(lexerState);
 }
 
 Lexeme makeLexem(TokenType type, const char* value, LexerState* lexerState) {
@@ -363,6 +386,19 @@ Lexeme lexOctalValue(LexerState* lexerState){
 }
 
 
+/**
+ * Wraps a string or char literal that runs into the end of the input as an invalid token,
+ * so that editing a file with an open quote does not lex past the buffer.
+ */
+static Lexeme lexUnterminated(LexerState* lexerState, uint64_t start, uint32_t line, uint32_t col, uint32_t pos) {
+    uint64_t len = lexerState->pos - start + 1;
+    char* str_val = malloc(len*sizeof(char));
+    memcpy(str_val, lexerState->buffer+start, len*sizeof(char)-1);
+    str_val[len-1] = '\0';
+
+    return makeLexemLineCol(TOK_INVALID, str_val, line, col, pos);
+}
+
 Lexeme lexString(LexerState* lexerState){
     uint64_t start = lexerState->pos;
     uint32_t line = lexerState->line;
@@ -373,6 +409,10 @@ Lexeme lexString(LexerState* lexerState){
     incLexer(lexerState);
     char c = getCurrentChar(lexerState);
     while(c != '"') {
+        if(c == '\0') {
+            // unterminated, the parser reports what was read so far
+            return lexUnterminated(lexerState, start, line, col, pos);
+        }
         incLexer(lexerState);
         // skip \"
         match(lexerState, "\\\"");
@@ -403,6 +443,10 @@ Lexeme lexChar(LexerState* lexerState){
     incLexer(lexerState);
     char c = getCurrentChar(lexerState);
     while(c != '\'') {
+        if(c == '\0') {
+            // unterminated, the parser reports what was read so far
+            return lexUnterminated(lexerState, start, line, col, pos);
+        }
         incLexer(lexerState);
         // skip \"
         match(lexerState, "\\\'");
@@ -514,12 +558,13 @@ Lexeme lexNumber(LexerState* lexerState){
 
 Lexeme lexer_lexCurrent(LexerState* lex) {
     Lexeme current;
+    // tokens start after the spaces and comments before them
+    skipSpaces(lex);
+
     uint32_t line = lex->line;
     uint32_t col = lex->col;
     uint32_t pos = lex->pos;
 
-    skipSpaces(lex);
-
     const char c = getCurrentChar(lex);
 
     switch (c) {
@@ -708,8 +753,10 @@ Lexeme lexer_lexCurrent(LexerState* lex) {
             }
         }
     }
-    // throw error at current lexem line and col
-    ASSERT(0 == 0,
-           "Line: %"PRIu16", Col: %"PRIu16" invalid symbol `%c`",
-            lex->line, lex->col, c);
+    // the character is consumed, the parser reports it and moves on
+    char* str_val = malloc(2*sizeof(char));
+    str_val[0] = c;
+    str_val[1] = '\0';
+    incLexer(lex);
+    return makeLexemLineCol(TOK_INVALID, str_val, line, col, pos);
 }
\ No newline at end of file
@@ -17,16 +17,37 @@ typedef struct Lexeme {
 }Lexeme;
 
 typedef struct LexerState {
-    const char* filename; /*< Buffer source */
+    const char* filename; /*< Buffer source, owned by the lexer */
     const char* buffer; /*< Buffer data */
+    uint8_t ownsBuffer; /*< 1 if the buffer is a copy freed along with the lexer */
     uint64_t pos;  /*< Buffer pos */
-    uint64_t len;  /*< Buffer length */
+    uint64_t len;  /*< Buffer length, lexing stops there */
 
     uint32_t line; /*< Current line */
     uint32_t col;  /*< Current col */
 }LexerState;
 
+/**
+ * Lexes a whole buffer, both the buffer and the filename are copied.
+ * @param filename
+ * @param buffer
+ * @param len
+ * @return new lexer state
+ */
 LexerState* lexer_init(const char* filename, const char* buffer, uint64_t len);
+/**
+ * Lexes a range of a buffer, which is borrowed and must outlive the lexer. The filename is copied.
+ * Token offsets are the ones they have in the whole buffer.
+ * @param filename
+ * @param buffer
+ * @param start offset of the first character
+ * @param end offset past the last character
+ * @param line line of the first character, one-based
+ * @param col column of the first character
+ * @return new lexer state
+ */
+LexerState* lexer_initRange(const char* filename, const char* buffer, uint64_t start, uint64_t end,
+                            uint32_t line, uint32_t col);
 Lexeme lexer_next(LexerState* lexerState);
 Lexeme lexer_peek(LexerState* lexerState);
 void lexer_free(LexerState* lexerState);
@@ -0,0 +1,88 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include "log.h"
+
+uint32_t log_mask = 0;
+// parsers may be created on several threads at once
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+
+static void log_readEnvironment(void) {
+    const char* env = getenv("TYPE_C_TRACE");
+    if(env != NULL) {
+        log_mask |= log_categoriesFromString(env);
+    }
+}
+
+void log_init(void) {
+    pthread_once(&log_once, log_readEnvironment);
+}
+
+void log_enable(uint32_t categories) {
+    log_mask |= categories;
+}
+
+void log_disable(uint32_t categories) {
+    log_mask &= ~categories;
+}
+
+static uint32_t log_categoryFromName(const char* name, size_t len) {
+    static const struct { const char* name; uint32_t category; } categories[] = {
+            {"parser", LOG_PARSER},
+            {"imports", LOG_IMPORTS},
+            {"types", LOG_TYPES},
+            {"inference", LOG_INFERENCE},
+            {"all", LOG_ALL},
+    };
+
+    uint32_t i = 0;
+    for(; i < sizeof(categories)/sizeof(categories[0]); i++) {
+        if(strlen(categories[i].name) == len && strncmp(categories[i].name, name, len) == 0) {
+            return categories[i].category;
+        }
+    }
+    return 0;
+}
+
+uint32_t log_categoriesFromString(const char* str) {
+    uint32_t mask = 0;
+    while(*str) {
+        const char* end = strchr(str, ',');
+        size_t len = end != NULL ? (size_t)(end - str) : strlen(str);
+        mask |= log_categoryFromName(str, len);
+        str += len;
+        if(*str == ',') {
+            str++;
+        }
+    }
+    return mask;
+}
+
+const char* log_categoryToString(LogCategory category) {
+    switch (category) {
+        case LOG_PARSER:
+            return "parser";
+        case LOG_IMPORTS:
+            return "imports";
+        case LOG_TYPES:
+            return "types";
+        case LOG_INFERENCE:
+            return "inference";
+        default:
+            return "all";
+    }
+}
+
+void log_trace(LogCategory category, const char* fmt, ...) {
+    va_list vl;
+    va_start(vl, fmt);
+    fprintf(stderr, "[%s] ", log_categoryToString(category));
+    vfprintf(stderr, fmt, vl);
+    va_end(vl);
+}
@@ -0,0 +1,64 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_LOG_H
+#define TYPE_C_LOG_H
+
+#include <stdint.h>
+
+/**
+ * Trace categories, enabled at runtime through the TYPE_C_TRACE environment
+ * variable, i.e TYPE_C_TRACE=imports,types or TYPE_C_TRACE=all
+ */
+typedef enum LogCategory {
+    LOG_PARSER = 1 << 0,     // parser progress
+    LOG_IMPORTS = 1 << 1,    // import statements, as JSON
+    LOG_TYPES = 1 << 2,      // type declarations, as JSON
+    LOG_INFERENCE = 1 << 3,  // inferred types
+    LOG_ALL = 0xFFFF
+}LogCategory;
+
+/**
+ * Enabled categories, a mask of LogCategory
+ */
+extern uint32_t log_mask;
+
+/**
+ * Reads TYPE_C_TRACE, once.
+ */
+void log_init(void);
+
+void log_enable(uint32_t categories);
+void log_disable(uint32_t categories);
+
+/**
+ * Parses a comma separated list of category names
+ * @param str
+ * @return mask of LogCategory
+ */
+uint32_t log_categoriesFromString(const char* str);
+
+const char* log_categoryToString(LogCategory category);
+
+void log_trace(LogCategory category, const char* fmt, ...);
+
+/**
+ * Trace points are compiled in only when TYPE_C_ENABLE_TRACE is defined
+ * (cmake -DTYPE_C_TRACE=ON). Otherwise they expand to nothing, and their
+ * arguments are never evaluated.
+ * When compiled in, arguments are evaluated only if the category is enabled.
+ */
+#if defined(TYPE_C_ENABLE_TRACE)
+#define TRACE_ENABLED(category) ((log_mask & (category)) != 0)
+#define TRACE(category, fmt, ...) do { \
+    if(TRACE_ENABLED(category)) {      \
+        log_trace(category, fmt, ##__VA_ARGS__); \
+    }                                  \
+} while(0)
+#else
+#define TRACE_ENABLED(category) 0
+#define TRACE(category, fmt, ...) do { } while(0)
+#endif
+
+#endif //TYPE_C_LOG_H
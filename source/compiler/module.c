@@ -0,0 +1,907 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include "module.h"
+#include "lexer.h"
+#include "type_inference.h"
+#include "scope.h"
+#include "log.h"
+#include "parser_parallel.h"
+#include "parser_resolve.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+uint64_t module_hash(const char* data, size_t len) {
+    uint64_t hash = FNV_OFFSET;
+    size_t i = 0;
+    for(; i < len; i++) {
+        hash = (hash ^ (uint8_t)data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+sds module_readFile(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if(f == NULL) {
+        return NULL;
+    }
+
+    sds content = sdsempty();
+    char buffer[16384];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        content = sdscatlen(content, buffer, n);
+    }
+    fclose(f);
+    return content;
+}
+
+static uint8_t module_absolutePath(const char* path, char absolute[PATH_MAX]) {
+    if(path[0] == '/') {
+        snprintf(absolute, PATH_MAX, "%s", path);
+        return 1;
+    }
+    char cwd[PATH_MAX];
+    if(getcwd(cwd, PATH_MAX) == NULL) {
+        return 0;
+    }
+    snprintf(absolute, PATH_MAX, "%s/%s", cwd, path);
+    return 1;
+}
+
+/**
+ * In-memory source of a path, NULL if it is on disk
+ */
+static sds module_cache_source(ModuleCache* cache, const char* path) {
+    if(cache == NULL) {
+        return NULL;
+    }
+    // read by several workers at once, map_get writes to the map
+    sds* text = map_get_(&cache->sources.base, path);
+    return text != NULL ? *text : NULL;
+}
+
+static uint8_t module_cache_exists(ModuleCache* cache, const char* path) {
+    return module_cache_source(cache, path) != NULL || access(path, R_OK) == 0;
+}
+
+/**
+ * Reads a source, from memory if it was given to the cache
+ */
+static sds module_cache_read(ModuleCache* cache, const char* path) {
+    sds text = module_cache_source(cache, path);
+    return text != NULL ? sdsdup(text) : module_readFile(path);
+}
+
+/**
+ * Absolute path of a file, which must exist. Files on disk have their links resolved.
+ */
+static uint8_t module_cache_canonical(ModuleCache* cache, const char* path, char canonical[PATH_MAX]) {
+    char absolute[PATH_MAX];
+    if(!module_absolutePath(path, absolute)) {
+        return 0;
+    }
+    if(module_cache_source(cache, absolute) != NULL) {
+        memcpy(canonical, absolute, PATH_MAX);
+        return 1;
+    }
+    return realpath(path, canonical) != NULL;
+}
+
+sds module_resolveImport(ModuleCache* cache, const char* importerPath, ImportStmt* import, uint32_t* prefixLength) {
+    // imports are relative to the importer's directory
+    const char* slash = strrchr(importerPath, '/');
+    sds dir = slash != NULL ? sdsnewlen(importerPath, slash - importerPath + 1) : sdsempty();
+
+    int32_t length = import->path->ids.length;
+    for(; length > 0; length--) {
+        sds candidate = sdsdup(dir);
+        int32_t i = 0;
+        for(; i < length; i++) {
+            candidate = sdscatprintf(candidate, "%s%s", i > 0 ? "/" : "", import->path->ids.data[i]);
+        }
+        candidate = sdscat(candidate, ".tc");
+        uint8_t found = module_cache_exists(cache, candidate);
+        if(!found) {
+            candidate = sdscat(candidate, "i");
+            found = module_cache_exists(cache, candidate);
+        }
+        if(found) {
+            if(prefixLength != NULL) {
+                *prefixLength = length;
+            }
+            sdsfree(dir);
+            return candidate;
+        }
+        sdsfree(candidate);
+    }
+
+    sdsfree(dir);
+    return NULL;
+}
+
+sds module_summarize(const char* path, const char* source) {
+    LexerState* lex = lexer_init(path, source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser->lazyBodies = 1;
+    parser->depGraph = depgraph_make();
+    ASTProgramNode* program = ast_makeProgramNode();
+    parser->programNode = program;
+
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        parser_parseProgram(parser, program);
+    }
+    parser->recovery = NULL;
+
+    uint32_t len = strlen(source);
+    vec_depnode_t* nodes = &parser->depGraph->nodes;
+    vec_skippedrange_t* bodies = &parser->skippedBodies;
+
+    // imports, and whatever comes before the first declaration
+    sds summary = sdsnewlen(source, nodes->length > 0 ? nodes->data[0]->start : 0);
+    uint32_t i = 0, body = 0;
+    DepNode* node;
+    vec_foreach(nodes, node, i) {
+        // statements are implementation
+        if(node->kind == DNK_STATEMENT || node->tokenCount == 0) {
+            continue;
+        }
+        uint32_t end = node->end > 0 ? node->end : len;
+        uint32_t pos = node->start;
+        while(body < (uint32_t)bodies->length && bodies->data[body].start < pos) {
+            body++;
+        }
+        for(; body < (uint32_t)bodies->length && bodies->data[body].end <= end; body++) {
+            summary = sdscatlen(summary, source + pos, bodies->data[body].start - pos);
+            summary = sdscat(summary, "{}");
+            pos = bodies->data[body].end;
+        }
+        summary = sdscatlen(summary, source + pos, end - pos);
+    }
+
+    parser_free(parser);
+    return summary;
+}
+
+static void module_free(Module* module) {
+    // the AST is not released, nodes are shared freely and there is no destructor for them yet
+    uint32_t i = 0;
+    char* path;
+    vec_foreach(&module->imports, path, i) { free(path); }
+    vec_deinit(&module->imports);
+    vec_deinit(&module->importHashes);
+    if(module->parser != NULL) {
+        parser_free(module->parser);
+    }
+    sdsfree(module->source);
+    free(module->path);
+    free(module);
+}
+
+static void module_freeInterface(ModuleInterface* interface) {
+    parser_free(interface->parser);
+    sdsfree(interface->text);
+    free(interface->path);
+    free(interface);
+}
+
+static uint8_t module_isInterfacePath(const char* path) {
+    size_t len = strlen(path), extLen = strlen(MODULE_INTERFACE_EXTENSION);
+    return len >= extLen && strcmp(path + len - extLen, MODULE_INTERFACE_EXTENSION) == 0;
+}
+
+/**
+ * Makes a declaration of `from` visible in `into`, under another name
+ */
+static uint8_t module_bindDeclaration(ASTScope* into, ASTScope* from, const char* name, const char* as) {
+    // `from` may be read by several workers at once, map_get writes to the map and is avoided
+    FnArgument** variable = map_get_(&from->variables.base, name);
+    if(variable != NULL) {
+        map_set(&into->variables, as, *variable);
+        return 1;
+    }
+    FnDeclStatement** function = map_get_(&from->functions.base, name);
+    if(function != NULL) {
+        map_set(&into->functions, as, *function);
+        return 1;
+    }
+    DataType** dataType = map_get_(&from->dataTypes.base, name);
+    if(dataType != NULL) {
+        map_set(&into->dataTypes, as, *dataType);
+        return 1;
+    }
+    ExternDecl** ffi = map_get_(&from->externDecls.base, name);
+    if(ffi != NULL) {
+        map_set(&into->externDecls, as, *ffi);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Finds an interface loaded during this request
+ */
+static ModuleInterface* module_cache_findInterface(ModuleCache* cache, const char* path) {
+    char canonical[PATH_MAX];
+    if(!module_cache_canonical(cache, path, canonical)) {
+        return NULL;
+    }
+    pthread_mutex_lock(&cache->lock);
+    ModuleInterface** interface = map_get(&cache->interfaces, canonical);
+    pthread_mutex_unlock(&cache->lock);
+    return interface != NULL ? *interface : NULL;
+}
+
+/**
+ * Binds the declarations a program imports into its scope, the interfaces must be loaded.
+ * Namespace imports, i.e `import a.b`, only load the interface, its members are not reachable yet.
+ */
+static void module_bindImports(ModuleCache* cache, const char* path, Parser* parser, ASTProgramNode* program,
+                               vec_str_t* imports, vec_u64_t* importHashes) {
+    // imports carry no position, their errors point to the top of the file
+    DiagnosticSpan span = {parser->lexerState->filename, 1, 0, 0, 0};
+    uint32_t i = 0;
+    ImportStmt* import;
+    vec_foreach(&program->importStatements, import, i) {
+        uint32_t prefixLength = 0;
+        sds importPath = module_resolveImport(cache, path, import, &prefixLength);
+        if(importPath == NULL) {
+            continue;
+        }
+
+        ModuleInterface* interface = module_cache_findInterface(cache, importPath);
+        sdsfree(importPath);
+        if(interface == NULL) {
+            continue;
+        }
+        if(imports != NULL) {
+            vec_push(imports, strdup(interface->path));
+            vec_push(importHashes, interface->hash);
+        }
+
+        if(prefixLength >= (uint32_t)import->path->ids.length) {
+            continue;
+        }
+        const char* name = import->path->ids.data[prefixLength];
+        ASTScopeResult* existing = resolveElement(import->lookupName, program->scope, 0);
+        if(existing != NULL) {
+            free(existing);
+            diagnostics_report(&parser->diagnostics, DS_ERROR, span, NULL, __FUNCTION__, __LINE__, NULL,
+                               "%s already declared, cannot import it from %s", import->lookupName, interface->path);
+        }
+        else if(!module_bindDeclaration(program->scope, interface->program->scope, name, import->lookupName)) {
+            diagnostics_report(&parser->diagnostics, DS_ERROR, span, NULL, __FUNCTION__, __LINE__, NULL,
+                               "%s not found in %s", name, interface->path);
+        }
+    }
+
+    // parents may be imported, they are looked up once the imports are bound
+    resolver_resolveParents(parser);
+}
+
+/**
+ * Canonical paths of the files a program imports, each once, in order
+ */
+static void module_importPaths(ModuleCache* cache, const char* path, ASTProgramNode* program, vec_str_t* paths) {
+    uint32_t i = 0;
+    ImportStmt* import;
+    vec_foreach(&program->importStatements, import, i) {
+        sds importPath = module_resolveImport(cache, path, import, NULL);
+        char canonical[PATH_MAX];
+        if(importPath != NULL && module_cache_canonical(cache, importPath, canonical)) {
+            uint32_t j = 0;
+            char* existing;
+            uint8_t found = 0;
+            vec_foreach(paths, existing, j) {
+                if(strcmp(existing, canonical) == 0) {
+                    found = 1;
+                    break;
+                }
+            }
+            if(!found) {
+                vec_push(paths, strdup(canonical));
+            }
+        }
+        sdsfree(importPath);
+    }
+}
+
+/**
+ * Parses the text of an interface into a new program, its imports are left unbound
+ * @param filename used in diagnostics
+ */
+static void module_parseInterface(ModuleInterface* interface, const char* filename) {
+    LexerState* lex = lexer_init(filename, interface->text, sdslen(interface->text));
+    Parser* parser = parser_init(lex);
+    parser->lazyBodies = 1;
+    ASTProgramNode* program = ast_makeProgramNode();
+    parser->programNode = program;
+    interface->parser = parser;
+    interface->program = program;
+
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        parser_parseProgram(parser, program);
+    }
+    parser->recovery = NULL;
+}
+
+/**
+ * Hash of the summary, mixed with the hashes of the interfaces it imports, which must be bound
+ */
+static uint64_t module_interfaceHash(ModuleCache* cache, ModuleInterface* interface) {
+    uint64_t hash = module_hash(interface->text, sdslen(interface->text));
+    vec_str_t paths;
+    vec_init(&paths);
+    module_importPaths(cache, interface->path, interface->program, &paths);
+    uint32_t i = 0;
+    char* path;
+    vec_foreach(&paths, path, i) {
+        ModuleInterface* imported = module_cache_findInterface(cache, path);
+        if(imported != NULL) {
+            hash = (hash ^ imported->hash) * FNV_PRIME;
+        }
+        free(path);
+    }
+    vec_deinit(&paths);
+    return hash;
+}
+
+/**
+ * Writes an interface file next to its source, best effort: the directory may not be writable.
+ * It is written aside then renamed over the previous one, so a concurrent reader, another
+ * process included, sees either the old file or the whole new one and never half of it
+ */
+static void module_writeInterface(const char* interfacePath, uint64_t stamp, sds text) {
+    sds tmpPath = sdscatprintf(sdsempty(), "%s.XXXXXX", interfacePath);
+    int fd = mkstemp(tmpPath);
+    if(fd < 0) {
+        sdsfree(tmpPath);
+        return;
+    }
+    FILE* f = fdopen(fd, "w");
+    if(f == NULL) {
+        close(fd);
+        unlink(tmpPath);
+        sdsfree(tmpPath);
+        return;
+    }
+    fprintf(f, MODULE_INTERFACE_MAGIC "%016"PRIx64"\n", stamp);
+    size_t written = fwrite(text, 1, sdslen(text), f);
+    int closed = fclose(f);
+    if(written != sdslen(text) || closed != 0 || rename(tmpPath, interfacePath) != 0) {
+        unlink(tmpPath);
+    }
+    sdsfree(tmpPath);
+}
+
+/**
+ * Returns the interface of a module, reading or making it if its source changed,
+ * with its imports left unbound. Safe to call from any worker.
+ */
+static ModuleInterface* module_cache_obtainInterface(ModuleCache* cache, const char* canonical) {
+    pthread_mutex_lock(&cache->lock);
+    ModuleInterface** cached = map_get(&cache->interfaces, canonical);
+    ModuleInterface* interface = cached != NULL ? *cached : NULL;
+    pthread_mutex_unlock(&cache->lock);
+    // already checked during this request
+    if(interface != NULL && interface->generation == cache->generation) {
+        return interface;
+    }
+
+    uint8_t hasSource = !module_isInterfacePath(canonical);
+    sds interfacePath = hasSource ? sdscat(sdsnew(canonical), "i") : sdsnew(canonical);
+    sds source = hasSource ? module_cache_read(cache, canonical) : NULL;
+    uint8_t inMemory = module_cache_source(cache, canonical) != NULL;
+    // the interface of an in-memory source is kept in memory only
+    sds file = inMemory ? NULL : module_cache_read(cache, interfacePath);
+    if((hasSource ? source : file) == NULL) {
+        sdsfree(interfacePath);
+        sdsfree(file);
+        return NULL;
+    }
+    uint64_t stamp = hasSource ? module_hash(source, sdslen(source)) : module_hash(file, sdslen(file));
+
+    if(interface != NULL && interface->stamp == stamp) {
+        pthread_mutex_lock(&cache->lock);
+        cache->stats.interfaceHits++;
+        pthread_mutex_unlock(&cache->lock);
+        sdsfree(interfacePath);
+        sdsfree(source);
+        sdsfree(file);
+        return interface;
+    }
+
+    // an interface file is used if it was made from the current source
+    sds text = NULL;
+    uint8_t built = 0;
+    size_t magicLen = strlen(MODULE_INTERFACE_MAGIC);
+    if(file != NULL && strncmp(file, MODULE_INTERFACE_MAGIC, magicLen) == 0) {
+        char* newLine = strchr(file, '\n');
+        uint64_t madeFrom = strtoull(file + magicLen, NULL, 16);
+        if(newLine != NULL && (!hasSource || madeFrom == stamp)) {
+            text = sdsnew(newLine + 1);
+        }
+    }
+    if(text == NULL && source != NULL) {
+        text = module_summarize(canonical, source);
+        built = 1;
+
+        if(!inMemory) {
+            module_writeInterface(interfacePath, stamp, text);
+        }
+    }
+    sdsfree(source);
+    sdsfree(file);
+    if(text == NULL) {
+        sdsfree(interfacePath);
+        return NULL;
+    }
+
+    ModuleInterface* fresh = malloc(sizeof(ModuleInterface));
+    fresh->path = strdup(canonical);
+    fresh->stamp = stamp;
+    fresh->hash = 0;
+    fresh->text = text;
+    // bound later, once its imports are
+    fresh->generation = 0;
+
+    module_parseInterface(fresh, interfacePath);
+    sdsfree(interfacePath);
+
+    pthread_mutex_lock(&cache->lock);
+    if(built) {
+        cache->stats.interfaceBuilds++;
+    }
+    else {
+        cache->stats.interfaceLoads++;
+    }
+    map_set(&cache->interfaces, canonical, fresh);
+    pthread_mutex_unlock(&cache->lock);
+    if(interface != NULL) {
+        module_freeInterface(interface);
+    }
+    return fresh;
+}
+
+static ThreadPool* module_cache_pool(ModuleCache* cache) {
+    if(cache->pool == NULL) {
+        cache->pool = threadpool_make(cache->jobs);
+    }
+    return cache->pool;
+}
+
+typedef struct ImportGraph ImportGraph;
+typedef struct ImportNode ImportNode;
+typedef vec_t(ImportNode*) vec_importnode_t;
+typedef map_t(ImportNode*) map_importnode_t;
+
+/**
+ * A module reached while loading the imports of a request
+ */
+struct ImportNode {
+    ImportGraph* graph;
+    char* path;
+    // NULL if it could not be read
+    ModuleInterface* interface;
+    vec_importnode_t deps;
+    // importers waiting for it to be bound
+    vec_importnode_t waiting;
+    // deps not bound yet
+    uint32_t pending;
+    uint8_t bound;
+};
+
+struct ImportGraph {
+    ModuleCache* cache;
+    // guards the nodes, their edges and counters
+    pthread_mutex_t lock;
+    map_importnode_t nodes;
+    // in discovery order
+    vec_importnode_t order;
+};
+
+static void module_graph_load(void* arg);
+
+/**
+ * Returns the node of a path, scheduling its load if it is new. The graph lock must be held.
+ */
+static ImportNode* module_graph_node(ImportGraph* graph, const char* path) {
+    ImportNode** existing = map_get(&graph->nodes, path);
+    if(existing != NULL) {
+        return *existing;
+    }
+
+    ImportNode* node = malloc(sizeof(ImportNode));
+    node->graph = graph;
+    node->path = strdup(path);
+    node->interface = NULL;
+    vec_init(&node->deps);
+    vec_init(&node->waiting);
+    node->pending = 0;
+    node->bound = 0;
+    map_set(&graph->nodes, path, node);
+    vec_push(&graph->order, node);
+    threadpool_submit(graph->cache->pool, module_graph_load, node);
+    return node;
+}
+
+/**
+ * Binds the imports of a node whose deps are bound, and releases the importers waiting on it
+ */
+static void module_graph_bind(ImportNode* node) {
+    ImportGraph* graph = node->graph;
+    ModuleInterface* interface = node->interface;
+    if(interface != NULL && interface->generation != graph->cache->generation) {
+        uint64_t hash = module_interfaceHash(graph->cache, interface);
+        uint8_t bind = interface->generation == 0;
+        if(!bind && hash != interface->hash) {
+            // bound to interfaces which changed since, its declarations are bound again in a new scope
+            sds filename = sdsnew(interface->parser->lexerState->filename);
+            parser_free(interface->parser);
+            module_parseInterface(interface, filename);
+            sdsfree(filename);
+            bind = 1;
+        }
+        if(bind) {
+            module_bindImports(graph->cache, interface->path, interface->parser, interface->program, NULL, NULL);
+        }
+        interface->hash = hash;
+        interface->generation = graph->cache->generation;
+    }
+
+    vec_importnode_t ready;
+    vec_init(&ready);
+    pthread_mutex_lock(&graph->lock);
+    node->bound = 1;
+    uint32_t i = 0;
+    ImportNode* importer;
+    vec_foreach(&node->waiting, importer, i) {
+        if(--importer->pending == 0) {
+            vec_push(&ready, importer);
+        }
+    }
+    pthread_mutex_unlock(&graph->lock);
+
+    vec_foreach(&ready, importer, i) {
+        threadpool_submit(graph->cache->pool, (ThreadPoolFn)module_graph_bind, importer);
+    }
+    vec_deinit(&ready);
+}
+
+static void module_graph_load(void* arg) {
+    ImportNode* node = arg;
+    ImportGraph* graph = node->graph;
+    ModuleInterface* interface = module_cache_obtainInterface(graph->cache, node->path);
+
+    // an interface checked earlier during this request has its whole graph checked too
+    vec_str_t paths;
+    vec_init(&paths);
+    if(interface != NULL && interface->generation != graph->cache->generation) {
+        module_importPaths(graph->cache, interface->path, interface->program, &paths);
+    }
+
+    pthread_mutex_lock(&graph->lock);
+    node->interface = interface;
+    uint32_t i = 0;
+    char* path;
+    vec_foreach(&paths, path, i) {
+        ImportNode* dep = module_graph_node(graph, path);
+        vec_push(&node->deps, dep);
+        if(!dep->bound) {
+            vec_push(&dep->waiting, node);
+            node->pending++;
+        }
+        free(path);
+    }
+    uint8_t ready = node->pending == 0;
+    pthread_mutex_unlock(&graph->lock);
+    vec_deinit(&paths);
+
+    if(ready) {
+        module_graph_bind(node);
+    }
+}
+
+/**
+ * Loads the interfaces of the given modules and of everything they import, on the cache's workers
+ * @param paths canonical paths
+ */
+static void module_cache_loadGraph(ModuleCache* cache, vec_str_t* paths) {
+    if(paths->length == 0) {
+        return;
+    }
+    module_cache_pool(cache);
+
+    ImportGraph graph;
+    graph.cache = cache;
+    pthread_mutex_init(&graph.lock, NULL);
+    map_init(&graph.nodes);
+    vec_init(&graph.order);
+
+    pthread_mutex_lock(&graph.lock);
+    uint32_t i = 0;
+    char* path;
+    vec_foreach(paths, path, i) {
+        module_graph_node(&graph, path);
+    }
+    pthread_mutex_unlock(&graph.lock);
+    threadpool_wait(cache->pool);
+
+    // whatever is left waits on a cycle, which is broken at the first node found
+    ImportNode* node;
+    vec_foreach(&graph.order, node, i) {
+        if(!node->bound) {
+            module_graph_bind(node);
+            threadpool_wait(cache->pool);
+        }
+    }
+
+    cache->stats.graphs++;
+    cache->stats.graphNodes += graph.order.length;
+    vec_foreach(&graph.order, node, i) {
+        vec_deinit(&node->deps);
+        vec_deinit(&node->waiting);
+        free(node->path);
+        free(node);
+    }
+    vec_deinit(&graph.order);
+    map_deinit(&graph.nodes);
+    pthread_mutex_destroy(&graph.lock);
+}
+
+ModuleInterface* module_cache_loadInterface(ModuleCache* cache, const char* path) {
+    char canonical[PATH_MAX];
+    if(!module_cache_canonical(cache, path, canonical)) {
+        return NULL;
+    }
+    vec_str_t paths;
+    vec_init(&paths);
+    vec_push(&paths, canonical);
+    module_cache_loadGraph(cache, &paths);
+    vec_deinit(&paths);
+    return module_cache_findInterface(cache, canonical);
+}
+
+static void module_compile(ModuleCache* cache, Module* module) {
+    LexerState* lex = lexer_init(module->path, module->source, sdslen(module->source));
+    Parser* parser = parser_init(lex);
+    ASTProgramNode* program = ast_makeProgramNode();
+    parser->programNode = program;
+    module->parser = parser;
+    module->program = program;
+    // in-memory sources have nowhere to keep their graph
+    uint8_t incremental = cache->incremental && module_cache_source(cache, module->path) == NULL;
+    if(incremental) {
+        parser->depGraph = depgraph_make();
+    }
+
+    // errors outside of a declaration, i.e in imports, must not bring the process down
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        // large files are split across the workers
+        parser_parallel_parseProgram(parser, program, sdslen(module->source) >= PARSER_PARALLEL_MIN_SIZE ?
+                                                      module_cache_pool(cache) : NULL);
+    }
+    parser->recovery = NULL;
+
+    // references are resolved lazily, imported declarations only have to be bound before inference
+    vec_str_t paths;
+    vec_init(&paths);
+    module_importPaths(cache, module->path, program, &paths);
+    module_cache_loadGraph(cache, &paths);
+    uint32_t i = 0;
+    char* path;
+    vec_foreach(&paths, path, i) { free(path); }
+    vec_deinit(&paths);
+    module_bindImports(cache, module->path, parser, program, &module->imports, &module->importHashes);
+
+    sds graphPath = NULL;
+    if(incremental) {
+        // declarations are checked against the interfaces of the imports too, when one
+        // of them changes the previous graph is ignored and everything is rechecked
+        DepGraph* graph = parser->depGraph;
+        graph->context = module_hash((const char*)module->importHashes.data,
+                                     module->importHashes.length * sizeof(uint64_t));
+        graphPath = sdscat(sdsnew(module->path), "g");
+        depgraph_load(graph, graphPath);
+        depgraph_resolve(graph);
+    }
+
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        ti_runProgram(parser, program);
+    }
+    parser->recovery = NULL;
+
+    if(graphPath != NULL) {
+        depgraph_save(parser->depGraph, graphPath);
+        sdsfree(graphPath);
+    }
+}
+
+/**
+ * Whether the interfaces a module was compiled against are still the same
+ */
+static uint8_t module_importsUnchanged(ModuleCache* cache, Module* module) {
+    module_cache_loadGraph(cache, &module->imports);
+    uint32_t i = 0;
+    char* path;
+    vec_foreach(&module->imports, path, i) {
+        ModuleInterface* interface = module_cache_findInterface(cache, path);
+        if(interface == NULL || interface->hash != module->importHashes.data[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void module_cache_init(ModuleCache* cache) {
+    map_init(&cache->modules);
+    map_init(&cache->interfaces);
+    map_init(&cache->sources);
+    cache->generation = 0;
+    memset(&cache->stats, 0, sizeof(ModuleCacheStats));
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->jobs = 0;
+    cache->incremental = 0;
+    cache->pool = NULL;
+    // sets up the log mask once, before any worker creates a parser
+    log_init();
+}
+
+void module_cache_deinit(ModuleCache* cache) {
+    const char* key;
+    map_iter_t iter = map_iter(&cache->modules);
+    while((key = map_next(&cache->modules, &iter))) {
+        module_free(*map_get(&cache->modules, key));
+    }
+    map_deinit(&cache->modules);
+
+    iter = map_iter(&cache->interfaces);
+    while((key = map_next(&cache->interfaces, &iter))) {
+        module_freeInterface(*map_get(&cache->interfaces, key));
+    }
+    map_deinit(&cache->interfaces);
+
+    iter = map_iter(&cache->sources);
+    while((key = map_next(&cache->sources, &iter))) {
+        sdsfree(*map_get(&cache->sources, key));
+    }
+    map_deinit(&cache->sources);
+
+    if(cache->pool != NULL) {
+        threadpool_free(cache->pool);
+    }
+    pthread_mutex_destroy(&cache->lock);
+}
+
+uint8_t module_cache_setSource(ModuleCache* cache, const char* path, const char* text, size_t len) {
+    char absolute[PATH_MAX];
+    if(!module_absolutePath(path, absolute)) {
+        return 0;
+    }
+
+    sds* existing = map_get(&cache->sources, absolute);
+    if(existing != NULL) {
+        sdsfree(*existing);
+    }
+    map_set(&cache->sources, absolute, sdsnewlen(text, len));
+    return 1;
+}
+
+void module_cache_beginRequest(ModuleCache* cache) {
+    cache->generation++;
+}
+
+Module* module_cache_load(ModuleCache* cache, const char* path) {
+    char canonical[PATH_MAX];
+    if(!module_cache_canonical(cache, path, canonical)) {
+        return NULL;
+    }
+
+    Module** cached = map_get(&cache->modules, canonical);
+    Module* module = cached != NULL ? *cached : NULL;
+    if(module != NULL && module->generation == cache->generation) {
+        return module;
+    }
+
+    sds source = module_cache_read(cache, canonical);
+    if(source == NULL) {
+        return NULL;
+    }
+    uint64_t hash = module_hash(source, sdslen(source));
+
+    if(module != NULL && module->hash == hash && module_importsUnchanged(cache, module)) {
+        cache->stats.hits++;
+        sdsfree(source);
+        module->generation = cache->generation;
+        return module;
+    }
+
+    cache->stats.misses++;
+    if(module != NULL) {
+        module_free(module);
+    }
+
+    module = malloc(sizeof(Module));
+    module->path = strdup(canonical);
+    module->hash = hash;
+    module->source = source;
+    vec_init(&module->imports);
+    vec_init(&module->importHashes);
+    module->parser = NULL;
+    module->program = NULL;
+    module->generation = cache->generation;
+    map_set(&cache->modules, canonical, module);
+    module_compile(cache, module);
+    return module;
+}
+
+void module_cache_drop(ModuleCache* cache, const char* path) {
+    char canonical[PATH_MAX];
+    if(!module_cache_canonical(cache, path, canonical)) {
+        return;
+    }
+
+    Module** module = map_get(&cache->modules, canonical);
+    if(module != NULL) {
+        module_free(*module);
+        map_remove(&cache->modules, canonical);
+    }
+}
+
+static void module_collect(DiagnosticsEngine* engine, DiagnosticsEngine* out) {
+    uint32_t i = 0;
+    Diagnostic* diagnostic;
+    vec_foreach(&engine->diagnostics, diagnostic, i) {
+        vec_push(&out->diagnostics, diagnostic);
+    }
+    out->errorCount += engine->errorCount;
+    out->warningCount += engine->warningCount;
+}
+
+void module_cache_collect(ModuleCache* cache, Module* root, DiagnosticsEngine* all) {
+    module_collect(&root->parser->diagnostics, all);
+
+    // an interface imported twice is reported once
+    map_int_t visited;
+    map_init(&visited);
+    uint32_t i = 0;
+    char* path;
+    vec_foreach(&root->imports, path, i) {
+        ModuleInterface** interface = map_get(&cache->interfaces, path);
+        if(interface != NULL && map_get(&visited, path) == NULL) {
+            map_set(&visited, path, 1);
+            module_collect(&(*interface)->parser->diagnostics, all);
+        }
+    }
+    map_deinit(&visited);
+}
+
+sds module_cache_render(ModuleCache* cache, Module* root, DiagnosticsFormat format, uint32_t* errorCount) {
+    // a view over the diagnostics, which it does not own
+    DiagnosticsEngine all;
+    diagnostics_init(&all);
+    module_cache_collect(cache, root, &all);
+
+    sds rendered = (format == DF_HUMAN && all.diagnostics.length == 0) ? sdsempty() : diagnostics_render(&all, format);
+    *errorCount = all.errorCount;
+
+    vec_deinit(&all.diagnostics);
+    map_deinit(&all.seen);
+    return rendered;
+}
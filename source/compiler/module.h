@@ -0,0 +1,200 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_MODULE_H
+#define TYPE_C_MODULE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "ast.h"
+#include "parser.h"
+#include "diagnostics.h"
+#include "threadpool.h"
+#include "../utils/vec.h"
+#include "../utils/map.h"
+#include "../utils/sds.h"
+
+// first line of an interface file, followed by the hash of the source it was made from
+#define MODULE_INTERFACE_MAGIC "// type-c interface 1 "
+#define MODULE_INTERFACE_EXTENSION ".tci"
+
+typedef vec_t(uint64_t) vec_u64_t;
+
+/**
+ * A parsed and type-checked source file
+ */
+typedef struct Module {
+    // canonical path
+    char* path;
+    // hash of the source, a module whose file still has the same hash is reused as is
+    uint64_t hash;
+    sds source;
+    Parser* parser;
+    ASTProgramNode* program;
+    // canonical paths of the interfaces of its imports, and the hash they had when it was compiled
+    vec_str_t imports;
+    vec_u64_t importHashes;
+    // request during which it was last validated
+    uint32_t generation;
+}Module;
+
+/**
+ * Declarations of a module, without the implementation.
+ * Made from the source by module_summarize: imports, types, extern blocks, top-level lets
+ * and function headers, with every block body replaced by `{}`.
+ * It is saved next to the source as <name>.tci, and can be shipped instead of the source.
+ */
+typedef struct ModuleInterface {
+    // canonical path of the source, or of the interface file when there is none
+    char* path;
+    // hash of the source it was made from, of the interface file when there is no source
+    uint64_t stamp;
+    // hash of the summary and of the interfaces it imports, importers are recompiled when it changes
+    uint64_t hash;
+    sds text;
+    Parser* parser;
+    ASTProgramNode* program;
+    uint32_t generation;
+}ModuleInterface;
+
+typedef map_t(Module*) map_module_t;
+typedef map_t(ModuleInterface*) map_moduleinterface_t;
+typedef map_t(sds) map_sds_t;
+
+typedef struct ModuleCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    // interfaces found in memory, read from a .tci file, or made from the source
+    uint64_t interfaceHits;
+    uint64_t interfaceLoads;
+    uint64_t interfaceBuilds;
+    // import graphs walked, and the modules they held
+    uint64_t graphs;
+    uint64_t graphNodes;
+}ModuleCacheStats;
+
+/**
+ * Modules kept in memory across compile requests, keyed by canonical path.
+ * Imports are bound to the interfaces of the modules they name, an importer is
+ * recompiled when its own text or the interface of one of its imports changes,
+ * never because the implementation of an import did.
+ *
+ * The transitive imports of a module are loaded as a graph: every interface is read or
+ * summarized and parsed by a worker as soon as an importer names it, and its own imports
+ * are bound once all of them are, so independent modules are processed in parallel.
+ * Imports forming a cycle are bound one after the other once the rest of the graph is done.
+ */
+typedef struct ModuleCache {
+    map_module_t modules;
+    map_moduleinterface_t interfaces;
+    // in-memory sources by absolute path, looked up before the file system
+    map_sds_t sources;
+    uint32_t generation;
+    ModuleCacheStats stats;
+    // guards the maps and the stats while an import graph is loaded
+    pthread_mutex_t lock;
+    // number of workers loading imports and parsing large files, 0 for one per CPU. read when they are first needed
+    uint32_t jobs;
+    // saves the dependency graph of each compiled module next to its source, as <name>.tcg,
+    // so that a later process only rechecks the declarations which changed and their dependents
+    uint8_t incremental;
+    ThreadPool* pool;
+}ModuleCache;
+
+void module_cache_init(ModuleCache* cache);
+void module_cache_deinit(ModuleCache* cache);
+
+/**
+ * Adds or replaces an in-memory source, which hides any file at the same path.
+ * Interfaces of in-memory sources are kept in memory, never saved.
+ * @param cache
+ * @param path made absolute from the working directory, its directories need not exist
+ * @param text
+ * @param len
+ * @return 1 on success
+ */
+uint8_t module_cache_setSource(ModuleCache* cache, const char* path, const char* text, size_t len);
+
+/**
+ * Starts a new request, every module is checked against its file at most once per request
+ * @param cache
+ */
+void module_cache_beginRequest(ModuleCache* cache);
+
+/**
+ * Loads a module, compiling it if it is new, its file changed or the interface of one
+ * of its imports did.
+ * @param cache
+ * @param path
+ * @return the module, NULL if the file could not be read
+ */
+Module* module_cache_load(ModuleCache* cache, const char* path);
+
+/**
+ * Forgets a module, which is compiled again the next time it is loaded.
+ * Used once an internal error left it half built.
+ * @param cache
+ * @param path
+ */
+void module_cache_drop(ModuleCache* cache, const char* path);
+
+/**
+ * Loads the interface of a module: from memory if its source did not change, from its
+ * .tci file if it was made from the current source, otherwise from the source, saving
+ * the .tci file along the way. Its transitive imports are loaded the same way.
+ * @param cache
+ * @param path path of the source, or of an interface file
+ * @return the interface, NULL if neither the source nor the interface could be read
+ */
+ModuleInterface* module_cache_loadInterface(ModuleCache* cache, const char* path);
+
+/**
+ * Gathers the diagnostics of a module and of the interfaces of its imports
+ * @param cache
+ * @param root
+ * @param all output, a view over the diagnostics which it does not own
+ */
+void module_cache_collect(ModuleCache* cache, Module* root, DiagnosticsEngine* all);
+
+/**
+ * Renders the diagnostics of a module and of the interfaces of its imports, in a single document
+ * @param cache
+ * @param root
+ * @param format
+ * @param errorCount output, total number of errors
+ * @return new sds string
+ */
+sds module_cache_render(ModuleCache* cache, Module* root, DiagnosticsFormat format, uint32_t* errorCount);
+
+/**
+ * Finds the file an import refers to. The longest prefix of the import path
+ * which names a file relative to the importer wins, i.e `from a.b import c`
+ * is looked up as a/b/c.tc, then a/b.tc, then a.tc. An interface file stands
+ * for a missing source.
+ * @param cache in-memory sources are looked up first, may be NULL
+ * @param importerPath
+ * @param import
+ * @param prefixLength output, may be NULL. number of ids naming the file, the next one names a declaration
+ * @return new sds path, NULL if no file matches
+ */
+sds module_resolveImport(ModuleCache* cache, const char* importerPath, ImportStmt* import, uint32_t* prefixLength);
+
+/**
+ * Summarizes a module into its interface, see ModuleInterface
+ * @param path used in diagnostics
+ * @param source
+ * @return new sds string
+ */
+sds module_summarize(const char* path, const char* source);
+
+/**
+ * Reads a whole file
+ * @param path
+ * @return new sds string, NULL if it could not be read
+ */
+sds module_readFile(const char* path);
+
+uint64_t module_hash(const char* data, size_t len);
+
+#endif //TYPE_C_MODULE_H
@@ -6,6 +6,8 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <printf.h>
+#include <string.h>
+#include <inttypes.h>
 #include "../utils/vec.h"
 #include "parser.h"
 #include "parser_resolve.h"
@@ -16,6 +18,7 @@
 #include "scope.h"
 #include "type_checker.h"
 #include "type_inference.h"
+#include "log.h"
 
 #define ACCEPT parser_accept(parser)
 #define CURRENT lexeme = parser_peek(parser)
@@ -26,12 +29,54 @@ Parser* parser_init(LexerState* lexerState) {
     parser->lexerState = lexerState;
     vec_init(&parser->stack);
     parser->stack_index = 0;
+    parser->token_offset = 0;
+    memset(&parser->stats, 0, sizeof(ParserStats));
+    diagnostics_init(&parser->diagnostics);
+    log_init();
+    parser->recovery = NULL;
+    parser->brace_depth = 0;
+    parser->last_line = 0;
+    parser->error_line = 0;
+    parser->depGraph = NULL;
+    parser->lazyBodies = 0;
+    vec_init(&parser->skippedBodies);
+    query_init(&parser->queries);
+    instance_cache_init(&parser->instances);
+    ast_walker_init(&parser->walker);
+    parser->pendingOperand = NULL;
+    vec_init(&parser->unresolvedTypes);
+    vec_init(&parser->unresolvedParents);
+    parser->boundTypes = NULL;
     return parser;
 }
 
+void parser_free(Parser* parser) {
+    lexer_free(parser->lexerState);
+    vec_deinit(&parser->stack);
+    vec_deinit(&parser->skippedBodies);
+    diagnostics_deinit(&parser->diagnostics);
+    query_deinit(&parser->queries);
+    instance_cache_deinit(&parser->instances);
+    ast_walker_deinit(&parser->walker);
+    vec_deinit(&parser->unresolvedTypes);
+    vec_deinit(&parser->unresolvedParents);
+    if(parser->depGraph != NULL) {
+        depgraph_free(parser->depGraph);
+    }
+    free(parser);
+}
+
 Lexeme parser_peek(Parser* parser) {
     if (parser->stack_index == parser->stack.length) {
         Lexeme lexeme = lexer_lexCurrent(parser->lexerState);
+        parser->stats.tokensLexed++;
+        // reported once, the grammar never sees it
+        while(lexeme.type == TOK_INVALID) {
+            parser_utils_raise(parser, lexeme, NULL, __FUNCTION_NAME__, __LINE__, "invalid symbol `%s`", lexeme.string);
+            free(lexeme.string);
+            lexeme = lexer_lexCurrent(parser->lexerState);
+            parser->stats.tokensLexed++;
+        }
         vec_push(&parser->stack, lexeme);
         parser->stack_index++;
         return lexeme;
@@ -44,6 +89,19 @@ Lexeme parser_peek(Parser* parser) {
 
 void parser_accept(Parser* parser) {
     // TODO: free lexeme's str value
+    uint32_t i = 0;
+    uint8_t recording = parser->depGraph != NULL && parser->depGraph->current != NULL;
+    for(; i < parser->stack_index; i++) {
+        TokenType type = parser->stack.data[i].type;
+        parser->brace_depth += (type == TOK_LBRACE) - (type == TOK_RBRACE);
+        if(recording) {
+            depgraph_feedToken(parser->depGraph, &parser->stack.data[i]);
+        }
+    }
+    if(parser->stack_index > 0) {
+        parser->last_line = parser->stack.data[parser->stack_index - 1].line;
+    }
+    parser->token_offset += parser->stack_index;
     vec_splice(&parser->stack, 0, parser->stack_index);
     parser->stack_index = 0;
 }
@@ -52,15 +110,115 @@ void parser_reject(Parser* parser) {
     parser->stack_index = 0;
 }
 
+void parser_synchronize(Parser* parser, int32_t depth, uint32_t startIndex) {
+    // the error may have been raised on a token from a previous line
+    uint32_t line = parser->error_line > parser->last_line ? parser->error_line : parser->last_line;
+    parser_reject(parser);
+
+    while(1) {
+        Lexeme lexeme = parser_peek(parser);
+        uint8_t progressed = parser->token_offset > startIndex;
+
+        if(lexeme.type == TOK_EOF) {
+            break;
+        }
+
+        if(parser->brace_depth <= depth) {
+            // closing brace of the enclosing block, it belongs to the caller
+            if(lexeme.type == TOK_RBRACE && depth > 0) {
+                break;
+            }
+            if(progressed && (lexeme.type == TOK_FN || lexeme.type == TOK_TYPE || lexeme.type == TOK_EXTERN)) {
+                break;
+            }
+            if(progressed && lexeme.line > line) {
+                break;
+            }
+        }
+
+        parser_accept(parser);
+
+        // a nested block was closed, the failed statement ends here
+        if(lexeme.type == TOK_RBRACE && parser->brace_depth == depth) {
+            return;
+        }
+    }
+    parser_reject(parser);
+}
+
+void parser_reportDiagnostics(Parser* parser) {
+    diagnostics_flush(&parser->diagnostics, stdout);
+}
+
+void parser_printStats(Parser* parser) {
+    ParserStats * stats = &parser->stats;
+    printf("tokens lexed: %"PRIu64", look-ahead tokens: %"PRIu64"\n", stats->tokensLexed, stats->lookaheadTokens);
+    uint32_t i = 0;
+    for(; i < QK_COUNT; i++) {
+        printf("%s queries: %"PRIu64" computed, %"PRIu64" cached\n", query_kindToString(i),
+               parser->queries.stats.misses[i], parser->queries.stats.hits[i]);
+    }
+    printf("generic instances: %"PRIu64" made, %"PRIu64" reused\n",
+           parser->instances.stats.misses, parser->instances.stats.hits);
+}
+
 void parser_parse(Parser* parser) {
     ASTProgramNode * node = ast_makeProgramNode();
     parser->programNode = node;
     parser_parseProgram(parser, node);
     ti_runProgram(parser, node);
+    parser_reportDiagnostics(parser);
 
     return;
 }
 
+void parser_parseIncremental(Parser* parser, const char* graphPath) {
+    DepGraph* graph = depgraph_make();
+    depgraph_load(graph, graphPath);
+    parser->depGraph = graph;
+
+    ASTProgramNode * node = ast_makeProgramNode();
+    parser->programNode = node;
+    parser_parseProgram(parser, node);
+    depgraph_resolve(graph);
+    TRACE(LOG_PARSER, "%"PRIu32" of %d declarations to recheck\n", graph->dirtyCount, graph->nodes.length);
+
+    // clean statements are skipped, see ti_runProgram
+    ti_runProgram(parser, node);
+    if(!depgraph_save(graph, graphPath)) {
+        fprintf(stderr, "Could not write dependency graph '%s'\n", graphPath);
+    }
+    parser_reportDiagnostics(parser);
+}
+
+/**
+ * Adds a top-level statement to the dependency graph, under the names it declares
+ */
+static void parser_recordStatement(Parser* parser, Statement* stmt) {
+    DepGraph* graph = parser->depGraph;
+    DepNode* depNode;
+    if(stmt->type == ST_FN_DECL) {
+        depNode = depgraph_endDecl(graph, DNK_FUNCTION);
+        depgraph_declare(graph, depNode, stmt->fnDecl->header->name);
+    }
+    else if(stmt->type == ST_VAR_DECL) {
+        depNode = depgraph_endDecl(graph, DNK_VARIABLE);
+        uint32_t i = 0;
+        LetExprDecl* decl;
+        vec_foreach(&stmt->varDecl->letList, decl, i) {
+            uint32_t j = 0;
+            char* name;
+            omap_foreach_key(&decl->variables, name, j) {
+                depgraph_declare(graph, depNode, name);
+            }
+        }
+    }
+    else {
+        depNode = depgraph_endDecl(graph, DNK_STATEMENT);
+    }
+    vec_push(&graph->statements, depNode);
+}
+
 void parser_parseProgram(Parser* parser, ASTProgramNode * node) {
     Lexeme lexeme = parser_peek(parser);
 
@@ -75,8 +233,7 @@ void parser_parseProgram(Parser* parser, ASTProgramNode * node) {
             ACCEPT;
             parser_parseImportStmt(parser, node->scope);
         }
-        char* imports = ast_json_serializeImports(node);
-        printf("%s\n", imports);
+        TRACE(LOG_IMPORTS, "%s\n", ast_json_serializeImports(node));
         lexeme = parser_peek(parser);
         can_loop = lexeme.type == TOK_FROM || lexeme.type == TOK_IMPORT;
     }
@@ -84,8 +241,27 @@ void parser_parseProgram(Parser* parser, ASTProgramNode * node) {
     // TODO: Resolve Imports and add them to symbol table
     // we no longer expect import or from after this
 
+    jmp_buf recovery;
+    jmp_buf* previousRecovery = parser->recovery;
+    parser->recovery = &recovery;
+
     can_loop = 1; //lexeme.type == TOK_TYPE;
     while (can_loop) {
+        uint32_t startIndex = parser->token_offset;
+        if(setjmp(recovery)) {
+            // skip the broken declaration and resume from the next one
+            if(parser->depGraph != NULL) {
+                depgraph_abortDecl(parser->depGraph);
+            }
+            parser_synchronize(parser, 0, startIndex);
+            CURRENT;
+            continue;
+        }
+
+        if(parser->depGraph != NULL) {
+            depgraph_beginDecl(parser->depGraph, lexeme.pos);
+        }
+
         switch(lexeme.type) {
             case TOK_EXTERN: {
                 parser_reject(parser);
@@ -95,6 +271,10 @@ void parser_parseProgram(Parser* parser, ASTProgramNode * node) {
                 if (res == SRRT_TOKEN_ALREADY_REGISTERED) {
                     PARSER_ASSERT(0, "ExternDecl %s already registered", externDecl->name);
                 }
+                if(parser->depGraph != NULL) {
+                    DepNode* depNode = depgraph_endDecl(parser->depGraph, DNK_FFI);
+                    depgraph_declare(parser->depGraph, depNode, externDecl->name);
+                }
 
                 //char* strDecl = ast_json_serializeExternDecl(externDecl);
                 //printf("%s\n", strDecl);
@@ -102,12 +282,20 @@ void parser_parseProgram(Parser* parser, ASTProgramNode * node) {
                 break;
             }
             case TOK_TYPE: {
-                parser_parseTypeDecl(parser, node->scope);
+                DataType* type = parser_parseTypeDecl(parser, node->scope);
+                if(parser->depGraph != NULL) {
+                    DepNode* depNode = depgraph_endDecl(parser->depGraph, DNK_TYPE);
+                    depgraph_declare(parser->depGraph, depNode, type->name);
+                }
                 CURRENT;
                 break;
             }
             case TOK_EOF: {
-                printf("EOF reached, Parsing done.\n");
+                if(parser->depGraph != NULL) {
+                    depgraph_abortDecl(parser->depGraph);
+                }
+                TRACE(LOG_PARSER, "EOF reached, Parsing done.\n");
+                parser->recovery = previousRecovery;
                 return;
             }
             default:
@@ -121,6 +309,9 @@ void parser_parseProgram(Parser* parser, ASTProgramNode * node) {
                 }
 
                 vec_push(&node->stmts, stmt);
+                if(parser->depGraph != NULL) {
+                    parser_recordStatement(parser, stmt);
+                }
                 //printf("%s\n", ast_json_serializeStatement(stmt));
 
                 /*
@@ -133,7 +324,8 @@ void parser_parseProgram(Parser* parser, ASTProgramNode * node) {
             }
         }
     }
-    printf("Gracefully exiting\n");
+    parser->recovery = previousRecovery;
+    TRACE(LOG_PARSER, "Gracefully exiting\n");
 }
 
 ExternDecl* parser_parseExternDecl(Parser* parser, ASTScope* currentScope){
@@ -209,7 +401,7 @@ We need to generate functions to parse each of the following:
                  | <reference_type>
 
 */
-void parser_parseTypeDecl(Parser* parser, ASTScope* currentScope) {
+DataType* parser_parseTypeDecl(Parser* parser, ASTScope* currentScope) {
     DataType * type = ast_type_makeType(currentScope, parser->stack.data[0], DT_REFERENCE);
     ACCEPT;
     Lexeme lexeme = parser_peek(parser);
@@ -272,13 +464,15 @@ void parser_parseTypeDecl(Parser* parser, ASTScope* currentScope) {
     PARSER_ASSERT(lexeme.type == TOK_EQUAL, "`=` expected but %s was found.", token_type_to_string(lexeme.type));
     ACCEPT;
     //lexeme = parser_peek(parser);
-    DataType* type_def = parser_parseTypeUnion(parser, type, currentScope);
+    // generic parameters are declared in the scope of the type, its definition refers to them
+    DataType* type_def = parser_parseTypeUnion(parser, type, type->isGeneric ? type->scope : currentScope);
     type->refType = ast_type_makeReference();
     type->refType->ref = type_def;
     //printf("%s\n", ast_stringifyType(type_def));
-    printf("%s\n", ast_json_serializeDataType(type_def));
+    TRACE(LOG_TYPES, "%s\n", ast_json_serializeDataType(type_def));
 
     PARSER_ASSERT(scope_registerType(currentScope, type), "type `%s` already exists.", type->name);
+    return type;
 }
 
 // <union_type> ::= <intersection_type> ( "|" <union_type> )*
@@ -291,7 +485,8 @@ DataType* parser_parseTypeUnion(Parser* parser, DataType* parentReferee, ASTScop
         // we have an intersection
         ACCEPT;
         DataType* type2 = parser_parseTypeUnion(parser, parentReferee, currentScope);
-        uint8_t canJoin = tc_check_canJoinOrUnion(parser, currentScope, type, type2);
+        uint8_t canJoin = tc_check_canJoinOrUnion(parser, currentScope, type, type2) ||
+                          tc_check_canUnionPrimitives(parser, currentScope, type, type2);
         PARSER_ASSERT(canJoin, "Cannot create union data types of different categories `%s` and `%s`", dataTypeKindToString(type), dataTypeKindToString(type2));
         char* unionResult = tc_check_canUnion(parser, currentScope,type, type2);
         PARSER_ASSERT(unionResult == NULL, "Cannot create union of these types, duplicate field `%s` found. ", unionResult);
@@ -305,6 +500,7 @@ DataType* parser_parseTypeUnion(Parser* parser, DataType* parentReferee, ASTScop
         // create new datatype to hold joints
         DataType* newType = ast_type_makeType(currentScope, parser->stack.data[0], DT_TYPE_UNION);
         newType->unionType = unions;
+        tc_flattenUnion(newType);
         type = newType;
     }
 
@@ -334,6 +530,7 @@ DataType* parser_parseTypeIntersection(Parser* parser, DataType* parentReferee,
         // create new datatype to hold joints
         DataType* newType = ast_type_makeType(currentScope, parser->stack.data[0], DT_TYPE_JOIN);
         newType->joinType = join;
+        tc_flattenUnion(newType);
         return newType;
     }
     parser_reject(parser);
@@ -556,6 +753,9 @@ DataType* parser_parseTypeRef(Parser* parser, DataType* parentReferee, ASTScope*
 
     }
 
+    UnresolvedType pending = {refType, currentScope};
+    vec_push(&parser->unresolvedTypes, pending);
+
     return refType;
 }
 
@@ -577,7 +777,7 @@ DataType* parser_parseTypeInterface(Parser* parser, DataType* parentReferee, AST
     // if we have "(", means interface extends other interfaces
     if(lexeme.type == TOK_LPAREN) {
         ACCEPT;
-        parser_parseExtends(parser, parentReferee, &interfaceType->interfaceType->extends, currentScope, DT_INTERFACE);
+        parser_parseExtends(parser, parentReferee, interfaceType, currentScope, DT_INTERFACE);
         CURRENT;
     }
     /*else {
@@ -640,7 +840,7 @@ DataType* parser_parseTypeClass(Parser* parser, DataType* parentReferee, ASTScop
     // if we have "(", means interface extends other interfaces
     if(lexeme.type == TOK_LPAREN) {
         ACCEPT;
-        parser_parseExtends(parser, parentReferee, &classType->classType->extends, currentScope, DT_INTERFACE);
+        parser_parseExtends(parser, parentReferee, classType, currentScope, DT_INTERFACE);
         CURRENT;
     }
     else {
@@ -745,8 +945,8 @@ DataType* parser_parseTypeVariant(Parser* parser, DataType* parentReferee, ASTSc
 
         char* variantName = lexeme.string;
         // make sure the variant doesn't have constructor with same name, by checking variantType->variantType->constructors
-        // using map_get
-        PARSER_ASSERT(map_get(&variantType->variantType->constructors, variantName) == NULL,
+        // using omap_get
+        PARSER_ASSERT(omap_get(&variantType->variantType->constructors, variantName) == NULL,
                "variant constructor with name %s already exists.", variantName);
 
         // we create a new VariantConstructor
@@ -838,7 +1038,7 @@ DataType* parser_parseTypeStruct(Parser* parser, DataType* parentReferee, ASTSco
     // if we have "(", means interface extends other interfaces
     if(lexeme.type == TOK_LPAREN) {
         ACCEPT;
-        parser_parseExtends(parser, parentReferee, &structType->structType->extends, currentScope, DT_STRUCT);
+        parser_parseExtends(parser, parentReferee, structType, currentScope, DT_STRUCT);
         CURRENT;
     }
     else {
@@ -965,7 +1165,7 @@ void parser_parseFromStmt(Parser* parser, ASTScope* currentScope){
         }
         ImportStmt* import = ast_makeImportStmt(source, target, hasAlias, alias);
 
-        PARSER_ASSERT(scope_program_addImport(parser->programNode, import) == 0, "import already exists.");
+        PARSER_ASSERT(scope_program_addImport(parser->programNode, import), "import already exists.");
         lexeme = parser_peek(parser);
 
         // here we might find a comma. if we do, we accept it and keep looping
@@ -978,7 +1178,7 @@ void parser_parseFromStmt(Parser* parser, ASTScope* currentScope){
 }
 
 // parses extends list, must start from first symbol after "("
-void parser_parseExtends(Parser* parser, DataType* parentReferee, vec_dtype_t* extends, ASTScope* currentScope, DataTypeKind kind){
+void parser_parseExtends(Parser* parser, DataType* parentReferee, DataType* child, ASTScope* currentScope, DataTypeKind kind){
     Lexeme lexeme = parser_peek(parser);
     uint8_t can_loop = lexeme.type != TOK_RPAREN;
     while(can_loop) {
@@ -989,12 +1189,9 @@ void parser_parseExtends(Parser* parser, DataType* parentReferee, vec_dtype_t* e
         // parse type
         parser_reject(parser);
         DataType* interfaceParentType = parser_parseTypePrimary(parser, parentReferee, currentScope);
-        // add to extends
-        //vec_push(extends, interfaceParentType);
-        PARSER_ASSERT(scope_canExtend(parser, currentScope, interfaceParentType, kind), "Parent category `%s` doesn't match child category.",
-                      dataTypeKindToString(interfaceParentType));
-        char* pushRes = scope_extends_addParent(parser, currentScope, extends, interfaceParentType);
-        PARSER_ASSERT(pushRes == NULL, "Duplicate field `%s` in parent already exists.", pushRes);
+        // added to extends by resolver_resolveParents, nothing is looked up while parsing
+        UnresolvedParent pending = {child, interfaceParentType, currentScope, kind, interfaceParentType->lexeme};
+        vec_push(&parser->unresolvedParents, pending);
 
         // check if we have a comma
         lexeme = parser_peek(parser);
@@ -1207,7 +1404,8 @@ Expr* parser_parseExpr(Parser* parser, ASTScope* currentScope) {
  */
 Expr* parser_parseLetExpr(Parser* parser, ASTScope* currentScope) {
     Lexeme CURRENT;
-    if(lexeme.type == TOK_LET)
+    // a pending operand starts the expression, it cannot be a `let`
+    if(lexeme.type == TOK_LET && parser->pendingOperand == NULL)
     {
         Expr *expr = ast_expr_makeExpr(ET_LET, lexeme);
         LetExpr *let = ast_expr_makeLetExpr(currentScope);
@@ -1271,8 +1469,7 @@ Expr* parser_parseLetExpr(Parser* parser, ASTScope* currentScope) {
                 // add vars to scope
                 PARSER_ASSERT(scope_registerVariable(currentScope, var), "Variable `%s` already exists", var->name);
 
-                map_set(&letDecl->variables, var->name, var);
-                vec_push(&letDecl->variableNames, var->name);
+                omap_set(&letDecl->variables, var->name, var);
 
                 if (lexeme.type == TOK_COMMA) {
                     ACCEPT;
@@ -1343,7 +1540,7 @@ Expr* parser_parseLetExpr(Parser* parser, ASTScope* currentScope) {
 // "match" uhs "{" <cases> "}"
 Expr* parser_parseMatchExpr(Parser* parser, ASTScope* currentScope){
     Lexeme CURRENT;
-    if(lexeme.type != TOK_MATCH) {
+    if(lexeme.type != TOK_MATCH || parser->pendingOperand != NULL) {
         parser_reject(parser);
         return parser_parseOpAssign(parser, currentScope);
     }
@@ -1440,154 +1637,88 @@ Expr* parser_parseOpAssign(Parser* parser, ASTScope* currentScope){
     return lhs;
 }
 
-Expr* parser_parseOpOr(Parser* parser, ASTScope* currentScope) {
-    Expr* lhs = parser_parseOpAnd(parser, currentScope);
-    if(lhs == NULL){
+/**
+ * Operators of the same precedence, see parser_parseBinaryChain
+ */
+typedef struct ParserBinaryLevel {
+    uint32_t count;
+    TokenType tokens[3];
+    BinaryExprType ops[3];
+}ParserBinaryLevel;
+
+/**
+ * Parses <operand> ( <op> <operand> )*, nested to the right as the grammar is written,
+ * i.e `a + b + c` is `a + (b + c)`.
+ * Operands are parsed in a loop, so the length of the chain does not grow the C stack.
+ */
+static Expr* parser_parseBinaryChain(Parser* parser, ASTScope* currentScope,
+                                     Expr* (*operand)(Parser*, ASTScope*), const ParserBinaryLevel* level) {
+    Expr* root = operand(parser, currentScope);
+    if(root == NULL){
         return NULL;
     }
-    Lexeme CURRENT;
-    if(lexeme.type == TOK_LOGICAL_OR) {
-        ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(BET_OR, NULL, NULL);
-
-        Expr* rhs = parser_parseOpOr(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
-
-        // Todo: compute data type
-        //binaryExpr->dataType
 
-        return binaryExpr;
-    }
-
-    parser_reject(parser);
-    return lhs;
-}
-
-Expr* parser_parseOpAnd(Parser* parser, ASTScope* currentScope){
-    Expr* lhs = parser_parseOpBinOr(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
-    Lexeme CURRENT;
-    if(lexeme.type == TOK_LOGICAL_AND) {
+    // deepest operation so far, the next one replaces its rhs
+    Expr* last = NULL;
+    while(1) {
+        Lexeme CURRENT;
+        uint32_t i = 0;
+        while((i < level->count) && (level->tokens[i] != lexeme.type)) {
+            i++;
+        }
+        if(i == level->count) {
+            parser_reject(parser);
+            return root;
+        }
         ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(BET_AND, NULL, NULL);
-
-        Expr* rhs = parser_parseOpAnd(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
-
-        // Todo: compute data type
-        //binaryExpr->dataType
 
-        return binaryExpr;
-    }
-
-    parser_reject(parser);
-    return lhs;
-}
-
-Expr* parser_parseOpBinOr(Parser* parser, ASTScope* currentScope){
-    Expr* lhs = parser_parseOpBinXor(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
-    Lexeme CURRENT;
-    if(lexeme.type == TOK_BITWISE_OR) {
-        ACCEPT;
         Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(BET_BIT_OR, NULL, NULL);
-
-        Expr* rhs = parser_parseOpBinOr(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
-
-        // Todo: compute data type
-        //binaryExpr->dataType
+        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(level->ops[i], NULL, NULL);
+        if(last == NULL) {
+            binaryExpr->binaryExpr->lhs = root;
+            root = binaryExpr;
+        }
+        else {
+            binaryExpr->binaryExpr->lhs = last->binaryExpr->rhs;
+            last->binaryExpr->rhs = binaryExpr;
+        }
+        last = binaryExpr;
 
-        return binaryExpr;
+        binaryExpr->binaryExpr->rhs = operand(parser, currentScope);
+        if(binaryExpr->binaryExpr->rhs == NULL) {
+            return root;
+        }
     }
-
-    parser_reject(parser);
-    return lhs;
 }
 
-Expr* parser_parseOpBinXor(Parser* parser, ASTScope* currentScope){
-    Expr* lhs =  parser_parseOpBinAnd(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
-    Lexeme CURRENT;
-    if(lexeme.type == TOK_BITWISE_XOR) {
-        ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr =ast_expr_makeBinaryExpr(BET_BIT_XOR, NULL, NULL);
-
-        Expr* rhs = parser_parseOpBinXor(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
-
-        // Todo: compute data type
-        //binaryExpr->dataType
-
-        return binaryExpr;
-    }
-
-    parser_reject(parser);
-    return lhs;
+Expr* parser_parseOpOr(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {1, {TOK_LOGICAL_OR}, {BET_OR}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpAnd, &level);
 }
 
-Expr* parser_parseOpBinAnd(Parser* parser, ASTScope* currentScope){
-    Expr* lhs = parser_parseOpEq(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
-    Lexeme CURRENT;
-    if(lexeme.type == TOK_BITWISE_AND) {
-        ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(BET_BIT_AND, NULL, NULL);
-
-        Expr* rhs = parser_parseOpBinAnd(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
-
-        // Todo: compute data type
-        //binaryExpr->dataType
-
-        return binaryExpr;
-    }
-
-    parser_reject(parser);
-    return lhs;
+Expr* parser_parseOpAnd(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {1, {TOK_LOGICAL_AND}, {BET_AND}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpBinOr, &level);
 }
 
-Expr* parser_parseOpEq(Parser* parser, ASTScope* currentScope){
-    Expr* lhs = parser_parseOpCompare(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
-    Lexeme CURRENT;
-    if(lexeme.type == TOK_EQUAL_EQUAL || lexeme.type == TOK_NOT_EQUAL) {
-        ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(lexeme.type == TOK_EQUAL_EQUAL?BET_EQ:BET_NEQ, NULL, NULL);
-
-        Expr* rhs = parser_parseOpEq(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
+Expr* parser_parseOpBinOr(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {1, {TOK_BITWISE_OR}, {BET_BIT_OR}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpBinXor, &level);
+}
 
-        // Todo: compute data type
-        //binaryExpr->dataType
+Expr* parser_parseOpBinXor(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {1, {TOK_BITWISE_XOR}, {BET_BIT_XOR}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpBinAnd, &level);
+}
 
-        return binaryExpr;
-    }
+Expr* parser_parseOpBinAnd(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {1, {TOK_BITWISE_AND}, {BET_BIT_AND}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpEq, &level);
+}
 
-    parser_reject(parser);
-    return lhs;
+Expr* parser_parseOpEq(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {2, {TOK_EQUAL_EQUAL, TOK_NOT_EQUAL}, {BET_EQ, BET_NEQ}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpCompare, &level);
 }
 
 uint8_t lookUpGenericFunctionCall(Parser* parser){
@@ -1599,25 +1730,34 @@ uint8_t lookUpGenericFunctionCall(Parser* parser){
     uint8_t prevWasGreater = 0;
     while(1){
         Lexeme CURRENT;
+        parser->stats.lookaheadTokens++;
         if(lexeme.type == TOK_LESS ||
             lexeme.type == TOK_LBRACE ||
             lexeme.type == TOK_LPAREN ||
             lexeme.type == TOK_LBRACKET){
 
             if(prevWasGreater && lexeme.type == TOK_LPAREN && stack.length == 0){
+                vec_deinit(&stack);
                 return 1;
             }
             vec_push(&stack, lexeme.type);
         }
         else if (lexeme.type == TOK_GREATER || lexeme.type == TOK_RBRACE ||
                  lexeme.type == TOK_RPAREN ||  lexeme.type == TOK_RBRACKET){
+            // closing a scope opened before the `<`, i.e `(a < b)`, so not a generic call
+            if(stack.length == 0){
+                parser_reject(parser);
+                vec_deinit(&stack);
+                return 0;
+            }
             if(lexeme.type == TOK_GREATER){
                 prevWasGreater = 1;
             }
-            vec_pop(&stack);
+            (void) vec_pop(&stack);
 
         }else if(lexeme.type == TOK_EOF){
             parser_reject(parser);
+            vec_deinit(&stack);
             return 0;
         }
         else {
@@ -1735,111 +1875,123 @@ Expr* parser_parseOpCompare(Parser* parser, ASTScope* currentScope) {
 }
 
 Expr* parser_parseOpShift(Parser* parser, ASTScope* currentScope) {
-    Expr* lhs = parser_parseAdd(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
-    Lexeme CURRENT;
-    if(lexeme.type == TOK_RIGHT_SHIFT || lexeme.type == TOK_LEFT_SHIFT) {
-        ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(lexeme.type == TOK_RIGHT_SHIFT?BET_RSHIFT:BET_LSHIFT, NULL, NULL);
-
-        Expr* rhs = parser_parseOpShift(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
+    static const ParserBinaryLevel level = {2, {TOK_RIGHT_SHIFT, TOK_LEFT_SHIFT}, {BET_RSHIFT, BET_LSHIFT}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseAdd, &level);
+}
 
-        // Todo: compute data type
-        //binaryExpr->dataType
+Expr* parser_parseAdd(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {2, {TOK_PLUS, TOK_MINUS}, {BET_ADD, BET_SUB}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpMult, &level);
+}
 
-        return binaryExpr;
-    }
+Expr* parser_parseOpMult(Parser* parser, ASTScope* currentScope) {
+    static const ParserBinaryLevel level = {3, {TOK_STAR, TOK_DIV, TOK_PERCENT}, {BET_MUL, BET_DIV, BET_MOD}};
+    return parser_parseBinaryChain(parser, currentScope, parser_parseOpUnary, &level);
+}
 
-    parser_reject(parser);
-    return lhs;
+static uint8_t parser_isPrefixOp(TokenType type) {
+    return type == TOK_STAR || type == TOK_MINUS || type == TOK_BITWISE_NOT ||
+           type == TOK_NOT || type == TOK_INCREMENT || type == TOK_DECREMENT ||
+           type == TOK_DENULL || type == TOK_BITWISE_AND;
 }
 
-Expr* parser_parseAdd(Parser* parser, ASTScope* currentScope){
-    Expr* lhs = parser_parseOpMult(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
+static Expr* parser_makePrefixExpr(Lexeme lexeme, Expr* uhs) {
+    Expr *unaryExpr = ast_expr_makeExpr(ET_UNARY, lexeme);
+
+    unaryExpr->unaryExpr = ast_expr_makeUnaryExpr(UET_DEREF, NULL);
+    if(lexeme.type == TOK_MINUS)
+        unaryExpr->unaryExpr->type = UET_NEG;
+    else if(lexeme.type == TOK_BITWISE_NOT)
+        unaryExpr->unaryExpr->type = UET_BIT_NOT;
+    else if(lexeme.type == TOK_NOT)
+        unaryExpr->unaryExpr->type = UET_NOT;
+    else if(lexeme.type == TOK_INCREMENT)
+        unaryExpr->unaryExpr->type = UET_PRE_INC;
+    else if(lexeme.type == TOK_DECREMENT)
+        unaryExpr->unaryExpr->type = UET_PRE_DEC;
+    else if(lexeme.type == TOK_DENULL)
+        unaryExpr->unaryExpr->type = UET_DENULL;
+    else if(lexeme.type == TOK_BITWISE_AND)
+        unaryExpr->unaryExpr->type = UET_ADDRESS_OF;
+
+    unaryExpr->unaryExpr->uhs = uhs;
+    return unaryExpr;
+}
+
+/**
+ * <uhs> ("++" | "--")?
+ */
+static Expr* parser_parsePostfixOp(Parser* parser, Expr* uhs) {
     Lexeme CURRENT;
-    if(lexeme.type == TOK_PLUS || lexeme.type == TOK_MINUS) {
+    if(lexeme.type == TOK_INCREMENT || lexeme.type == TOK_DECREMENT) {
         ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(lexeme.type == TOK_PLUS?BET_ADD:BET_SUB, NULL, NULL);
-
-        Expr* rhs = parser_parseAdd(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
-
-        // Todo: compute data type
-        //binaryExpr->dataType
+        Expr *unaryExpr = ast_expr_makeExpr(ET_UNARY, lexeme);
+        unaryExpr->unaryExpr = ast_expr_makeUnaryExpr(lexeme.type == TOK_INCREMENT?UET_POST_INC:UET_POST_DEC, NULL);
+        unaryExpr->unaryExpr->uhs = uhs;
 
-        return binaryExpr;
+        return unaryExpr;
     }
 
     parser_reject(parser);
-    return lhs;
+    return uhs;
 }
 
-Expr* parser_parseOpMult(Parser* parser, ASTScope* currentScope) {
-    Expr* lhs = parser_parseOpUnary(parser, currentScope);
-    if(lhs == NULL){
-        return NULL;
-    }
+/**
+ * Parses a run of prefix operators and `(`, i.e `-(!(-(a + b)))`, with an explicit stack.
+ * The innermost operand is parsed first, then the run is unwound: a prefix operator wraps the
+ * operand, a `(` continues with its content, the operand being the start of it, see pendingOperand.
+ * Neither the nesting of parentheses nor the length of prefix chains grows the C stack.
+ */
+static Expr* parser_parsePrefixRun(Parser* parser, ASTScope* currentScope) {
+    lexem_vec_t run;
+    vec_init(&run);
     Lexeme CURRENT;
-    if(lexeme.type == TOK_STAR || lexeme.type == TOK_DIV || lexeme.type == TOK_PERCENT) {
+    while(parser_isPrefixOp(lexeme.type) || lexeme.type == TOK_LPAREN) {
         ACCEPT;
-        Expr *binaryExpr = ast_expr_makeExpr(ET_BINARY, lexeme);
-        binaryExpr->binaryExpr = ast_expr_makeBinaryExpr(lexeme.type == TOK_STAR?BET_MUL:BET_DIV, NULL, NULL);
-        if(lexeme.type == TOK_PERCENT)
-            binaryExpr->binaryExpr->type = BET_MOD;
-
-        Expr* rhs = parser_parseOpMult(parser, currentScope);
-        binaryExpr->binaryExpr->lhs = lhs;
-        binaryExpr->binaryExpr->rhs = rhs;
+        vec_push(&run, lexeme);
+        CURRENT;
+    }
+    parser_reject(parser);
 
-        // Todo: compute data type
-        //binaryExpr->dataType
+    Expr* expr = parser_parseOpUnary(parser, currentScope);
+    while(run.length > 0) {
+        Lexeme opening = vec_pop(&run);
+        if(opening.type != TOK_LPAREN) {
+            expr = parser_makePrefixExpr(opening, expr);
+            continue;
+        }
 
-        return binaryExpr;
+        parser->pendingOperand = expr;
+        expr = parser_parseExpr(parser, currentScope);
+        // assert )
+        CURRENT;
+        if(lexeme.type != TOK_RPAREN) {
+            // released before the assertion jumps away
+            vec_deinit(&run);
+        }
+        PARSER_ASSERT(lexeme.type == TOK_RPAREN, "`)` expected but %s was found.", token_type_to_string(lexeme.type));
+        ACCEPT;
+        if(expr != NULL) {
+            expr = parser_parsePostfixOp(parser, parser_parseMemberAccess(parser, currentScope, expr));
+        }
     }
-
-    parser_reject(parser);
-    return lhs;
+    vec_deinit(&run);
+    return expr;
 }
 
 Expr* parser_parseOpUnary(Parser* parser, ASTScope* currentScope) {
+    // the start of the expression is already parsed, see parser_parsePrefixRun
+    if(parser->pendingOperand != NULL) {
+        Expr* operand = parser->pendingOperand;
+        parser->pendingOperand = NULL;
+        return operand;
+    }
+
     // check if we have prefix op
     Lexeme CURRENT;
-    if (lexeme.type == TOK_STAR || lexeme.type == TOK_MINUS || lexeme.type == TOK_BITWISE_NOT ||
-        lexeme.type == TOK_NOT || lexeme.type == TOK_INCREMENT || lexeme.type == TOK_DECREMENT ||
-        lexeme.type == TOK_DENULL || lexeme.type == TOK_BITWISE_AND) {
-        ACCEPT;
-        Expr *unaryExpr = ast_expr_makeExpr(ET_UNARY, lexeme);
-
-        unaryExpr->unaryExpr = ast_expr_makeUnaryExpr(UET_DEREF, NULL);
-        if(lexeme.type == TOK_MINUS)
-            unaryExpr->unaryExpr->type = UET_NEG;
-        else if(lexeme.type == TOK_BITWISE_NOT)
-            unaryExpr->unaryExpr->type = UET_BIT_NOT;
-        else if(lexeme.type == TOK_NOT)
-            unaryExpr->unaryExpr->type = UET_NOT;
-        else if(lexeme.type == TOK_INCREMENT)
-            unaryExpr->unaryExpr->type = UET_PRE_INC;
-        else if(lexeme.type == TOK_DECREMENT)
-            unaryExpr->unaryExpr->type = UET_PRE_DEC;
-        else if(lexeme.type == TOK_DENULL)
-            unaryExpr->unaryExpr->type = UET_DENULL;
-        else if(lexeme.type == TOK_BITWISE_AND)
-            unaryExpr->unaryExpr->type = UET_ADDRESS_OF;
-
-        Expr *uhs = parser_parseOpUnary(parser, currentScope);
-        unaryExpr->unaryExpr->uhs = uhs;
-
-        return unaryExpr;
+    if (parser_isPrefixOp(lexeme.type) || lexeme.type == TOK_LPAREN) {
+        parser_reject(parser);
+        return parser_parsePrefixRun(parser, currentScope);
     }
     else if (lexeme.type == TOK_NEW) {
         Expr* new = ast_expr_makeExpr(ET_NEW, lexeme);
@@ -1928,96 +2080,90 @@ Expr* parser_parseOpUnary(Parser* parser, ASTScope* currentScope) {
     }
 
     parser_reject(parser);
-    Expr* uhs = parser_parseOpPointer(parser, currentScope);
-    Expr *unaryExpr = ast_expr_makeExpr(ET_UNARY, lexeme);
-    CURRENT;
-
-    if(lexeme.type == TOK_INCREMENT || lexeme.type == TOK_DECREMENT) {
-        ACCEPT;
-        unaryExpr->unaryExpr = ast_expr_makeUnaryExpr(lexeme.type == TOK_INCREMENT?UET_POST_INC:UET_POST_DEC, NULL);
-        unaryExpr->unaryExpr->uhs = uhs;
-
-        return unaryExpr;
-    }
-
-    parser_reject(parser);
-    return uhs;
+    return parser_parsePostfixOp(parser, parser_parseOpPointer(parser, currentScope));
 }
 
 
 Expr* parser_parseMemberAccess(Parser* parser, ASTScope* currentScope, Expr* lhs) {
-    Lexeme CURRENT;
+    // suffixes are folded into lhs one after the other, a long chain does not grow the stack
+    Lexeme lexeme;
+    while(1) {
+        CURRENT;
 
-    if (lexeme.type == TOK_DOT) {
-        ACCEPT;
-        Expr* rhs = parser_parseOpValue(parser, currentScope);
-        MemberAccessExpr* memberAccessExpr = ast_expr_makeMemberAccessExpr(lhs, rhs);
+        if (lexeme.type == TOK_DOT) {
+            ACCEPT;
+            Expr* rhs = parser_parseOpValue(parser, currentScope);
+            MemberAccessExpr* memberAccessExpr = ast_expr_makeMemberAccessExpr(lhs, rhs);
 
-        Expr* memberExpr = ast_expr_makeExpr(ET_MEMBER_ACCESS, lexeme);
-        memberExpr->memberAccessExpr = memberAccessExpr;
+            Expr* memberExpr = ast_expr_makeExpr(ET_MEMBER_ACCESS, lexeme);
+            memberExpr->memberAccessExpr = memberAccessExpr;
 
-        return parser_parseMemberAccess(parser, currentScope, memberExpr);
-    }
+            lhs = memberExpr;
+            continue;
+        }
 
-    if (lexeme.type == TOK_LBRACKET) {
-        ACCEPT;
-        IndexAccessExpr* idx = ast_expr_makeIndexAccessExpr(lhs);
-        uint8_t can_loop = 1;
+        if (lexeme.type == TOK_LBRACKET) {
+            ACCEPT;
+            IndexAccessExpr* idx = ast_expr_makeIndexAccessExpr(lhs);
+            uint8_t can_loop = 1;
 
-        while (can_loop) {
-            Expr* index = parser_parseExpr(parser, currentScope);
-            vec_push(&idx->indexes, index);
-            CURRENT;
-            if (lexeme.type == TOK_COMMA) {
-                ACCEPT;
-            }
-            else {
-                can_loop = 0;
-                parser_reject(parser);
+            while (can_loop) {
+                Expr* index = parser_parseExpr(parser, currentScope);
+                vec_push(&idx->indexes, index);
+                CURRENT;
+                if (lexeme.type == TOK_COMMA) {
+                    ACCEPT;
+                }
+                else {
+                    can_loop = 0;
+                    parser_reject(parser);
+                }
             }
-        }
 
-        // assert ]
-        CURRENT;
-        PARSER_ASSERT(lexeme.type == TOK_RBRACKET, "`]` expected but %s was found.", token_type_to_string(lexeme.type));
-        ACCEPT;
+            // assert ]
+            CURRENT;
+            PARSER_ASSERT(lexeme.type == TOK_RBRACKET, "`]` expected but %s was found.", token_type_to_string(lexeme.type));
+            ACCEPT;
 
-        Expr* expr = ast_expr_makeExpr(ET_INDEX_ACCESS, lexeme);
-        expr->indexAccessExpr = idx;
+            Expr* expr = ast_expr_makeExpr(ET_INDEX_ACCESS, lexeme);
+            expr->indexAccessExpr = idx;
 
-        return parser_parseMemberAccess(parser, currentScope, expr);
-    }
-
-    if (lexeme.type == TOK_LPAREN) {
-        ACCEPT;
-        CURRENT;
-        CallExpr* call = ast_expr_makeCallExpr(lhs);
-        uint8_t can_loop = lexeme.type != TOK_RPAREN;
+            lhs = expr;
+            continue;
+        }
 
-        while (can_loop) {
-            parser_reject(parser);
-            Expr* index = parser_parseExpr(parser, currentScope);
-            vec_push(&call->args, index);
+        if (lexeme.type == TOK_LPAREN) {
+            ACCEPT;
             CURRENT;
-            if (lexeme.type == TOK_COMMA) {
-                ACCEPT;
-            }
-            else {
-                PARSER_ASSERT(lexeme.type == TOK_RPAREN, "`)` expected but %s was found.", token_type_to_string(lexeme.type));
-                ACCEPT;
-                can_loop = 0;
+            CallExpr* call = ast_expr_makeCallExpr(lhs);
+            uint8_t can_loop = lexeme.type != TOK_RPAREN;
+
+            while (can_loop) {
+                parser_reject(parser);
+                Expr* index = parser_parseExpr(parser, currentScope);
+                vec_push(&call->args, index);
+                CURRENT;
+                if (lexeme.type == TOK_COMMA) {
+                    ACCEPT;
+                }
+                else {
+                    PARSER_ASSERT(lexeme.type == TOK_RPAREN, "`)` expected but %s was found.", token_type_to_string(lexeme.type));
+                    ACCEPT;
+                    can_loop = 0;
+                }
             }
-        }
-        ACCEPT;
+            ACCEPT;
 
-        Expr* expr = ast_expr_makeExpr(ET_CALL, lexeme);
-        expr->callExpr = call;
+            Expr* expr = ast_expr_makeExpr(ET_CALL, lexeme);
+            expr->callExpr = call;
 
-        return parser_parseMemberAccess(parser, currentScope, expr);
-    }
+            lhs = expr;
+            continue;
+        }
 
-    parser_reject(parser);
-    return lhs;
+        parser_reject(parser);
+        return lhs;
+    }
 }
 
 Expr* parser_parseOpPointer(Parser* parser, ASTScope* currentScope) {
@@ -2063,11 +2209,10 @@ Expr* parser_parseOpValue(Parser* parser, ASTScope* currentScope) {
     if(lexeme.type == TOK_FN){
         // lambda expression
         parser_reject(parser);
-        FnHeader * fnHeader= parser_parseLambdaFnHeader(parser, NULL, currentScope);
-
         Expr* expr = ast_expr_makeExpr(ET_LAMBDA, lexeme);
         expr->lambdaExpr = ast_expr_makeLambdaExpr(currentScope);
-        expr->lambdaExpr->header = fnHeader;
+        // its generic parameters are declared in its own scope, the body included
+        expr->lambdaExpr->header = parser_parseLambdaFnHeader(parser, NULL, expr->lambdaExpr->scope);
         /**
          * TODO: add args to scope and detect closures
          */
@@ -2134,54 +2279,54 @@ Expr* parser_parseOpValue(Parser* parser, ASTScope* currentScope) {
         ACCEPT;
         // we need to look a head find an ID and ":", then it's named
         // else its unnamed
+        uint8_t isNamed = 0;
         CURRENT;
-        if(lexeme.type == TOK_IDENTIFIER){
+        if(lexeme.type == TOK_IDENTIFIER) {
             CURRENT;
-            if(lexeme.type == TOK_COLON){
-                // build expressions
-                NamedStructConstructionExpr* namedStruct = ast_expr_makeNamedStructConstructionExpr();
-                Expr* expr = ast_expr_makeExpr(ET_NAMED_STRUCT_CONSTRUCTION, lexeme);
-                expr->namedStructConstructionExpr = namedStruct;
+            isNamed = lexeme.type == TOK_COLON;
+        }
+        parser->stats.lookaheadTokens += parser->stack_index;
+        parser_reject(parser);
+        CURRENT;
 
-                parser_reject(parser);
-                // we are back at the identifier
-                uint8_t loop = 1;
-                while(loop) {
-                    CURRENT;
-                    // we make sure format is <id>":"<expr> (","<id>":"<expr>)*
-                    // we parse the id
-                    PARSER_ASSERT(lexeme.type == TOK_IDENTIFIER, "identifier expected but %s was found.", token_type_to_string(lexeme.type));
-                    char* argName = strdup(lexeme.string);
+        if(isNamed){
+            // build expressions
+            NamedStructConstructionExpr* namedStruct = ast_expr_makeNamedStructConstructionExpr();
+            Expr* expr = ast_expr_makeExpr(ET_NAMED_STRUCT_CONSTRUCTION, lexeme);
+            expr->namedStructConstructionExpr = namedStruct;
+
+            parser_reject(parser);
+            // we are back at the identifier
+            uint8_t loop = 1;
+            while(loop) {
+                CURRENT;
+                // we make sure format is <id>":"<expr> (","<id>":"<expr>)*
+                // we parse the id
+                PARSER_ASSERT(lexeme.type == TOK_IDENTIFIER, "identifier expected but %s was found.", token_type_to_string(lexeme.type));
+                char* argName = strdup(lexeme.string);
+                ACCEPT;
+                // we assert ":"
+                CURRENT;
+                PARSER_ASSERT(lexeme.type == TOK_COLON, "`:` expected but %s was found.", token_type_to_string(lexeme.type));
+                ACCEPT;
+
+                Expr* value = parser_parseExpr(parser, currentScope);
+                // we add the arg to the struct
+                omap_set(&namedStruct->args, argName, value);
+                // we check if we have a "," or a "}"
+                CURRENT;
+                if(lexeme.type == TOK_COMMA) {
                     ACCEPT;
-                    // we assert ":"
-                    CURRENT;
-                    PARSER_ASSERT(lexeme.type == TOK_COLON, "`:` expected but %s was found.", token_type_to_string(lexeme.type));
+                }
+                else if(lexeme.type == TOK_RBRACE) {
                     ACCEPT;
-
-                    Expr* value = parser_parseExpr(parser, currentScope);
-                    // we add the arg to the struct
-                    vec_push(&namedStruct->argNames, argName);
-                    map_set(&namedStruct->args, argName, value);
-                    // we check if we have a "," or a "}"
-                    CURRENT;
-                    if(lexeme.type == TOK_COMMA) {
-                        ACCEPT;
-                    }
-                    else if(lexeme.type == TOK_RBRACE) {
-                        ACCEPT;
-                        loop = 0;
-                    }
+                    loop = 0;
                 }
-
-                return expr;
-            }
-            else {
-                parser_reject(parser);
             }
+
+            return expr;
         }
-        else{
-            parser_reject(parser);
-        }
+        parser_reject(parser);
 
         // unnamed struct
         UnnamedStructConstructionExpr* unnamedStruct = ast_expr_makeUnnamedStructConstructionExpr();
@@ -2386,6 +2531,8 @@ FnHeader* parser_parseFnHeader(Parser* parser, ASTScope* currentScope) {
     // build header struct
     FnHeader* header = ast_makeFnHeader();
     header->type = ast_type_makeFn();
+    // scope of the generic parameters, the types of the arguments are written in it
+    ASTScope* typeScope = currentScope;
     // assert we are at "fn"
     Lexeme CURRENT;
     PARSER_ASSERT(lexeme.type == TOK_FN, "`fn` expected but %s was found.", token_type_to_string(lexeme.type));
@@ -2401,6 +2548,7 @@ FnHeader* parser_parseFnHeader(Parser* parser, ASTScope* currentScope) {
     CURRENT;
     if(lexeme.type == TOK_LESS) {
         header->isGeneric = 1;
+        typeScope = ast_scope_makeScope(currentScope);
         ACCEPT;
         // get current lexeme
         CURRENT;
@@ -2419,6 +2567,7 @@ FnHeader* parser_parseFnHeader(Parser* parser, ASTScope* currentScope) {
                 // get generic name
                 genericParam->name = strdup(lexeme.string);
                 PARSER_ASSERT(scope_fnheader_addGeneric(header, genericParam), "generic param `%s` already exists in function `%s`.", genericParam->name, header->name);
+                scope_registerGeneric(typeScope, genericParam);
                 ACCEPT;
                 CURRENT;
                 // check if have ":"
@@ -2473,7 +2622,7 @@ FnHeader* parser_parseFnHeader(Parser* parser, ASTScope* currentScope) {
         ACCEPT;
         CURRENT;
         // assert type
-        DataType* type = parser_parseTypeUnion(parser, NULL, currentScope);
+        DataType* type = parser_parseTypeUnion(parser, NULL, typeScope);
         arg->type = type;
 
         // check if we reached ")"
@@ -2494,7 +2643,7 @@ FnHeader* parser_parseFnHeader(Parser* parser, ASTScope* currentScope) {
     CURRENT;
     if(lexeme.type == TOK_FN_RETURN_TYPE) {
         ACCEPT;
-        header->type->returnType = parser_parseTypeUnion(parser, NULL, currentScope);
+        header->type->returnType = parser_parseTypeUnion(parser, NULL, typeScope);
     }
     else{
         parser_reject(parser);
@@ -2534,6 +2683,7 @@ FnHeader* parser_parseLambdaFnHeader(Parser* parser, DataType* parentReferee, AS
             // get generic name
             genericParam->name = strdup(lexeme.string);
             PARSER_ASSERT(scope_fnheader_addGeneric(header, genericParam), "generic param `%s` already exists in anonymous function.", genericParam->name);
+            scope_registerGeneric(currentScope, genericParam);
             ACCEPT;
             CURRENT;
             // check if have ":"
@@ -2636,10 +2786,10 @@ Statement* parser_parseStmt(Parser* parser, ASTScope* currentScope) {
             // register varDecl->name
             // iterate through varDecl
             char* name;
+            FnArgument* arg;
             uint32_t j = 0;
-            vec_foreach(&varDecl->variableNames, name, j){
-                FnArgument ** arg = map_get(&varDecl->variables, name);
-                PARSER_ASSERT(scope_registerVariable(currentScope, *arg), "variable `%s` already exists in scope.", name);
+            omap_foreach(&varDecl->variables, name, arg, j){
+                PARSER_ASSERT(scope_registerVariable(currentScope, arg), "variable `%s` already exists in scope.", name);
             }
         }
 
@@ -2771,8 +2921,7 @@ Statement* parser_parseStmtLet(Parser* parser, ASTScope* currentScope){
                 CURRENT;
             }
             // add to args
-            map_set(&letDecl->variables, var->name, var);
-            vec_push(&letDecl->variableNames, var->name);
+            omap_set(&letDecl->variables, var->name, var);
 
             // check if we have a comma
 
@@ -2827,6 +2976,75 @@ Statement* parser_parseStmtLet(Parser* parser, ASTScope* currentScope){
     return stmt;
 }
 
+/**
+ * Skips a block by matching its braces, its text is kept to be parsed later
+ */
+static FnBodySource* parser_skipBlock(Parser* parser) {
+    Lexeme CURRENT;
+    PARSER_ASSERT(lexeme.type == TOK_LBRACE, "`{` expected but %s was found.", token_type_to_string(lexeme.type));
+
+    FnBodySource* body = malloc(sizeof(FnBodySource));
+    body->filename = strdup(parser->lexerState->filename);
+    body->line = lexeme.line;
+    body->col = lexeme.col;
+    uint32_t start = lexeme.pos;
+
+    int32_t depth = 0;
+    for(;;) {
+        PARSER_ASSERT(lexeme.type != TOK_EOF, "`}` expected but %s was found.", token_type_to_string(lexeme.type));
+        if(lexeme.type == TOK_LBRACE) {
+            depth++;
+        }
+        else if(lexeme.type == TOK_RBRACE) {
+            depth--;
+        }
+        ACCEPT;
+        if(depth == 0) {
+            break;
+        }
+        CURRENT;
+    }
+
+    // the closing brace is a single character
+    SkippedRange range = {start, lexeme.pos + 1};
+    vec_push(&parser->skippedBodies, range);
+    body->text = strndup(parser->lexerState->buffer + start, range.end - start);
+    return body;
+}
+
+uint8_t parser_parseFnBody(Parser* parser, FnDeclStatement* fnDecl) {
+    FnBodySource* body = fnDecl->deferredBody;
+    if(body == NULL) {
+        return 1;
+    }
+    fnDecl->deferredBody = NULL;
+
+    LexerState* lex = lexer_init(body->filename, body->text, strlen(body->text));
+    lex->line = body->line;
+    lex->col = body->col;
+    Parser* bodyParser = parser_init(lex);
+    bodyParser->programNode = parser->programNode;
+
+    jmp_buf recovery;
+    bodyParser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        fnDecl->block = parser_parseStmtBlock(bodyParser, fnDecl->scope);
+    }
+    bodyParser->recovery = NULL;
+
+    // bound in the scopes they were written in, the function's generic parameters included
+    resolver_takeReferences(parser, bodyParser);
+    resolver_resolveReferences(parser);
+
+    uint8_t ok = bodyParser->diagnostics.errorCount == 0;
+    diagnostics_take(&parser->diagnostics, &bodyParser->diagnostics);
+    parser_free(bodyParser);
+    free(body->text);
+    free(body->filename);
+    free(body);
+    return ok;
+}
+
 Statement* parser_parseStmtFn(Parser* parser, ASTScope* currentScope) {
     Lexeme CURRENT;
 
@@ -2867,6 +3085,7 @@ Statement* parser_parseStmtFn(Parser* parser, ASTScope* currentScope) {
             genericParam->name = strdup(lexeme.string);
             PARSER_ASSERT(scope_fnheader_addGeneric(stmt->fnDecl->header, genericParam),
                    "Generic parameter %s already exists in function %s", genericParam->name, stmt->fnDecl->header->name);
+            scope_registerGeneric(stmt->fnDecl->scope, genericParam);
             ACCEPT;
             CURRENT;
             // check if have ":"
@@ -2923,13 +3142,12 @@ Statement* parser_parseStmtFn(Parser* parser, ASTScope* currentScope) {
         PARSER_ASSERT(lexeme.type == TOK_COLON, "`:` expected but %s was found.", token_type_to_string(lexeme.type));
         ACCEPT;
         // parse type
-        arg->type = parser_parseTypeUnion(parser, NULL, currentScope);
+        arg->type = parser_parseTypeUnion(parser, NULL, stmt->fnDecl->scope);
         // assert type is not null
         PARSER_ASSERT(arg->type != NULL,
                "`type` near %s, generated a NULL type. This is a parser issue.");
         // add to args
-        map_set(&stmt->fnDecl->header->type->args, arg->name, arg);
-        vec_push(&stmt->fnDecl->header->type->argNames, arg->name);
+        omap_set(&stmt->fnDecl->header->type->args, arg->name, arg);
 
         // check if we have a comma
         lexeme = parser_peek(parser);
@@ -2948,7 +3166,7 @@ Statement* parser_parseStmtFn(Parser* parser, ASTScope* currentScope) {
         ACCEPT;
         // parse the return type
         // TODO: add generics to scope if they exist?
-        stmt->fnDecl->header->type->returnType = parser_parseTypeUnion(parser, NULL, currentScope);
+        stmt->fnDecl->header->type->returnType = parser_parseTypeUnion(parser, NULL, stmt->fnDecl->scope);
         // assert type is not null
         PARSER_ASSERT(stmt->fnDecl->header->type->returnType != NULL,
                "`type` near %s, generated a NULL type. This is a parser issue.");
@@ -2973,7 +3191,12 @@ Statement* parser_parseStmtFn(Parser* parser, ASTScope* currentScope) {
     } else if (lexeme.type == TOK_LBRACE) {
         stmt->fnDecl->bodyType = FBT_BLOCK;
         parser_reject(parser);
-        stmt->fnDecl->block = parser_parseStmtBlock(parser, stmt->fnDecl->scope);
+        if(parser->lazyBodies) {
+            stmt->fnDecl->deferredBody = parser_skipBlock(parser);
+        }
+        else {
+            stmt->fnDecl->block = parser_parseStmtBlock(parser, stmt->fnDecl->scope);
+        }
     } else {
         parser_reject(parser);
         // assert false
@@ -3001,11 +3224,24 @@ Statement* parser_parseStmtBlock(Parser* parser, ASTScope* currentScope){
         return stmt;
     }
     parser_reject(parser);
+
+    // errors within a statement are recovered from here, so the rest of the block is still parsed
+    jmp_buf recovery;
+    jmp_buf* previousRecovery = parser->recovery;
+    int32_t depth = parser->brace_depth;
+    parser->recovery = &recovery;
+
     while(loop) {
-        Statement * s = parser_parseStmt(parser, stmt->blockStmt->scope);
-        PARSER_ASSERT(s != NULL, "Invalid symbol %s while parsing block statement.", token_type_to_string(lexeme.type));
-        vec_push(&stmt->blockStmt->stmts, s);
-        // TODO: free s
+        uint32_t startIndex = parser->token_offset;
+        if(setjmp(recovery) == 0) {
+            Statement *s = parser_parseStmt(parser, stmt->blockStmt->scope);
+            PARSER_ASSERT(s != NULL, "Invalid symbol %s while parsing block statement.", token_type_to_string(lexeme.type));
+            vec_push(&stmt->blockStmt->stmts, s);
+            // TODO: free s
+        }
+        else {
+            parser_synchronize(parser, depth, startIndex);
+        }
 
         CURRENT;
         if(lexeme.type == TOK_RBRACE || lexeme.type == TOK_EOF){
@@ -3013,10 +3249,10 @@ Statement* parser_parseStmtBlock(Parser* parser, ASTScope* currentScope){
             loop = 0;
         }
         else {
-            loop++;
             parser_reject(parser);
         }
     }
+    parser->recovery = previousRecovery;
 
     return stmt;
 }
@@ -6,23 +6,91 @@
 #define TYPE_C_PARSER_H
 
 #
+#include <setjmp.h>
 #include "lexer.h"
 #include "ast.h"
+#include "diagnostics.h"
+#include "depgraph.h"
+#include "query.h"
+#include "instance.h"
+#include "ast_walk.h"
 #include "../utils/vec.h"
 
 typedef vec_t(Lexeme) lexem_vec_t;
 
+// offsets of a body skipped by a lazy parse, end excluded
+typedef struct SkippedRange {
+    uint32_t start;
+    uint32_t end;
+}SkippedRange;
+typedef vec_t(SkippedRange) vec_skippedrange_t;
+
+typedef struct ParserStats {
+    uint64_t tokensLexed;
+    // number of tokens scanned by speculative look-aheads
+    uint64_t lookaheadTokens;
+}ParserStats;
+
 typedef struct Parser {
     LexerState* lexerState;
     lexem_vec_t stack;
     uint32_t stack_index;
-
-    vec_dtype_t unresolvedTypes;
+    // absolute index of stack.data[0], i.e number of tokens accepted so far
+    uint32_t token_offset;
+
+    ParserStats stats;
+
+    // diagnostics recorded so far, reported once parsing and type-checking are done
+    DiagnosticsEngine diagnostics;
+
+    // error recovery
+    // innermost recovery point, errors raised while it is NULL are fatal
+    jmp_buf* recovery;
+    // `{` minus `}` over accepted tokens
+    int32_t brace_depth;
+    // line of the last accepted token
+    uint32_t last_line;
+    // line of the last error raised
+    uint32_t error_line;
+
+    // top-level declarations and their dependencies, NULL unless building incrementally
+    DepGraph* depGraph;
+
+    // block bodies of functions and methods are skipped, only their text is kept.
+    // for when declarations are all that is needed, i.e the interface of an imported module
+    uint8_t lazyBodies;
+    // bodies skipped so far, in source order
+    vec_skippedrange_t skippedBodies;
+
+    // cached answers of type queries
+    QueryEngine queries;
+    // specializations of generic functions and types
+    InstanceCache instances;
+    // work stack of the passes over the AST
+    AstWalker walker;
+    // operand parsed ahead of the expression it starts, i.e the content of `(` in `(a) + b`,
+    // taken by the next parser_parseOpUnary, see parser_parseOpUnary
+    struct Expr* pendingOperand;
+
+    // references to types met while parsing, bound by resolver_resolveReferences
+    vec_unresolvedtype_t unresolvedTypes;
+    // when set, references are appended to it once bound, to bind them again if their declarations are replaced.
+    // owned by the caller, NULL by default
+    vec_unresolvedtype_t* boundTypes;
+    // parents of the types met while parsing, added by resolver_resolveParents
+    vec_unresolvedparent_t unresolvedParents;
     vec_str_t unresolvedSymbols;
     struct ASTProgramNode * programNode;
 }Parser;
 
 Parser* parser_init(LexerState* lexerState);
+
+/**
+ * Releases the parser, its lexer state, diagnostics and caches.
+ * The AST it produced is left untouched.
+ * @param parser
+ */
+void parser_free(Parser* parser);
 /**
  * Returns the current lexeme, and caches into its stack
  * The stack can hold as much as needed for look-aheads
@@ -49,15 +117,59 @@ void parser_accept(Parser* parser);
 void parser_reject(Parser* parser);
 
 /**
- * Cooking starts here
+ * Panic-mode recovery: skips tokens until a synchronization point
+ * at the given brace depth is reached, i.e a new line, a `}` closing the
+ * enclosing block, or a `fn`/`type`/`extern` declaration.
+ * At least one token is consumed if nothing was accepted since `startIndex`
+ * @param parser
+ * @param depth brace depth of the enclosing block
+ * @param startIndex token index at which the failed construct started
+ */
+void parser_synchronize(Parser* parser, int32_t depth, uint32_t startIndex);
+
+/**
+ * Flushes every recorded diagnostic, in parser->diagnostics.format
+ * @param parser
+ */
+void parser_reportDiagnostics(Parser* parser);
+
+/**
+ * Prints lexing, speculative parsing and type query statistics
+ * @param parser
+ */
+void parser_printStats(Parser* parser);
+
+/**
+ * Cooking starts here.
+ * Errors do not stop the parser, they are collected in parser->diagnostics
+ * and reported once the whole program has been parsed and type-checked.
  * @param parser
  */
 void parser_parse(Parser* parser);
 
+/**
+ * Same as parser_parse, but only type-checks the top-level declarations
+ * whose text or dependencies changed since the previous build.
+ * The dependency graph is loaded from and saved to graphPath,
+ * it is left in parser->depGraph.
+ * @param parser
+ * @param graphPath
+ */
+void parser_parseIncremental(Parser* parser, const char* graphPath);
+
 void parser_parseProgram(Parser* parser, ASTProgramNode* node);
+
+/**
+ * Parses the body of a function skipped by a lazy parse, nothing is done if it was already parsed.
+ * Its diagnostics are added to the parser's.
+ * @param parser parser which skipped it
+ * @param fnDecl
+ * @return 1 if the body parsed without errors
+ */
+uint8_t parser_parseFnBody(Parser* parser, FnDeclStatement* fnDecl);
 void parser_parseFromStmt(Parser* parser, ASTScope* currentScope);
 void parser_parseImportStmt(Parser* parser, ASTScope* currentScope);
-void parser_parseTypeDecl(Parser* parser, ASTScope* currentScope);
+DataType* parser_parseTypeDecl(Parser* parser, ASTScope* currentScope);
 
 ExternDecl* parser_parseExternDecl(Parser* parser, ASTScope* currentScope);
 
@@ -80,7 +192,7 @@ DataType * parser_parseTypeProcess(Parser* parser, DataType* parentReferee, ASTS
 
 void parser_parseTypeTemplate(Parser* parser, DataType* parentType, ASTScope* currentScope);
 
-void parser_parseExtends(Parser* parser, DataType* parentType, vec_dtype_t* extends, ASTScope* currentScope, DataTypeKind kind);
+void parser_parseExtends(Parser* parser, DataType* parentType, DataType* child, ASTScope* currentScope, DataTypeKind kind);
 void parser_parseFnDefArguments(Parser* parser, DataType* parentType, FnType* fnType, ASTScope* currentScope);
 PackageID* parser_parsePackage(Parser* parser, ASTScope* currentScope);
 FnHeader* parser_parseFnHeader(Parser* parser, ASTScope* currentScope);
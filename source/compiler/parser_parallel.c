@@ -0,0 +1,267 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <setjmp.h>
+#include "parser_parallel.h"
+#include "scope.h"
+#include "parser_resolve.h"
+
+/**
+ * Whether a top-level declaration starts at pos
+ */
+static uint8_t parser_parallel_isDeclaration(const char* text, uint32_t pos, uint32_t len) {
+    static const char* keywords[] = {"type", "fn", "extern"};
+    uint32_t i = 0;
+    for(; i < sizeof(keywords)/sizeof(keywords[0]); i++) {
+        uint32_t keywordLen = strlen(keywords[i]);
+        if(pos + keywordLen < len && strncmp(text + pos, keywords[i], keywordLen) == 0 &&
+           (text[pos + keywordLen] == ' ' || text[pos + keywordLen] == '\t')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void parser_parallel_split(const char* text, uint32_t len, uint32_t minSize, vec_parserchunk_t* chunks) {
+    ParserChunk chunk = {0, len, 1, 0};
+    // `{`, `(` and `[` minus their closing counterparts
+    int32_t depth = 0;
+    uint32_t line = 1, lineStart = 0;
+    // nothing but spaces since the line started
+    uint8_t blank = 1;
+
+    uint32_t i = 0;
+    while(i < len) {
+        char c = text[i];
+        if(c == '\n') {
+            line++;
+            lineStart = i + 1;
+            blank = 1;
+            i++;
+        }
+        else if(c == ' ' || c == '\t' || c == '\r') {
+            i++;
+        }
+        else if(c == '/' && i + 1 < len && text[i + 1] == '/') {
+            while(i < len && text[i] != '\n') {
+                i++;
+            }
+        }
+        else if(c == '/' && i + 1 < len && text[i + 1] == '*') {
+            i += 2;
+            while(i < len && !(text[i] == '*' && i + 1 < len && text[i + 1] == '/')) {
+                if(text[i] == '\n') {
+                    line++;
+                    lineStart = i + 1;
+                }
+                i++;
+            }
+            i += 2;
+        }
+        else if(c == '"' || c == '\'') {
+            i++;
+            while(i < len && text[i] != c) {
+                if(text[i] == '\\' && i + 1 < len) {
+                    i++;
+                }
+                if(text[i] == '\n') {
+                    line++;
+                    lineStart = i + 1;
+                }
+                i++;
+            }
+            i++;
+            blank = 0;
+        }
+        else if(isalpha((unsigned char)c) || c == '_') {
+            if(blank && depth == 0 && i - chunk.start >= minSize && parser_parallel_isDeclaration(text, i, len)) {
+                chunk.end = i;
+                vec_push(chunks, chunk);
+                ParserChunk next = {i, len, line, i - lineStart};
+                chunk = next;
+            }
+            while(i < len && (isalnum((unsigned char)text[i]) || text[i] == '_')) {
+                i++;
+            }
+            blank = 0;
+        }
+        else {
+            if(c == '{' || c == '(' || c == '[') {
+                depth++;
+            }
+            else if(c == '}' || c == ')' || c == ']') {
+                depth--;
+            }
+            blank = 0;
+            i++;
+        }
+    }
+    chunk.end = len;
+    vec_push(chunks, chunk);
+}
+
+typedef struct ParserChunkJob {
+    ParserChunk chunk;
+    // parser and program of the whole text
+    Parser* main;
+    ASTProgramNode* mainProgram;
+    // parent of the chunk scope while parsing, NULL at first: map look-ups write to the map, the
+    // program scope cannot be shared with concurrent parsers. the program scope itself when parsed again
+    ASTScope* parentScope;
+    Parser* parser;
+    ASTProgramNode* program;
+}ParserChunkJob;
+
+static void parser_parallel_parseChunk(void* arg) {
+    ParserChunkJob* job = arg;
+    LexerState* mainLex = job->main->lexerState;
+    LexerState* lex = lexer_initRange(mainLex->filename, mainLex->buffer, job->chunk.start, job->chunk.end,
+                                      job->chunk.line, job->chunk.col);
+    Parser* parser = parser_init(lex);
+    parser->lazyBodies = job->main->lazyBodies;
+    ASTProgramNode* program = ast_makeProgramNode();
+    if(job->parentScope == job->mainProgram->scope) {
+        // parsed again, alone, once the chunks before are published: its declarations are
+        // checked and registered by the parser as in a single parse
+        program->scope = job->mainProgram->scope;
+    }
+    else {
+        program->scope->parentScope = job->parentScope;
+    }
+    parser->programNode = program;
+    job->parser = parser;
+    job->program = program;
+
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        parser_parseProgram(parser, program);
+    }
+    parser->recovery = NULL;
+}
+
+/**
+ * Sets taken if a name declared by a chunk is already published into the program scope
+ */
+#define PARSER_PARALLEL_CONFLICTS(job, field, taken) {                                            \
+    ASTScope* from = (job)->program->scope;                                                       \
+    const char* key;                                                                              \
+    map_iter_t iter = map_iter(&from->field);                                                     \
+    while(!(taken) && (key = map_next(&from->field, &iter))) {                                    \
+        ASTScopeResult* existing = resolveElement((char*)key, (job)->mainProgram->scope, 0);      \
+        if(existing != NULL) {                                                                    \
+            free(existing);                                                                       \
+            taken = 1;                                                                            \
+        }                                                                                         \
+    }                                                                                             \
+}
+
+static uint8_t parser_parallel_conflicts(ParserChunkJob* job) {
+    uint8_t taken = 0;
+    PARSER_PARALLEL_CONFLICTS(job, variables, taken);
+    PARSER_PARALLEL_CONFLICTS(job, functions, taken);
+    PARSER_PARALLEL_CONFLICTS(job, dataTypes, taken);
+    PARSER_PARALLEL_CONFLICTS(job, externDecls, taken);
+    return taken;
+}
+
+/**
+ * Publishes the declarations of a chunk into the program scope, a chunk is free of
+ * conflicts by then. A chunk parsed again has registered them there already
+ */
+#define PARSER_PARALLEL_PUBLISH(job, field) {                                                     \
+    ASTScope* from = (job)->program->scope;                                                       \
+    ASTScope* to = (job)->mainProgram->scope;                                                     \
+    const char* key;                                                                              \
+    map_iter_t iter = map_iter(&from->field);                                                     \
+    while((key = map_next(&from->field, &iter))) {                                                \
+        map_set(&to->field, key, *map_get(&from->field, key));                                    \
+    }                                                                                             \
+}
+
+static void parser_parallel_merge(ParserChunkJob* job) {
+    Parser* main = job->main;
+    Parser* parser = job->parser;
+    vec_extend(&job->mainProgram->stmts, &job->program->stmts);
+    vec_extend(&job->mainProgram->importStatements, &job->program->importStatements);
+    if(job->program->scope != job->mainProgram->scope) {
+        // references to other chunks are resolved through the program scope
+        job->program->scope->parentScope = job->mainProgram->scope;
+        PARSER_PARALLEL_PUBLISH(job, variables);
+        PARSER_PARALLEL_PUBLISH(job, functions);
+        PARSER_PARALLEL_PUBLISH(job, dataTypes);
+        PARSER_PARALLEL_PUBLISH(job, externDecls);
+    }
+    vec_extend(&main->skippedBodies, &parser->skippedBodies);
+    resolver_takeReferences(main, parser);
+    diagnostics_take(&main->diagnostics, &parser->diagnostics);
+
+    main->stats.tokensLexed += parser->stats.tokensLexed;
+    main->stats.lookaheadTokens += parser->stats.lookaheadTokens;
+    if(parser->error_line > 0) {
+        main->error_line = parser->error_line;
+    }
+}
+
+ParserParallelStats parser_parallel_parseProgram(Parser* parser, ASTProgramNode* program, ThreadPool* pool) {
+    ParserParallelStats stats = {1, 0};
+    LexerState* lex = parser->lexerState;
+    // a dependency graph is recorded token by token, by a single parser
+    if(pool == NULL || parser->depGraph != NULL || lex->pos != 0 || lex->len < PARSER_PARALLEL_MIN_SIZE) {
+        parser_parseProgram(parser, program);
+        return stats;
+    }
+
+    // a few chunks per worker, so that uneven ones even out
+    uint32_t minSize = lex->len / (pool->threads.length * 4 + 1);
+    if(minSize < PARSER_PARALLEL_MIN_CHUNK) {
+        minSize = PARSER_PARALLEL_MIN_CHUNK;
+    }
+    vec_parserchunk_t chunks;
+    vec_init(&chunks);
+    parser_parallel_split(lex->buffer, lex->len, minSize, &chunks);
+    if(chunks.length < 2) {
+        vec_deinit(&chunks);
+        parser_parseProgram(parser, program);
+        return stats;
+    }
+    stats.chunks = chunks.length;
+    uint32_t reparsed = 0;
+
+    ParserChunkJob* jobs = calloc(chunks.length, sizeof(ParserChunkJob));
+    uint32_t i = 0;
+    ParserChunk chunk;
+    vec_foreach(&chunks, chunk, i) {
+        jobs[i].chunk = chunk;
+        jobs[i].main = parser;
+        jobs[i].mainProgram = program;
+        threadpool_submit(pool, parser_parallel_parseChunk, &jobs[i]);
+    }
+    threadpool_wait(pool);
+
+    // in source order, the first declaration of a name wins as it would in a single parse
+    for(i = 0; i < (uint32_t)chunks.length; i++) {
+        // a chunk which failed is parsed again now that the ones before it are published, in case it
+        // referred to them. so is a chunk declaring a name taken by an earlier one, straight into the
+        // program scope: the parser reports the duplicate itself, where and as a single parse does
+        if(i > 0 && (jobs[i].parser->diagnostics.errorCount > 0 || parser_parallel_conflicts(&jobs[i]))) {
+            parser_free(jobs[i].parser);
+            jobs[i].parentScope = program->scope;
+            parser_parallel_parseChunk(&jobs[i]);
+            reparsed++;
+        }
+        parser_parallel_merge(&jobs[i]);
+        parser_free(jobs[i].parser);
+    }
+    // the whole text counts as parsed
+    lex->pos = lex->len;
+
+    free(jobs);
+    vec_deinit(&chunks);
+    stats.reparsed = reparsed;
+    return stats;
+}
@@ -0,0 +1,70 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_PARSER_PARALLEL_H
+#define TYPE_C_PARSER_PARALLEL_H
+
+#include <stdint.h>
+#include "parser.h"
+#include "ast.h"
+#include "threadpool.h"
+#include "../utils/vec.h"
+
+/**
+ * Parsing a large file on several threads.
+ * A pre-scan cuts the text before top-level `type`, `fn` and `extern` declarations,
+ * tracking brackets and skipping strings, characters and comments. The chunks are parsed
+ * concurrently, each by its own parser into its own scope whose parent is the program scope.
+ * Their statements are then appended to the program in source order, their declarations
+ * published into the program scope and their diagnostics moved to the main parser.
+ * Nothing declared elsewhere is looked up while parsing, parents included, see resolver_resolveParents.
+ * A chunk which failed anyway is parsed again once the ones before it are published, so the
+ * outcome is the one of a single parse.
+ */
+
+// texts smaller than this are parsed in one go
+#define PARSER_PARALLEL_MIN_SIZE (256 * 1024)
+// chunks are at least this large, smaller ones cost more to merge than they save
+#define PARSER_PARALLEL_MIN_CHUNK (32 * 1024)
+
+typedef struct ParserChunk {
+    // offset of its first character, it ends where the next one starts
+    uint32_t start;
+    uint32_t end;
+    // position of its first character, line is one-based
+    uint32_t line;
+    uint32_t col;
+}ParserChunk;
+
+typedef vec_t(ParserChunk) vec_parserchunk_t;
+
+typedef struct ParserParallelStats {
+    // 1 when parsed in one go
+    uint32_t chunks;
+    // chunks parsed a second time, after the ones before them
+    uint32_t reparsed;
+}ParserParallelStats;
+
+/**
+ * Cuts a text before top-level declarations, the first chunk holds the imports
+ * @param text
+ * @param len
+ * @param minSize chunks are merged until they reach this size, the last one may be smaller
+ * @param chunks output, covers the whole text
+ */
+void parser_parallel_split(const char* text, uint32_t len, uint32_t minSize, vec_parserchunk_t* chunks);
+
+/**
+ * Parses a program in chunks on the given pool, when its text is large enough.
+ * The outcome is the one of parser_parseProgram, diagnostics included: a chunk declaring
+ * a name taken by an earlier one is parsed again against the program scope.
+ * Parsers recording a dependency graph, or without a pool, parse in one go.
+ * @param parser
+ * @param program
+ * @param pool may be NULL
+ * @return how the text was split
+ */
+ParserParallelStats parser_parallel_parseProgram(Parser* parser, ASTProgramNode* program, ThreadPool* pool);
+
+#endif //TYPE_C_PARSER_PARALLEL_H
@@ -12,6 +12,9 @@
 #include "ast.h"
 #include "error.h"
 #include "type_inference.h"
+#include "scope.h"
+#include "parser_utils.h"
+#include "../utils/sds.h"
 
 DataType* resolver_resolveType(Parser* parser, ASTScope* currentScope, char* typeName) {
     uint8_t fetchParent = 1;
@@ -39,15 +42,9 @@ DataType* resolver_resolveType(Parser* parser, ASTScope* currentScope, char* typ
 DataType* resolver_resolveStructAttribute(Parser* parser, ASTScope* currentScope, DataType* structType, char* methodName){
     DataType * dt = ti_type_findBase(parser, currentScope, structType);
     ASSERT(dt->kind == DT_STRUCT, "Expected struct type");
-    char* att;
-    uint32_t i = 0;
-    vec_foreach(&dt->structType->attributeNames, att, i) {
-        if(strcmp(att, methodName) == 0){
-            StructAttribute ** structAttribute = map_get(&dt->structType->attributes, att);
-            if(structAttribute != NULL){
-                return (*structAttribute)->type;
-            }
-        }
+    StructAttribute ** structAttribute = omap_get(&dt->structType->attributes, methodName);
+    if(structAttribute != NULL){
+        return (*structAttribute)->type;
     }
 
     return NULL;
@@ -58,20 +55,14 @@ DataType* resolver_resolveInterfaceMethod(Parser* parser, ASTScope* currentScope
 
     ASSERT(dt->kind == DT_INTERFACE, "Expected interface type");
 
-    char* att;
-    uint32_t i = 0;
-    vec_foreach(&dt->interfaceType->methodNames, att, i) {
-        if(strcmp(att, methodName) == 0){
-            FnHeader ** fnHeader = map_get(&dt->interfaceType->methods, att);
-            if(fnHeader != NULL){
-                return ti_fnheader_toType(parser, currentScope, *fnHeader, interfaceType->lexeme);
-            }
-        }
+    FnHeader ** fnHeader = omap_get(&dt->interfaceType->methods, methodName);
+    if(fnHeader != NULL){
+        return ti_fnheader_toType(parser, currentScope, *fnHeader, interfaceType->lexeme);
     }
 
     if(dt->interfaceType->extends.length > 0){
         DataType* parent;
-        i = 0;
+        uint32_t i = 0;
         vec_foreach(&dt->interfaceType->extends, parent, i) {
             DataType * parentMethod = resolver_resolveInterfaceMethod(parser, currentScope, parent, methodName);
             if(parentMethod != NULL){
@@ -92,26 +83,16 @@ DataType* resolver_resolveClassField(Parser* parser, ASTScope* currentScope, Dat
     uint32_t i = 0;
     LetExprDecl* let;
     vec_foreach(&dt->classType->letList, let, i){
-        char* var;
-        uint32_t j = 0;
-
-        vec_foreach(&let->variableNames, var, j){
-            if(strcmp(var, field) == 0){
-                FnArgument ** arg = map_get(&let->variables, var);
-                return (*arg)->type;
-            }
+        FnArgument ** arg = omap_get(&let->variables, field);
+        if(arg != NULL){
+            return (*arg)->type;
         }
     }
 
     // next look up methods
-    char* att;
-    vec_foreach(&dt->classType->methodNames, att, i) {
-        if(strcmp(att, field) == 0){
-            ClassMethod ** method = map_get(&dt->classType->methods, att);
-            if(method != NULL){
-                return (*method)->decl->dataType;
-            }
-        }
+    ClassMethod ** method = omap_get(&dt->classType->methods, field);
+    if(method != NULL){
+        return (*method)->decl->dataType;
     }
 
     // look up parent interfaces
@@ -134,21 +115,15 @@ DataType* resolver_resolveClassMethod(Parser* parser, ASTScope* currentScope, Da
 
     ASSERT(dt->kind == DT_CLASS, "Expected class type");
 
-    uint32_t i = 0;
-    char* att;
-    vec_foreach(&dt->classType->methodNames, att, i) {
-            if(strcmp(att, field) == 0){
-                ClassMethod ** method = map_get(&dt->classType->methods, att);
-                if(method != NULL){
-                    return (*method)->decl->dataType;
-                }
-            }
-        }
+    ClassMethod ** method = omap_get(&dt->classType->methods, field);
+    if(method != NULL){
+        return (*method)->decl->dataType;
+    }
 
     // look up parent interfaces
     if(dt->classType->extends.length > 0){
         DataType* parent;
-        i = 0;
+        uint32_t i = 0;
         vec_foreach(&dt->classType->extends, parent, i) {
                 DataType * parentMethod = resolver_resolveInterfaceMethod(parser, currentScope, parent, field);
                 if(parentMethod != NULL){
@@ -162,4 +137,158 @@ DataType* resolver_resolveClassMethod(Parser* parser, ASTScope* currentScope, Da
 
 uint8_t resolver_matchTypes(DataType* t1, DataType* t2){
     return 0;
-}
\ No newline at end of file
+}
+
+typedef enum ResolverAliasState {
+    RAS_NEW = 0,
+    RAS_VISITING,
+    RAS_DONE
+}ResolverAliasState;
+
+/**
+ * The declaration a declared type is an alias of, i.e B for `type A = B`, NULL if it is not an alias
+ */
+static DataType* resolver_aliasOf(DataType* decl) {
+    DataType* definition = decl->refType->ref;
+    if(definition == NULL || definition->kind != DT_REFERENCE || definition->name != NULL) {
+        return NULL;
+    }
+    return definition->refType->ref;
+}
+
+static int* resolver_aliasState(map_int_t* states, DataType* decl) {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", (void*)decl);
+    int* state = map_get(states, key);
+    if(state == NULL) {
+        map_set(states, key, RAS_NEW);
+        state = map_get(states, key);
+    }
+    return state;
+}
+
+/**
+ * Walks the aliases from a type declaration, each declaration is only walked once
+ */
+static void resolver_checkAliases(Parser* parser, map_int_t* states, DataType* decl) {
+    vec_dtype_t chain;
+    vec_init(&chain);
+    DataType* current = decl;
+    while(current != NULL && current->kind == DT_REFERENCE && current->name != NULL && current->refType != NULL) {
+        int state = *resolver_aliasState(states, current);
+        if(state == RAS_DONE) {
+            break;
+        }
+        if(state == RAS_VISITING) {
+            sds path = sdsempty();
+            uint32_t i = 0;
+            DataType* alias;
+            vec_foreach(&chain, alias, i) {
+                if(path[0] != '\0' || alias == current) {
+                    path = sdscatprintf(path, "%s -> ", alias->name);
+                }
+            }
+            path = sdscat(path, current->name);
+            // reported once, the declarations on the cycle are not walked again
+            vec_foreach(&chain, alias, i) {
+                *resolver_aliasState(states, alias) = RAS_DONE;
+            }
+            vec_deinit(&chain);
+            Lexeme lexeme = current->lexeme;
+            PARSER_ASSERT(0, "Type `%s` is an alias of itself: %s", current->name, path);
+        }
+        *resolver_aliasState(states, current) = RAS_VISITING;
+        vec_push(&chain, current);
+        current = resolver_aliasOf(current);
+    }
+
+    uint32_t i = 0;
+    DataType* alias;
+    vec_foreach(&chain, alias, i) {
+        *resolver_aliasState(states, alias) = RAS_DONE;
+    }
+    vec_deinit(&chain);
+}
+
+/**
+ * Checks if a name is a generic parameter declared in a scope or in one of its parents,
+ * i.e `T` within `fn id<T>(a: T) -> T`
+ */
+static uint8_t resolver_isGenericParam(ASTScope* scope, const char* name) {
+    for(; scope != NULL; scope = scope->parentScope) {
+        if(map_get(&scope->generics, name) != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void resolver_resolveReferences(Parser* parser) {
+    // bind every reference once, in the scope it was written in
+    uint32_t i = 0;
+    UnresolvedType pending;
+    vec_foreach(&parser->unresolvedTypes, pending, i) {
+        ReferenceType* refType = pending.typeRef->refType;
+        if(refType->ref != NULL || refType->pkg->ids.length != 1) {
+            continue;
+        }
+        char* name = refType->pkg->ids.data[0];
+        if(resolver_isGenericParam(pending.scope, name)) {
+            continue;
+        }
+        refType->ref = resolver_resolveType(parser, pending.scope, name);
+    }
+
+    // then the declarations they lead to, an alias only once the one it names has been walked
+    map_int_t states;
+    map_init(&states);
+    jmp_buf recovery;
+    jmp_buf* previousRecovery = parser->recovery;
+    parser->recovery = &recovery;
+    volatile uint32_t j = 0;
+    for(; j < (uint32_t)parser->unresolvedTypes.length; j++) {
+        // a cycle is reported, and the walk goes on with the next reference
+        if(setjmp(recovery) == 0) {
+            DataType* decl = parser->unresolvedTypes.data[j].typeRef->refType->ref;
+            // a declaration which is not an alias cannot be on a cycle
+            if(decl != NULL && decl->kind == DT_REFERENCE && resolver_aliasOf(decl) != NULL) {
+                resolver_checkAliases(parser, &states, decl);
+            }
+        }
+    }
+    parser->recovery = previousRecovery;
+    map_deinit(&states);
+    if(parser->boundTypes != NULL) {
+        vec_extend(parser->boundTypes, &parser->unresolvedTypes);
+    }
+    vec_clear(&parser->unresolvedTypes);
+
+    resolver_resolveParents(parser);
+}
+
+void resolver_resolveParents(Parser* parser) {
+    jmp_buf recovery;
+    jmp_buf* previousRecovery = parser->recovery;
+    parser->recovery = &recovery;
+    volatile uint32_t i = 0;
+    for(; i < (uint32_t)parser->unresolvedParents.length; i++) {
+        // a parent which cannot be added is reported, the walk goes on with the next one
+        if(setjmp(recovery) == 0) {
+            UnresolvedParent* pending = &parser->unresolvedParents.data[i];
+            Lexeme lexeme = pending->lexeme;
+            PARSER_ASSERT(scope_canExtend(parser, pending->scope, pending->parent, pending->kind),
+                          "Parent category `%s` doesn't match child category.", dataTypeKindToString(pending->parent));
+            char* pushRes = scope_extends_addParent(parser, pending->scope, pending->child, pending->parent);
+            PARSER_ASSERT(pushRes == NULL, "Duplicate field `%s` in parent already exists.", pushRes);
+        }
+    }
+    parser->recovery = previousRecovery;
+    vec_clear(&parser->unresolvedParents);
+}
+
+void resolver_takeReferences(Parser* into, Parser* from) {
+    vec_extend(&into->unresolvedTypes, &from->unresolvedTypes);
+    vec_clear(&from->unresolvedTypes);
+    vec_extend(&into->unresolvedParents, &from->unresolvedParents);
+    vec_clear(&from->unresolvedParents);
+}
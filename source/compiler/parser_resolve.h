@@ -62,4 +62,34 @@ DataType* resolver_resolveClassField(Parser* parser, ASTScope* currentScope, Dat
  */
 DataType* resolver_resolveClassMethod(Parser* parser, ASTScope* currentScope, DataType* classType, char* field);
 
+/**
+ * Binds the references to types met while parsing, parser->unresolvedTypes, to their declarations,
+ * all at once so that inference only follows them. Aliases are then walked in dependency order,
+ * each declaration once, and cycles such as `type A = B` `type B = A` are reported.
+ * References to a generic parameter declared in their own scope chain, or to names which are
+ * not declared, are left unbound: the former are replaced by instances, the latter reported
+ * where they are used. A type which shares its name with a generic parameter declared
+ * elsewhere is bound as any other.
+ * The references are then appended to parser->boundTypes, if set.
+ * @param parser
+ */
+void resolver_resolveReferences(Parser* parser);
+
+/**
+ * Checks the parents met while parsing, parser->unresolvedParents, and adds them to the types
+ * extending them, in source order. A parent of another category, or bringing a member the type
+ * already has, is reported and left out. Called by resolver_resolveReferences, and once the
+ * imports of a module interface are bound.
+ * @param parser
+ */
+void resolver_resolveParents(Parser* parser);
+
+/**
+ * Moves the pending references and parents of a parser into another,
+ * i.e from the parser of a chunk or of a function body into the parser of the program
+ * @param into
+ * @param from
+ */
+void resolver_takeReferences(Parser* into, Parser* from);
+
 #endif //TYPE_C_PARSER_RESOLVE_H
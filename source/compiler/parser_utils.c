@@ -5,166 +5,108 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <string.h>
 #include "parser_utils.h"
 #include "parser.h"
-
-void parser_assert(int cond, const char * rawcond, const char* func_name, int line, const char * fmt, ...) {
-    if (cond)
-        return;
-    char temp[1024];
-    va_list vl;
-    va_start(vl, fmt);
-    vsprintf(temp, fmt, vl);
-    va_end(vl);
-    fprintf(stdout, "Fatal error, assertion failed: `%s` in function `%s`, line %d \n", rawcond, func_name, line);
-    fprintf(stdout, "%s", temp);
-    fprintf(stdout, "\n");
-}
-
-
-char* extractLine(Parser* parser, Lexeme lexeme){
-    uint32_t token_len = lexeme.type != TOK_IDENTIFIER? strlen(token_type_to_string(lexeme.type)) : strlen(lexeme.string);
-    token_len = lexeme.string != NULL? strlen(lexeme.string) : token_len;
-    char line[512] = {0};
-    uint32_t lineIndex1 = lexeme.pos;
+#include "../utils/sds.h"
+
+/**
+ * Returns the source line holding pos, with a caret of len under it
+ */
+static sds extractLineAt(Parser* parser, uint32_t pos, uint32_t token_len){
+    LexerState* lexerState = parser->lexerState;
+    pos = pos < lexerState->len ? pos : lexerState->len;
+    uint32_t lineIndex1 = pos;
     // find new line pre pos:
-    while (lineIndex1 > 0 && parser->lexerState->buffer[lineIndex1-1] != '\n') {
+    while (lineIndex1 > 0 && lexerState->buffer[lineIndex1-1] != '\n') {
         lineIndex1--;
     }
     // find new line post pos:
-    uint32_t lineIndex2 = lexeme.pos;
-    while (lineIndex2 < parser->lexerState->len && parser->lexerState->buffer[lineIndex2] != '\n') {
+    uint32_t lineIndex2 = pos;
+    while (lineIndex2 < lexerState->len && lexerState->buffer[lineIndex2] != '\n') {
         lineIndex2++;
     }
-    // create new string
-    uint32_t lineLength = lineIndex2 - lineIndex1;
-    strncpy(line, parser->lexerState->buffer + lineIndex1, lineLength);
-    // add new line
-    line[lineLength] = '\n';
-    // now we add spaces from new line until pos relative to line
-    uint32_t spaces = lexeme.pos - lineIndex1;
-    for (uint32_t i = 0; i < spaces; i++) {
-        line[lineLength+i+1] = ' ';
-    }
-    // add ^ equal to token length
-    for (uint32_t i = 0; i < token_len; i++) {
-        line[lineLength+spaces+i+1] = '^';
-    }
-    line[lineLength+token_len+spaces+3] = '\0';
 
+    sds line = sdsnewlen(lexerState->buffer + lineIndex1, lineIndex2 - lineIndex1);
+    line = sdscat(line, "\n");
+    // now we add spaces from new line until pos relative to line, then ^ equal to token length
+    uint32_t spaces = pos - lineIndex1;
+    size_t start = sdslen(line);
+    line = sdsgrowzero(line, start + spaces + token_len);
+    memset(line + start, ' ', spaces);
+    memset(line + start + spaces, '^', token_len);
+
+    return line;
+}
+
+sds extractLine(Parser* parser, Lexeme lexeme){
+    uint32_t token_len = lexeme.type != TOK_IDENTIFIER? strlen(token_type_to_string(lexeme.type)) : strlen(lexeme.string);
+    token_len = lexeme.string != NULL? strlen(lexeme.string) : token_len;
+    return extractLineAt(parser, lexeme.pos, token_len);
+}
 
-    //line[lineLength+spaces+1] = '^';
-    //line[lineLength+spaces+2] = '\0';
-    return strdup(line);
+static DiagnosticSpan parser_utils_span(Parser* parser, Lexeme lexeme) {
+    DiagnosticSpan span = {parser->lexerState->filename, lexeme.line, lexeme.col, lexeme.pos, 0};
+    span.len = lexeme.string != NULL ? strlen(lexeme.string) : strlen(token_type_to_string(lexeme.type));
+    return span;
 }
 
 void parser_utils_raise(Parser* parser, Lexeme lexeme, const char* condition, const char* func_name, int line, const char* fmt, ...){
-    char temp[1024];
     va_list vl;
     va_start(vl, fmt);
-    vsprintf(temp, fmt, vl);
+    if(parser == NULL) {
+        fprintf(stdout, "%"PRIu32":%"PRIu32": error: ", lexeme.line, lexeme.col);
+        vfprintf(stdout, fmt, vl);
+        fprintf(stdout, "\ntriggered from: %s:%d\nFailure condition: %s\n", func_name, line, condition);
+        va_end(vl);
+        return;
+    }
+
+    diagnostics_reportv(&parser->diagnostics, DS_ERROR, parser_utils_span(parser, lexeme), extractLine(parser, lexeme),
+                        func_name, line, condition, fmt, vl);
+    va_end(vl);
+    parser->error_line = lexeme.line;
+}
+
+void parser_utils_warn(Parser* parser, Lexeme lexeme, const char* func_name, int line, const char* fmt, ...){
+    va_list vl;
+    va_start(vl, fmt);
+    diagnostics_reportv(&parser->diagnostics, DS_WARNING, parser_utils_span(parser, lexeme), extractLine(parser, lexeme),
+                        func_name, line, NULL, fmt, vl);
     va_end(vl);
+}
+
+void parser_utils_report(Parser* parser, DiagnosticSeverity severity, DiagnosticSpan span, const char* message){
+    span.filename = parser->lexerState->filename;
+    diagnostics_report(&parser->diagnostics, severity, span, extractLineAt(parser, span.pos, span.len),
+                       NULL, 0, NULL, "%s", message);
+}
+
+void parser_utils_panic(Parser* parser) {
+    if(parser != NULL && parser->recovery != NULL) {
+        longjmp(*parser->recovery, 1);
+    }
 
-    fprintf(stdout, "%s:%"PRIu32":%"PRIu32": error: %s\n", parser->lexerState->filename, lexeme.line, lexeme.col, temp);
-    fprintf(stdout, "%s\n", extractLine(parser, lexeme));
-    fprintf(stdout, "triggered from: %s:%d\n", func_name, line);
-    fprintf(stdout, "Failure condition: %s\n", condition);
+    // embedders and servers survive errors raised outside of the compiler's own recovery points
+    if(parser != NULL && parser->diagnostics.diagnostics.length > 0) {
+        error_unwind(vec_last(&parser->diagnostics.diagnostics)->message);
+    }
+    else {
+        error_unwind("parse error");
+    }
+
+    if(parser != NULL) {
+        parser_reportDiagnostics(parser);
+    }
+    exit(EXIT_FAILURE);
 }
 
 char* dataTypeKindToString(DataType* type){
-    switch (type->kind) {
-        case DT_I8:
-            return "i8";
-            
-        case DT_I16:
-            return "i16";
-            
-        case DT_I32:
-            return "i32";
-            
-        case DT_I64:
-            return "i64";
-            
-        case DT_U8:
-            return "u8";
-            
-        case DT_U16:
-            return "u16";
-            
-        case DT_U32:
-            return "u32";
-            
-        case DT_U64:
-            return "u64";
-            
-        case DT_F32:
-            return "f32";
-            
-        case DT_F64:
-            return "f64";
-            
-        case DT_BOOL:
-            return "bool";
-            
-        case DT_VOID:
-            return "void";
-            
-        case DT_STRING:
-            return "string";
-            
-        case DT_CHAR:
-            return "char";
-            
-        case DT_CLASS:
-            return "class";
-            
-        case DT_INTERFACE:
-            return "interface";
-            
-        case DT_STRUCT:
-            return "struct";
-            
-        case DT_ENUM:
-            return "enum";
-            
-        case DT_VARIANT:
-            return "variant";
-            
-        case DT_ARRAY:
-            return "array";
-            
-        case DT_FN:
-            return "fn";
-            
-        case DT_PTR:
-            return "ptr";
-            
-        case DT_VEC:
-            return "vec";
-            
-        case DT_REFERENCE:
-            if(type->refType->ref != NULL)
-                return dataTypeKindToString(type->refType->ref);
-            else
-                // concatenate the name of the reference with ref(<name>)
-                return "ref";
-            
-        case DT_TYPE_JOIN:
-            return "type_join";
-            
-        case DT_TYPE_UNION:
-            return "type_union";
-            
-        case DT_PROCESS:
-            return "process";
-            
-        case DT_UNRESOLVED:
-            return "unresolved";
-            
-        case DT_INVALID:
-            return "invalid";
-            
+    // the category of a bound reference is the one of its definition
+    if(type->kind == DT_REFERENCE) {
+        return type->refType->ref != NULL ? dataTypeKindToString(type->refType->ref) : "ref";
     }
+    return stringifyType(type);
 }
 
 char* stringifyType(DataType* type){
@@ -260,4 +202,111 @@ char* stringifyType(DataType* type){
         default:
             return "unknown";
     }
-}
\ No newline at end of file
+}
+/**
+ * Appends ( a : T, b : U ) -> R
+ */
+static sds describeFn(sds str, omap_fnargument_t* args, DataType* returnType) {
+    str = sdscat(str, "(");
+    uint32_t i = 0;
+    char* argName = NULL;
+    FnArgument* arg = NULL;
+    omap_foreach(args, argName, arg, i) {
+        str = sdscatprintf(str, " %s : %s%s", argName, describeType(arg->type), i < omap_length(args) - 1 ? "," : "");
+    }
+    return sdscatprintf(str, " ) -> %s", describeType(returnType));
+}
+
+static sds describeUncached(sds str, DataType* type) {
+    if(type->kind == DT_REFERENCE) {
+        // named as written, whether it is bound or not
+        if(type->refType->pkg == NULL) {
+            return type->refType->ref != NULL ? sdscat(str, describeType(type->refType->ref)) : str;
+        }
+        ASSERT(type->refType->pkg->ids.length > 0, "Invalid reference type");
+        uint32_t i = 0;
+        char* id = NULL;
+        vec_foreach(&type->refType->pkg->ids, id, i) {
+            str = sdscatprintf(str, "%s%s", i > 0 ? "." : "", id);
+        }
+        return str;
+    }
+
+    if((type->kind == DT_TYPE_JOIN) || (type->kind == DT_TYPE_UNION)) {
+        return sdscatprintf(str, "(%s %s %s)", describeType(type->unionType->left),
+                            type->kind == DT_TYPE_JOIN ? "&" : "|", describeType(type->unionType->right));
+    }
+
+    str = sdscat(str, stringifyType(type));
+    uint32_t i = 0;
+    if(type->kind == DT_STRUCT) {
+        str = sdscat(str, " {");
+        StructAttribute* attr = NULL;
+        omap_foreach_value(&type->structType->attributes, attr, i) {
+            str = sdscatprintf(str, " %s %s%s", describeType(attr->type), attr->name,
+                               i < omap_length(&type->structType->attributes) - 1 ? "," : "");
+        }
+        str = sdscat(str, " }");
+    }
+    else if(type->kind == DT_INTERFACE) {
+        str = sdscat(str, " {");
+        FnHeader* method = NULL;
+        omap_foreach_value(&type->interfaceType->methods, method, i) {
+            str = sdscatprintf(str, " %s", method->name);
+            str = describeFn(str, &method->type->args, method->type->returnType);
+            if(i < omap_length(&type->interfaceType->methods) - 1) {
+                str = sdscat(str, ",");
+            }
+        }
+        str = sdscat(str, " }");
+    }
+    else if(type->kind == DT_CLASS) {
+        str = sdscat(str, " {");
+        ClassMethod* method = NULL;
+        omap_foreach_value(&type->classType->methods, method, i) {
+            FnHeader* header = method->decl->header;
+            str = sdscatprintf(str, " %s", header->name);
+            str = describeFn(str, &header->type->args, header->type->returnType);
+            if(i < omap_length(&type->classType->methods) - 1) {
+                str = sdscat(str, ",");
+            }
+        }
+        LetExprDecl* letDecl = NULL;
+        vec_foreach(&type->classType->letList, letDecl, i) {
+            uint32_t j = 0;
+            char* varName = NULL;
+            FnArgument* var = NULL;
+            omap_foreach(&letDecl->variables, varName, var, j) {
+                str = sdscatprintf(str, " let %s: %s%s", varName, describeType(var->type),
+                                   j < omap_length(&letDecl->variables) - 1 ? "," : "");
+            }
+            if(i < type->classType->letList.length - 1) {
+                str = sdscat(str, ",");
+            }
+        }
+        str = sdscat(str, " }");
+    }
+    return str;
+}
+
+const char* describeType(DataType* type) {
+    if(type == NULL) {
+        return "void";
+    }
+    if(type->name != NULL) {
+        return type->name;
+    }
+
+    // types are shared by the parsers of a program, which may describe them concurrently
+    char* description = __atomic_load_n(&type->description, __ATOMIC_ACQUIRE);
+    if(description != NULL) {
+        return description;
+    }
+    sds str = describeUncached(sdsempty(), type);
+    char* expected = NULL;
+    if(!__atomic_compare_exchange_n(&type->description, &expected, str, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        sdsfree(str);
+        return expected;
+    }
+    return str;
+}
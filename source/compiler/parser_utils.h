@@ -8,21 +8,58 @@
 #include <stdarg.h>
 #include "error.h"
 #include "parser.h"
+#include "../utils/sds.h"
 
 char* stringifyType(DataType* type);
 
-void parser_assert(int cond, const char * rawcond, const char* func_name, int line, const char * fmt, ...);
-char* extractLine(Parser* parser, Lexeme lexeme);
+/**
+ * Describes a type for diagnostics and tooling, i.e `struct { u32 x, u32 y }`.
+ * Named types are described by their name and references as they are written,
+ * anything else is described once and the description is kept on the type.
+ * @param type may be NULL, for void
+ * @return the description, owned by the type
+ */
+const char* describeType(DataType* type);
+
+/**
+ * Returns the source line of the lexeme, with a caret under it
+ * @param parser
+ * @param lexeme
+ * @return new sds string
+ */
+sds extractLine(Parser* parser, Lexeme lexeme);
 void parser_utils_raise(Parser* parser, Lexeme lexeme, const char* condition, const char* func_name, int line, const char* fmt, ...);
+void parser_utils_warn(Parser* parser, Lexeme lexeme, const char* func_name, int line, const char* fmt, ...);
+
+/**
+ * Reports again a diagnostic raised by an earlier build, at its span within the current source.
+ * The compiler location which raised it is not kept.
+ * @param parser
+ * @param severity
+ * @param span its filename is the parser's
+ * @param message
+ */
+void parser_utils_report(Parser* parser, DiagnosticSeverity severity, DiagnosticSpan span, const char* message);
+
+/**
+ * Records the error into parser->diagnostics, then unwinds to the innermost recovery point.
+ * If there is none, the errors are reported and the process exits.
+ * @param parser
+ */
+void parser_utils_panic(Parser* parser);
 
 #define PARSER_ASSERT(c, msg, ...) { \
     if(!(c)){                                     \
         parser_utils_raise(parser, lexeme, #c, __FUNCTION_NAME__, __LINE__ , msg, ##__VA_ARGS__);\
-\
-        assert(c);                           \
+        parser_utils_panic(parser);          \
     }                                    \
 }
 
+#define PARSER_WARN(msg, ...) parser_utils_warn(parser, lexeme, __FUNCTION_NAME__, __LINE__ , msg, ##__VA_ARGS__)
+
+/**
+ * Category of a type, i.e `struct`, following references to their definition
+ */
 char* dataTypeKindToString(DataType* type);
 
 #endif //TYPE_C_PARSER_UTILS_H
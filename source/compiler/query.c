@@ -0,0 +1,346 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "query.h"
+#include "parser.h"
+#include "parser_utils.h"
+#include "type_inference.h"
+#include "type_checker.h"
+
+#define QUERY_INITIAL_CAPACITY 256
+
+typedef void* (*QueryCompute)(Parser* parser, ASTScope* scope, void* key);
+
+static uint32_t query_hash(QueryKind kind, const void* key) {
+    uint64_t h = (uint64_t)(uintptr_t)key ^ ((uint64_t)kind << 59);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+static void query_freeValue(QueryEntry* entry) {
+    if(entry->kind == QK_MEMBERS_OF && entry->value != NULL) {
+        QueryMembers* members = entry->value;
+        map_deinit(&members->names);
+        vec_deinit(&members->order);
+        free(members);
+    }
+    if(entry->kind == QK_STRUCT_FIELDS && entry->value != NULL) {
+        QueryStructFields* fields = entry->value;
+        free(fields->fields);
+        free(fields);
+    }
+    entry->value = NULL;
+}
+
+static QueryEntry* query_find(QueryEntry* entries, uint32_t capacity, QueryKind kind, const void* key) {
+    uint32_t i = query_hash(kind, key) & (capacity - 1);
+    while(entries[i].key != NULL && (entries[i].key != key || entries[i].kind != kind)) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &entries[i];
+}
+
+static uint8_t query_isValid(QueryEngine* engine, QueryEntry* entry) {
+    return entry->key != NULL && entry->state != QS_EMPTY && entry->revision == engine->revision;
+}
+
+static void query_grow(QueryEngine* engine) {
+    uint32_t capacity = engine->capacity == 0 ? QUERY_INITIAL_CAPACITY : engine->capacity * 2;
+    QueryEntry* entries = calloc(capacity, sizeof(QueryEntry));
+
+    // stale and dropped answers are not carried over
+    uint32_t count = 0;
+    uint32_t i = 0;
+    for(; i < engine->capacity; i++) {
+        QueryEntry* entry = &engine->entries[i];
+        if(entry->key == NULL) {
+            continue;
+        }
+        if(query_isValid(engine, entry)) {
+            *query_find(entries, capacity, entry->kind, entry->key) = *entry;
+            count++;
+        }
+        else {
+            query_freeValue(entry);
+        }
+    }
+
+    free(engine->entries);
+    engine->entries = entries;
+    engine->capacity = capacity;
+    engine->count = count;
+}
+
+void query_init(QueryEngine* engine) {
+    memset(engine, 0, sizeof(QueryEngine));
+}
+
+void query_deinit(QueryEngine* engine) {
+    uint32_t i = 0;
+    for(; i < engine->capacity; i++) {
+        query_freeValue(&engine->entries[i]);
+    }
+    free(engine->entries);
+    memset(engine, 0, sizeof(QueryEngine));
+}
+
+void query_invalidate(QueryEngine* engine, QueryKind kind, const void* key) {
+    if(kind == QK_TYPE_OF) {
+        ((Expr*)key)->inferred = 0;
+    }
+    if(engine->count == 0) {
+        return;
+    }
+
+    // the entry stays in place so probing still works
+    QueryEntry* entry = query_find(engine->entries, engine->capacity, kind, key);
+    if(entry->key != NULL) {
+        query_freeValue(entry);
+        entry->state = QS_EMPTY;
+    }
+}
+
+void query_invalidateAll(QueryEngine* engine) {
+    engine->revision++;
+}
+
+/**
+ * Answers a query from the cache, or computes it.
+ * An error while computing is remembered, and raised again on later requests.
+ */
+static void* query_run(Parser* parser, ASTScope* scope, QueryKind kind, void* key, Lexeme lexeme, QueryCompute compute) {
+    QueryEngine* engine = &parser->queries;
+
+    if(engine->count > 0) {
+        QueryEntry* entry = query_find(engine->entries, engine->capacity, kind, key);
+        if(query_isValid(engine, entry)) {
+            engine->stats.hits[kind]++;
+            if(entry->state == QS_FAILED) {
+                parser_utils_panic(parser);
+            }
+            PARSER_ASSERT(entry->state != QS_RUNNING, "Cyclic dependency while computing the %s", query_kindToString(kind));
+            return entry->value;
+        }
+    }
+    engine->stats.misses[kind]++;
+
+    // keep the load factor under 3/4
+    if((engine->count + 1) * 4 > engine->capacity * 3) {
+        query_grow(engine);
+    }
+    QueryEntry* entry = query_find(engine->entries, engine->capacity, kind, key);
+    if(entry->key == NULL) {
+        engine->count++;
+    }
+    query_freeValue(entry);
+    entry->key = key;
+    entry->kind = kind;
+    entry->state = QS_RUNNING;
+    entry->revision = engine->revision;
+
+    jmp_buf recovery;
+    jmp_buf* previousRecovery = parser->recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery)) {
+        parser->recovery = previousRecovery;
+        // nested queries may have moved it
+        entry = query_find(engine->entries, engine->capacity, kind, key);
+        entry->state = QS_FAILED;
+        parser_utils_panic(parser);
+    }
+
+    void* value = compute(parser, scope, key);
+    parser->recovery = previousRecovery;
+
+    entry = query_find(engine->entries, engine->capacity, kind, key);
+    entry->state = QS_DONE;
+    entry->value = value;
+    return value;
+}
+
+static void* query_computeTypeOf(Parser* parser, ASTScope* scope, void* key) {
+    Expr* expr = key;
+    ti_infer_expr(parser, scope, expr);
+    return expr->dataType;
+}
+
+/**
+ * Adds the member names of a parent, its own duplicate is reported as well
+ * @return the first name found twice, NULL if none
+ */
+static char* query_mergeMembers(QueryMembers* members, QueryMembers* from) {
+    char* duplicate = from->duplicate;
+    if(duplicate != NULL && members->duplicate == NULL) {
+        members->duplicate = duplicate;
+    }
+
+    uint32_t i = 0;
+    char* name;
+    vec_foreach(&from->order, name, i) {
+        char* res = query_addMember(members, name);
+        if(duplicate == NULL) {
+            duplicate = res;
+        }
+    }
+    return duplicate;
+}
+
+static void query_mergeParents(Parser* parser, ASTScope* scope, QueryMembers* members, vec_dtype_small_t* extends) {
+    uint32_t i = 0;
+    DataType* parent;
+    vec_foreach(extends, parent, i) {
+        query_mergeMembers(members, query_membersOf(parser, scope, parent));
+    }
+}
+
+/**
+ * Adds the keys of an ordered map, whichever its values
+ */
+static void query_addMembers(QueryMembers* members, omap_base_t* names) {
+    uint32_t i = 0;
+    for(; i < names->length; i++) {
+        query_addMember(members, names->keys[i]);
+    }
+}
+
+static void* query_computeMembersOf(Parser* parser, ASTScope* scope, void* key) {
+    DataType* type = key;
+    QueryMembers* members = malloc(sizeof(QueryMembers));
+    map_init(&members->names);
+    vec_init(&members->order);
+    members->duplicate = NULL;
+
+    uint32_t i = 0;
+    switch(type->kind) {
+        case DT_STRUCT:
+            query_mergeParents(parser, scope, members, &type->structType->extends);
+            query_addMembers(members, &type->structType->attributes.base);
+            break;
+        case DT_INTERFACE:
+            query_mergeParents(parser, scope, members, &type->interfaceType->extends);
+            query_addMembers(members, &type->interfaceType->methods.base);
+            break;
+        case DT_CLASS: {
+            query_mergeParents(parser, scope, members, &type->classType->extends);
+            query_addMembers(members, &type->classType->methods.base);
+            LetExprDecl* letDecl;
+            vec_foreach(&type->classType->letList, letDecl, i) {
+                query_addMembers(members, &letDecl->variables.base);
+            }
+            break;
+        }
+        case DT_TYPE_JOIN:
+            query_mergeParents(parser, scope, members, &type->joinType->members);
+            break;
+        case DT_TYPE_UNION: {
+            // each member is checked on its own
+            DataType* member;
+            vec_foreach(&type->unionType->members, member, i) {
+                QueryMembers* memberMembers = query_membersOf(parser, scope, member);
+                if(members->duplicate == NULL) {
+                    members->duplicate = memberMembers->duplicate;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return members;
+}
+
+int query_compareFields(const QueryField* left, const QueryField* right) {
+    if(left->hash != right->hash) {
+        return left->hash < right->hash ? -1 : 1;
+    }
+    return strcmp(left->name, right->name);
+}
+
+static int query_sortFields(const void* a, const void* b) {
+    return query_compareFields(a, b);
+}
+
+static void* query_computeStructFields(Parser* parser, ASTScope* scope, void* key) {
+    DataType* type = key;
+    omap_structattribute_t* attributes = &type->structType->attributes;
+    QueryStructFields* fields = malloc(sizeof(QueryStructFields));
+    fields->bloom = 0;
+    fields->count = omap_length(attributes);
+    fields->fields = malloc(sizeof(QueryField) * (fields->count > 0 ? fields->count : 1));
+
+    uint32_t i = 0;
+    char* name;
+    StructAttribute* attribute;
+    omap_foreach(attributes, name, attribute, i) {
+        uint32_t hash = attributes->base.hashes[i];
+        fields->fields[i].hash = hash;
+        fields->fields[i].name = name;
+        fields->fields[i].type = attribute->type;
+        fields->bloom |= (1ULL << (hash & 63)) | (1ULL << ((hash >> 6) & 63));
+    }
+    qsort(fields->fields, fields->count, sizeof(QueryField), query_sortFields);
+    return fields;
+}
+
+static void* query_computeResolvedBase(Parser* parser, ASTScope* scope, void* key) {
+    return ti_type_resolveBase(parser, scope, key);
+}
+
+DataType* query_typeOf(Parser* parser, ASTScope* scope, Expr* expr) {
+    // answered by the expression itself once inferred, without probing the table
+    uint32_t revision = parser->queries.revision + 1;
+    if(expr->inferred == revision) {
+        parser->queries.stats.hits[QK_TYPE_OF]++;
+        return expr->dataType;
+    }
+    DataType* type = query_run(parser, scope, QK_TYPE_OF, expr, expr->lexeme, query_computeTypeOf);
+    expr->inferred = revision;
+    return type;
+}
+
+QueryMembers* query_membersOf(Parser* parser, ASTScope* scope, DataType* type) {
+    // a reference shares the answer of the type it names
+    type = ti_type_findBase(parser, scope, type);
+    return query_run(parser, scope, QK_MEMBERS_OF, type, type->lexeme, query_computeMembersOf);
+}
+
+char* query_addMember(QueryMembers* members, char* name) {
+    if(map_get(&members->names, name) != NULL) {
+        if(members->duplicate == NULL) {
+            members->duplicate = name;
+        }
+        return name;
+    }
+    map_set(&members->names, name, 1);
+    vec_push(&members->order, name);
+    return NULL;
+}
+
+QueryStructFields* query_structFieldsOf(Parser* parser, ASTScope* scope, DataType* type) {
+    return query_run(parser, scope, QK_STRUCT_FIELDS, type, type->lexeme, query_computeStructFields);
+}
+
+DataType* query_resolvedBase(Parser* parser, ASTScope* scope, DataType* type) {
+    return query_run(parser, scope, QK_RESOLVED_BASE, type, type->lexeme, query_computeResolvedBase);
+}
+
+const char* query_kindToString(QueryKind kind) {
+    switch (kind) {
+        case QK_TYPE_OF:
+            return "type of expression";
+        case QK_MEMBERS_OF:
+            return "members of type";
+        case QK_RESOLVED_BASE:
+            return "base of type";
+        case QK_STRUCT_FIELDS:
+            return "fields of struct";
+        default:
+            return "unknown";
+    }
+}
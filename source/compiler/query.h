@@ -0,0 +1,163 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_QUERY_H
+#define TYPE_C_QUERY_H
+
+#include <stdint.h>
+#include "ast.h"
+#include "../utils/vec.h"
+#include "../utils/map.h"
+
+struct Parser;
+
+/**
+ * Demand-driven type information.
+ * Each query is answered on first request, by running the matching inference
+ * routine, and its answer is cached until it is invalidated.
+ * Answers are keyed by the AST node they are about, an expression always lives in
+ * the same scope and a type node is always resolved the same way.
+ */
+typedef enum QueryKind {
+    QK_TYPE_OF = 0,         // type of an expression
+    QK_MEMBERS_OF,          // member names of a struct, class, interface or join, parents included
+    QK_RESOLVED_BASE,       // full definition of a type reference
+    QK_STRUCT_FIELDS,       // attributes of a struct, sorted for structural checks
+    QK_COUNT
+}QueryKind;
+
+typedef enum QueryState {
+    QS_EMPTY = 0,
+    QS_RUNNING,             // being computed, a request in this state is a cycle
+    QS_DONE,
+    QS_FAILED               // computing it raised an error
+}QueryState;
+
+typedef struct QueryEntry {
+    const void* key;
+    QueryKind kind;
+    QueryState state;
+    // revision at which the answer was computed, older ones are stale
+    uint32_t revision;
+    void* value;
+}QueryEntry;
+
+typedef struct QueryMembers {
+    map_int_t names;
+    // the same names, in the order they were added
+    vec_str_t order;
+    // first duplicate member found, names is incomplete if not NULL
+    char* duplicate;
+}QueryMembers;
+
+typedef struct QueryField {
+    // hash of the name, as kept by the attributes map
+    uint32_t hash;
+    char* name;
+    DataType* type;
+}QueryField;
+
+/**
+ * Fingerprint of the attributes of a struct.
+ * Two bits of the bloom are set per attribute name, a struct whose bloom is not
+ * a subset of another's is missing one of its attributes.
+ * The fields are sorted by hash then name, so two structs are compared in one pass.
+ */
+typedef struct QueryStructFields {
+    uint64_t bloom;
+    uint32_t count;
+    QueryField* fields;
+}QueryStructFields;
+
+typedef struct QueryStats {
+    uint64_t hits[QK_COUNT];
+    uint64_t misses[QK_COUNT];
+}QueryStats;
+
+/**
+ * Open addressing table keyed by (kind, node)
+ */
+typedef struct QueryEngine {
+    QueryEntry* entries;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t revision;
+    QueryStats stats;
+}QueryEngine;
+
+void query_init(QueryEngine* engine);
+void query_deinit(QueryEngine* engine);
+
+/**
+ * Drops a single answer, i.e when the node it is about was modified
+ * @param engine
+ * @param kind
+ * @param key
+ */
+void query_invalidate(QueryEngine* engine, QueryKind kind, const void* key);
+
+/**
+ * Drops every answer, i.e when the program was re-parsed
+ * @param engine
+ */
+void query_invalidateAll(QueryEngine* engine);
+
+/**
+ * Type of the given expression, inferring it if needed.
+ * An expression is inferred once per revision, its answer is then kept on it, see Expr.inferred
+ * @param parser
+ * @param scope scope the expression lives in
+ * @param expr
+ * @return the type, errors are raised through the parser
+ */
+DataType* query_typeOf(struct Parser* parser, ASTScope* scope, Expr* expr);
+
+/**
+ * Member names of the given type, parents included.
+ * They are made from the member names of its parents, each computed once, so
+ * a hierarchy is flattened in time linear in the number of members.
+ * A union has no member names, only the first duplicate found on either side.
+ * @param parser
+ * @param scope
+ * @param type references are followed
+ * @return owned by the engine
+ */
+QueryMembers* query_membersOf(struct Parser* parser, ASTScope* scope, DataType* type);
+
+/**
+ * Adds a member declared after the member names were computed, so a type under
+ * construction is checked for duplicates one member at a time
+ * @param members obtained with query_membersOf before the member was added to the type
+ * @param name
+ * @return name if it is already a member, NULL otherwise
+ */
+char* query_addMember(QueryMembers* members, char* name);
+
+/**
+ * Attributes of a struct, fingerprinted for structural checks
+ * @param parser
+ * @param scope
+ * @param type base type of a struct
+ * @return owned by the engine
+ */
+QueryStructFields* query_structFieldsOf(struct Parser* parser, ASTScope* scope, DataType* type);
+
+/**
+ * Order of the fields within QueryStructFields
+ * @return < 0, 0 or > 0 as left comes before, is, or comes after right
+ */
+int query_compareFields(const QueryField* left, const QueryField* right);
+
+/**
+ * Full definition of a type, following references
+ * @param parser
+ * @param scope
+ * @param type
+ * @return the base type, errors are raised through the parser
+ */
+DataType* query_resolvedBase(struct Parser* parser, ASTScope* scope, DataType* type);
+
+const char* query_kindToString(QueryKind kind);
+
+#endif //TYPE_C_QUERY_H
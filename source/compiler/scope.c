@@ -27,9 +27,8 @@ ScopeRegResult scope_program_addImport(ASTProgramNode* program, ImportStmt * imp
 
 ScopeRegResult scope_ffi_addMethod(ExternDecl* ffi, FnHeader* method){
     // make sure function name doesn't exist already
-    if(map_get(&ffi->methods, method->name) == NULL){
-        vec_push(&ffi->methodNames, method->name);
-        map_set(&ffi->methods, method->name, method);
+    if(omap_get(&ffi->methods, method->name) == NULL){
+        omap_set(&ffi->methods, method->name, method);
         return SRRT_SUCCESS;
     }
 
@@ -49,9 +48,8 @@ ScopeRegResult scope_fnheader_addGeneric(FnHeader* fn, GenericParam * genericPar
 
 ScopeRegResult scope_fnheader_addArg(FnHeader* fn, FnArgument* arg){
     // make sure argument name doesn't exist already
-    if(map_get(&fn->type->args, arg->name) == NULL){
-        vec_push(&fn->type->argNames, arg->name);
-        map_set(&fn->type->args, arg->name, arg);
+    if(omap_get(&fn->type->args, arg->name) == NULL){
+        omap_set(&fn->type->args, arg->name, arg);
         return SRRT_SUCCESS;
     }
 
@@ -65,8 +63,7 @@ ScopeRegResult scope_dtype_addGeneric(DataType* dtype, GenericParam * genericPar
         map_set(&dtype->generics, genericParam->name, genericParam);
 
         // add generic to scope to
-        vec_push(&dtype->scope->genericNames, genericParam->name);
-        map_set(&dtype->scope->generics, genericParam->name, genericParam);
+        scope_registerGeneric(dtype->scope, genericParam);
 
         return SRRT_SUCCESS;
     }
@@ -74,6 +71,11 @@ ScopeRegResult scope_dtype_addGeneric(DataType* dtype, GenericParam * genericPar
     return SRRT_TOKEN_ALREADY_REGISTERED;
 }
 
+void scope_registerGeneric(ASTScope* scope, GenericParam* genericParam) {
+    vec_push(&scope->genericNames, genericParam->name);
+    map_set(&scope->generics, genericParam->name, genericParam);
+}
+
 uint8_t scope_canExtend(Parser * parser, ASTScope *parentScope,DataType* parent, DataTypeKind childKind){
     DataType* bareparent = ti_type_findBase(parser, parentScope, parent);
     if(bareparent->kind == DT_CLASS) {
@@ -86,28 +88,36 @@ uint8_t scope_canExtend(Parser * parser, ASTScope *parentScope,DataType* parent,
     return tc_gettype_base(parser, parentScope,bareparent) == childKind;
 }
 
-char* scope_extends_addParent(Parser* parser, ASTScope * scope, vec_dtype_t* extends, DataType* parent){
-    DataType* bareparent = ti_type_findBase(NULL, scope, parent);
-    map_int_t map;
-    map_init(&map);
-    char* res1 = tc_accumulate_type_methods_attribute(parser, scope, bareparent, &map);
-    if(res1 != NULL){
-        return res1;
+static vec_dtype_small_t* scope_extendsOf(DataType* child) {
+    switch(child->kind) {
+        case DT_STRUCT:
+            return &child->structType->extends;
+        case DT_INTERFACE:
+            return &child->interfaceType->extends;
+        case DT_CLASS:
+            return &child->classType->extends;
+        default:
+            ASSERT(0, "Type of kind %d cannot extend", child->kind);
+            return NULL;
     }
+}
 
-    if(parent->kind == DT_TYPE_JOIN){
-        char* duplicate = tc_check_canJoin(parser, scope, parent->joinType->left, parent->joinType->right);
-        if(duplicate != NULL){
-            return duplicate;
-        }
+char* scope_extends_addParent(Parser* parser, ASTScope * scope, DataType* child, DataType* parent){
+    vec_dtype_small_t* extends = scope_extendsOf(child);
+    // flattened once per type, a join's sides are checked against each other
+    QueryMembers* parentMembers = query_membersOf(parser, scope, parent);
+    if(parentMembers->duplicate != NULL){
+        return parentMembers->duplicate;
     }
 
+    // names of the parents added so far, the new one must not clash with them
+    QueryMembers* members = query_membersOf(parser, scope, child);
     uint32_t i = 0;
-    DataType * type = NULL;
-    vec_foreach(extends, type, i){
-        char* res = tc_accumulate_type_methods_attribute(parser, scope, type, &map);
-        if(res != NULL){
-            return res;
+    char* name;
+    vec_foreach(&parentMembers->order, name, i){
+        char* duplicate = query_addMember(members, name);
+        if(duplicate != NULL){
+            return duplicate;
         }
     }
 
@@ -127,76 +137,54 @@ ScopeRegResult scope_registerType(ASTScope* scope, DataType* dataType){
 
 char* scope_interface_addMethod(Parser* parser, ASTScope * scope, DataType * interface, FnHeader* method){
     ASSERT(interface->kind == DT_INTERFACE, "Input is not an interface");
+    // member names so far, parents included. kept up to date rather than computed again
+    QueryMembers* members = query_membersOf(parser, scope, interface);
 
-    map_set(&interface->interfaceType->methods, method->name, method);
-    vec_push(&interface->interfaceType->methodNames, method->name);
+    omap_set(&interface->interfaceType->methods, method->name, method);
 
-    map_int_t map;
-    map_init(&map);
-    // check current interface
-    char* res = tc_accumulate_type_methods_attribute(parser, scope, interface, &map);
-    if(res != NULL){
-        return res;
-    }
-
-    return NULL;
+    return query_addMember(members, method->name);
 }
 
 char* scope_class_addMethod(Parser* parser, ASTScope * scope, DataType * class, ClassMethod* fnDecl){
     ASSERT(class->kind == DT_CLASS, "Input is not an interface");
+    QueryMembers* members = query_membersOf(parser, scope, class);
 
-    map_int_t map;
-    map_init(&map);
+    omap_set(&class->classType->methods, fnDecl->decl->header->name, fnDecl);
 
-    vec_push(&class->classType->methodNames, fnDecl->decl->header->name);
-    map_set(&class->classType->methods, fnDecl->decl->header->name, fnDecl);
-
-    // check current interface
-    char* dup = tc_accumulate_type_methods_attribute(parser, scope, class, &map);
-    if(dup != NULL) {
-        return dup;
-    }
-
-    return NULL;
+    return query_addMember(members, fnDecl->decl->header->name);
 }
 
 char* scope_class_addAttribute(Parser* parser, ASTScope * scope, DataType * class, LetExprDecl* decl){
     ASSERT(class->kind == DT_CLASS, "Input is not an interface");
+    QueryMembers* members = query_membersOf(parser, scope, class);
     vec_push(&class->classType->letList, decl);
 
-    map_int_t map;
-    map_init(&map);
-    // check current interface
-    char* dup = tc_accumulate_type_methods_attribute(parser, scope, class, &map);
-    if(dup != NULL) {
-        return dup;
+    // every variable is added, the first duplicate is reported
+    char* dup = NULL;
+    char* varName;
+    uint32_t i = 0;
+    omap_foreach_key(&decl->variables, varName, i) {
+        char* res = query_addMember(members, varName);
+        if(dup == NULL) {
+            dup = res;
+        }
     }
-
-    return NULL;
+    return dup;
 }
 
 char* scope_struct_addAttribute(Parser* parser, ASTScope * scope, DataType * struct_, StructAttribute* attr){
     ASSERT(struct_->kind == DT_STRUCT, "Input is not a struct");
+    QueryMembers* members = query_membersOf(parser, scope, struct_);
 
-    vec_push(&struct_->structType->attributeNames, attr->name);
-    map_set(&struct_->structType->attributes, attr->name, attr);
+    omap_set(&struct_->structType->attributes, attr->name, attr);
 
-    map_int_t map;
-    map_init(&map);
-    // check current interface
-    char* dup = tc_accumulate_type_methods_attribute(parser, scope, struct_, &map);
-    if(dup != NULL) {
-        return dup;
-    }
-
-    return NULL;
+    return query_addMember(members, attr->name);
 }
 
 ScopeRegResult scope_variantConstructor_addArg(VariantConstructor* constructor, VariantConstructorArgument* arg){
     // make sure argument name doesn't exist already
-    if(map_get(&constructor->args, arg->name) == NULL){
-        vec_push(&constructor->argNames, arg->name);
-        map_set(&constructor->args, arg->name, arg);
+    if(omap_get(&constructor->args, arg->name) == NULL){
+        omap_set(&constructor->args, arg->name, arg);
         return SRRT_SUCCESS;
     }
 
@@ -205,9 +193,8 @@ ScopeRegResult scope_variantConstructor_addArg(VariantConstructor* constructor,
 
 ScopeRegResult scope_variant_addConstructor(VariantType * variant, VariantConstructor * constructor){
     // make sure constructor name doesn't exist already
-    if(map_get(&variant->constructors, constructor->name) == NULL){
-        vec_push(&variant->constructorNames, constructor->name);
-        map_set(&variant->constructors, constructor->name, constructor);
+    if(omap_get(&variant->constructors, constructor->name) == NULL){
+        omap_set(&variant->constructors, constructor->name, constructor);
         return SRRT_SUCCESS;
     }
 
@@ -216,9 +203,8 @@ ScopeRegResult scope_variant_addConstructor(VariantType * variant, VariantConstr
 
 ScopeRegResult scope_process_AddArg(ProcessType * process, FnArgument * arg){
     // make sure argument name doesn't exist already
-    if(map_get(&process->args, arg->name) == NULL){
-        vec_push(&process->argNames, arg->name);
-        map_set(&process->args, arg->name, arg);
+    if(omap_get(&process->args, arg->name) == NULL){
+        omap_set(&process->args, arg->name, arg);
         return SRRT_SUCCESS;
     }
 
@@ -243,9 +229,8 @@ ScopeRegResult scope_process_hasReceive(ProcessType * process){
 
 ScopeRegResult scope_fntype_addArg(FnType* fn, FnArgument* arg){
     // make sure argument name doesn't exist already
-    if(map_get(&fn->args, arg->name) == NULL){
-        vec_push(&fn->argNames, arg->name);
-        map_set(&fn->args, arg->name, arg);
+    if(omap_get(&fn->args, arg->name) == NULL){
+        omap_set(&fn->args, arg->name, arg);
         return SRRT_SUCCESS;
     }
 
@@ -379,7 +364,7 @@ ASTScopeResultType scope_lookupSymbol(ASTScope* scope, char* name){
     // if scope is function we check its args
     if(scope->isFn){
         // fetch args
-        FnArgument ** arg = map_get(&scope->fnHeader->type->args, name);
+        FnArgument ** arg = omap_get(&scope->fnHeader->type->args, name);
         if(arg != NULL){
             return SCOPE_ARGUMENT;
         }
@@ -387,19 +372,15 @@ ASTScopeResultType scope_lookupSymbol(ASTScope* scope, char* name){
 
     if((scope->withinClass) && (scope->classRef != NULL) && (scope == scope->classRef->classType->scope)){
         // check methods
-        ClassMethod ** method = map_get(&scope->classRef->classType->methods, name);
+        ClassMethod ** method = omap_get(&scope->classRef->classType->methods, name);
         if(method != NULL){
             return SCOPE_METHOD;
         }
         // iterate through letList
         for(uint32_t i = 0; i < scope->classRef->classType->letList.length; i++){
             struct LetExprDecl * let = scope->classRef->classType->letList.data[i];
-            // look up let->variableNames
-            for(uint32_t j = 0; j < let->variableNames.length; j++){
-                char * varName = let->variableNames.data[j];
-                if(strcmp(varName, name) == 0){
-                    return SCOPE_ATTRIBUTE;
-                }
+            if(omap_get(&let->variables, name) != NULL){
+                return SCOPE_ATTRIBUTE;
             }
         }
     }
@@ -439,7 +420,7 @@ DataType* scope_lookupVariable(ASTScope* scope, char* name){
     // if scope is function we check its args
     if(scope->isFn){
         // fetch args
-        FnArgument ** arg = map_get(&scope->fnHeader->type->args, name);
+        FnArgument ** arg = omap_get(&scope->fnHeader->type->args, name);
         if(arg != NULL){
             return (*arg)->type;
         }
@@ -450,13 +431,9 @@ DataType* scope_lookupVariable(ASTScope* scope, char* name){
         // iterate through letList
         for(uint32_t i = 0; i < scope->classRef->classType->letList.length; i++){
             struct LetExprDecl * let = scope->classRef->classType->letList.data[i];
-            // look up let->variableNames
-            for(uint32_t j = 0; j < let->variableNames.length; j++){
-                char * varName = let->variableNames.data[j];
-                if(strcmp(varName, name) == 0){
-                    FnArgument ** arg = map_get(&let->variables, name);
-                    return (*arg)->type;
-                }
+            FnArgument ** arg = omap_get(&let->variables, name);
+            if(arg != NULL){
+                return (*arg)->type;
             }
         }
     }
@@ -484,7 +461,7 @@ DataType* scope_lookupFunction(ASTScope* scope, char* name){
     // if class check methods
     if((scope->withinClass) && (scope->classRef != NULL) && (scope == scope->classRef->classType->scope)){
         // check methods
-        ClassMethod ** method = map_get(&scope->classRef->classType->methods, name);
+        ClassMethod ** method = omap_get(&scope->classRef->classType->methods, name);
         if(method != NULL){
             return (*method)->decl->dataType;
         }
@@ -57,9 +57,15 @@ ScopeRegResult scope_fnheader_addGeneric(FnHeader* fn, GenericParam * genericPar
 ScopeRegResult scope_fnheader_addArg(FnHeader* fn, FnArgument* arg);
 ScopeRegResult scope_dtype_addGeneric(DataType* dtype, GenericParam * genericParam);
 
+/**
+ * Declares a generic parameter in a scope, the references written in it, or in its
+ * children, by that name are left to the instances, see resolver_resolveReferences
+ */
+void scope_registerGeneric(ASTScope* scope, GenericParam* genericParam);
+
 uint8_t scope_canExtend(Parser * parser, ASTScope *parentScope,DataType* parent, DataTypeKind childKind);
 
-char* scope_extends_addParent(Parser* parser, ASTScope * scope, vec_dtype_t* extends, DataType* parent);
+char* scope_extends_addParent(Parser* parser, ASTScope * scope, DataType* child, DataType* parent);
 char* scope_interface_addMethod(Parser* parser, ASTScope * scope, DataType * interface, FnHeader* method);
 char* scope_class_addMethod(Parser* parser, ASTScope * scope, DataType * class, ClassMethod* fnDecl);
 char* scope_class_addAttribute(Parser* parser, ASTScope * scope, DataType * class, LetExprDecl* decl);
@@ -0,0 +1,130 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "threadpool.h"
+#include "error.h"
+
+static void* threadpool_worker(void* arg) {
+    ThreadPool* pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    for(;;) {
+        while(pool->head == (uint32_t)pool->queue.length && !pool->stopping) {
+            pthread_cond_wait(&pool->hasWork, &pool->lock);
+        }
+        if(pool->head == (uint32_t)pool->queue.length) {
+            break;
+        }
+
+        ThreadPoolTask task = pool->queue.data[pool->head++];
+        // drained, the storage is reused
+        if(pool->head == (uint32_t)pool->queue.length) {
+            vec_clear(&pool->queue);
+            pool->head = 0;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        AllocArena* arena = alloc_enter(task.arena);
+        jmp_buf recovery;
+        jmp_buf* previous = error_enterRecovery(&recovery);
+        uint8_t failed = 0;
+        if(setjmp(recovery) == 0) {
+            task.fn(task.arg);
+        }
+        else {
+            failed = 1;
+        }
+        error_enterRecovery(previous);
+        alloc_enter(arena);
+
+        pthread_mutex_lock(&pool->lock);
+        if(failed && pool->failures++ == 0) {
+            snprintf(pool->failure, sizeof(pool->failure), "%s", error_lastMessage());
+        }
+        if(--pool->pending == 0) {
+            pthread_cond_broadcast(&pool->idle);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+uint32_t threadpool_cpuCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+}
+
+ThreadPool* threadpool_make(uint32_t threads) {
+    ThreadPool* pool = malloc(sizeof(ThreadPool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->hasWork, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    vec_init(&pool->queue);
+    pool->head = 0;
+    pool->pending = 0;
+    pool->stopping = 0;
+    vec_init(&pool->threads);
+    pool->failures = 0;
+    pool->failure[0] = '\0';
+
+    if(threads == 0) {
+        threads = threadpool_cpuCount();
+    }
+    uint32_t i = 0;
+    for(; i < threads; i++) {
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, threadpool_worker, pool) == 0) {
+            vec_push(&pool->threads, thread);
+        }
+    }
+    return pool;
+}
+
+void threadpool_free(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->hasWork);
+    pthread_mutex_unlock(&pool->lock);
+
+    uint32_t i = 0;
+    pthread_t thread;
+    vec_foreach(&pool->threads, thread, i) {
+        pthread_join(thread, NULL);
+    }
+    vec_deinit(&pool->threads);
+    vec_deinit(&pool->queue);
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->hasWork);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void threadpool_submit(ThreadPool* pool, ThreadPoolFn fn, void* arg) {
+    // no worker could be started, the caller does the work
+    if(pool->threads.length == 0) {
+        fn(arg);
+        return;
+    }
+
+    ThreadPoolTask task = {fn, arg, alloc_current()};
+    pthread_mutex_lock(&pool->lock);
+    vec_push(&pool->queue, task);
+    pool->pending++;
+    pthread_cond_signal(&pool->hasWork);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void threadpool_wait(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    while(pool->pending > 0) {
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    uint32_t failures = pool->failures;
+    pool->failures = 0;
+    pthread_mutex_unlock(&pool->lock);
+
+    ASSERT(failures == 0, "%u task(s) failed, first: %s", failures, pool->failure);
+}
@@ -0,0 +1,75 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_THREADPOOL_H
+#define TYPE_C_THREADPOOL_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "alloc.h"
+#include "../utils/vec.h"
+
+/**
+ * Fixed set of worker threads consuming a FIFO of tasks.
+ * Tasks may submit other tasks, threadpool_wait returns once none is queued or running.
+ * A task runs within the allocation arena its submitter was in, and an assertion failing
+ * within a task fails again in threadpool_wait, on the waiting thread.
+ */
+
+typedef void (*ThreadPoolFn)(void* arg);
+
+typedef struct ThreadPoolTask {
+    ThreadPoolFn fn;
+    void* arg;
+    AllocArena* arena;
+}ThreadPoolTask;
+
+typedef vec_t(ThreadPoolTask) vec_threadpooltask_t;
+typedef vec_t(pthread_t) vec_pthread_t;
+
+typedef struct ThreadPool {
+    pthread_mutex_t lock;
+    // signaled when a task is queued, or when stopping
+    pthread_cond_t hasWork;
+    // signaled when the last task is done
+    pthread_cond_t idle;
+    vec_threadpooltask_t queue;
+    // index of the next task to run in queue
+    uint32_t head;
+    // queued and running tasks
+    uint32_t pending;
+    uint8_t stopping;
+    vec_pthread_t threads;
+    // tasks which failed an assertion since the last wait, and the first message
+    uint32_t failures;
+    char failure[512];
+}ThreadPool;
+
+/**
+ * Starts the workers
+ * @param threads number of workers, 0 for one per online CPU
+ * @return new pool
+ */
+ThreadPool* threadpool_make(uint32_t threads);
+
+/**
+ * Stops the workers once the queue is drained, and releases the pool
+ * @param pool
+ */
+void threadpool_free(ThreadPool* pool);
+
+void threadpool_submit(ThreadPool* pool, ThreadPoolFn fn, void* arg);
+
+/**
+ * Blocks until every submitted task, and every task they submitted, is done
+ * @param pool
+ */
+void threadpool_wait(ThreadPool* pool);
+
+/**
+ * @return number of online CPUs, at least 1
+ */
+uint32_t threadpool_cpuCount();
+
+#endif //TYPE_C_THREADPOOL_H
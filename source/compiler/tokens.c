@@ -231,6 +231,8 @@ const char* token_type_to_string(TokenType type) {
             return "double";
         case TOK_EOF:
             return "EOF";
+        case TOK_INVALID:
+            return "invalid symbol";
         default:
             return "unknown";
     }
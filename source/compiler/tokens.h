@@ -125,6 +125,7 @@ typedef enum {
     TOK_FLOAT,             //
     TOK_DOUBLE,
     TOK_EOF,
+    TOK_INVALID,           // a character no token starts with, or an unterminated literal
 } TokenType;
 
 const char* token_type_to_string(TokenType type);
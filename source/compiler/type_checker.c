@@ -6,25 +6,25 @@
 #include "parser_resolve.h"
 #include "parser_utils.h"
 #include "type_inference.h"
+#include "query.h"
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 DataTypeKind tc_gettype_base(Parser* parser, ASTScope* scope, DataType* type){
-    if(type->kind == DT_TYPE_UNION){
-        DataTypeKind t1 = tc_gettype_base(parser, scope, type->unionType->left);
-        DataTypeKind t2 = tc_gettype_base(parser, scope, type->unionType->left);
-        if(t1 != t2){
-            return DT_INVALID;
-        }
-        return t1;
-    }
-
-    if(type->kind == DT_TYPE_JOIN){
-        DataTypeKind t1 = tc_gettype_base(parser, scope, type->joinType->left);
-        DataTypeKind t2 = tc_gettype_base(parser, scope, type->joinType->left);
-        if(t1 != t2){
-            return DT_INVALID;
+    if((type->kind == DT_TYPE_UNION) || (type->kind == DT_TYPE_JOIN)){
+        // every member must be of the same category
+        DataTypeKind kind = DT_INVALID;
+        uint32_t i = 0;
+        DataType* member;
+        vec_foreach(&type->unionType->members, member, i){
+            DataTypeKind memberKind = tc_gettype_base(parser, scope, member);
+            if((memberKind == DT_INVALID) || ((i > 0) && (memberKind != kind))){
+                return DT_INVALID;
+            }
+            kind = memberKind;
         }
-        return t1;
+        return kind;
     }
 
     if(type->kind == DT_REFERENCE){
@@ -34,137 +34,6 @@ DataTypeKind tc_gettype_base(Parser* parser, ASTScope* scope, DataType* type){
     return type->kind;
 }
 
-char* tc_accumulate_type_methods_attribute(Parser* parser, ASTScope * scope, DataType* type, map_int_t * map){
-    if(type->kind == DT_TYPE_UNION){
-        map_int_t left;
-        map_init(&left);
-
-        char* leftOk = tc_accumulate_type_methods_attribute(parser, scope, type->unionType->left, &left);
-
-        map_int_t right;
-        map_init(&right);
-
-        char* rightOk = tc_accumulate_type_methods_attribute(parser, scope, type->unionType->right, &right);
-
-        map_deinit(&left);
-        map_deinit(&right);
-
-        return leftOk!=NULL?(leftOk):(rightOk!=NULL?(rightOk):(NULL));
-    }
-
-    if(type->kind == DT_TYPE_JOIN){
-        char* leftOk = tc_accumulate_type_methods_attribute(parser, scope, type->joinType->left, map);
-        char* rightOk = tc_accumulate_type_methods_attribute(parser, scope, type->joinType->right, map);
-
-        return leftOk!=NULL?(leftOk):(rightOk!=NULL?(rightOk):(NULL));
-    }
-
-    if(type->kind == DT_STRUCT){
-        StructType * structType = type->structType;
-        uint32_t i = 0;
-
-        // check parent
-        DataType * parent;
-        vec_foreach(&structType->extends, parent, i){
-            char* parentOk = tc_accumulate_type_methods_attribute(parser, scope, parent, map);
-            if(parentOk != NULL){
-                return parentOk;
-            }
-        }
-
-        char* attributeName;
-        vec_foreach(&structType->attributeNames, attributeName, i){
-            int* val = map_get(map, attributeName);
-
-            if(val != NULL){
-                return attributeName;
-            }
-            map_set(map, attributeName, 1);
-        }
-    }
-
-    if(type->kind == DT_INTERFACE){
-        InterfaceType* interfaceType = type->interfaceType;
-        uint32_t i = 0;
-
-        // check parent
-        DataType * parent;
-        vec_foreach(&interfaceType->extends, parent, i){
-            char* parentOk = tc_accumulate_type_methods_attribute(parser, scope, parent, map);
-            if(parentOk != NULL){
-                return parentOk;
-            }
-        }
-
-        char* methodName;
-        vec_foreach(&interfaceType->methodNames, methodName, i){
-            int* val = map_get(map, methodName);
-
-            if(val != NULL){
-                return methodName;
-            }
-            map_set(map, methodName, 1);
-        }
-
-    }
-
-    if(type->kind == DT_CLASS){
-        ClassType * classType = type->classType;
-
-        // check parent
-        uint32_t i = 0;
-        DataType * parent;
-        vec_foreach(&classType->extends, parent, i){
-            char* parentOk = tc_accumulate_type_methods_attribute(parser, scope, parent, map);
-            if(parentOk != NULL){
-                return parentOk;
-            }
-        }
-
-        char* methodName;
-        vec_foreach(&classType->methodNames, methodName, i){
-            int* val = map_get(map, methodName);
-
-            if(val != NULL){
-                return methodName;
-            }
-            map_set(map, methodName, 1);
-        }
-        LetExprDecl* letDecl;
-
-        vec_foreach(&classType->letList, letDecl, i){
-            char* varName; uint32_t j = 0;
-            vec_foreach(&letDecl->variableNames, varName, j)
-            {
-                int *val = map_get(map, varName);
-
-                if (val != NULL) {
-                    return varName;
-                }
-                map_set(map, varName, 1);
-            }
-        }
-    }
-
-    if(type->kind == DT_REFERENCE) {
-        if(type->refType->ref != NULL)
-            return tc_accumulate_type_methods_attribute(parser, scope, type->refType->ref, map);
-        else {
-            char* name = type->refType->pkg->ids.data[0];
-            DataType* dt = resolver_resolveType(parser, scope, name);
-            if(dt == NULL) {
-                ASSERT(0, "Type %s not found", name);
-            }
-
-            dt = ti_type_findBase(parser, scope, dt);
-            return tc_accumulate_type_methods_attribute(parser, scope, dt, map);
-        }
-        return 0;
-    }
-
-    return 0;
-}
-
 uint8_t tc_check_canJoinOrUnion(Parser* parser, ASTScope* scope, DataType* left, DataType* right){
     DataTypeKind leftKind = tc_gettype_base(parser, scope, ti_type_findBase(parser, scope, left));
     DataTypeKind rightKind = tc_gettype_base(parser, scope, ti_type_findBase(parser, scope, right));
@@ -182,28 +51,106 @@ uint8_t tc_check_canJoinOrUnion(Parser* parser, ASTScope* scope, DataType* left,
 }
 
 char* tc_check_canJoin(Parser* parser, ASTScope* scope, DataType* left, DataType* right) {
-    map_int_t map;
-    map_init(&map);
-
-    char* leftOk = tc_accumulate_type_methods_attribute(parser, scope, left, &map);
-    char* rightOk = tc_accumulate_type_methods_attribute(parser, scope, right, &map);
+    QueryMembers* leftMembers = query_membersOf(parser, scope, left);
+    QueryMembers* rightMembers = query_membersOf(parser, scope, right);
+    if(leftMembers->duplicate != NULL) {
+        return leftMembers->duplicate;
+    }
+    if(rightMembers->duplicate != NULL) {
+        return rightMembers->duplicate;
+    }
 
-    map_deinit(&map);
-    return leftOk!=NULL?(leftOk):(rightOk!=NULL?(rightOk):(NULL));
+    uint32_t i = 0;
+    char* name;
+    vec_foreach(&rightMembers->order, name, i) {
+        if(map_get(&leftMembers->names, name) != NULL) {
+            return name;
+        }
+    }
+    return NULL;
 }
 
 char* tc_check_canUnion(Parser* parser, ASTScope* scope, DataType* left, DataType* right) {
-    map_int_t mapLeft;
-    map_init(&mapLeft);
-    char* leftOk = tc_accumulate_type_methods_attribute(parser, scope, left, &mapLeft);
+    // each side must be valid on its own
+    QueryMembers* leftMembers = query_membersOf(parser, scope, left);
+    QueryMembers* rightMembers = query_membersOf(parser, scope, right);
+    return leftMembers->duplicate != NULL ? leftMembers->duplicate : rightMembers->duplicate;
+}
 
-    map_int_t mapRight;
-    map_init(&mapRight);
-    char* rightOk = tc_accumulate_type_methods_attribute(parser, scope, right, &mapRight);
+/**
+ * Checks that a type is a primitive, or a union of primitives, once its references are resolved
+ */
+static uint8_t tc_isPrimitiveUnion(Parser* parser, ASTScope* scope, DataType* type) {
+    DataType* base = ti_type_findBase(parser, scope, type);
+    if(base->kind != DT_TYPE_UNION) {
+        return (TYPE_KIND_BIT(base->kind) & TYPE_KIND_PRIMITIVES) != 0;
+    }
+    // the mask holds the kinds of the members as written, aliases are references
+    if((base->unionType->kinds & ~TYPE_KIND_PRIMITIVES) == 0) {
+        return 1;
+    }
+    uint32_t i = 0;
+    DataType* member;
+    vec_foreach(&base->unionType->members, member, i) {
+        if(!tc_isPrimitiveUnion(parser, scope, member)) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
-    map_deinit(&mapLeft);
-    map_deinit(&mapRight);
+uint8_t tc_check_canUnionPrimitives(Parser* parser, ASTScope* scope, DataType* left, DataType* right) {
+    return tc_isPrimitiveUnion(parser, scope, left) && tc_isPrimitiveUnion(parser, scope, right);
+}
 
-    return leftOk!=NULL?(leftOk):(rightOk!=NULL?(rightOk):(NULL));
+/**
+ * Orders members by kind, then by nullability, then by description.
+ * Primitives of the same kind compare equal, the order of equal members is unspecified
+ */
+static int tc_compareMembers(const void* a, const void* b) {
+    DataType* left = *(DataType* const*)a;
+    DataType* right = *(DataType* const*)b;
+    if(left->kind != right->kind) {
+        return left->kind < right->kind ? -1 : 1;
+    }
+    if(left->isNullable != right->isNullable) {
+        return left->isNullable < right->isNullable ? -1 : 1;
+    }
+    // primitives are told apart by their kind alone
+    if(left->kind <= DT_CHAR) {
+        return 0;
+    }
+    return strcmp(describeType(left), describeType(right));
 }
 
+void tc_flattenUnion(DataType* type) {
+    // a join has the same layout
+    UnionType* unionType = type->unionType;
+    DataType* sides[2] = {unionType->left, unionType->right};
+    vec_dtype_t members;
+    vec_init(&members);
+    uint32_t i = 0;
+    for(; i < 2; i++) {
+        // the nested side was flattened when it was made
+        if(sides[i]->kind == type->kind) {
+            vec_extend(&members, &sides[i]->unionType->members);
+        }
+        else {
+            vec_push(&members, sides[i]);
+        }
+    }
+    qsort(members.data, members.length, sizeof(DataType*), tc_compareMembers);
+
+    vec_clear(&unionType->members);
+    unionType->kinds = 0;
+    DataType* member;
+    vec_foreach(&members, member, i) {
+        // duplicates are next to each other
+        if((unionType->members.length > 0) && (tc_compareMembers(&vec_last(&unionType->members), &member) == 0)) {
+            continue;
+        }
+        vec_push(&unionType->members, member);
+        unionType->kinds |= TYPE_KIND_BIT(member->kind);
+    }
+    vec_deinit(&members);
+}
@@ -10,8 +10,21 @@
 
 DataTypeKind tc_gettype_base(Parser* parser, ASTScope* scope, DataType* type);
 uint8_t tc_check_canJoinOrUnion(Parser* parser, ASTScope* scope, DataType* left, DataType* right);
-char* tc_accumulate_type_methods_attribute(Parser* parser, ASTScope * scope, DataType* type, map_int_t * map);
 char* tc_check_canUnion(Parser* parser, ASTScope* scope, DataType* left, DataType* right);
 char* tc_check_canJoin(Parser* parser, ASTScope* scope, DataType* left, DataType* right);
 
+/**
+ * Checks that both sides of a union are primitives, or unions of primitives, i.e `i32 | string`.
+ * Aliases are resolved, members included, so the result does not depend on how the union is grouped
+ */
+uint8_t tc_check_canUnionPrimitives(Parser* parser, ASTScope* scope, DataType* left, DataType* right);
+
+/**
+ * Fills the members of a union or a join from its left and right sides.
+ * Members of the same operator are spread, the others are kept as they are written:
+ * a reference to a union is a single member.
+ * @param type union or join, its sides set
+ */
+void tc_flattenUnion(DataType* type);
+
 #endif //TYPE_C_TYPE_CHECKER_H
@@ -2,6 +2,7 @@
 // Created by praisethemoon on 10.05.23.
 //
 #include <assert.h>
+#include <inttypes.h>
 
 #include "parser_resolve.h"
 #include "type_inference.h"
@@ -11,8 +12,18 @@
 #include "parser_utils.h"
 #include "scope.h"
 #include "ast_json.h"
+#include "log.h"
+#include "query.h"
+#include "instance.h"
 
 DataType* ti_type_findBase(Parser* parser, ASTScope * scope, DataType *dtype){
+    if(dtype->kind != DT_REFERENCE){
+        return dtype;
+    }
+    return query_resolvedBase(parser, scope, dtype);
+}
+
+DataType* ti_type_resolveBase(Parser* parser, ASTScope * scope, DataType *dtype){
     // if type is reference, lookup the scope for the reference
     if(dtype->kind == DT_REFERENCE){
         DataType * dt = NULL;
@@ -25,6 +36,10 @@ DataType* ti_type_findBase(Parser* parser, ASTScope * scope, DataType *dtype){
                 dt = tmp;
         }
         if(dt != NULL) {
+            // i.e Box<u32>, specialized once per program
+            if(dtype->hasGenerics && dt->isGeneric) {
+                return instance_ofType(parser, scope, dt, &dtype->genericRefs, dtype->lexeme);
+            }
             if(dt->kind == DT_REFERENCE){
                 return ti_type_findBase(parser, scope, dt);
             }
@@ -44,15 +59,16 @@ DataType * ti_fnheader_toType(Parser * parser, ASTScope * currentScope, FnHeader
     // create an empty datatype
     DataType* dt = ast_type_makeType(currentScope, lexeme, DT_FN);
     dt->fnType = ast_type_makeFn();
+    // generic functions are specialized from it, see instance_ofFunction
+    dt->fnType->header = header;
 
     // copy args
     uint32_t i = 0;
     char* argName = NULL;
+    FnArgument* arg = NULL;
 
-    vec_foreach(&header->type->argNames, argName, i){
-        vec_push(&dt->fnType->argNames, argName);
-        FnArgument ** arg = map_get(&header->type->args, argName);
-        map_set(&dt->fnType->args, argName, arg);
+    omap_foreach(&header->type->args, argName, arg, i){
+        omap_set(&dt->fnType->args, argName, arg);
     }
 
     // compute type
@@ -69,15 +85,15 @@ DataType* ti_fndecl_toType(Parser * parser, ASTScope * currentScope, FnDeclState
     // create an empty datatype
     DataType* dt = ast_type_makeType(currentScope, lexeme, DT_FN);
     dt->fnType = ast_type_makeFn();
+    dt->fnType->header = fndecl->header;
 
     // copy args
     uint32_t i = 0;
     char* argName = NULL;
+    FnArgument* arg = NULL;
 
-    vec_foreach(&fndecl->header->type->argNames, argName, i){
-        vec_push(&dt->fnType->argNames, argName);
-        FnArgument ** arg = map_get(&fndecl->header->type->args, argName);
-        map_set(&dt->fnType->args, argName, *arg);
+    omap_foreach(&fndecl->header->type->args, argName, arg, i){
+        omap_set(&dt->fnType->args, argName, arg);
     }
 
     // compute type
@@ -92,81 +108,189 @@ DataType* ti_fndecl_toType(Parser * parser, ASTScope * currentScope, FnDeclState
     return dt;
 }
 
-void ti_runProgram(Parser* parser, ASTProgramNode* program) {
+/**
+ * Keeps on the statement's node the diagnostics its check raised in this file,
+ * so that they are reported again while it is skipped
+ */
+static void ti_keepDiagnostics(Parser* parser, DepNode* depNode, uint32_t firstDiagnostic) {
+    vec_diagnostic_t* diagnostics = &parser->diagnostics.diagnostics;
+    uint32_t i = firstDiagnostic;
+    for(; i < (uint32_t) diagnostics->length; i++) {
+        Diagnostic* diagnostic = diagnostics->data[i];
+        if(diagnostic->span.filename != NULL && strcmp(diagnostic->span.filename, parser->lexerState->filename) == 0) {
+            depgraph_recordDiagnostic(depNode, diagnostic);
+        }
+    }
+}
+
+static void ti_replayDiagnostics(Parser* parser, DepNode* depNode) {
     uint32_t i = 0;
-    for(; i < program->stmts.length; i++) {
-        ti_runStatement(parser, program->scope, program->stmts.data[i]);
+    DepDiagnostic* diagnostic;
+    vec_foreach_ptr(&depNode->diagnostics, diagnostic, i) {
+        parser_utils_report(parser, diagnostic->severity, depgraph_diagnosticSpan(depNode, diagnostic), diagnostic->message);
     }
 }
 
-void ti_runStatement(Parser* parser, ASTScope* currentScope, Statement * stmt){
-    switch(stmt->type){
-        case ST_EXPR:
-            ti_infer_expr(parser, currentScope, stmt->expr->expr);
-            break;
-        case ST_VAR_DECL:
-            // todo check if variables has types, else we set it to the type of the expression
-            break;
-        case ST_FN_DECL:
-            // todo check if function has return type or infer it from body/expr
-            break;
-        case ST_BLOCK: {
-            // recursively run the statements in the block
-            uint32_t i = 0;
-            for(; i < stmt->blockStmt->stmts.length; i++) {
-                ti_runStatement(parser, stmt->blockStmt->scope, stmt->blockStmt->stmts.data[i]);
+void ti_runProgram(Parser* parser, ASTProgramNode* program) {
+    // references are bound before anything is inferred
+    resolver_resolveReferences(parser);
+
+    // an error within a statement skips to the next one
+    jmp_buf recovery;
+    jmp_buf* previousRecovery = parser->recovery;
+    parser->recovery = &recovery;
+
+    volatile uint32_t i = 0;
+    for(; i < program->stmts.length; i++) {
+        // incremental build, statements which did not change and whose dependencies did not either are skipped
+        DepNode* depNode = NULL;
+        if(parser->depGraph != NULL && i < parser->depGraph->statements.length) {
+            depNode = parser->depGraph->statements.data[i];
+            if(!depNode->dirty) {
+                ti_replayDiagnostics(parser, depNode);
+                continue;
             }
-            break;
         }
-        case ST_IF_CHAIN:
-            break;
-        case ST_MATCH:
-            break;
-        case ST_WHILE:
-            break;
-        case ST_DO_WHILE:
-            break;
-        case ST_FOR:
-            break;
-        case ST_FOREACH:
-            break;
-        case ST_CONTINUE:
-            break;
-        case ST_RETURN:
-            // TODO: check if return has an expression
-            break;
-        case ST_BREAK:
-            break;
-        case ST_UNSAFE:
-            ti_runStatement(parser, currentScope, stmt->unsafeStmt->block);
+
+        uint32_t firstDiagnostic = parser->diagnostics.diagnostics.length;
+        if(setjmp(recovery) == 0) {
+            ti_runStatement(parser, program->scope, program->stmts.data[i]);
+        }
+        else {
+            // the walk was left midway
+            vec_clear(&parser->walker.stack);
+            if(depNode != NULL) {
+                depNode->failed = 1;
+            }
+        }
+        if(depNode != NULL) {
+            ti_keepDiagnostics(parser, depNode, firstDiagnostic);
+        }
+    }
+
+    parser->recovery = previousRecovery;
+}
+
+static AstWalkAction ti_walk_skip(AstWalker* walker, Statement* stmt){
+    return AWA_SKIP;
+}
+
+/**
+ * Pushes the operands whose types the inference of an expression reads, see ti_infer_expr
+ */
+static void ti_pushOperands(vec_walkitem_t* stack, Expr* expr, ASTScope* scope) {
+    AstWalkItem item = {NULL, scope, 0, 0};
+    uint32_t i = 0;
+    Expr* indexExpr;
+    switch(expr->type) {
+        case ET_CALL:
+            item.node = expr->callExpr->lhs;
+            vec_push(stack, item);
+            break;
+        case ET_MEMBER_ACCESS:
+            item.node = expr->memberAccessExpr->lhs;
+            vec_push(stack, item);
+            break;
+        case ET_INDEX_ACCESS:
+            item.node = expr->indexAccessExpr->expr;
+            vec_push(stack, item);
+            vec_foreach(&expr->indexAccessExpr->indexes, indexExpr, i) {
+                item.node = indexExpr;
+                vec_push(stack, item);
+            }
             break;
-        case ST_SYNC:
-            ti_runStatement(parser, currentScope, stmt->syncStmt->block);
+        case ET_CAST:
+            item.node = expr->castExpr->expr;
+            vec_push(stack, item);
             break;
-        case ST_SPAWN:
+        case ET_UNSAFE:
+            item.node = expr->unsafeExpr->expr;
+            item.scope = expr->unsafeExpr->scope;
+            vec_push(stack, item);
             break;
-        case ST_EMIT:
+        default:
             break;
     }
 }
 
+/**
+ * Infers an expression after its operands, deepest first, so that every query finds
+ * the types of the operands it reads cached and a chain such as `a.b.c` or `a[0][0]`
+ * does not grow the C stack. Only the operands ti_infer_expr reads are visited:
+ * the walker would also enter the arguments of calls and the names of members.
+ */
+static DataType* ti_infer_operandsFirst(Parser* parser, ASTScope* scope, Expr* expr) {
+    // kept on the walker's stack, which is cleared when an error leaves the statement
+    vec_walkitem_t* order = &parser->walker.stack;
+    uint32_t base = order->length;
+    vec_walkitem_t pending;
+    vec_init(&pending);
+    AstWalkItem root = {expr, scope, 0, 0};
+    vec_push(&pending, root);
+    while(pending.length > 0) {
+        AstWalkItem item = vec_pop(&pending);
+        vec_push(order, item);
+        ti_pushOperands(&pending, item.node, item.scope);
+    }
+    vec_deinit(&pending);
+
+    // operands come after the expressions reading them
+    while(order->length > base) {
+        AstWalkItem item = vec_pop(order);
+        query_typeOf(parser, item.scope, item.node);
+    }
+    return expr->dataType;
+}
+
+static AstWalkAction ti_walk_exprStatement(AstWalker* walker, Statement* stmt){
+    ti_infer_operandsFirst(walker->data, walker->scope, stmt->expr->expr);
+    return AWA_SKIP;
+}
+
+/**
+ * Statements inferred by ti_runStatement, blocks are entered and the rest is yet to be checked
+ */
+static const AstWalkCallbacks ti_runCallbacks = {
+    .enterStatement = {
+        [ST_EXPR] = ti_walk_exprStatement,
+        // todo check if variables has types, else we set it to the type of the expression
+        [ST_VAR_DECL] = ti_walk_skip,
+        // todo check if function has return type or infer it from body/expr
+        [ST_FN_DECL] = ti_walk_skip,
+        [ST_IF_CHAIN] = ti_walk_skip,
+        [ST_MATCH] = ti_walk_skip,
+        [ST_WHILE] = ti_walk_skip,
+        [ST_DO_WHILE] = ti_walk_skip,
+        [ST_FOR] = ti_walk_skip,
+        [ST_FOREACH] = ti_walk_skip,
+        // TODO: check if return has an expression
+        [ST_RETURN] = ti_walk_skip,
+    }
+};
+
+void ti_runStatement(Parser* parser, ASTScope* currentScope, Statement * stmt){
+    ast_walk_statement(&parser->walker, &ti_runCallbacks, parser, currentScope, stmt);
+}
+
 void ti_infer_exprLiteral(Parser* parser, ASTScope* scope, Expr* expr){
     // literal types are already setup in the parser
     ASSERT(expr->dataType != NULL, "Literal type not set");
 }
 
 void ti_infer_exprThis(Parser* parser, ASTScope* scope, Expr* expr){
-    ASSERT(scope->withinClass, "`this` can only be used inside a class");
+    Lexeme lexeme = expr->lexeme;
+    PARSER_ASSERT(scope->withinClass, "`this` can only be used inside a class");
     // find class reference
     DataType * dt = scope_getClassRef(scope);
-    ASSERT(dt != NULL, "Could not find class reference");
+    PARSER_ASSERT(dt != NULL, "Could not find class reference");
     expr->dataType = dt;
 }
 
 void ti_infer_element(Parser* parser, ASTScope* scope, Expr* expr) {
+    Lexeme lexeme = expr->lexeme;
     char* name = expr->elementExpr->name;
     ASTScopeResult* res = resolveElement(name, scope, 1);
-    ASSERT(res != NULL, "Element %s not found", name);
+    PARSER_ASSERT(res != NULL, "Element %s not found", name);
 
     if(res->type == SCOPE_VARIABLE){
         expr->dataType = ti_type_findBase(parser, scope, res->variable->type);
@@ -179,27 +303,72 @@ void ti_infer_element(Parser* parser, ASTScope* scope, Expr* expr) {
     }
 }
 
+/**
+ * Hints the type an expression is expected to have before it is inferred.
+ * Only array constructions make use of it so far, their elements are checked against it
+ */
+static void ti_expect(Parser* parser, ASTScope* scope, Expr* expr, DataType* expected) {
+    if((expected == NULL) || (expr->type != ET_ARRAY_CONSTRUCTION) || (expr->inferred != 0)) {
+        return;
+    }
+    DataType* base = ti_type_findBase(parser, scope, expected);
+    if(base->kind == DT_ARRAY) {
+        expr->arrayConstructionExpr->expectedType = base;
+    }
+}
+
+DataType* ti_check_expr(Parser* parser, ASTScope* scope, Expr* expr, DataType* expected) {
+    ti_expect(parser, scope, expr, expected);
+    DataType* type = query_typeOf(parser, scope, expr);
+    if(expected == NULL) {
+        return type;
+    }
+    Lexeme lexeme = expr->lexeme;
+    PARSER_ASSERT((type != NULL) && ti_types_match(parser, scope, expected, type),
+                  "Expected %s but %s was found", describeType(expected), describeType(type));
+    return type;
+}
+
 void ti_infer_exprArrayConstruction(Parser* parser, ASTScope* scope, Expr* expr){
     ArrayConstructionExpr* arrExpr = expr->arrayConstructionExpr;
-    DataType* elementType = NULL;
-    if(arrExpr->args.length > 0){
-        // infer the type of the first argument
-        ti_infer_expr(parser, scope, arrExpr->args.data[0]);
-        // set the type of the array to the type of the first argument
-        elementType = arrExpr->args.data[0]->dataType;
-
-        Expr* arg; uint32_t i =0;
-        vec_foreach(&arrExpr->args, arg, i) {
-            ti_infer_expr(parser, scope, arg);
-            Lexeme lexeme = arg->lexeme;
-            elementType = ti_types_getCommonType(parser, scope, elementType, arg->dataType);
-            PARSER_ASSERT(elementType != NULL, "Array construction type mismatch");
-        }
-
-    } else {
+    DataType* expected = arrExpr->expectedType;
+    Lexeme lexeme = expr->lexeme;
+    // an array of unknown size, `u32[]`, takes any number of elements
+    PARSER_ASSERT((expected == NULL) || (expected->arrayType->len == 0) || (expected->arrayType->len == arrExpr->args.length),
+                  "Expected an array of %"PRIu64" elements but %d were given", expected->arrayType->len, arrExpr->args.length);
+    if((arrExpr->args.length == 0) && (expected == NULL)) {
+        // nothing to infer the elements from
         expr->dataType = NULL;
+        return;
     }
 
+    // checked against the expected element type, or else unified with the elements before them
+    DataType* elementType = expected != NULL ? expected->arrayType->arrayOf : NULL;
+    Expr* arg; uint32_t i = 0;
+    vec_foreach(&arrExpr->args, arg, i) {
+        if(expected != NULL) {
+            ti_check_expr(parser, scope, arg, elementType);
+            continue;
+        }
+        DataType* argType = query_typeOf(parser, scope, arg);
+        lexeme = arg->lexeme;
+        PARSER_ASSERT(argType != NULL, "Could not infer the type of the array element");
+        if(elementType == NULL) {
+            elementType = argType;
+            continue;
+        }
+        DataType* common = ti_types_getCommonType(parser, scope, elementType, argType);
+        PARSER_ASSERT(common != NULL, "Array construction type mismatch, %s is not compatible with %s",
+                      describeType(argType), describeType(elementType));
+        elementType = common;
+    }
+
+    // sized after the literal, whether a type was expected or not
+    DataType* arrayType = ast_type_makeType(scope, expr->lexeme, DT_ARRAY);
+    arrayType->arrayType = ast_type_makeArray();
+    arrayType->arrayType->len = arrExpr->args.length;
+    arrayType->arrayType->arrayOf = elementType;
+    expr->dataType = arrayType;
 }
 
 void ti_infer_expr(Parser* parser, ASTScope* scope, Expr* expr) {
@@ -224,12 +393,12 @@ void ti_infer_expr(Parser* parser, ASTScope* scope, Expr* expr) {
             expr->dataType = expr->newExpr->type;
             break;
         case ET_CALL:
-            ti_infer_expr(parser, scope, expr->callExpr->lhs);
+            query_typeOf(parser, scope, expr->callExpr->lhs);
             expr->dataType = ti_call_check(parser, scope, expr);
             break;
         case ET_MEMBER_ACCESS: {
             //printf("%s\n", ast_json_serializeExpr(expr));
-            ti_infer_expr(parser, scope, expr->memberAccessExpr->lhs);
+            query_typeOf(parser, scope, expr->memberAccessExpr->lhs);
             //ti_infer_expr(parser, scope, expr->memberAccessExpr->rhs);
             DataType * res = ti_member_access_check(parser, scope, expr->memberAccessExpr->lhs,
                                                     expr->memberAccessExpr->rhs);
@@ -242,26 +411,30 @@ void ti_infer_expr(Parser* parser, ASTScope* scope, Expr* expr) {
 
         case ET_INDEX_ACCESS: {
             // infer main expression
-            ti_infer_expr(parser, scope, expr->indexAccessExpr->expr);
+            query_typeOf(parser, scope, expr->indexAccessExpr->expr);
 
             // infer indexes
             uint32_t i = 0;
             Expr* indexExpr;
             vec_foreach(&expr->indexAccessExpr->indexes, indexExpr, i){
-                ti_infer_expr(parser, scope, indexExpr);
+                query_typeOf(parser, scope, indexExpr);
             }
 
             // index access works inherently on arrays, strings but also on objects with __index__ method
             DataType* res = ti_index_access_check(parser, scope, expr->indexAccessExpr->expr, expr->indexAccessExpr->indexes);
             Lexeme lexeme = expr->lexeme;
             PARSER_ASSERT(res!=NULL, "Index access requires either an array or class/interface with `__index__` method");
-
+            expr->dataType = res;
             break;
         }
-        case ET_CAST:
-            ti_infer_expr(parser, scope, expr->castExpr->expr);
+        case ET_CAST: {
+            query_typeOf(parser, scope, expr->castExpr->expr);
+            Lexeme lexeme = expr->lexeme;
+            // binary and unary operands are not inferred yet
+            PARSER_ASSERT(expr->castExpr->expr->dataType != NULL && expr->castExpr->type != NULL, "Cannot infer the type of the cast operand");
             expr->dataType = ti_cast_check(parser, scope, expr->castExpr->expr, expr->castExpr->type);
             break;
+        }
         case ET_INSTANCE_CHECK:
             break;
         case ET_UNARY:
@@ -277,7 +450,7 @@ void ti_infer_expr(Parser* parser, ASTScope* scope, Expr* expr) {
         case ET_LAMBDA:
             break;
         case ET_UNSAFE:
-            ti_infer_expr(parser, expr->unsafeExpr->scope, expr->unsafeExpr->expr);
+            query_typeOf(parser, expr->unsafeExpr->scope, expr->unsafeExpr->expr);
             expr->dataType = expr->unsafeExpr->expr->dataType;
             break;
         case ET_SYNC:
@@ -292,7 +465,7 @@ void ti_infer_expr(Parser* parser, ASTScope* scope, Expr* expr) {
 }
 
 DataType* ti_index_access_check(Parser* parser, ASTScope* currentScope, Expr* expr, vec_expr_t indexes){
-    printf("DataType: %s\n", ti_type_toString(parser, currentScope, expr->dataType));
+    TRACE(LOG_INFERENCE, "DataType: %s\n", describeType(expr->dataType));
     DataType* dt = ti_type_findBase(parser, currentScope, expr->dataType);
     return ti_index_access_dataTypeCanIndex(parser, currentScope, dt, indexes);
 }
@@ -315,7 +488,7 @@ DataType* ti_index_access_dataTypeCanIndex(Parser* parser, ASTScope* currentScop
             DataType* fn = resolver_resolveInterfaceMethod(parser, currentScope, dt, "__index__");
             PARSER_ASSERT(fn != NULL, "Index access on interface requires a __index__ method");
             // make sure the number of indexes and function args match
-            PARSER_ASSERT(fn->fnType->argNames.length == indexes.length, "Index access on interface requires exactly %d index expressions", fn->fnType->argNames.length);
+            PARSER_ASSERT(omap_length(&fn->fnType->args) == indexes.length, "Index access on interface requires exactly %d index expressions", omap_length(&fn->fnType->args));
 
             // TODO: make sure fn args match indexes
             return fn->fnType->returnType;
@@ -324,7 +497,7 @@ DataType* ti_index_access_dataTypeCanIndex(Parser* parser, ASTScope* currentScop
             DataType* fn = resolver_resolveClassMethod(parser, currentScope, dt, "__index__");
             PARSER_ASSERT(fn != NULL, "Index access on class requires a __index__ method");
             // make sure the number of indexes and function args match
-            PARSER_ASSERT(fn->fnType->argNames.length == indexes.length, "Index access on interface requires exactly %d index expressions", fn->fnType->argNames.length);
+            PARSER_ASSERT(omap_length(&fn->fnType->args) == indexes.length, "Index access on interface requires exactly %d index expressions", omap_length(&fn->fnType->args));
 
             // TODO: make sure fn args match indexes
             // using ti_types_match(parser, currentScope, left, right)
@@ -333,13 +506,15 @@ DataType* ti_index_access_dataTypeCanIndex(Parser* parser, ASTScope* currentScop
 
             // if it is a join, if one element implements index it is fine
         else if (dt->kind == DT_TYPE_JOIN){
-            DataType* lhsType = ti_index_access_dataTypeCanIndex(parser, currentScope, dt->joinType->left, indexes);
-            if(lhsType == NULL){
-                return ti_index_access_dataTypeCanIndex(parser, currentScope, dt->joinType->right, indexes);
-            }
-            else {
-                return lhsType;
+            uint32_t i = 0;
+            DataType* member;
+            vec_foreach(&dt->joinType->members, member, i){
+                DataType* lhsType = ti_index_access_dataTypeCanIndex(parser, currentScope, member, indexes);
+                if(lhsType != NULL){
+                    return lhsType;
+                }
             }
+            return NULL;
         }
 
         else if(dt->kind == DT_TYPE_UNION){
@@ -359,10 +534,17 @@ DataType* ti_member_access_check(Parser* parser, ASTScope* currentScope, Expr* e
     ASSERT(element->type == ET_ELEMENT, "Expected element expression");
     char* name = element->elementExpr->name;
     // assert expr->dataType is either a struct, class or interface
-    DataType* dt = ti_type_findBase(parser, currentScope, expr->dataType);
     Lexeme lexeme = expr->lexeme;
+    PARSER_ASSERT(expr->dataType != NULL, "Cannot infer the type of the lhs of member access");
+    DataType* dt = ti_type_findBase(parser, currentScope, expr->dataType);
     PARSER_ASSERT((dt->kind == DT_STRUCT) || (dt->kind == DT_CLASS) || (dt->kind == DT_INTERFACE), "Expected struct, interface or class type as lhs of member access ");
 
+    // unknown members are rejected without walking the parents
+    QueryMembers* members = query_membersOf(parser, currentScope, dt);
+    if((members->duplicate == NULL) && (map_get(&members->names, name) == NULL)) {
+        return NULL;
+    }
+
     if(dt->kind == DT_STRUCT) {
         return resolver_resolveStructAttribute(parser, currentScope, dt, name);
     }
@@ -400,8 +582,8 @@ DataType* ti_cast_check(Parser* parser, ASTScope* currentScope, Expr* expr, Data
     // this is important for example if x = y, we check match_types(x.type, y.type)
     PARSER_ASSERT(ti_types_match(parser, currentScope, targetType, fromType),
                   "Cannot cast %s to %s",
-                  ti_type_toString(parser, currentScope, fromType),
-                  ti_type_toString(parser, currentScope, targetType));
+                  describeType(fromType),
+                  describeType(targetType));
     return NULL;
 }
 
@@ -409,76 +591,135 @@ DataType* ti_call_check(Parser* parser, ASTScope* currentScope, Expr* expr){
     // make sure the lhs is a function
     DataType* lhsType = ti_type_findBase(parser, currentScope, expr->callExpr->lhs->dataType);
     Lexeme lexeme=expr->lexeme;
-    PARSER_ASSERT(lhsType->kind == DT_FN, "Cannot call non-function type %s", ti_type_toString(parser, currentScope, lhsType));
+    PARSER_ASSERT(lhsType->kind == DT_FN, "Cannot call non-function type %s", describeType(lhsType));
 
-    return expr->callExpr->lhs->dataType->fnType->returnType;
+    FnType* fnType = lhsType->fnType;
+    if(fnType->header != NULL && fnType->header->isGeneric) {
+        // i.e id<u32>(x), specialized once per program
+        PARSER_ASSERT(expr->callExpr->hasGenerics, "Generic function `%s` requires type arguments",
+                      fnType->header->name != NULL ? fnType->header->name : "anonymous function");
+        fnType = instance_ofFunction(parser, currentScope, lhsType, &expr->callExpr->generics, lexeme)->fnType;
+    }
+    return fnType->returnType;
 }
 
 uint8_t ti_struct_contains(Parser* parser, ASTScope* currentScope, DataType* bigStruct, DataType* smallStruct){
-    StructType * structB = bigStruct->structType;
-    StructType * structS = smallStruct->structType;
+    if(bigStruct == smallStruct) {
+        return 1;
+    }
 
-    uint32_t i = 0;
-    char* attName = NULL;
-    vec_foreach(&structS->attributeNames, attName, i){
-        StructAttribute** attrS = map_get(&structS->attributes, attName);
-        StructAttribute** attrB = map_get(&structB->attributes, attName);
-        Lexeme lexeme = bigStruct->lexeme;
+    QueryStructFields* fieldsB = query_structFieldsOf(parser, currentScope, bigStruct);
+    QueryStructFields* fieldsS = query_structFieldsOf(parser, currentScope, smallStruct);
+    // an attribute of the small struct is missing from the big one
+    if((fieldsS->count > fieldsB->count) || ((fieldsS->bloom & ~fieldsB->bloom) != 0)) {
+        return 0;
+    }
 
-        PARSER_ASSERT(ti_types_match(parser, currentScope, (*attrS)->type, (*attrB)->type), "Structs do not match, attribute `%s` missing");
+    // both are sorted, every attribute of the small struct is looked for past the previous one
+    uint32_t i = 0, j = 0;
+    for(; i < fieldsS->count; i++) {
+        QueryField* fieldS = &fieldsS->fields[i];
+        while((j < fieldsB->count) && (query_compareFields(&fieldsB->fields[j], fieldS) < 0)) {
+            j++;
+        }
+        if((j == fieldsB->count) || (query_compareFields(&fieldsB->fields[j], fieldS) != 0)) {
+            return 0;
+        }
+        if(!ti_types_match(parser, currentScope, fieldS->type, fieldsB->fields[j].type)) {
+            return 0;
+        }
+        j++;
     }
+    return 1;
 }
 
-uint8_t ti_types_match(Parser* parser, ASTScope* currentScope, DataType* left, DataType* right){
-    // check if any of left or right is a reference
-    DataType* L = NULL;
-    DataType* R = NULL;
-
-    // if left is a union, we return true if either union->left or union->right match right
-    if(left->kind == DT_TYPE_UNION){
-        return ti_types_match(parser, currentScope, left->unionType->left, right) ||
-               ti_types_match(parser, currentScope, left->unionType->right, right);
+/**
+ * Matches a primitive against the members of a union from their kinds alone
+ * @param unionType
+ * @param primitive base type
+ * @return 1 or 0 if they match or not, -1 if the kinds are not enough to tell
+ */
+static int8_t ti_union_matchesPrimitive(UnionType* unionType, DataType* primitive){
+    if(primitive->kind > DT_CHAR){
+        return -1;
     }
-
-    // if left is a join, both left and right must match
-    if(left->kind == DT_TYPE_JOIN){
-        return ti_types_match(parser, currentScope, left->joinType->left, right) &&
-               ti_types_match(parser, currentScope, left->joinType->right, right);
+    if(unionType->kinds & TYPE_KIND_BIT(primitive->kind)){
+        return 1;
     }
-
-    // if right is a union, we return true if either union->left or union->right match right
-    if(right->kind == DT_TYPE_UNION){
-        return ti_types_match(parser, currentScope, left, right->unionType->left) ||
-               ti_types_match(parser, currentScope, left, right->unionType->right);
+    // a reference or a join may still hold a matching primitive
+    if(unionType->kinds & (TYPE_KIND_BIT(DT_REFERENCE) | TYPE_KIND_BIT(DT_TYPE_JOIN))){
+        return -1;
     }
-    // if right is a join, both left and right must match
-    if(right->kind == DT_TYPE_JOIN){
-        return ti_types_match(parser, currentScope, left, right->joinType->left) &&
-               ti_types_match(parser, currentScope, left, right->joinType->right);
+    return 0;
+}
+
+uint8_t ti_types_match(Parser* parser, ASTScope* currentScope, DataType* left, DataType* right){
+    // references are followed, a named union is matched as a union
+    DataType* L = ti_type_findBase(parser, currentScope, left);
+    DataType* R = ti_type_findBase(parser, currentScope, right);
+    uint32_t i = 0;
+    DataType* member;
+    int8_t known;
+
+    // if left is a union, we return true if any of its members matches right
+    if(L->kind == DT_TYPE_UNION){
+        if((known = ti_union_matchesPrimitive(L->unionType, R)) >= 0){
+            return (uint8_t)known;
+        }
+        vec_foreach(&L->unionType->members, member, i){
+            if(ti_types_match(parser, currentScope, member, R))
+                return 1;
+        }
+        return 0;
     }
 
-    if (left->kind == DT_REFERENCE) {
-        L = ti_type_findBase(parser, currentScope, left);
-    } else {
-        L = left;
+    // if left is a join, all of its members must match
+    if(L->kind == DT_TYPE_JOIN){
+        vec_foreach(&L->joinType->members, member, i){
+            if(!ti_types_match(parser, currentScope, member, R))
+                return 0;
+        }
+        return 1;
     }
 
-    if(right->kind == DT_REFERENCE){
-        R = ti_type_findBase(parser, currentScope, right);
-    } else {
-        R = right;
+    // if right is a union, we return true if any of its members matches left
+    if(R->kind == DT_TYPE_UNION){
+        if((known = ti_union_matchesPrimitive(R->unionType, L)) >= 0){
+            return (uint8_t)known;
+        }
+        vec_foreach(&R->unionType->members, member, i){
+            if(ti_types_match(parser, currentScope, L, member))
+                return 1;
+        }
+        return 0;
+    }
+    // if right is a join, all of its members must match
+    if(R->kind == DT_TYPE_JOIN){
+        vec_foreach(&R->joinType->members, member, i){
+            if(!ti_types_match(parser, currentScope, L, member))
+                return 0;
+        }
+        return 1;
     }
 
     if((L->kind == DT_STRUCT) && (R->kind == DT_STRUCT)){
         return ti_struct_contains(parser, currentScope, L, R);
     }
 
+    // an array of unknown size takes arrays of any size, their elements must match
+    if((L->kind == DT_ARRAY) && (R->kind == DT_ARRAY)){
+        if((L->arrayType->len != 0) && (L->arrayType->len != R->arrayType->len)){
+            return 0;
+        }
+        return ti_types_match(parser, currentScope, L->arrayType->arrayOf, R->arrayType->arrayOf);
+    }
+
     if((L->kind == DT_INTERFACE) && (R->kind == DT_CLASS)){
         // check if the class right extends left
         // iterate through right class extends
         DataType * parentType;
         uint32_t i=0;
-        vec_foreach(&right->classType->extends, parentType, i){
+        vec_foreach(&R->classType->extends, parentType, i){
             if(ti_types_match(parser, currentScope, L, parentType))
                 return 1;
         }
@@ -498,7 +739,7 @@ uint8_t ti_types_match(Parser* parser, ASTScope* currentScope, DataType* left, D
         }
         Lexeme lexeme = left->lexeme;
         //PARSER_ASSERT(0, "Cannot cast class to interface outside `unsafe` expression/block");
-        printf("Warning: Cannot cast class to interface outside `unsafe` expression/block\n");
+        PARSER_WARN("Cannot cast class to interface outside `unsafe` expression/block");
         return 0;
     }
 
@@ -519,173 +760,3 @@ DataType* ti_types_getCommonType(Parser* parser, ASTScope* currentScope, DataTyp
 
     return NULL;
 }
-
-sds ti_type_toString(Parser* parser, ASTScope* currentScope, DataType* type){
-    // prepare string using sds
-    sds str = sdsnew("");
-
-    // if the type is a reference, we need to find its base type
-    if (type->name != NULL){
-        str = sdscat(str, type->name);
-        return str;
-    }
-
-    if (type->kind == DT_REFERENCE) {
-        if(type->refType->ref == NULL){
-            ASSERT(type->refType->pkg->ids.length > 0, "Invalid reference type");
-
-            // concatenate pkg->ids into str
-            uint32_t i = 0;
-            char* id = NULL;
-            vec_foreach(&type->refType->pkg->ids, id, i){
-                str = sdscat(str, id);
-                if(i < type->refType->pkg->ids.length - 1){
-                    str = sdscat(str, ".");
-                }
-            }
-        }
-        return str;
-    }
-
-    DataType* baseType = ti_type_findBase(parser, currentScope, type);
-
-    // add base type as string if its not join or union
-    if((baseType->kind != DT_TYPE_JOIN) && (baseType->kind != DT_TYPE_UNION)) {
-        str = sdscat(str, stringifyType(baseType));
-    }
-    else {
-        // we add (type1 & or | type2)
-        // start with (
-        str = sdscat(str, "(");
-        str = sdscat(str, ti_type_toString(parser, currentScope, baseType->joinType->left));
-        if(baseType->kind == DT_TYPE_JOIN){
-            str = sdscat(str, " & ");
-        }
-        else {
-            str = sdscat(str, " | ");
-        }
-        str = sdscat(str, ti_type_toString(parser, currentScope, baseType->joinType->right));
-        str = sdscat(str, ")");
-        return str;
-    }
-
-    // if it has a name we add it
-    if(baseType->name != NULL){
-        str = sdscat(str, " ");
-        str = sdscat(str, baseType->name);
-    }
-    else {
-        // else, if it is a struct we add its fields
-        if(baseType->kind == DT_STRUCT){
-            str = sdscat(str, " {");
-            uint32_t i = 0;
-            char* attName = NULL;
-            vec_foreach(&baseType->structType->attributeNames, attName, i){
-                StructAttribute** attr = map_get(&baseType->structType->attributes, attName);
-                str = sdscat(str, " ");
-                str = sdscat(str, ti_type_toString(parser, currentScope, (*attr)->type));
-                str = sdscat(str, " ");
-                str = sdscat(str, (*attr)->name);
-                // if it is not the last attribute we add a comma
-                if(i < baseType->structType->attributeNames.length - 1)
-                    str = sdscat(str, ",");
-            }
-            str = sdscat(str, " }");
-        }
-
-        // if it is an interface we add its methods with args
-        else if(baseType->kind == DT_INTERFACE){
-            str = sdscat(str, " {");
-            uint32_t i = 0;
-            char* methodName = NULL;
-            vec_foreach(&baseType->interfaceType->methodNames, methodName, i){
-                FnHeader ** method = map_get(&baseType->interfaceType->methods, methodName);
-                str = sdscat(str, " ");
-                str = sdscat(str, (*method)->name);
-                str = sdscat(str, "(");
-                uint32_t j = 0;
-                char* argName = NULL;
-                vec_foreach(&(*method)->type->argNames, argName, j){
-                    FnArgument ** arg = map_get(&(*method)->type->args, argName);
-                        str = sdscat(str, " ");
-                        str = sdscat(str, argName);
-                    str = sdscat(str, " : ");
-                    str = sdscat(str, ti_type_toString(parser, currentScope, (*arg)->type));
-                    if(j < (*method)->type->argNames.length - 1){
-                        str = sdscat(str, ",");
-                    }
-                }
-                str = sdscat(str, " ) -> ");
-                str = sdscat(str, ti_type_toString(parser, currentScope, (*method)->type->returnType));
-                // if it is not the last method we add a comma
-                if(i < baseType->interfaceType->methodNames.length - 1){
-                    str = sdscat(str, ",");
-                }
-            }
-            str = sdscat(str, " }");
-        }
-
-        // if it is a class we add its methods and attributes
-        if(baseType->kind == DT_CLASS){
-            str = sdscat(str, " {");
-            uint32_t i = 0;
-
-            char* methodName = NULL;
-            vec_foreach(&baseType->classType->methodNames, methodName, i){
-                    ClassMethod ** method = map_get(&baseType->classType->methods, methodName);
-                    str = sdscat(str, " ");
-                    str = sdscat(str, (*method)->decl->header->name);
-                    str = sdscat(str, "(");
-                    uint32_t j = 0;
-                    char* argName = NULL;
-                    vec_foreach(&(*method)->decl->header->type->argNames, argName, j){
-                            FnArgument ** arg = map_get(&(*method)->decl->header->type->args, argName);
-                            str = sdscat(str, " ");
-                            str = sdscat(str, argName);
-                            str = sdscat(str, " : ");
-                            str = sdscat(str, ti_type_toString(parser, currentScope, (*arg)->type));
-                            // if it is the last argument we dont add a comma
-                            if(j < (*method)->decl->header->type->argNames.length - 1){
-                                str = sdscat(str, ",");
-                            }
-                        }
-                    str = sdscat(str, " ) -> ");
-                    str = sdscat(str, ti_type_toString(parser, currentScope, (*method)->decl->header->type->returnType));
-                    // if it is the last method we dont add a comma
-                    if(i < baseType->classType->methodNames.length - 1){
-                        str = sdscat(str, ",");
-                    }
-                }
-
-            // add attributes, iterate over each letList
-            i = 0;
-            LetExprDecl * letDecl = NULL;
-            vec_foreach(&baseType->classType->letList, letDecl, i){
-                // iterate over variableNames of LetExprDecl
-                uint32_t j = 0;
-                char* varName = NULL;
-                vec_foreach(&letDecl->variableNames, varName, j){
-                        str = sdscat(str, " let ");
-                        // get the variable of that name
-                        FnArgument ** var = map_get(&letDecl->variables, varName);
-
-                        str = sdscat(str, " ");
-                        str = sdscat(str, varName);
-                        str = sdscat(str, ": ");
-                        str = sdscat(str, ti_type_toString(parser, currentScope, (*var)->type));
-                        // add , if not last element
-                        if(j < letDecl->variableNames.length - 1){
-                            str = sdscat(str, ",");
-                        }
-                }
-                // add , if not last element
-                if(i < baseType->classType->letList.length - 1){
-                    str = sdscat(str, ",");
-                }
-            }
-            str = sdscat(str, " }");
-        }
-    }
-
-    return str;
-}
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 /**
  * Finds the base type of the given type. I.E if it is a reference, it looks up its full definition
+ * References are resolved once, see query_resolvedBase
  * @param parser
  * @param scope
  * @param dtype
@@ -18,6 +19,15 @@
  */
 DataType* ti_type_findBase(Parser* parser, ASTScope * scope, DataType *dtype);
 
+/**
+ * Computes the base type of a reference, uncached. Use ti_type_findBase.
+ * @param parser
+ * @param scope
+ * @param dtype
+ * @return
+ */
+DataType* ti_type_resolveBase(Parser* parser, ASTScope * scope, DataType *dtype);
+
 DataType* ti_fnheader_toType(Parser * parser, ASTScope * currentScope, FnHeader* header, Lexeme lexeme);
 DataType* ti_fndecl_toType(Parser * parser, ASTScope * currentScope, FnDeclStatement * fndecl, Lexeme lexeme);
 
@@ -31,6 +41,18 @@ void ti_infer_exprThis(Parser* parser, ASTScope* scope, Expr* expr);
 void ti_infer_expr(Parser* parser, ASTScope* scope, Expr* expr);
 void ti_infer_exprArrayConstruction(Parser* parser, ASTScope* scope, Expr* expr);
 
+/**
+ * Infers an expression whose type is known from its context, i.e the elements of an array.
+ * The expected type flows down into array constructions, so their elements are inferred once
+ * and checked against it rather than against each other
+ * @param parser
+ * @param scope
+ * @param expr
+ * @param expected may be NULL, the expression is then only inferred
+ * @return the type of the expression, errors are raised through the parser if it does not match
+ */
+DataType* ti_check_expr(Parser* parser, ASTScope* scope, Expr* expr, DataType* expected);
+
 DataType* ti_cast_check(Parser* parser, ASTScope* currentScope, Expr* expr, DataType* toType);
 DataType* ti_call_check(Parser* parser, ASTScope* currentScope, Expr* expr);
 DataType* ti_member_access_check(Parser* parser, ASTScope* currentScope, Expr* expr, Expr* element);
@@ -47,6 +69,4 @@ uint8_t ti_struct_contains(Parser* parser, ASTScope* currentScope, DataType* big
 uint8_t ti_types_match(Parser* parser, ASTScope* currentScope, DataType* left, DataType* right);
 DataType* ti_types_getCommonType(Parser* parser, ASTScope* currentScope, DataType* left, DataType* right);
 
-sds ti_type_toString(Parser* parser, ASTScope* currentScope, DataType* type);
-
 #endif //TYPE_C_TYPE_INFERENCE_H
@@ -4,12 +4,21 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <setjmp.h>
 #include "../../utils/minunit.h"
 #include "../../utils/vec.h"
 #include "../../utils/map.h"
+#include "../../utils/omap.h"
 #include "../lexer.h"
 #include "../parser.h"
 #include "../ast.h"
+#include "../ast_json.h"
+#include "../module.h"
+#include "../parser_parallel.h"
+#include "../type_inference.h"
+#include "../parser_utils.h"
+#include "../parser_resolve.h"
+#include "../../lsp/document.h"
 
 char* readFile(const char* url){
     char* filename = url; "../../samples/sample2.tc";
@@ -55,6 +64,982 @@ MU_TEST(sample_1) {
     LexerState* lex = lexer_init("sample2.tc", input, strlen(input));
     Parser* parser = parser_init(lex);
     parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    mu_check(parser->stats.tokensLexed > 0);
+    // look-aheads only scan a few tokens past `<` and `{`
+    mu_check(parser->stats.lookaheadTokens < parser->stats.tokensLexed);
+}
+
+MU_TEST(test_error_recovery) {
+    char* input = readFile("../../source/compiler/unittest/errors.tc");
+    LexerState* lex = lexer_init("errors.tc", input, strlen(input));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    // every broken declaration is reported, the valid ones in between are still parsed
+    mu_assert_int_eq(4, parser->diagnostics.errorCount);
+    mu_check(parser->programNode->stmts.length == 3);
+}
+
+static Parser* parseSource(const char* source) {
+    LexerState* lex = lexer_init("source.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    return parser;
+}
+
+MU_TEST(test_lookahead_counts) {
+    // each look-ahead is taken once, at its own token, so a memo keyed by (rule, token) would never hit
+    Parser* parser = parseSource("let a = f<u32>(1)\n"
+                                 "let b = a < 2\n"
+                                 "let p = {x: 1, y: 2}\n"
+                                 "let q = {1, 2}\n");
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    // 36 tokens and EOF, none of them is lexed twice
+    mu_assert_int_eq(37, parser->stats.tokensLexed);
+    // `u32 > (` after f<, then the 21 tokens after a < and EOF, as nothing closes it,
+    // then `x :` and `1` after the two {. `x :` is scanned by both a < and its {, but by different rules
+    mu_assert_int_eq(3 + 22 + 2 + 1, parser->stats.lookaheadTokens);
+    parser_free(parser);
+}
+
+MU_TEST(test_invalid_symbol) {
+    // reported and skipped, parsing goes on past it
+    Parser* parser = parseSource("@");
+    mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    mu_assert_string_eq("invalid symbol `@`", parser->diagnostics.diagnostics.data[0]->message);
+    parser_free(parser);
+
+    parser = parseSource("type W = @");
+    mu_check(parser->diagnostics.errorCount >= 1);
+    mu_assert_string_eq("invalid symbol `@`", parser->diagnostics.diagnostics.data[0]->message);
+    parser_free(parser);
+
+    parser = parseSource("type W = @ u32\nfn f(x: W) -> u32 = x\n");
+    mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    mu_assert_int_eq(1, parser->programNode->stmts.length);
+    parser_free(parser);
+}
+
+static Parser* parseIncremental(const char* source, const char* graphPath) {
+    LexerState* lex = lexer_init("incremental.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parseIncremental(parser, graphPath);
+    return parser;
+}
+
+MU_TEST(test_incremental) {
+    const char* graphPath = "incremental.depgraph";
+    const char* v1 = "type Point = struct {x: u32, y: u32}\n"
+                     "fn norm(p: Point) -> u32 = 1\n"
+                     "fn twice(x: u32) -> u32 = x\n";
+    const char* v2 = "type Point = struct {x: u32, y: u32, z: u32}\n"
+                     "fn norm(p: Point) -> u32 = 1\n"
+                     "fn twice(x: u32) -> u32 = x\n";
+    remove(graphPath);
+
+    // first build checks everything
+    Parser* parser = parseIncremental(v1, graphPath);
+    mu_assert_int_eq(3, parser->depGraph->dirtyCount);
+
+    // nothing changed
+    parser = parseIncremental(v1, graphPath);
+    mu_assert_int_eq(0, parser->depGraph->dirtyCount);
+
+    // a warning raised by the check of twice is kept with the graph
+    DepNode* twice = parser->depGraph->statements.data[1];
+    Diagnostic warning = {DS_WARNING, {"incremental.tc", twice->line, twice->col + 3, twice->start + 3, 5}, "kept"};
+    depgraph_recordDiagnostic(twice, &warning);
+    mu_check(depgraph_save(parser->depGraph, graphPath));
+
+    // Point and norm, which depends on it
+    parser = parseIncremental(v2, graphPath);
+    mu_assert_int_eq(2, parser->depGraph->dirtyCount);
+    // twice is skipped, its warning is reported again, and saved again
+    mu_assert_int_eq(1, parser->diagnostics.warningCount);
+    Diagnostic* replayed = parser->diagnostics.diagnostics.data[0];
+    mu_assert_string_eq("kept", replayed->message);
+    mu_assert_int_eq(3, replayed->span.line);
+    mu_assert_int_eq(3, replayed->span.col);
+    mu_check(replayed->snippet != NULL);
+
+    parser = parseIncremental(v2, graphPath);
+    mu_assert_int_eq(0, parser->depGraph->dirtyCount);
+    mu_assert_int_eq(1, parser->diagnostics.warningCount);
+    remove(graphPath);
+}
+
+MU_TEST(test_queries) {
+    const char* source = "type Point = struct {x: u32, y: u32}\n"
+                         "let origin: Point = {x: 0, y: 0}\n"
+                         "fn getX() -> u32 = origin.x\n";
+    LexerState* lex = lexer_init("queries.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+
+    // function bodies are not part of the eager walk, their types are computed on demand
+    Statement* fn = parser->programNode->stmts.data[1];
+    mu_check(fn->type == ST_FN_DECL);
+    DataType* type = query_typeOf(parser, fn->fnDecl->scope, fn->fnDecl->expr);
+    mu_check(type != NULL && type->kind == DT_U32);
+    mu_assert_int_eq(0, parser->queries.stats.hits[QK_TYPE_OF]);
+
+    // and only once
+    mu_check(query_typeOf(parser, fn->fnDecl->scope, fn->fnDecl->expr) == type);
+    mu_assert_int_eq(1, parser->queries.stats.hits[QK_TYPE_OF]);
+
+    // until invalidated
+    query_invalidateAll(&parser->queries);
+    mu_check(query_typeOf(parser, fn->fnDecl->scope, fn->fnDecl->expr) == type);
+    mu_assert_int_eq(1, parser->queries.stats.hits[QK_TYPE_OF]);
+}
+
+MU_TEST(test_array_inference) {
+    const char* source = "[[1, 2], [3, 4], [5, 6]]\n";
+    LexerState* lex = lexer_init("arrays.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+
+    Expr* expr = parser->programNode->stmts.data[0]->expr->expr;
+    DataType* type = expr->dataType;
+    mu_check(type != NULL && type->kind == DT_ARRAY);
+    mu_assert_int_eq(3, type->arrayType->len);
+    mu_check(type->arrayType->arrayOf == expr->arrayConstructionExpr->args.data[0]->dataType);
+
+    // the inner arrays keep their own type, unified with the first one
+    Expr* last = expr->arrayConstructionExpr->args.data[2];
+    mu_check(last->dataType->kind == DT_ARRAY);
+    mu_assert_int_eq(2, last->dataType->arrayType->len);
+    mu_check(last->arrayConstructionExpr->args.data[0]->dataType->kind == DT_I32);
+
+    // every expression was inferred once, the outer one, 3 arrays and 6 numbers
+    mu_assert_int_eq(10, parser->queries.stats.misses[QK_TYPE_OF]);
+    mu_assert_int_eq(0, parser->queries.stats.hits[QK_TYPE_OF]);
+    mu_check(query_typeOf(parser, parser->programNode->scope, last) == last->dataType);
+    mu_assert_int_eq(1, parser->queries.stats.hits[QK_TYPE_OF]);
+
+    // numbers and strings do not mix, nor do arrays of different sizes
+    const char* mismatches[] = {"[1, \"two\"]\n", "[[1, 2], [3, 4, 5]]\n", "[[1, 2, 3], [4]]\n"};
+    uint32_t i = 0;
+    for(; i < 3; i++) {
+        lex = lexer_init("mixed.tc", mismatches[i], strlen(mismatches[i]));
+        parser = parser_init(lex);
+        parser_parse(parser);
+        mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    }
+
+    // the expected size is checked, bodies are inferred on demand
+    source = "fn three() -> u32[2] = [1, 2, 3]\n";
+    lex = lexer_init("expected.tc", source, strlen(source));
+    parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    Statement* fn = parser->programNode->stmts.data[0];
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        ti_check_expr(parser, fn->fnDecl->scope, fn->fnDecl->expr, fn->fnDecl->header->type->returnType);
+    }
+    parser->recovery = NULL;
+    mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    mu_check(strstr(parser->diagnostics.diagnostics.data[0]->message, "2 elements") != NULL);
+}
+
+MU_TEST(test_member_sets) {
+    sds source = sdsnew("type Wide = class {\n");
+    uint32_t i = 0;
+    for(; i < 200; i++) {
+        source = sdscatprintf(source, "    fn m%u() -> u32 = %u\n", i, i);
+    }
+    source = sdscat(source, "    let m7: u32 = 0\n}\n");
+    LexerState* lex = lexer_init("members.tc", source, sdslen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+
+    // the member names are computed once, then every new member is added to them
+    mu_assert_int_eq(1, parser->queries.stats.misses[QK_MEMBERS_OF]);
+    mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    mu_check(strstr(parser->diagnostics.diagnostics.data[0]->message, "m7") != NULL);
+    sdsfree(source);
+}
+
+MU_TEST(test_extends_sets) {
+    sds source = sdsempty();
+    uint32_t i = 0;
+    for(; i < 100; i++) {
+        source = sdscatprintf(source, "type P%u = interface {\n    fn p%u() -> u32\n}\n", i, i);
+    }
+    source = sdscat(source, "type Q = interface {\n    fn p42() -> u32\n}\n");
+    source = sdscat(source, "type All = interface(");
+    for(i = 0; i < 100; i++) {
+        source = sdscatprintf(source, "P%u, ", i);
+    }
+    source = sdscat(source, "Q) {\n    fn all() -> u32\n}\n");
+    LexerState* lex = lexer_init("extends.tc", source, sdslen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+
+    // every parent is flattened once, then merged into the names of the child
+    mu_assert_int_eq(102, parser->queries.stats.misses[QK_MEMBERS_OF]);
+    mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    mu_check(strstr(parser->diagnostics.diagnostics.data[0]->message, "p42") != NULL);
+    sdsfree(source);
+}
+
+MU_TEST(test_struct_fields) {
+    const char* source = "type P = struct {x: u32, y: u32}\n"
+                         "type Q = struct {z: u32, y: u32, x: u32}\n"
+                         "type R = struct {x: u32, y: string}\n";
+    LexerState* lex = lexer_init("fields.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+
+    ASTScope* scope = parser->programNode->scope;
+    DataType* p = ti_type_findBase(parser, scope, resolver_resolveType(parser, scope, "P"));
+    DataType* q = ti_type_findBase(parser, scope, resolver_resolveType(parser, scope, "Q"));
+    DataType* r = ti_type_findBase(parser, scope, resolver_resolveType(parser, scope, "R"));
+
+    // declared in any order
+    mu_check(ti_struct_contains(parser, scope, q, p));
+    mu_check(!ti_struct_contains(parser, scope, p, q));
+    // same names, another type
+    mu_check(!ti_struct_contains(parser, scope, r, p));
+    mu_check(ti_struct_contains(parser, scope, p, p));
+
+    // each struct is fingerprinted once
+    mu_assert_int_eq(3, parser->queries.stats.misses[QK_STRUCT_FIELDS]);
+    QueryStructFields* fields = query_structFieldsOf(parser, scope, q);
+    mu_assert_int_eq(3, fields->count);
+    mu_check(query_compareFields(&fields->fields[0], &fields->fields[1]) < 0);
+    mu_check(query_compareFields(&fields->fields[1], &fields->fields[2]) < 0);
+}
+
+MU_TEST(test_flat_unions) {
+    const char* source = "type Int = i8 | i16 | (i32 | i64) | string | i16\n"
+                         "type Shape = struct {x: u32} | struct {y: u32} | struct {x: u32}\n";
+    LexerState* lex = lexer_init("unions.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+
+    ASTScope* scope = parser->programNode->scope;
+    DataType* integer = ti_type_findBase(parser, scope, resolver_resolveType(parser, scope, "Int"));
+    DataType* shape = ti_type_findBase(parser, scope, resolver_resolveType(parser, scope, "Shape"));
+
+    // nested unions are spread, sorted by kind and deduplicated
+    mu_assert_int_eq(5, integer->unionType->members.length);
+    mu_assert_int_eq(DT_I8, integer->unionType->members.data[0]->kind);
+    mu_assert_int_eq(DT_STRING, integer->unionType->members.data[4]->kind);
+    mu_check(integer->unionType->kinds == (TYPE_KIND_BIT(DT_I8) | TYPE_KIND_BIT(DT_I16) | TYPE_KIND_BIT(DT_I32) |
+                                           TYPE_KIND_BIT(DT_I64) | TYPE_KIND_BIT(DT_STRING)));
+    mu_assert_int_eq(2, shape->unionType->members.length);
+
+    DataType* i32 = ast_type_makeType(scope, integer->lexeme, DT_I32);
+    DataType* u32 = ast_type_makeType(scope, integer->lexeme, DT_U32);
+    mu_check(ti_types_match(parser, scope, integer, i32));
+    mu_check(!ti_types_match(parser, scope, integer, u32));
+    mu_check(ti_types_match(parser, scope, resolver_resolveType(parser, scope, "Int"), i32));
+
+    // aliases of primitives are primitives, however the union is grouped
+    source = "type Num = u32\n"
+             "type X = Num | string | bool\n"
+             "type Y = (Num | string) | bool\n"
+             "type Z = Y | bool\n";
+    lex = lexer_init("aliases.tc", source, strlen(source));
+    parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+}
+
+MU_TEST(test_forward_references) {
+    const char* source = "fn get(l: Later) -> u32 = l.x\n"
+                         "fn id<T>(a: T) -> T = a\n"
+                         "type Later = struct {x: u32}\n"
+                         "type Box<Later> = struct {v: Later}\n"
+                         "type A = B\n"
+                         "type B = A\n";
+    LexerState* lex = lexer_init("references.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+
+    // the cycle is reported once
+    mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    mu_check(strstr(parser->diagnostics.diagnostics.data[0]->message, "alias of itself") != NULL);
+    mu_assert_int_eq(0, parser->unresolvedTypes.length);
+
+    // bound ahead of its declaration, generic parameters are left to the instances
+    Statement* stmt = parser->programNode->stmts.data[0];
+    DataType* later = omap_value(&stmt->fnDecl->header->type->args, 0)->type;
+    mu_check(later->refType->ref != NULL);
+    mu_assert_string_eq("Later", later->refType->ref->name);
+    stmt = parser->programNode->stmts.data[1];
+    mu_check(omap_value(&stmt->fnDecl->header->type->args, 0)->type->refType->ref == NULL);
+
+    // only within their declaration, `Later` is still bound in `get`
+    ASTScope* scope = parser->programNode->scope;
+    DataType* box = ti_type_findBase(parser, scope, resolver_resolveType(parser, scope, "Box"));
+    mu_check(omap_value(&box->structType->attributes, 0)->type->refType->ref == NULL);
+}
+
+MU_TEST(test_type_descriptions) {
+    const char* source = "type Later = u32\n"
+                         "fn get(p: struct {x: u32, y: Later}, q: (struct {a: u32} | struct {b: Later})) -> u32 = p.x\n";
+    LexerState* lex = lexer_init("descriptions.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+
+    Statement* stmt = parser->programNode->stmts.data[0];
+    DataType* p = omap_value(&stmt->fnDecl->header->type->args, 0)->type;
+    DataType* q = omap_value(&stmt->fnDecl->header->type->args, 1)->type;
+    const char* description = describeType(p);
+    mu_assert_string_eq("struct { u32 x, Later y }", description);
+    mu_assert_string_eq("(struct { u32 a } | struct { Later b })", describeType(q));
+    mu_assert_string_eq("void", describeType(NULL));
+
+    // described once, then kept on the type
+    mu_check(describeType(p) == description);
+    mu_check(p->description == description);
+}
+
+MU_TEST(test_generic_instances) {
+    const char* source = "type Box<T> = struct {x: T}\n"
+                         "fn id<T>(a: T) -> T = a\n"
+                         "type Num = u32\n"
+                         "let b: Box<u32> = {x: 1}\n"
+                         "let c: Box<Num> = {x: 2}\n"
+                         "id<u32>(1)\n"
+                         "id<Num>(2)\n"
+                         "id<string>(\"a\")\n"
+                         "b.x\n"
+                         "c.x\n";
+    LexerState* lex = lexer_init("instances.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+
+    // an alias names the same instance
+    mu_assert_int_eq(3, parser->instances.stats.misses);
+    mu_assert_int_eq(2, parser->instances.stats.hits);
+
+    // types declared as T are replaced
+    Statement* stmt = parser->programNode->stmts.data[3];
+    mu_check(stmt->expr->expr->dataType->kind == DT_U32);
+    stmt = parser->programNode->stmts.data[7];
+    DataType* field = ti_type_findBase(parser, parser->programNode->scope, stmt->expr->expr->dataType);
+    mu_check(field->kind == DT_U32);
+
+    // unions are keyed by their members, whichever their order and grouping
+    source = "fn id<T>(a: T) -> T = a\n"
+             "type Small = i8\n"
+             "type Grouped = (i8 | string) | i8\n"
+             "id<i8 | string>(1)\n"
+             "id<string | i8>(2)\n"
+             "id<Grouped>(3)\n"
+             "id<Small | string>(4)\n";
+    lex = lexer_init("unions.tc", source, strlen(source));
+    parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    mu_assert_int_eq(1, parser->instances.stats.misses);
+    mu_assert_int_eq(3, parser->instances.stats.hits);
+
+    // a bare parameter alias is named on a copy, the argument belongs to the caller
+    source = "type Point = struct {x: u32}\n"
+             "type Id<T> = T\n"
+             "let p: Id<Point> = {x: 1}\n"
+             "p.x\n";
+    lex = lexer_init("alias.tc", source, strlen(source));
+    parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    mu_assert_int_eq(1, parser->instances.stats.misses);
+    stmt = parser->programNode->stmts.data[0];
+    DataType* idType = omap_value(&stmt->varDecl->letList.data[0]->variables, 0)->type;
+    DataType* point = idType->genericRefs.data[0];
+    mu_check(point->name == NULL || strcmp(point->name, "Id<Point>") != 0);
+    stmt = parser->programNode->stmts.data[1];
+    mu_check(stmt->expr->expr->dataType->kind == DT_U32);
+    mu_assert_string_eq("Point", point->refType->ref->name);
+}
+
+typedef struct WalkCounts {
+    uint32_t entered;
+    uint32_t left;
+    uint32_t binaries;
+    // first literals entered, in order
+    uint32_t literals[4];
+    uint32_t literalCount;
+}WalkCounts;
+
+static AstWalkAction walk_enter(AstWalker* walker, Expr* expr) {
+    WalkCounts* counts = walker->data;
+    counts->entered++;
+    counts->binaries += expr->type == ET_BINARY;
+    if(expr->type == ET_LITERAL && counts->literalCount < 4) {
+        counts->literals[counts->literalCount++] = atoi(expr->literalExpr->value);
+    }
+    return AWA_CONTINUE;
+}
+
+static AstWalkAction walk_leave(AstWalker* walker, Expr* expr) {
+    ((WalkCounts*)walker->data)->left++;
+    return AWA_CONTINUE;
+}
+
+MU_TEST(test_deep_walk) {
+    const uint32_t depth = 100000;
+    sds source = sdsnew("1 + 2 - 3 * 4\n0");
+    uint32_t i = 1;
+    for(; i <= depth; i++) {
+        source = sdscatprintf(source, " %s %u", i % 2 ? "+" : "*", i % 10);
+    }
+    source = sdscat(source, "\n");
+    LexerState* lex = lexer_init("deep.tc", source, sdslen(source));
+    Parser* parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    mu_assert_int_eq(2, parser->programNode->stmts.length);
+
+    // nested to the right, as the grammar is written
+    Expr* expr = parser->programNode->stmts.data[0]->expr->expr;
+    mu_assert_int_eq(BET_ADD, expr->binaryExpr->type);
+    mu_assert_int_eq(BET_SUB, expr->binaryExpr->rhs->binaryExpr->type);
+    mu_assert_int_eq(BET_MUL, expr->binaryExpr->rhs->binaryExpr->rhs->binaryExpr->type);
+
+    AstWalkCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    for(i = 0; i < AST_WALK_EXPR_TYPES; i++) {
+        callbacks.enterExpr[i] = walk_enter;
+        callbacks.leaveExpr[i] = walk_leave;
+    }
+
+    // in source order
+    WalkCounts counts;
+    memset(&counts, 0, sizeof(counts));
+    ast_walk_statement(&parser->walker, &callbacks, &counts, parser->programNode->scope, parser->programNode->stmts.data[0]);
+    mu_assert_int_eq(7, counts.entered);
+    mu_assert_int_eq(7, counts.left);
+    mu_assert_int_eq(4, counts.literalCount);
+    mu_assert_int_eq(1, counts.literals[0]);
+    mu_assert_int_eq(4, counts.literals[3]);
+
+    // deeper than the C stack would allow
+    memset(&counts, 0, sizeof(counts));
+    ast_walk_statement(&parser->walker, &callbacks, &counts, parser->programNode->scope, parser->programNode->stmts.data[1]);
+    mu_assert_int_eq(2 * depth + 1, counts.entered);
+    mu_assert_int_eq(2 * depth + 1, counts.left);
+    mu_assert_int_eq(depth, counts.binaries);
+    mu_assert_int_eq(0, parser->walker.stack.length);
+    parser_free(parser);
+    sdsfree(source);
+
+    // postfix chains are parsed in a loop and inferred operands first
+    const uint32_t chain = 20000;
+    // a struct cannot name itself, two of them name each other
+    source = sdsnew("type S = struct {y: T}\n"
+                    "type T = struct {y: S}\n"
+                    "let s: S = {y: s}\n"
+                    "s");
+    for(i = 0; i < chain; i++) {
+        source = sdscat(source, ".y");
+    }
+    source = sdscat(source, "\n");
+    lex = lexer_init("chain.tc", source, sdslen(source));
+    parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    // types are not statements
+    mu_assert_int_eq(2, parser->programNode->stmts.length);
+    expr = parser->programNode->stmts.data[1]->expr->expr;
+    mu_assert_int_eq(ET_MEMBER_ACCESS, expr->type);
+    mu_check(expr->dataType != NULL);
+    parser_free(parser);
+    sdsfree(source);
+
+    // parentheses and prefix operators are parsed with an explicit stack
+    source = sdsempty();
+    for(i = 0; i < depth; i++) {
+        source = sdscat(source, "-(");
+    }
+    source = sdscat(source, "1");
+    for(i = 0; i < depth; i++) {
+        source = sdscat(source, ")");
+    }
+    source = sdscat(source, "\nlet x: u32 = ");
+    for(i = 0; i < depth; i++) {
+        source = sdscat(source, "(");
+    }
+    source = sdscat(source, "1");
+    for(i = 0; i < depth; i++) {
+        source = sdscat(source, ")");
+    }
+    source = sdscat(source, "\n");
+    lex = lexer_init("parens.tc", source, sdslen(source));
+    parser = parser_init(lex);
+    parser_parse(parser);
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    mu_assert_int_eq(2, parser->programNode->stmts.length);
+    char* json = ast_json_serializeStatement(parser->programNode->stmts.data[1]);
+    mu_check(strstr(json, "\"initializer\":{\"category\":\"literal\"") != NULL);
+    json_free_serialized_string(json);
+
+    expr = parser->programNode->stmts.data[0]->expr->expr;
+    mu_assert_int_eq(UET_NEG, expr->unaryExpr->type);
+    mu_assert_int_eq(UET_NEG, expr->unaryExpr->uhs->unaryExpr->type);
+    memset(&counts, 0, sizeof(counts));
+    ast_walk_statement(&parser->walker, &callbacks, &counts, parser->programNode->scope, parser->programNode->stmts.data[0]);
+    mu_assert_int_eq(depth + 1, counts.entered);
+    mu_assert_int_eq(1, counts.literalCount);
+    parser_free(parser);
+    sdsfree(source);
+}
+
+MU_TEST(test_lazy_bodies) {
+    const char* source = "fn good(a: u32) -> u32 {\n"
+                         "    let x: u32 = a\n"
+                         "    return x\n"
+                         "}\n"
+                         "fn bad(a: u32) -> u32 {\n"
+                         "    let x: u32 = )\n"
+                         "    return a\n"
+                         "}\n"
+                         "fn short(a: u32) -> u32 = a\n";
+    LexerState* lex = lexer_init("lazy.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    parser->lazyBodies = 1;
+    parser_parse(parser);
+
+    // signatures only, errors within bodies are not seen yet
+    mu_assert_int_eq(0, parser->diagnostics.errorCount);
+    mu_assert_int_eq(3, parser->programNode->stmts.length);
+    FnDeclStatement* good = parser->programNode->stmts.data[0]->fnDecl;
+    FnDeclStatement* bad = parser->programNode->stmts.data[1]->fnDecl;
+    mu_check(good->deferredBody != NULL && good->block == NULL);
+    mu_check(parser->programNode->stmts.data[2]->fnDecl->deferredBody == NULL);
+
+    mu_check(parser_parseFnBody(parser, good));
+    mu_check(good->deferredBody == NULL && good->block != NULL);
+    mu_assert_int_eq(2, good->block->blockStmt->stmts.length);
+
+    // reported where they are in the file
+    mu_check(!parser_parseFnBody(parser, bad));
+    mu_assert_int_eq(1, parser->diagnostics.errorCount);
+    mu_assert_int_eq(6, parser->diagnostics.diagnostics.data[0]->span.line);
+    parser_free(parser);
+}
+
+static void writeFile(const char* path, const char* content) {
+    FILE* f = fopen(path, "w");
+    fputs(content, f);
+    fclose(f);
+}
+
+MU_TEST(test_module_interfaces) {
+    writeFile("modlib.tc", "type Point = struct {x: u32, y: u32}\n"
+                           "fn norm(p: Point) -> u32 {\n"
+                           "    return p.x\n"
+                           "}\n");
+    writeFile("modmain.tc", "from modlib import Point, norm\n"
+                            "norm({x: 1, y: 2})\n");
+    remove("modlib.tci");
+
+    ModuleCache cache;
+    module_cache_init(&cache);
+    module_cache_beginRequest(&cache);
+    Module* module = module_cache_load(&cache, "modmain.tc");
+    mu_check(module != NULL);
+    mu_assert_int_eq(0, module->parser->diagnostics.errorCount);
+    mu_assert_int_eq(1, cache.stats.interfaceBuilds);
+
+    // made from the current source, the body is not part of it
+    sds saved = module_readFile("modlib.tci");
+    mu_check(saved != NULL && strstr(saved, "fn norm(p: Point) -> u32 {}") != NULL);
+    sdsfree(saved);
+
+    // the implementation changes, not the interface: the importer is kept
+    writeFile("modlib.tc", "type Point = struct {x: u32, y: u32}\n"
+                           "fn norm(p: Point) -> u32 {\n"
+                           "    return p.y\n"
+                           "}\n");
+    module_cache_beginRequest(&cache);
+    mu_check(module_cache_load(&cache, "modmain.tc") == module);
+    mu_assert_int_eq(2, cache.stats.interfaceBuilds);
+    mu_assert_int_eq(1, cache.stats.hits);
+
+    // the interface changes, the importer is compiled again
+    writeFile("modlib.tc", "type Point = struct {x: u32, y: u32}\n"
+                           "fn length(p: Point) -> u32 = p.x\n");
+    module_cache_beginRequest(&cache);
+    module = module_cache_load(&cache, "modmain.tc");
+    mu_assert_int_eq(2, cache.stats.misses);
+    // norm is neither imported nor found by the call
+    mu_assert_int_eq(2, module->parser->diagnostics.errorCount);
+    module_cache_deinit(&cache);
+
+    // a new process reads the saved interface instead of the source
+    module_cache_init(&cache);
+    module_cache_beginRequest(&cache);
+    mu_check(module_cache_loadInterface(&cache, "modlib.tc") != NULL);
+    mu_assert_int_eq(1, cache.stats.interfaceLoads);
+    mu_assert_int_eq(0, cache.stats.interfaceBuilds);
+    module_cache_deinit(&cache);
+
+    // parents may be imported, by a module and by its interface
+    writeFile("modparent.tc", "type I = interface {\n    fn get() -> u32\n}\n");
+    writeFile("modchild.tc", "from modparent import I\n"
+                             "type J = interface(I) {\n    fn put() -> u32\n}\n");
+    module_cache_init(&cache);
+    module_cache_beginRequest(&cache);
+    module = module_cache_load(&cache, "modchild.tc");
+    mu_assert_int_eq(0, module->parser->diagnostics.errorCount);
+    ModuleInterface* child = module_cache_loadInterface(&cache, "modchild.tc");
+    mu_assert_int_eq(0, child->parser->diagnostics.errorCount);
+    DataType* j = ti_type_findBase(child->parser, child->program->scope,
+                                   resolver_resolveType(child->parser, child->program->scope, "J"));
+    mu_assert_int_eq(1, j->interfaceType->extends.length);
+    module_cache_deinit(&cache);
+
+    remove("modlib.tc");
+    remove("modlib.tci");
+    remove("modmain.tc");
+    remove("modparent.tc");
+    remove("modparent.tci");
+    remove("modchild.tc");
+    remove("modchild.tci");
+}
+
+/**
+ * Compiles a module the way a new `type_c --incremental` process does
+ */
+static uint32_t compileIncremental(const char* path, DepGraph** graph, ModuleCache* cache) {
+    module_cache_init(cache);
+    cache->incremental = 1;
+    module_cache_beginRequest(cache);
+    Module* module = module_cache_load(cache, path);
+    *graph = module->parser->depGraph;
+    return module->parser->diagnostics.errorCount;
+}
+
+MU_TEST(test_module_incremental) {
+    writeFile("modinclib.tc", "type Base = struct {x: u32}\n");
+    const char* v1 = "from modinclib import Base\n"
+                     "type Point = struct {x: u32, y: u32}\n"
+                     "fn norm(p: Point) -> u32 = p.x\n"
+                     "fn twice(x: u32) -> u32 = x\n"
+                     "twice(1)\n"
+                     "norm({x: 1, y: 2})\n";
+    const char* v2 = "from modinclib import Base\n"
+                     "type Point = struct {x: u32, y: u32}\n"
+                     "fn norm(p: Point) -> u32 = p.y\n"
+                     "fn twice(x: u32) -> u32 = x\n"
+                     "twice(1)\n"
+                     "norm({x: 1, y: 2})\n";
+    writeFile("modinc.tc", v1);
+    remove("modinc.tcg");
+
+    // first build checks everything
+    ModuleCache cache;
+    DepGraph* graph;
+    mu_assert_int_eq(0, compileIncremental("modinc.tc", &graph, &cache));
+    mu_assert_int_eq(5, graph->dirtyCount);
+    module_cache_deinit(&cache);
+
+    // a new process finds nothing to recheck
+    mu_assert_int_eq(0, compileIncremental("modinc.tc", &graph, &cache));
+    mu_assert_int_eq(0, graph->dirtyCount);
+    module_cache_deinit(&cache);
+
+    // norm's body changes: norm and the call which depends on it
+    writeFile("modinc.tc", v2);
+    mu_assert_int_eq(0, compileIncremental("modinc.tc", &graph, &cache));
+    mu_assert_int_eq(2, graph->dirtyCount);
+    mu_check(graph->nodes.data[1]->dirty && graph->nodes.data[4]->dirty);
+    module_cache_deinit(&cache);
+
+    // the interface of an import changes, everything is rechecked
+    writeFile("modinclib.tc", "type Base = struct {x: u32, y: u32}\n");
+    mu_assert_int_eq(0, compileIncremental("modinc.tc", &graph, &cache));
+    mu_assert_int_eq(5, graph->dirtyCount);
+    module_cache_deinit(&cache);
+
+    remove("modinc.tc");
+    remove("modinc.tcg");
+    remove("modinclib.tc");
+    remove("modinclib.tci");
+}
+
+MU_TEST(test_module_graph) {
+    // eight modules importing the same base, all imported by the root
+    writeFile("modbase.tc", "type Base = struct {x: u32}\n");
+    sds root = sdsempty();
+    char name[32], text[256];
+    int i = 0;
+    for(; i < 8; i++) {
+        sprintf(name, "modleaf%d.tc", i);
+        sprintf(text, "from modbase import Base\n"
+                      "fn leaf%d(b: Base) -> u32 {\n"
+                      "    return b.x\n"
+                      "}\n", i);
+        writeFile(name, text);
+        root = sdscatprintf(root, "from modleaf%d import leaf%d\n", i, i);
+    }
+    root = sdscat(root, "leaf0({x: 1})\n");
+    writeFile("modroot.tc", root);
+    sdsfree(root);
+    // a cycle is bound once the rest of the graph is
+    writeFile("modcyca.tc", "from modcycb import b\nfn a() -> u32 = 1\n");
+    writeFile("modcycb.tc", "from modcyca import a\nfn b() -> u32 = 2\n");
+
+    ModuleCache cache;
+    module_cache_init(&cache);
+    cache.jobs = 4;
+    module_cache_beginRequest(&cache);
+    Module* module = module_cache_load(&cache, "modroot.tc");
+    mu_check(module != NULL);
+    mu_assert_int_eq(0, module->parser->diagnostics.errorCount);
+    mu_assert_int_eq(8, module->imports.length);
+    mu_assert_int_eq(9, cache.stats.interfaceBuilds);
+    mu_assert_int_eq(9, cache.stats.graphNodes);
+
+    ModuleInterface* cycle = module_cache_loadInterface(&cache, "modcyca.tc");
+    mu_check(cycle != NULL);
+    mu_assert_int_eq(0, cycle->parser->diagnostics.errorCount);
+    mu_check(map_get(&cycle->program->scope->functions, "b") != NULL);
+
+    // the interface of the base changes, so do the leaves' though their text does not
+    writeFile("modbase.tc", "type Base = struct {x: u32, y: u32}\n");
+    module_cache_beginRequest(&cache);
+    module = module_cache_load(&cache, "modroot.tc");
+    mu_assert_int_eq(2, cache.stats.misses);
+    mu_assert_int_eq(0, module->parser->diagnostics.errorCount);
+    mu_assert_int_eq(8, cache.stats.interfaceHits);
+    module_cache_deinit(&cache);
+
+    remove("modbase.tc");
+    remove("modbase.tci");
+    remove("modroot.tc");
+    for(i = 0; i < 8; i++) {
+        sprintf(name, "modleaf%d.tc", i);
+        remove(name);
+        sprintf(name, "modleaf%d.tci", i);
+        remove(name);
+    }
+    remove("modcyca.tc");
+    remove("modcyca.tci");
+    remove("modcycb.tc");
+    remove("modcycb.tci");
+}
+
+static Parser* parseWith(const char* source, ThreadPool* pool, ParserParallelStats* stats) {
+    LexerState* lex = lexer_init("parallel.tc", source, strlen(source));
+    Parser* parser = parser_init(lex);
+    ASTProgramNode* program = ast_makeProgramNode();
+    parser->programNode = program;
+    *stats = parser_parallel_parseProgram(parser, program, pool);
+    return parser;
+}
+
+MU_TEST(test_parallel_parse) {
+    sds source = sdsempty();
+    uint32_t i = 0;
+    for(; i < 3000; i++) {
+        // braces, quotes and declarations within strings and comments are no boundaries
+        source = sdscatprintf(source, "type T%u = struct {x: u32}\n"
+                                      "// fn c%u() {\n"
+                                      "fn fun%u(t: T%u) -> u32 {\n"
+                                      "    let s = \"}\\\"\\nfn fake%u(x: u32) -> u32 = x\"\n"
+                                      "    return t.x\n"
+                                      "}\n", i, i, i, i, i);
+        // each interface extends the previous one, which may be in another chunk
+        if(i % 50 == 0) {
+            source = sdscatprintf(source, i == 0 ? "type I0 = interface {\n    fn m0() -> u32\n}\n" :
+                                          "type I%u = interface(I%u) {\n    fn m%u() -> u32\n}\n", i, i - 50, i);
+        }
+    }
+    source = sdscat(source, "type T5 = struct {y: u32}\n");
+    mu_check(sdslen(source) >= PARSER_PARALLEL_MIN_SIZE);
+
+    vec_parserchunk_t chunks;
+    vec_init(&chunks);
+    parser_parallel_split(source, sdslen(source), PARSER_PARALLEL_MIN_CHUNK, &chunks);
+    mu_check(chunks.length > 1);
+    ParserChunk chunk;
+    vec_foreach(&chunks, chunk, i) {
+        mu_check(strncmp(source + chunk.start, "type T", 6) == 0 || strncmp(source + chunk.start, "fn fun", 6) == 0 ||
+                 strncmp(source + chunk.start, "type I", 6) == 0 || i == 0);
+    }
+    vec_deinit(&chunks);
+
+    ParserParallelStats stats;
+    Parser* single = parseWith(source, NULL, &stats);
+    mu_assert_int_eq(1, stats.chunks);
+    ThreadPool* pool = threadpool_make(4);
+    Parser* parallel = parseWith(source, pool, &stats);
+    threadpool_free(pool);
+    mu_check(stats.chunks > 1);
+    // parents are looked up once every chunk is merged, only the chunk redeclaring T5 is parsed again
+    mu_assert_int_eq(1, stats.reparsed);
+    resolver_resolveReferences(parallel);
+    DataType* last = ti_type_findBase(parallel, parallel->programNode->scope,
+                                      resolver_resolveType(parallel, parallel->programNode->scope, "I2950"));
+    mu_assert_int_eq(1, last->interfaceType->extends.length);
+
+    // T5 declared twice, whatever the split
+    mu_assert_int_eq(1, single->diagnostics.errorCount);
+    mu_assert_int_eq(1, parallel->diagnostics.errorCount);
+    Diagnostic* expected = single->diagnostics.diagnostics.data[0];
+    Diagnostic* found = parallel->diagnostics.diagnostics.data[0];
+    mu_assert_string_eq(expected->message, found->message);
+    mu_assert_int_eq(expected->span.line, found->span.line);
+    mu_assert_int_eq(expected->span.col, found->span.col);
+    mu_assert_int_eq(single->programNode->stmts.length, parallel->programNode->stmts.length);
+    mu_assert_int_eq(single->programNode->scope->dataTypes.base.nnodes,
+                     parallel->programNode->scope->dataTypes.base.nnodes);
+    mu_assert_int_eq(single->programNode->scope->functions.base.nnodes,
+                     parallel->programNode->scope->functions.base.nnodes);
+    mu_check(map_get(&parallel->programNode->scope->functions, "fake1") == NULL);
+    parser_free(single);
+    parser_free(parallel);
+    sdsfree(source);
+}
+
+MU_TEST(test_lsp_document) {
+    const char* source = "type Point = struct {x: u32, y: u32}\n"
+                         "fn norm(p: Point) -> u32 = 1\n"
+                         "fn twice(x: u32) -> u32 = x\n";
+    LspDocument* doc = lsp_document_open("lsp.tc", source, 1);
+    int32_t delta;
+    uint32_t i = 0;
+    mu_assert_int_eq(3, doc->regions.length);
+    mu_assert_int_eq(1, doc->stats.fullParses);
+
+    // within twice's body, only its region is parsed again and nothing depends on it
+    lsp_document_applyEdit(doc, 2, 26, 2, 27, "x + x");
+    mu_assert_int_eq(1, doc->stats.fullParses);
+    mu_assert_int_eq(4, doc->stats.regionParses);
+    mu_assert_int_eq(4, doc->stats.regionInferences);
+
+    // Point changes, norm which refers to it is inferred again
+    lsp_document_applyEdit(doc, 0, 35, 0, 35, ", z: u32");
+    mu_assert_int_eq(1, doc->stats.fullParses);
+    mu_assert_int_eq(5, doc->stats.regionParses);
+    mu_assert_int_eq(6, doc->stats.regionInferences);
+
+    sds hover = lsp_document_hover(doc, 2, 4);
+    mu_check(hover != NULL);
+    mu_assert_string_eq("fn twice(x: u32) -> u32", hover);
+    sdsfree(hover);
+
+    // Point within norm's arguments
+    uint32_t line = 1, col = 11;
+    mu_check(lsp_document_definition(doc, &line, &col));
+    mu_assert_int_eq(0, line);
+    mu_assert_int_eq(5, col);
+
+    // what a region held is released once it is parsed again, editing back and forth holds as much
+    lsp_document_applyEdit(doc, 2, 26, 2, 31, "x");
+    uint64_t regionBlocks = doc->regions.data[2]->arena->count;
+    uint64_t documentBlocks = doc->arena->count;
+    mu_check(regionBlocks > 0);
+    for(i = 0; i < 10; i++) {
+        lsp_document_applyEdit(doc, 2, 26, 2, 27, "x + x");
+        lsp_document_applyEdit(doc, 2, 26, 2, 31, "x");
+    }
+    mu_assert_int_eq(1, doc->stats.fullParses);
+    mu_assert_int_eq(regionBlocks, doc->regions.data[2]->arena->count);
+    mu_assert_int_eq(documentBlocks, doc->arena->count);
+
+    // a new declaration spans the boundary of two regions
+    lsp_document_applyEdit(doc, 3, 0, 3, 0, "fn thrice(x: u32) -> u32 = x\n");
+    mu_assert_int_eq(2, doc->stats.fullParses);
+    mu_assert_int_eq(4, doc->regions.length);
+    lsp_document_close(doc);
+
+    // the last statement only reaches Point through a, it is inferred again too, against the new Point
+    source = "type Point = struct {x: u32, y: u32}\n"
+             "let a: Point = {x: 1, y: 2}\n"
+             "a.z\n";
+    doc = lsp_document_open("lsp.tc", source, 1);
+    mu_assert_int_eq(1, lsp_document_diagnosticsAt(doc, 3, &delta)->diagnostics.errorCount);
+    lsp_document_applyEdit(doc, 0, 35, 0, 35, ", z: u32");
+    mu_assert_int_eq(1, doc->stats.fullParses);
+    mu_assert_int_eq(6, doc->stats.regionInferences);
+    for(i = 0; i <= (uint32_t)doc->regions.length; i++) {
+        mu_assert_int_eq(0, lsp_document_diagnosticsAt(doc, i, &delta)->diagnostics.errorCount);
+    }
+    lsp_document_close(doc);
+
+    // a.z is inferred before the declaration of a, which must already lead to the new Point
+    source = "type Point = struct {x: u32, y: u32}\n"
+             "a.z\n"
+             "let a: Point = {x: 1, y: 2}\n";
+    doc = lsp_document_open("lsp.tc", source, 1);
+    mu_assert_int_eq(1, lsp_document_diagnosticsAt(doc, 2, &delta)->diagnostics.errorCount);
+    lsp_document_applyEdit(doc, 0, 35, 0, 35, ", z: u32");
+    mu_assert_int_eq(1, doc->stats.fullParses);
+    mu_assert_int_eq(0, lsp_document_diagnosticsAt(doc, 2, &delta)->diagnostics.errorCount);
+    lsp_document_close(doc);
+}
+
+MU_TEST(test_ordered_map) {
+    // keys are not copied
+    char keys[1000][8];
+    omap_t(uint32_t) m;
+    omap_init(&m);
+    uint32_t i = 0;
+    for(; i < 1000; i++) {
+        sprintf(keys[i], "k%u", 999 - i);
+        omap_set(&m, keys[i], i);
+    }
+    mu_assert_int_eq(1000, omap_length(&m));
+    mu_check(omap_get(&m, "k1000") == NULL);
+    mu_assert_int_eq(990, *omap_get(&m, "k9"));
+
+    // a replaced entry keeps its position
+    char k500[] = "k500";
+    omap_set(&m, k500, 7);
+    mu_assert_int_eq(1000, omap_length(&m));
+    mu_assert_int_eq(7, *omap_get(&m, "k500"));
+
+    char* key;
+    uint32_t value;
+    uint32_t ordered = 1;
+    omap_foreach(&m, key, value, i) {
+        ordered &= key == keys[i] && (value == i || (i == 499 && value == 7));
+    }
+    mu_check(ordered);
+    omap_deinit(&m);
+}
+
+MU_TEST(test_small_vector) {
+    vec_small_t(int, 3) v;
+    vec_small_init(&v);
+    vec_push(&v, 1);
+    vec_push(&v, 2);
+    vec_push(&v, 3);
+    // nothing allocated so far
+    mu_check(v.data == v.inline_);
+
+    vec_push(&v, 4);
+    vec_insert(&v, 0, 0);
+    mu_check(v.data != v.inline_);
+    mu_assert_int_eq(5, v.length);
+    int i = 0, value;
+    vec_foreach(&v, value, i) {
+        mu_assert_int_eq(i, value);
+    }
+    vec_deinit(&v);
+
+    // compacting keeps the inline storage
+    vec_small_init(&v);
+    vec_push(&v, 1);
+    vec_compact(&v);
+    mu_check(v.data == v.inline_);
+    mu_assert_int_eq(1, vec_first(&v));
+    vec_deinit(&v);
 }
 
 MU_TEST_SUITE(imports_test) {
@@ -65,14 +1050,80 @@ MU_TEST_SUITE(type_declaration_test) {
     MU_RUN_TEST(test_type_declaration_1);
 }
 
+MU_TEST_SUITE(utils_test) {
+    MU_RUN_TEST(test_ordered_map);
+    MU_RUN_TEST(test_small_vector);
+}
+
 MU_TEST_SUITE(not_a_test) {
     MU_RUN_TEST(sample_1);
+    MU_RUN_TEST(test_lookahead_counts);
+}
+
+MU_TEST_SUITE(error_recovery_test) {
+    MU_RUN_TEST(test_error_recovery);
+    MU_RUN_TEST(test_invalid_symbol);
+}
+
+MU_TEST_SUITE(incremental_test) {
+    MU_RUN_TEST(test_incremental);
+}
+
+MU_TEST_SUITE(query_test) {
+    MU_RUN_TEST(test_queries);
+    MU_RUN_TEST(test_array_inference);
+    MU_RUN_TEST(test_member_sets);
+    MU_RUN_TEST(test_extends_sets);
+    MU_RUN_TEST(test_struct_fields);
+}
+
+MU_TEST_SUITE(resolve_test) {
+    MU_RUN_TEST(test_forward_references);
+    MU_RUN_TEST(test_type_descriptions);
+    MU_RUN_TEST(test_flat_unions);
+}
+
+MU_TEST_SUITE(instance_test) {
+    MU_RUN_TEST(test_generic_instances);
+}
+
+MU_TEST_SUITE(walk_test) {
+    MU_RUN_TEST(test_deep_walk);
+}
+
+MU_TEST_SUITE(lazy_test) {
+    MU_RUN_TEST(test_lazy_bodies);
+}
+
+MU_TEST_SUITE(module_test) {
+    MU_RUN_TEST(test_module_interfaces);
+    MU_RUN_TEST(test_module_graph);
+    MU_RUN_TEST(test_module_incremental);
+}
+
+MU_TEST_SUITE(parallel_test) {
+    MU_RUN_TEST(test_parallel_parse);
+}
+
+MU_TEST_SUITE(lsp_test) {
+    MU_RUN_TEST(test_lsp_document);
 }
 
 int main(int argc, char *argv[]) {
     //MU_RUN_SUITE(imports_test);
     //MU_RUN_SUITE(type_declaration_test);
+    MU_RUN_SUITE(utils_test);
     MU_RUN_SUITE(not_a_test);
+    MU_RUN_SUITE(error_recovery_test);
+    MU_RUN_SUITE(incremental_test);
+    MU_RUN_SUITE(query_test);
+    MU_RUN_SUITE(resolve_test);
+    MU_RUN_SUITE(instance_test);
+    MU_RUN_SUITE(walk_test);
+    MU_RUN_SUITE(lazy_test);
+    MU_RUN_SUITE(module_test);
+    MU_RUN_SUITE(parallel_test);
+    MU_RUN_SUITE(lsp_test);
     MU_REPORT();
     return MU_EXIT_CODE;
 }
\ No newline at end of file
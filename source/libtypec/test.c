@@ -0,0 +1,111 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "typec.h"
+#include "../utils/minunit.h"
+
+#define LIBTYPEC_TEST_THREADS 4
+#define LIBTYPEC_TEST_ROUNDS 8
+
+typedef struct CompileRun {
+    uint32_t id;
+    // results of the last round, checked by the main thread
+    int okErrors;
+    int badErrors;
+    TypecDiagnostic diagnostic;
+    char message[256];
+    int hasAst;
+}CompileRun;
+
+static void addSource(TypecContext* ctx, const char* path, const char* text) {
+    typec_addSource(ctx, path, text, strlen(text));
+}
+
+/**
+ * Compiles in-memory modules, a context per round, on its own thread
+ */
+static void* compileRun(void* arg) {
+    CompileRun* run = arg;
+    char root[64], base[64];
+    sprintf(root, "/libtypec-test/%u/root.tc", run->id);
+    sprintf(base, "/libtypec-test/%u/base.tc", run->id);
+
+    uint32_t round = 0;
+    for(; round < LIBTYPEC_TEST_ROUNDS; round++) {
+        TypecContext* ctx = typec_create(2);
+        addSource(ctx, base, "type Base = struct {x: u32}\n");
+        addSource(ctx, root, "from base import Base\n"
+                             "fn get(b: Base) -> u32 {\n"
+                             "    return b.x\n"
+                             "}\n");
+        run->okErrors = typec_compile(ctx, root);
+        const char* ast = typec_astJson(ctx);
+        run->hasAst = ast != NULL && strstr(ast, "\"statements\"") != NULL;
+
+        // the new text hides the old one
+        addSource(ctx, root, "from base import Base\n"
+                             "fn get(b: Base) -> u32 {\n"
+                             "    let y: u32 = )\n"
+                             "    return b.x\n"
+                             "}\n");
+        run->badErrors = typec_compile(ctx, root);
+        run->message[0] = '\0';
+        if(typec_diagnostic(ctx, 0, &run->diagnostic) == 0) {
+            snprintf(run->message, sizeof(run->message), "%s", run->diagnostic.message);
+        }
+        typec_destroy(ctx);
+    }
+    return NULL;
+}
+
+MU_TEST(test_libtypec_contexts) {
+    pthread_t threads[LIBTYPEC_TEST_THREADS];
+    CompileRun runs[LIBTYPEC_TEST_THREADS];
+    uint32_t i = 0;
+    for(; i < LIBTYPEC_TEST_THREADS; i++) {
+        runs[i].id = i;
+        pthread_create(&threads[i], NULL, compileRun, &runs[i]);
+    }
+    for(i = 0; i < LIBTYPEC_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for(i = 0; i < LIBTYPEC_TEST_THREADS; i++) {
+        mu_assert_int_eq(0, runs[i].okErrors);
+        mu_check(runs[i].hasAst);
+        mu_check(runs[i].badErrors > 0);
+        mu_assert_int_eq(TYPEC_ERROR, runs[i].diagnostic.severity);
+        mu_check(runs[i].message[0] != '\0');
+        mu_assert_int_eq(3, runs[i].diagnostic.line);
+    }
+}
+
+MU_TEST(test_libtypec_errors) {
+    TypecContext* ctx = typec_create(1);
+    mu_assert_int_eq(-1, typec_compile(ctx, "/libtypec-test/missing.tc"));
+    mu_check(strstr(typec_lastError(ctx), "missing.tc") != NULL);
+    mu_check(typec_astJson(ctx) == NULL);
+    mu_assert_int_eq(0, typec_diagnosticCount(ctx));
+
+    addSource(ctx, "/libtypec-test/a.tc", "let x: u32 = 1\n");
+    mu_assert_int_eq(0, typec_compile(ctx, "/libtypec-test/a.tc"));
+    mu_check(strcmp(typec_lastError(ctx), "") == 0);
+    const char* rendered = typec_renderDiagnostics(ctx, TYPEC_FORMAT_JSON);
+    mu_check(rendered != NULL && strstr(rendered, "\"errors\"") != NULL);
+    typec_destroy(ctx);
+}
+
+MU_TEST_SUITE(libtypec_test) {
+    MU_RUN_TEST(test_libtypec_contexts);
+    MU_RUN_TEST(test_libtypec_errors);
+}
+
+int main(int argc, char *argv[]) {
+    MU_RUN_SUITE(libtypec_test);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
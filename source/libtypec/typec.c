@@ -0,0 +1,219 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include "typec.h"
+#include "../compiler/alloc.h"
+#include "../compiler/error.h"
+#include "../compiler/module.h"
+#include "../compiler/ast_json.h"
+#include "../utils/parson.h"
+#include "../utils/sds.h"
+
+struct TypecContext {
+    // owns everything allocated on behalf of the context, by the caller's thread and the workers
+    AllocArena* arena;
+    ModuleCache cache;
+    // last compiled module, NULL if the last compilation failed
+    Module* module;
+    // view over the diagnostics of the last compilation, see module_cache_collect
+    DiagnosticsEngine diagnostics;
+    sds rendered;
+    char* ast;
+    // an internal error left the compiler in an unknown state
+    uint8_t broken;
+    char error[512];
+};
+
+static pthread_once_t typec_once = PTHREAD_ONCE_INIT;
+
+static void typec_init(void) {
+    // serialized strings are released with free, which goes through the arenas
+    json_set_allocation_functions(alloc_malloc, alloc_free);
+}
+
+/**
+ * Runs the rest of the calling function within the context: in its arena, with internal errors
+ * jumping back here, where the context is marked broken and `failed` is returned.
+ * Must be paired with TYPEC_LEAVE before every return.
+ */
+#define TYPEC_ENTER(ctx, failed) \
+    jmp_buf recovery; \
+    AllocArena* outerArena = alloc_enter((ctx)->arena); \
+    jmp_buf* outerRecovery = error_enterRecovery(&recovery); \
+    if(setjmp(recovery) != 0) { \
+        TYPEC_LEAVE(); \
+        typec_fail(ctx, error_lastMessage()); \
+        return failed; \
+    }
+
+#define TYPEC_LEAVE() \
+    do { \
+        error_enterRecovery(outerRecovery); \
+        alloc_enter(outerArena); \
+    } while(0)
+
+static void typec_fail(TypecContext* ctx, const char* message) {
+    ctx->broken = 1;
+    snprintf(ctx->error, sizeof(ctx->error), "internal error: %s", message);
+}
+
+/**
+ * Drops the results of the previous call
+ */
+static void typec_reset(TypecContext* ctx) {
+    ctx->error[0] = '\0';
+    if(ctx->rendered != NULL) {
+        sdsfree(ctx->rendered);
+        ctx->rendered = NULL;
+    }
+    if(ctx->ast != NULL) {
+        json_free_serialized_string(ctx->ast);
+        ctx->ast = NULL;
+    }
+}
+
+static uint8_t typec_usable(TypecContext* ctx) {
+    if(ctx->broken) {
+        // the message of the internal error is kept
+        return 0;
+    }
+    typec_reset(ctx);
+    return 1;
+}
+
+TypecContext* typec_create(uint32_t jobs) {
+    pthread_once(&typec_once, typec_init);
+
+    AllocArena* arena = alloc_arena_make();
+    AllocArena* outer = alloc_enter(arena);
+    TypecContext* ctx = calloc(1, sizeof(TypecContext));
+    ctx->arena = arena;
+    module_cache_init(&ctx->cache);
+    ctx->cache.jobs = jobs;
+    diagnostics_init(&ctx->diagnostics);
+    alloc_enter(outer);
+    return ctx;
+}
+
+void typec_destroy(TypecContext* ctx) {
+    if(ctx == NULL) {
+        return;
+    }
+
+    AllocArena* outer = alloc_enter(ctx->arena);
+    if(!ctx->broken) {
+        typec_reset(ctx);
+        vec_deinit(&ctx->diagnostics.diagnostics);
+        map_deinit(&ctx->diagnostics.seen);
+        module_cache_deinit(&ctx->cache);
+    }
+    else if(ctx->cache.pool != NULL) {
+        // the rest may be inconsistent, the arena releases it all the same
+        threadpool_free(ctx->cache.pool);
+    }
+    alloc_enter(outer);
+
+    // the context itself lives in the arena
+    alloc_arena_free(ctx->arena);
+}
+
+int typec_addSource(TypecContext* ctx, const char* path, const char* text, size_t len) {
+    if(!typec_usable(ctx)) {
+        return -1;
+    }
+
+    TYPEC_ENTER(ctx, -1)
+    uint8_t added = module_cache_setSource(&ctx->cache, path, text, len);
+    TYPEC_LEAVE();
+
+    if(!added) {
+        snprintf(ctx->error, sizeof(ctx->error), "invalid path '%s'", path);
+        return -1;
+    }
+    return 0;
+}
+
+int typec_compile(TypecContext* ctx, const char* path) {
+    if(!typec_usable(ctx)) {
+        return -1;
+    }
+
+    TYPEC_ENTER(ctx, -1)
+    ctx->module = NULL;
+    vec_clear(&ctx->diagnostics.diagnostics);
+    ctx->diagnostics.errorCount = 0;
+    ctx->diagnostics.warningCount = 0;
+
+    module_cache_beginRequest(&ctx->cache);
+    Module* module = module_cache_load(&ctx->cache, path);
+    if(module != NULL) {
+        ctx->module = module;
+        module_cache_collect(&ctx->cache, module, &ctx->diagnostics);
+    }
+    TYPEC_LEAVE();
+
+    if(module == NULL) {
+        snprintf(ctx->error, sizeof(ctx->error), "could not read '%s'", path);
+        return -1;
+    }
+    return (int)ctx->diagnostics.errorCount;
+}
+
+uint32_t typec_diagnosticCount(TypecContext* ctx) {
+    return ctx->broken ? 0 : ctx->diagnostics.diagnostics.length;
+}
+
+int typec_diagnostic(TypecContext* ctx, uint32_t index, TypecDiagnostic* diagnostic) {
+    if(ctx->broken || index >= (uint32_t)ctx->diagnostics.diagnostics.length) {
+        return -1;
+    }
+
+    Diagnostic* source = ctx->diagnostics.diagnostics.data[index];
+    diagnostic->severity = (TypecSeverity)source->severity;
+    diagnostic->filename = source->span.filename;
+    diagnostic->line = source->span.line;
+    diagnostic->col = source->span.col;
+    diagnostic->len = source->span.len;
+    diagnostic->message = source->message;
+    return 0;
+}
+
+const char* typec_renderDiagnostics(TypecContext* ctx, TypecFormat format) {
+    if(!typec_usable(ctx)) {
+        return NULL;
+    }
+    if(ctx->module == NULL) {
+        snprintf(ctx->error, sizeof(ctx->error), "nothing was compiled");
+        return NULL;
+    }
+
+    TYPEC_ENTER(ctx, NULL)
+    uint32_t errorCount = 0;
+    ctx->rendered = module_cache_render(&ctx->cache, ctx->module, (DiagnosticsFormat)format, &errorCount);
+    TYPEC_LEAVE();
+    return ctx->rendered;
+}
+
+const char* typec_astJson(TypecContext* ctx) {
+    if(!typec_usable(ctx)) {
+        return NULL;
+    }
+    if(ctx->module == NULL) {
+        snprintf(ctx->error, sizeof(ctx->error), "nothing was compiled");
+        return NULL;
+    }
+
+    TYPEC_ENTER(ctx, NULL)
+    ctx->ast = ast_json_serializeProgram(ctx->module->program);
+    TYPEC_LEAVE();
+    return ctx->ast;
+}
+
+const char* typec_lastError(TypecContext* ctx) {
+    return ctx->error;
+}
@@ -0,0 +1,120 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_LIBTYPEC_H
+#define TYPE_C_LIBTYPEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Embedding API of the compiler, built as the libtypec shared library.
+ *
+ * A context is a compiler instance: its own module cache, workers and allocation arena.
+ * Contexts share nothing, so several may be used at once from different threads, one thread
+ * per context at a time. Destroying a context releases everything it ever allocated.
+ * An internal error of the compiler marks the context as failed rather than aborting the process,
+ * every call but typec_destroy then fails.
+ *
+ * Strings returned by a context are owned by it, and stay valid until the next call on it.
+ */
+
+#if defined(_WIN32)
+#define TYPEC_API __declspec(dllexport)
+#else
+#define TYPEC_API __attribute__((visibility("default")))
+#endif
+
+typedef struct TypecContext TypecContext;
+
+typedef enum TypecSeverity {
+    TYPEC_ERROR = 0,
+    TYPEC_WARNING,
+    TYPEC_NOTE
+}TypecSeverity;
+
+typedef enum TypecFormat {
+    TYPEC_FORMAT_HUMAN = 0,
+    TYPEC_FORMAT_JSON,
+    TYPEC_FORMAT_SARIF
+}TypecFormat;
+
+typedef struct TypecDiagnostic {
+    TypecSeverity severity;
+    const char* filename;
+    // line is 1-based, col is 0-based
+    uint32_t line;
+    uint32_t col;
+    uint32_t len;
+    const char* message;
+}TypecDiagnostic;
+
+/**
+ * Creates a compiler instance
+ * @param jobs number of workers loading imports and parsing large files, 0 for one per CPU
+ * @return new context, NULL if it could not be created
+ */
+TYPEC_API TypecContext* typec_create(uint32_t jobs);
+
+/**
+ * Releases a context and everything it allocated
+ * @param ctx may be NULL
+ */
+TYPEC_API void typec_destroy(TypecContext* ctx);
+
+/**
+ * Adds or replaces a source held in memory, which hides any file at the same path,
+ * both when compiled and when imported.
+ * @param ctx
+ * @param path relative paths are made absolute from the working directory
+ * @param text
+ * @param len
+ * @return 0 on success, -1 on failure
+ */
+TYPEC_API int typec_addSource(TypecContext* ctx, const char* path, const char* text, size_t len);
+
+/**
+ * Compiles a file and the interfaces of its imports. Unchanged modules are reused from
+ * the previous compilations of the context.
+ * @param ctx
+ * @param path
+ * @return number of errors, -1 if the file could not be read or the compiler failed
+ */
+TYPEC_API int typec_compile(TypecContext* ctx, const char* path);
+
+/**
+ * @return number of diagnostics of the last compilation
+ */
+TYPEC_API uint32_t typec_diagnosticCount(TypecContext* ctx);
+
+/**
+ * Reads a diagnostic of the last compilation
+ * @param ctx
+ * @param index
+ * @param diagnostic output
+ * @return 0 on success, -1 if out of range
+ */
+TYPEC_API int typec_diagnostic(TypecContext* ctx, uint32_t index, TypecDiagnostic* diagnostic);
+
+/**
+ * Renders the diagnostics of the last compilation in a single document
+ * @param ctx
+ * @param format
+ * @return the document, NULL on failure
+ */
+TYPEC_API const char* typec_renderDiagnostics(TypecContext* ctx, TypecFormat format);
+
+/**
+ * Serializes the AST of the last compiled file
+ * @param ctx
+ * @return JSON document, NULL on failure
+ */
+TYPEC_API const char* typec_astJson(TypecContext* ctx);
+
+/**
+ * @return why the last call failed, empty if it did not
+ */
+TYPEC_API const char* typec_lastError(TypecContext* ctx);
+
+#endif //TYPE_C_LIBTYPEC_H
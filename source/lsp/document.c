@@ -0,0 +1,649 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <setjmp.h>
+#include "document.h"
+#include "../compiler/lexer.h"
+#include "../compiler/scope.h"
+#include "../compiler/type_inference.h"
+#include "../compiler/parser_utils.h"
+
+static void lsp_document_indexLines(LspDocument* doc) {
+    vec_clear(&doc->lines);
+    vec_push(&doc->lines, 0);
+    uint32_t i = 0;
+    uint32_t len = sdslen(doc->text);
+    for(; i < len; i++) {
+        if(doc->text[i] == '\n') {
+            vec_push(&doc->lines, i + 1);
+        }
+    }
+}
+
+uint32_t lsp_document_offsetAt(LspDocument* doc, uint32_t line, uint32_t col) {
+    uint32_t len = sdslen(doc->text);
+    if(line >= (uint32_t)doc->lines.length) {
+        return len;
+    }
+    // a column past the end of the line stops at its new line
+    uint32_t end = line + 1 < (uint32_t)doc->lines.length ? doc->lines.data[line + 1] - 1 : len;
+    uint32_t offset = doc->lines.data[line] + col;
+    return offset > end ? end : offset;
+}
+
+void lsp_document_positionAt(LspDocument* doc, uint32_t offset, uint32_t* line, uint32_t* col) {
+    // last line starting at or before the offset
+    int32_t low = 0, high = doc->lines.length - 1;
+    while(low < high) {
+        int32_t mid = (low + high + 1) / 2;
+        if((uint32_t)doc->lines.data[mid] <= offset) {
+            low = mid;
+        }
+        else {
+            high = mid - 1;
+        }
+    }
+    *line = low;
+    *col = offset - doc->lines.data[low];
+}
+
+static uint32_t lsp_document_regionEnd(LspDocument* doc, uint32_t index) {
+    return index + 1 < (uint32_t)doc->regions.length ? doc->regions.data[index + 1]->start : sdslen(doc->text);
+}
+
+/**
+ * Index of the region containing the offset, -1 if it is within the header
+ */
+static int32_t lsp_document_regionAt(LspDocument* doc, uint32_t offset) {
+    int32_t low = 0, high = doc->regions.length - 1, found = -1;
+    while(low <= high) {
+        int32_t mid = (low + high) / 2;
+        if(doc->regions.data[mid]->start <= offset) {
+            found = mid;
+            low = mid + 1;
+        }
+        else {
+            high = mid - 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * Parses a slice of the text, positions of its tokens are the ones they have in the document
+ */
+static Parser* lsp_document_parseSlice(LspDocument* doc, uint32_t start, uint32_t end, ASTProgramNode* program) {
+    sds slice = sdsnewlen(doc->text + start, end - start);
+    LexerState* lex = lexer_init(doc->uri, slice, end - start);
+    sdsfree(slice);
+
+    uint32_t line, col;
+    lsp_document_positionAt(doc, start, &line, &col);
+    lex->line = line + 1;
+    lex->col = col;
+
+    Parser* parser = parser_init(lex);
+    parser->depGraph = depgraph_make();
+    parser->programNode = program;
+
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        parser_parseProgram(parser, program);
+    }
+    parser->recovery = NULL;
+    return parser;
+}
+
+static void lsp_document_infer(Parser* parser, ASTProgramNode* program) {
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        ti_runProgram(parser, program);
+    }
+    parser->recovery = NULL;
+}
+
+static void lsp_document_unpublish(LspDocument* doc, LspRegion* region) {
+    ASTScope* scope = doc->program->scope;
+    uint32_t i = 0;
+    char* name;
+    vec_foreach(&region->names, name, i) {
+        map_remove(&scope->variables, name);
+        map_remove(&scope->functions, name);
+        map_remove(&scope->dataTypes, name);
+        map_remove(&scope->externDecls, name);
+        map_remove(&doc->owners, name);
+        free(name);
+    }
+    vec_clear(&region->names);
+}
+
+/**
+ * Reserves a name for a region, a name already declared elsewhere is reported and stays local
+ */
+static uint8_t lsp_document_claim(LspDocument* doc, uint32_t index, const char* name) {
+    LspRegion* region = doc->regions.data[index];
+    ASTScopeResult* existing = resolveElement((char*)name, doc->program->scope, 0);
+    if(existing != NULL) {
+        free(existing);
+        DiagnosticSpan span = {doc->uri, 0, 0, 0, 0};
+        DepNode** node = map_get(&region->parser->depGraph->byName, name);
+        if(node != NULL) {
+            span.line = (*node)->line;
+            span.col = (*node)->col;
+            span.pos = (*node)->start;
+        }
+        diagnostics_report(&region->parser->diagnostics, DS_ERROR, span, NULL, __FUNCTION__, __LINE__, NULL,
+                           "%s already declared", name);
+        return 0;
+    }
+    map_set(&doc->owners, name, index);
+    vec_push(&region->names, strdup(name));
+    return 1;
+}
+
+#define LSP_DOCUMENT_PUBLISH(doc, index, from, to, field) {                 \
+    const char* key;                                                        \
+    map_iter_t iter = map_iter(&(from)->field);                             \
+    while((key = map_next(&(from)->field, &iter))) {                        \
+        if(lsp_document_claim(doc, index, key)) {                           \
+            map_set(&(to)->field, key, *map_get(&(from)->field, key));      \
+        }                                                                   \
+    }                                                                       \
+}
+
+static void lsp_document_publish(LspDocument* doc, uint32_t index) {
+    ASTScope* from = doc->regions.data[index]->program->scope;
+    ASTScope* to = doc->program->scope;
+    // the entries of the document scope live as long as it does
+    AllocArena* outerArena = alloc_enter(doc->arena);
+    LSP_DOCUMENT_PUBLISH(doc, index, from, to, variables);
+    LSP_DOCUMENT_PUBLISH(doc, index, from, to, functions);
+    LSP_DOCUMENT_PUBLISH(doc, index, from, to, dataTypes);
+    LSP_DOCUMENT_PUBLISH(doc, index, from, to, externDecls);
+    alloc_enter(outerArena);
+}
+
+/**
+ * Releases the parser of a region and the AST it parsed, its names must be unpublished first
+ */
+static void lsp_document_releaseRegion(LspRegion* region) {
+    // may have grown within the arena
+    vec_deinit(&region->references);
+    vec_init(&region->references);
+    if(region->parser != NULL) {
+        parser_free(region->parser);
+        region->parser = NULL;
+    }
+    if(region->arena != NULL) {
+        alloc_arena_free(region->arena);
+        region->arena = NULL;
+    }
+    region->program = NULL;
+}
+
+static void lsp_document_parseRegion(LspDocument* doc, uint32_t index) {
+    LspRegion* region = doc->regions.data[index];
+    lsp_document_unpublish(doc, region);
+    lsp_document_releaseRegion(region);
+
+    // declarations land in a scope of their own, the document scope only sees what gets published
+    region->arena = alloc_arena_make();
+    AllocArena* outerArena = alloc_enter(region->arena);
+    region->program = ast_makeProgramNode();
+    region->program->scope->parentScope = doc->program->scope;
+    region->parser = lsp_document_parseSlice(doc, region->start, lsp_document_regionEnd(doc, index), region->program);
+    alloc_enter(outerArena);
+    region->parser->boundTypes = &region->references;
+    region->parseDiagnostics = region->parser->diagnostics.diagnostics.length;
+
+    uint32_t col;
+    lsp_document_positionAt(doc, region->start, &region->parsedLine, &col);
+    lsp_document_publish(doc, index);
+    doc->stats.regionParses++;
+}
+
+static void lsp_document_inferRegion(LspDocument* doc, uint32_t index) {
+    LspRegion* region = doc->regions.data[index];
+    diagnostics_truncate(&region->parser->diagnostics, region->parseDiagnostics);
+    query_invalidateAll(&region->parser->queries);
+    // instances are keyed by the address of their declaration, which a replaced one may now have
+    instance_cache_deinit(&region->parser->instances);
+    instance_cache_init(&region->parser->instances);
+    lsp_document_infer(region->parser, region->program);
+    doc->stats.regionInferences++;
+}
+
+static void lsp_document_clear(LspDocument* doc) {
+    uint32_t i = 0;
+    LspRegion* region;
+    vec_foreach(&doc->regions, region, i) {
+        uint32_t j = 0;
+        char* name;
+        vec_foreach(&region->names, name, j) { free(name); }
+        vec_deinit(&region->names);
+        lsp_document_releaseRegion(region);
+        free(region);
+    }
+    vec_clear(&doc->regions);
+    map_deinit(&doc->owners);
+    map_init(&doc->owners);
+    if(doc->header != NULL) {
+        parser_free(doc->header);
+        doc->header = NULL;
+    }
+    // the document scope goes last, region scopes were children of it
+    if(doc->arena != NULL) {
+        alloc_arena_free(doc->arena);
+        doc->arena = NULL;
+    }
+    doc->program = NULL;
+}
+
+static void lsp_document_parseAll(LspDocument* doc) {
+    lsp_document_clear(doc);
+    uint32_t len = sdslen(doc->text);
+
+    // a first pass finds where declarations start, recovery already cuts the text at these points
+    AllocArena* scanArena = alloc_arena_make();
+    AllocArena* outerArena = alloc_enter(scanArena);
+    Parser* scan = lsp_document_parseSlice(doc, 0, len, ast_makeProgramNode());
+    alloc_enter(outerArena);
+    uint32_t i = 0;
+    DepNode* node;
+    vec_foreach(&scan->depGraph->nodes, node, i) {
+        if(node->tokenCount == 0 || (doc->regions.length > 0 && vec_last(&doc->regions)->start >= node->start)) {
+            continue;
+        }
+        LspRegion* region = malloc(sizeof(LspRegion));
+        region->start = node->start;
+        region->arena = NULL;
+        region->parsedLine = 0;
+        region->parser = NULL;
+        region->program = NULL;
+        vec_init(&region->names);
+        region->parseDiagnostics = 0;
+        vec_init(&region->references);
+        vec_push(&doc->regions, region);
+    }
+    parser_free(scan);
+    alloc_arena_free(scanArena);
+
+    uint32_t headerEnd = doc->regions.length > 0 ? doc->regions.data[0]->start : len;
+    doc->arena = alloc_arena_make();
+    outerArena = alloc_enter(doc->arena);
+    doc->program = ast_makeProgramNode();
+    doc->header = lsp_document_parseSlice(doc, 0, headerEnd, doc->program);
+    alloc_enter(outerArena);
+
+    // everything is published before inference, declarations may refer to later ones
+    for(i = 0; i < (uint32_t)doc->regions.length; i++) {
+        lsp_document_parseRegion(doc, i);
+    }
+    lsp_document_infer(doc->header, doc->program);
+    for(i = 0; i < (uint32_t)doc->regions.length; i++) {
+        lsp_document_inferRegion(doc, i);
+    }
+    doc->stats.fullParses++;
+}
+
+LspDocument* lsp_document_open(const char* uri, const char* text, int32_t version) {
+    LspDocument* doc = malloc(sizeof(LspDocument));
+    doc->uri = strdup(uri);
+    doc->text = sdsnew(text);
+    doc->version = version;
+    vec_init(&doc->lines);
+    doc->arena = NULL;
+    doc->header = NULL;
+    doc->program = NULL;
+    vec_init(&doc->regions);
+    map_init(&doc->owners);
+    memset(&doc->stats, 0, sizeof(LspDocumentStats));
+
+    lsp_document_indexLines(doc);
+    lsp_document_parseAll(doc);
+    return doc;
+}
+
+void lsp_document_close(LspDocument* doc) {
+    lsp_document_clear(doc);
+    vec_deinit(&doc->regions);
+    map_deinit(&doc->owners);
+    vec_deinit(&doc->lines);
+    sdsfree(doc->text);
+    free(doc->uri);
+    free(doc);
+}
+
+void lsp_document_setText(LspDocument* doc, const char* text) {
+    sdsfree(doc->text);
+    doc->text = sdsnew(text);
+    lsp_document_indexLines(doc);
+    lsp_document_parseAll(doc);
+}
+
+/**
+ * Strings and comments may extend past a region, the text they are cut from decides
+ */
+static uint8_t lsp_document_mayCrossRegions(const char* text, size_t len) {
+    size_t i = 0;
+    for(; i < len; i++) {
+        if(text[i] == '"' || text[i] == '\'') {
+            return 1;
+        }
+        if(i + 1 < len && ((text[i] == '/' && text[i + 1] == '*') || (text[i] == '*' && text[i + 1] == '/'))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Whether a region references one of the given names
+ */
+static uint8_t lsp_document_references(LspRegion* region, map_int_t* names) {
+    uint32_t i = 0;
+    DepNode* node;
+    vec_foreach(&region->parser->depGraph->nodes, node, i) {
+        const char* name;
+        map_iter_t iter = map_iter(names);
+        while((name = map_next(names, &iter))) {
+            if(map_get(&node->refs, name) != NULL) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void lsp_document_addNames(map_int_t* into, map_int_t* names) {
+    const char* name;
+    map_iter_t iter = map_iter(names);
+    while((name = map_next(names, &iter))) {
+        map_set(into, name, 1);
+    }
+}
+
+/**
+ * Unbinds the references of a region leading to one of the given names, they are bound
+ * again, to the declarations now published under these names, before it is inferred
+ */
+static void lsp_document_rebind(LspRegion* region, map_int_t* names) {
+    uint32_t kept = 0;
+    uint32_t i = 0;
+    UnresolvedType reference;
+    vec_foreach(&region->references, reference, i) {
+        ReferenceType* refType = reference.typeRef->refType;
+        if(refType->pkg->ids.length == 1 && map_get(names, refType->pkg->ids.data[0]) != NULL) {
+            refType->ref = NULL;
+            vec_push(&region->parser->unresolvedTypes, reference);
+        }
+        else {
+            region->references.data[kept++] = reference;
+        }
+    }
+    region->references.length = kept;
+}
+
+void lsp_document_applyEdit(LspDocument* doc, uint32_t startLine, uint32_t startCol,
+                            uint32_t endLine, uint32_t endCol, const char* text) {
+    uint32_t start = lsp_document_offsetAt(doc, startLine, startCol);
+    uint32_t end = lsp_document_offsetAt(doc, endLine, endCol);
+    if(end < start) {
+        uint32_t tmp = start;
+        start = end;
+        end = tmp;
+    }
+    size_t len = strlen(text);
+    int32_t delta = (int32_t)len - (int32_t)(end - start);
+
+    // the first and last characters of the region must stay, so its boundaries still hold
+    int32_t index = lsp_document_regionAt(doc, start);
+    uint8_t local = index >= 0 && doc->regions.data[index]->start < start &&
+                    end < lsp_document_regionEnd(doc, index) &&
+                    !lsp_document_mayCrossRegions(text, len) &&
+                    !lsp_document_mayCrossRegions(doc->text + start, end - start);
+
+    sds updated = sdsnewlen(doc->text, start);
+    updated = sdscatlen(updated, text, len);
+    updated = sdscatlen(updated, doc->text + end, sdslen(doc->text) - end);
+    sdsfree(doc->text);
+    doc->text = updated;
+    lsp_document_indexLines(doc);
+
+    if(!local) {
+        lsp_document_parseAll(doc);
+        return;
+    }
+
+    uint32_t i = index + 1;
+    for(; i < (uint32_t)doc->regions.length; i++) {
+        doc->regions.data[i]->start += delta;
+    }
+
+    // names declared before and after the edit, the declarations behind them were replaced
+    map_int_t replaced;
+    map_init(&replaced);
+    LspRegion* region = doc->regions.data[index];
+    char* name;
+    vec_foreach(&region->names, name, i) { map_set(&replaced, name, 1); }
+    lsp_document_parseRegion(doc, index);
+    vec_foreach(&region->names, name, i) { map_set(&replaced, name, 1); }
+
+    // their users must be inferred again, then the users of those, until nothing is added
+    uint8_t* dirty = calloc(doc->regions.length, sizeof(uint8_t));
+    dirty[index] = 1;
+    map_int_t changed;
+    map_init(&changed);
+    lsp_document_addNames(&changed, &replaced);
+    uint8_t grown = 1;
+    while(grown) {
+        grown = 0;
+        LspRegion* other;
+        vec_foreach(&doc->regions, other, i) {
+            if(!dirty[i] && lsp_document_references(other, &changed)) {
+                dirty[i] = 1;
+                uint32_t j = 0;
+                vec_foreach(&other->names, name, j) { map_set(&changed, name, 1); }
+                grown = 1;
+            }
+        }
+    }
+
+    // nothing may still lead to a replaced declaration once inference starts, it was released
+    LspRegion* other;
+    vec_foreach(&doc->regions, other, i) {
+        if(dirty[i] && i != (uint32_t)index) {
+            lsp_document_rebind(other, &replaced);
+        }
+    }
+
+    // in document order, as a full parse does
+    vec_foreach(&doc->regions, other, i) {
+        if(dirty[i]) {
+            lsp_document_inferRegion(doc, i);
+        }
+        else {
+            // cached answers may still point to the replaced declarations
+            query_invalidateAll(&other->parser->queries);
+        }
+    }
+    free(dirty);
+    map_deinit(&changed);
+    map_deinit(&replaced);
+}
+
+Parser* lsp_document_diagnosticsAt(LspDocument* doc, uint32_t index, int32_t* lineDelta) {
+    *lineDelta = 0;
+    if(index == 0) {
+        return doc->header;
+    }
+
+    LspRegion* region = doc->regions.data[index - 1];
+    uint32_t line, col;
+    lsp_document_positionAt(doc, region->start, &line, &col);
+    *lineDelta = (int32_t)line - (int32_t)region->parsedLine;
+    return region->parser;
+}
+
+/**
+ * Bounds of the identifier at the offset
+ */
+static uint8_t lsp_document_wordAt(LspDocument* doc, uint32_t offset, uint32_t* start, uint32_t* end) {
+    uint32_t len = sdslen(doc->text);
+    uint32_t s = offset, e = offset;
+    while(s > 0 && (isalnum((unsigned char)doc->text[s - 1]) || doc->text[s - 1] == '_')) {
+        s--;
+    }
+    while(e < len && (isalnum((unsigned char)doc->text[e]) || doc->text[e] == '_')) {
+        e++;
+    }
+    *start = s;
+    *end = e;
+    return e > s && !isdigit((unsigned char)doc->text[s]);
+}
+
+static sds lsp_document_describeFn(Parser* parser, ASTScope* scope, FnHeader* header) {
+    sds str = sdscatprintf(sdsempty(), "fn %s(", header->name);
+    uint32_t i = 0;
+    char* argName;
+    omap_foreach_key(&header->type->args, argName, i) {
+        FnArgument** arg = omap_get(&header->type->args, argName);
+        str = sdscatprintf(str, "%s%s%s: %s", i > 0 ? ", " : "", (*arg)->isMutable ? "mut " : "", argName,
+                           describeType((*arg)->type));
+    }
+    str = sdscat(str, ")");
+    if(header->type->returnType != NULL) {
+        str = sdscatprintf(str, " -> %s", describeType(header->type->returnType));
+    }
+    return str;
+}
+
+static sds lsp_document_describe(Parser* parser, ASTScope* scope, const char* name) {
+    // locals and arguments of the functions declared around the cursor first
+    uint32_t i = 0;
+    Statement* stmt;
+    vec_foreach(&parser->programNode->stmts, stmt, i) {
+        if(stmt->type != ST_FN_DECL) {
+            continue;
+        }
+        parser_parseFnBody(parser, stmt->fnDecl);
+        ASTScope* fnScope = stmt->fnDecl->bodyType == FBT_BLOCK && stmt->fnDecl->block != NULL ?
+                            stmt->fnDecl->block->blockStmt->scope : stmt->fnDecl->scope;
+        DataType* type = scope_lookupVariable(fnScope, (char*)name);
+        if(type != NULL) {
+            return sdscatprintf(sdsempty(), "%s: %s", name, describeType(type));
+        }
+    }
+
+    ASTScopeResult* result = resolveElement((char*)name, scope, 1);
+    if(result == NULL) {
+        return NULL;
+    }
+
+    sds str = NULL;
+    switch(result->type) {
+        case SCOPE_VARIABLE: {
+            str = sdscatprintf(sdsempty(), "let %s%s: %s", result->variable->isMutable ? "mut " : "", name,
+                               describeType(result->variable->type));
+            break;
+        }
+        case SCOPE_FUNCTION:
+            str = lsp_document_describeFn(parser, scope, result->function);
+            break;
+        case SCOPE_TYPE: {
+            DataType* type = result->dataType;
+            DataType* definition = type->kind == DT_REFERENCE && type->refType->ref != NULL ? type->refType->ref : NULL;
+            if(definition != NULL && definition->name == NULL) {
+                str = sdscatprintf(sdsempty(), "type %s = %s", name, describeType(definition));
+            }
+            else {
+                str = sdscatprintf(sdsempty(), "type %s", name);
+            }
+            break;
+        }
+        case SCOPE_FFI: {
+            str = sdscatprintf(sdsempty(), "extern \"C\" %s {", result->ffi->name);
+            char* methodName;
+            omap_foreach_key(&result->ffi->methods, methodName, i) {
+                str = sdscatprintf(str, "%s fn %s", i > 0 ? "," : "", methodName);
+            }
+            str = sdscat(str, " }");
+            break;
+        }
+        default:
+            break;
+    }
+    free(result);
+    return str;
+}
+
+sds lsp_document_hover(LspDocument* doc, uint32_t line, uint32_t col) {
+    uint32_t start, end;
+    if(!lsp_document_wordAt(doc, lsp_document_offsetAt(doc, line, col), &start, &end)) {
+        return NULL;
+    }
+
+    int32_t index = lsp_document_regionAt(doc, start);
+    Parser* parser = index >= 0 ? doc->regions.data[index]->parser : doc->header;
+    ASTScope* scope = index >= 0 ? doc->regions.data[index]->program->scope : doc->program->scope;
+
+    sds name = sdsnewlen(doc->text + start, end - start);
+    sds str = NULL;
+    // types are computed on demand, one which does not resolve is not described
+    uint32_t diagnostics = parser->diagnostics.diagnostics.length;
+    jmp_buf recovery;
+    parser->recovery = &recovery;
+    if(setjmp(recovery) == 0) {
+        str = lsp_document_describe(parser, scope, name);
+    }
+    parser->recovery = NULL;
+    diagnostics_truncate(&parser->diagnostics, diagnostics);
+
+    sdsfree(name);
+    return str;
+}
+
+uint8_t lsp_document_definition(LspDocument* doc, uint32_t* line, uint32_t* col) {
+    uint32_t start, end;
+    if(!lsp_document_wordAt(doc, lsp_document_offsetAt(doc, *line, *col), &start, &end)) {
+        return 0;
+    }
+
+    sds name = sdsnewlen(doc->text + start, end - start);
+    int* owner = map_get(&doc->owners, name);
+    if(owner == NULL) {
+        sdsfree(name);
+        return 0;
+    }
+
+    // the first whole word occurrence within the declaring region is its name
+    LspRegion* region = doc->regions.data[*owner];
+    uint32_t regionEnd = lsp_document_regionEnd(doc, *owner);
+    size_t len = sdslen(name);
+    uint32_t offset = region->start;
+    uint8_t found = 0;
+    for(; offset + len <= regionEnd; offset++) {
+        if(strncmp(doc->text + offset, name, len) != 0) {
+            continue;
+        }
+        uint32_t wordStart, wordEnd;
+        lsp_document_wordAt(doc, offset, &wordStart, &wordEnd);
+        if(wordStart == offset && wordEnd == offset + len) {
+            found = 1;
+            break;
+        }
+    }
+    sdsfree(name);
+
+    if(found) {
+        lsp_document_positionAt(doc, offset, line, col);
+    }
+    return found;
+}
@@ -0,0 +1,148 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_LSP_DOCUMENT_H
+#define TYPE_C_LSP_DOCUMENT_H
+
+#include <stdint.h>
+#include "../compiler/ast.h"
+#include "../compiler/parser.h"
+#include "../compiler/alloc.h"
+#include "../utils/vec.h"
+#include "../utils/map.h"
+#include "../utils/sds.h"
+
+/**
+ * An open document of the language server.
+ * The text is split into regions, one per top-level declaration, each parsed
+ * by its own parser into its own scope. The names a region declares are published
+ * into the document scope, which is the parent of every region scope, so regions
+ * see each other without being parsed together.
+ * An edit within a single region reparses that region only. The regions referencing
+ * names it declared, before or after the edit, are inferred again, and so are the ones
+ * referencing theirs, transitively. Their references to the replaced declarations are bound again.
+ * Anything else, i.e an edit spanning two regions or touching the imports, reparses the document.
+ * A region's parser and AST are allocated in an arena of its own, released when it is parsed again.
+ * The header and the document scope have one too, released when the document is parsed again.
+ */
+
+typedef struct LspRegion {
+    // offset of its first character, it ends where the next region starts
+    uint32_t start;
+    // owns what was allocated while it was parsed, NULL until then
+    AllocArena* arena;
+    // line of its first character, when it was parsed. lines of its diagnostics are relative to it
+    uint32_t parsedLine;
+    Parser* parser;
+    // its statements, its scope's parent is the document scope
+    ASTProgramNode* program;
+    // names it published into the document scope
+    vec_str_t names;
+    // number of diagnostics raised while parsing, the ones after are from inference
+    uint32_t parseDiagnostics;
+    // type references bound in the region, bound again when a declaration they lead to is replaced
+    vec_unresolvedtype_t references;
+}LspRegion;
+
+typedef vec_t(LspRegion*) vec_lspregion_t;
+
+typedef struct LspDocumentStats {
+    uint32_t fullParses;
+    uint32_t regionParses;
+    uint32_t regionInferences;
+}LspDocumentStats;
+
+typedef struct LspDocument {
+    char* uri;
+    sds text;
+    int32_t version;
+    // offset of the first character of every line
+    vec_int_t lines;
+
+    // owns what was allocated while the header was parsed, and the document scope
+    AllocArena* arena;
+    // imports and anything before the first declaration
+    Parser* header;
+    // holds the document scope, and the imports
+    ASTProgramNode* program;
+    vec_lspregion_t regions;
+    // published name -> index of the region declaring it
+    map_int_t owners;
+
+    LspDocumentStats stats;
+}LspDocument;
+
+/**
+ * Opens and parses a document
+ * @param uri used as file name in diagnostics
+ * @param text
+ * @param version
+ * @return new document
+ */
+LspDocument* lsp_document_open(const char* uri, const char* text, int32_t version);
+
+/**
+ * Releases the document, its parsers, diagnostics and AST
+ * @param doc
+ */
+void lsp_document_close(LspDocument* doc);
+
+/**
+ * Replaces the whole text and parses it again
+ * @param doc
+ * @param text
+ */
+void lsp_document_setText(LspDocument* doc, const char* text);
+
+/**
+ * Replaces a range of the text, positions are zero-based lines and byte columns.
+ * @param doc
+ * @param startLine
+ * @param startCol
+ * @param endLine
+ * @param endCol
+ * @param text new text of the range
+ */
+void lsp_document_applyEdit(LspDocument* doc, uint32_t startLine, uint32_t startCol,
+                            uint32_t endLine, uint32_t endCol, const char* text);
+
+/**
+ * Converts a zero-based position into an offset, clamped to the text
+ */
+uint32_t lsp_document_offsetAt(LspDocument* doc, uint32_t line, uint32_t col);
+
+/**
+ * Converts an offset into a zero-based position
+ */
+void lsp_document_positionAt(LspDocument* doc, uint32_t offset, uint32_t* line, uint32_t* col);
+
+/**
+ * Returns the parser whose diagnostics are reported at the given index, 0 being the header,
+ * and the number of lines their spans must be shifted by since it ran.
+ * @param doc
+ * @param index from 0 to regions.length included
+ * @param lineDelta output
+ * @return the parser, NULL if the region was never parsed
+ */
+Parser* lsp_document_diagnosticsAt(LspDocument* doc, uint32_t index, int32_t* lineDelta);
+
+/**
+ * Describes the symbol under the cursor, with its type
+ * @param doc
+ * @param line zero-based
+ * @param col zero-based
+ * @return new sds string, NULL if there is nothing to describe
+ */
+sds lsp_document_hover(LspDocument* doc, uint32_t line, uint32_t col);
+
+/**
+ * Finds where the top-level symbol under the cursor is declared
+ * @param doc
+ * @param line zero-based, in/out
+ * @param col zero-based, in/out
+ * @return 1 if found
+ */
+uint8_t lsp_document_definition(LspDocument* doc, uint32_t* line, uint32_t* col);
+
+#endif //TYPE_C_LSP_DOCUMENT_H
@@ -0,0 +1,382 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <setjmp.h>
+#include "lsp.h"
+#include "document.h"
+#include "../compiler/error.h"
+#include "../utils/parson.h"
+#include "../utils/map.h"
+#include "../utils/sds.h"
+
+#define LSP_CONTENT_LENGTH "Content-Length:"
+// larger messages are read past instead of buffered
+#define LSP_MAX_CONTENT_LENGTH (64L * 1024 * 1024)
+#define LSP_METHOD_NOT_FOUND -32601
+#define LSP_INTERNAL_ERROR -32603
+
+typedef map_t(LspDocument*) map_lspdocument_t;
+
+typedef struct LspServer {
+    FILE* in;
+    FILE* out;
+    map_lspdocument_t documents;
+    uint8_t shutdown;
+}LspServer;
+
+/**
+ * Reads past the body of a rejected message, so that the next header is found again
+ */
+static void lsp_skip(FILE* in, long length) {
+    char chunk[4096];
+    while(length > 0) {
+        size_t read = fread(chunk, 1, length < (long)sizeof(chunk) ? (size_t)length : sizeof(chunk), in);
+        if(read == 0) {
+            return;
+        }
+        length -= (long)read;
+    }
+}
+
+/**
+ * Reads the next message body, NULL once the input is closed.
+ * Messages with a Content-Length that is negative, unparsable or above LSP_MAX_CONTENT_LENGTH are dropped.
+ */
+static char* lsp_read(FILE* in) {
+    long length = -1;
+    long rejected = 0;
+    char header[256];
+    while(fgets(header, sizeof(header), in) != NULL) {
+        if(strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0) {
+            if(rejected > 0) {
+                lsp_skip(in, rejected);
+                rejected = 0;
+                continue;
+            }
+            if(length < 0) {
+                continue;
+            }
+            char* body = malloc(length + 1);
+            if(body == NULL) {
+                lsp_skip(in, length);
+                length = -1;
+                continue;
+            }
+            if(fread(body, 1, length, in) != (size_t)length) {
+                free(body);
+                return NULL;
+            }
+            body[length] = '\0';
+            return body;
+        }
+        if(strncmp(header, LSP_CONTENT_LENGTH, strlen(LSP_CONTENT_LENGTH)) == 0) {
+            char* value = header + strlen(LSP_CONTENT_LENGTH);
+            char* end = NULL;
+            length = strtol(value, &end, 10);
+            if(end == value || length < 0 || length > LSP_MAX_CONTENT_LENGTH) {
+                fprintf(stderr, "lsp: dropping message with Content-Length%.*s\n", (int)strcspn(value, "\r\n"), value);
+                rejected = length > LSP_MAX_CONTENT_LENGTH ? length : 0;
+                length = -1;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void lsp_write(LspServer* server, JSON_Value* message) {
+    json_object_set_string(json_value_get_object(message), "jsonrpc", "2.0");
+    char* body = json_serialize_to_string(message);
+    fprintf(server->out, LSP_CONTENT_LENGTH " %zu\r\n\r\n%s", strlen(body), body);
+    fflush(server->out);
+    json_free_serialized_string(body);
+    json_value_free(message);
+}
+
+static void lsp_respond(LspServer* server, JSON_Value* id, JSON_Value* result) {
+    JSON_Value* message = json_value_init_object();
+    json_object_set_value(json_value_get_object(message), "id", json_value_deep_copy(id));
+    json_object_set_value(json_value_get_object(message), "result", result != NULL ? result : json_value_init_null());
+    lsp_write(server, message);
+}
+
+static void lsp_respondError(LspServer* server, JSON_Value* id, int code, const char* text) {
+    JSON_Value* message = json_value_init_object();
+    JSON_Object* object = json_value_get_object(message);
+    json_object_set_value(object, "id", json_value_deep_copy(id));
+    json_object_dotset_number(object, "error.code", code);
+    json_object_dotset_string(object, "error.message", text);
+    lsp_write(server, message);
+}
+
+static JSON_Value* lsp_makePosition(uint32_t line, uint32_t col) {
+    JSON_Value* position = json_value_init_object();
+    json_object_set_number(json_value_get_object(position), "line", line);
+    json_object_set_number(json_value_get_object(position), "character", col);
+    return position;
+}
+
+static JSON_Value* lsp_makeRange(uint32_t line, uint32_t startCol, uint32_t endCol) {
+    JSON_Value* range = json_value_init_object();
+    json_object_set_value(json_value_get_object(range), "start", lsp_makePosition(line, startCol));
+    json_object_set_value(json_value_get_object(range), "end", lsp_makePosition(line, endCol));
+    return range;
+}
+
+static void lsp_publishDiagnostics(LspServer* server, LspDocument* doc) {
+    JSON_Value* list = json_value_init_array();
+    uint32_t i = 0;
+    for(; i <= (uint32_t)doc->regions.length; i++) {
+        int32_t lineDelta;
+        Parser* parser = lsp_document_diagnosticsAt(doc, i, &lineDelta);
+        if(parser == NULL) {
+            continue;
+        }
+
+        uint32_t j = 0;
+        Diagnostic* diagnostic;
+        vec_foreach(&parser->diagnostics.diagnostics, diagnostic, j) {
+            // spans are one-based lines, as of the last time the region was parsed
+            int32_t line = (int32_t)diagnostic->span.line - 1 + lineDelta;
+            uint32_t length = diagnostic->span.len > 0 ? diagnostic->span.len : 1;
+
+            JSON_Value* item = json_value_init_object();
+            JSON_Object* object = json_value_get_object(item);
+            json_object_set_value(object, "range", lsp_makeRange(line < 0 ? 0 : line, diagnostic->span.col,
+                                                                 diagnostic->span.col + length));
+            // LSP severities: 1 error, 2 warning, 3 information
+            json_object_set_number(object, "severity", diagnostic->severity == DS_ERROR ? 1 :
+                                                       diagnostic->severity == DS_WARNING ? 2 : 3);
+            json_object_set_string(object, "source", "type-c");
+            json_object_set_string(object, "message", diagnostic->message);
+            json_array_append_value(json_value_get_array(list), item);
+        }
+    }
+
+    JSON_Value* message = json_value_init_object();
+    JSON_Object* object = json_value_get_object(message);
+    json_object_set_string(object, "method", "textDocument/publishDiagnostics");
+    json_object_dotset_string(object, "params.uri", doc->uri);
+    json_object_dotset_number(object, "params.version", doc->version);
+    json_object_dotset_value(object, "params.diagnostics", list);
+    lsp_write(server, message);
+}
+
+static LspDocument* lsp_findDocument(LspServer* server, JSON_Object* params) {
+    const char* uri = json_object_dotget_string(params, "textDocument.uri");
+    if(uri == NULL) {
+        return NULL;
+    }
+    LspDocument** doc = map_get(&server->documents, uri);
+    return doc != NULL ? *doc : NULL;
+}
+
+static JSON_Value* lsp_initialize() {
+    JSON_Value* result = json_value_init_object();
+    JSON_Object* object = json_value_get_object(result);
+    json_object_dotset_boolean(object, "capabilities.textDocumentSync.openClose", 1);
+    // 2: incremental
+    json_object_dotset_number(object, "capabilities.textDocumentSync.change", 2);
+    json_object_dotset_boolean(object, "capabilities.hoverProvider", 1);
+    json_object_dotset_boolean(object, "capabilities.definitionProvider", 1);
+    json_object_dotset_string(object, "serverInfo.name", "type-c");
+    return result;
+}
+
+static void lsp_didOpen(LspServer* server, JSON_Object* params) {
+    const char* uri = json_object_dotget_string(params, "textDocument.uri");
+    const char* text = json_object_dotget_string(params, "textDocument.text");
+    if(uri == NULL || text == NULL) {
+        return;
+    }
+
+    LspDocument** existing = map_get(&server->documents, uri);
+    if(existing != NULL) {
+        lsp_document_close(*existing);
+    }
+    LspDocument* doc = lsp_document_open(uri, text, (int32_t)json_object_dotget_number(params, "textDocument.version"));
+    map_set(&server->documents, uri, doc);
+    lsp_publishDiagnostics(server, doc);
+}
+
+static void lsp_didChange(LspServer* server, JSON_Object* params) {
+    LspDocument* doc = lsp_findDocument(server, params);
+    if(doc == NULL) {
+        return;
+    }
+
+    JSON_Array* changes = json_object_get_array(params, "contentChanges");
+    size_t i = 0;
+    for(; i < json_array_get_count(changes); i++) {
+        JSON_Object* change = json_array_get_object(changes, i);
+        const char* text = json_object_get_string(change, "text");
+        if(text == NULL) {
+            continue;
+        }
+        if(json_object_has_value(change, "range")) {
+            lsp_document_applyEdit(doc,
+                                   (uint32_t)json_object_dotget_number(change, "range.start.line"),
+                                   (uint32_t)json_object_dotget_number(change, "range.start.character"),
+                                   (uint32_t)json_object_dotget_number(change, "range.end.line"),
+                                   (uint32_t)json_object_dotget_number(change, "range.end.character"),
+                                   text);
+        }
+        else {
+            lsp_document_setText(doc, text);
+        }
+    }
+    doc->version = (int32_t)json_object_dotget_number(params, "textDocument.version");
+    lsp_publishDiagnostics(server, doc);
+}
+
+static void lsp_didClose(LspServer* server, JSON_Object* params) {
+    const char* uri = json_object_dotget_string(params, "textDocument.uri");
+    LspDocument** doc = uri != NULL ? map_get(&server->documents, uri) : NULL;
+    if(doc == NULL) {
+        return;
+    }
+    lsp_document_close(*doc);
+    map_remove(&server->documents, uri);
+}
+
+static JSON_Value* lsp_hover(LspServer* server, JSON_Object* params) {
+    LspDocument* doc = lsp_findDocument(server, params);
+    if(doc == NULL) {
+        return NULL;
+    }
+
+    uint32_t line = (uint32_t)json_object_dotget_number(params, "position.line");
+    uint32_t col = (uint32_t)json_object_dotget_number(params, "position.character");
+    sds description = lsp_document_hover(doc, line, col);
+    if(description == NULL) {
+        return NULL;
+    }
+
+    sds markdown = sdscatprintf(sdsempty(), "```type-c\n%s\n```", description);
+    JSON_Value* result = json_value_init_object();
+    json_object_dotset_string(json_value_get_object(result), "contents.kind", "markdown");
+    json_object_dotset_string(json_value_get_object(result), "contents.value", markdown);
+    sdsfree(markdown);
+    sdsfree(description);
+    return result;
+}
+
+static JSON_Value* lsp_definition(LspServer* server, JSON_Object* params) {
+    LspDocument* doc = lsp_findDocument(server, params);
+    if(doc == NULL) {
+        return NULL;
+    }
+
+    uint32_t line = (uint32_t)json_object_dotget_number(params, "position.line");
+    uint32_t col = (uint32_t)json_object_dotget_number(params, "position.character");
+    if(!lsp_document_definition(doc, &line, &col)) {
+        return NULL;
+    }
+
+    JSON_Value* result = json_value_init_object();
+    json_object_set_string(json_value_get_object(result), "uri", doc->uri);
+    json_object_set_value(json_value_get_object(result), "range", lsp_makeRange(line, col, col));
+    return result;
+}
+
+/**
+ * Handles a message, sets exited once the client asks to
+ */
+static void lsp_dispatch(LspServer* server, const char* method, JSON_Value* id, JSON_Object* params, uint8_t* exited) {
+    if(strcmp(method, "initialize") == 0) {
+        lsp_respond(server, id, lsp_initialize());
+    }
+    else if(strcmp(method, "shutdown") == 0) {
+        server->shutdown = 1;
+        lsp_respond(server, id, NULL);
+    }
+    else if(strcmp(method, "exit") == 0) {
+        *exited = 1;
+    }
+    else if(strcmp(method, "textDocument/didOpen") == 0) {
+        lsp_didOpen(server, params);
+    }
+    else if(strcmp(method, "textDocument/didChange") == 0) {
+        lsp_didChange(server, params);
+    }
+    else if(strcmp(method, "textDocument/didClose") == 0) {
+        lsp_didClose(server, params);
+    }
+    else if(strcmp(method, "textDocument/hover") == 0) {
+        lsp_respond(server, id, lsp_hover(server, params));
+    }
+    else if(strcmp(method, "textDocument/definition") == 0) {
+        lsp_respond(server, id, lsp_definition(server, params));
+    }
+    else if(id != NULL) {
+        lsp_respondError(server, id, LSP_METHOD_NOT_FOUND, "method not found");
+    }
+    // other notifications, i.e `initialized`, need no answer
+}
+
+/**
+ * Answers a message which raised an internal error, the document it touched may be half updated and is dropped
+ */
+static void lsp_fail(LspServer* server, JSON_Value* id, JSON_Object* params) {
+    if(id != NULL) {
+        sds text = sdscatprintf(sdsempty(), "internal error: %s", error_lastMessage());
+        lsp_respondError(server, id, LSP_INTERNAL_ERROR, text);
+        sdsfree(text);
+    }
+
+    const char* uri = json_object_dotget_string(params, "textDocument.uri");
+    LspDocument** doc = uri != NULL ? map_get(&server->documents, uri) : NULL;
+    if(doc != NULL) {
+        lsp_document_close(*doc);
+        map_remove(&server->documents, uri);
+    }
+}
+
+int lsp_run(FILE* in, FILE* out) {
+    LspServer server;
+    server.in = in;
+    server.out = out;
+    map_init(&server.documents);
+    server.shutdown = 0;
+
+    uint8_t exited = 0;
+    char* body;
+    while(!exited && (body = lsp_read(in)) != NULL) {
+        JSON_Value* message = json_parse_string(body);
+        free(body);
+        JSON_Object* object = json_value_get_object(message);
+        const char* method = json_object_get_string(object, "method");
+        if(method == NULL) {
+            // responses to requests we never send, or garbage
+            json_value_free(message);
+            continue;
+        }
+
+        JSON_Value* id = json_object_get_value(object, "id");
+        JSON_Object* params = json_object_get_object(object, "params");
+
+        // an internal error fails the message, not the server
+        jmp_buf recovery;
+        jmp_buf* outerRecovery = error_enterRecovery(&recovery);
+        if(setjmp(recovery) == 0) {
+            lsp_dispatch(&server, method, id, params, &exited);
+        }
+        else {
+            lsp_fail(&server, id, params);
+        }
+        error_enterRecovery(outerRecovery);
+        json_value_free(message);
+    }
+
+    const char* uri;
+    map_iter_t iter = map_iter(&server.documents);
+    while((uri = map_next(&server.documents, &iter))) {
+        lsp_document_close(*map_get(&server.documents, uri));
+    }
+    map_deinit(&server.documents);
+    return !server.shutdown;
+}
@@ -0,0 +1,29 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_LSP_H
+#define TYPE_C_LSP_H
+
+#include <stdio.h>
+
+/**
+ * Language server, JSON-RPC over the given streams with Content-Length framing.
+ *
+ * Supported:
+ *   initialize, initialized, shutdown, exit
+ *   textDocument/didOpen, didChange (full or incremental), didClose
+ *   textDocument/hover, textDocument/definition
+ * Diagnostics are published after every open and change.
+ * Columns are byte offsets within their line.
+ */
+
+/**
+ * Serves requests until `exit` is received or the input is closed
+ * @param in
+ * @param out
+ * @return 0 if `shutdown` was requested before `exit`, 1 otherwise
+ */
+int lsp_run(FILE* in, FILE* out);
+
+#endif //TYPE_C_LSP_H
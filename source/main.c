@@ -1,36 +1,72 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include "compiler/lexer.h"
-#include "compiler/parser.h"
+#include <string.h>
+#include "compiler/module.h"
+#include "compiler/diagnostics.h"
+#include "server/server.h"
+#include "lsp/lsp.h"
 
-int _main_() {
-    char* filename = "../../samples/sample2.tc";
-    FILE* file = fopen(filename, "r");
-    if (!file)
-    {
-        fprintf(stderr, "Could not open file '%s'\n", filename);
-        return 1;
+static int usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--format human|json|sarif] [--jobs <n>] [--incremental] <file>\n"
+                    "       %s --server <socket>\n"
+                    "       %s --lsp\n", program, program, program);
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc == 3 && strcmp(argv[1], "--server") == 0) {
+        return server_run(argv[2]);
+    }
+    if(argc == 2 && strcmp(argv[1], "--lsp") == 0) {
+        return lsp_run(stdin, stdout);
     }
 
-    // Get file size
-    fseek(file, 0L, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
+    DiagnosticsFormat format = DF_HUMAN;
+    const char* filename = NULL;
+    // workers loading imports and parsing large files, 0 for one per CPU
+    uint32_t jobs = 0;
+    // keeps the dependency graph of the file next to it, only what changed since is rechecked
+    uint8_t incremental = 0;
+    int i = 1;
+    for(; i < argc; i++) {
+        if(strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if(!diagnostics_formatFromString(argv[++i], &format)) {
+                return usage(argv[0]);
+            }
+        }
+        else if(strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--incremental") == 0) {
+            incremental = 1;
+        }
+        else if(filename == NULL) {
+            filename = argv[i];
+        }
+        else {
+            return usage(argv[0]);
+        }
+    }
 
-    // Allocate buffer for file contents
-    char *input = malloc(file_size + 1);
-    if (!input)
-    {
-        fprintf(stderr, "Could not allocate memory for file contents\n");
-        return 1;
+    if(filename == NULL) {
+        return usage(argv[0]);
     }
 
-    // Read file contents into buffer
-    size_t bytes_read = fread(input, 1, file_size, file);
-    input[bytes_read] = '\0';
+    // same path as a single server request, imports are bound to their interfaces
+    ModuleCache cache;
+    module_cache_init(&cache);
+    cache.jobs = jobs;
+    cache.incremental = incremental;
+    module_cache_beginRequest(&cache);
+    Module* module = module_cache_load(&cache, filename);
+    if(module == NULL) {
+        fprintf(stderr, "Could not open file '%s'\n", filename);
+        return 1;
+    }
 
-    LexerState* lex = lexer_init("sample.tc", input, bytes_read);
-    Parser* parser = parser_init(lex);
-    parser_parse(parser);
-    return 0;
+    uint32_t errorCount = 0;
+    sds rendered = module_cache_render(&cache, module, format, &errorCount);
+    fwrite(rendered, 1, sdslen(rendered), stdout);
+    sdsfree(rendered);
+    return errorCount > 0;
 }
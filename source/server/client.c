@@ -0,0 +1,115 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+/**
+ * type_c_client: thin client of the compile server, see server.h
+ * Usage: type_c_client <socket> [--format human|json|sarif] <file>
+ *        type_c_client <socket> --stats
+ *        type_c_client <socket> --shutdown
+ * Exits with 0 if the file compiled, 1 if it has errors, 2 if the request failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+
+static int client_usage(const char* program) {
+    fprintf(stderr, "Usage: %s <socket> [--format human|json|sarif] <file>\n"
+                    "       %s <socket> --stats\n"
+                    "       %s <socket> --shutdown\n", program, program, program);
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 3) {
+        return client_usage(argv[0]);
+    }
+
+    const char* socketPath = argv[1];
+    const char* format = "human";
+    char request[PATH_MAX + 64];
+
+    if(strcmp(argv[2], "--stats") == 0) {
+        strcpy(request, "stats\n");
+    }
+    else if(strcmp(argv[2], "--shutdown") == 0) {
+        strcpy(request, "shutdown\n");
+    }
+    else {
+        int i = 2;
+        if(strcmp(argv[i], "--format") == 0) {
+            if(argc < 5) {
+                return client_usage(argv[0]);
+            }
+            format = argv[i + 1];
+            i += 2;
+        }
+
+        // the server does not share our working directory
+        char path[PATH_MAX];
+        if(realpath(argv[i], path) == NULL) {
+            fprintf(stderr, "Could not open file '%s'\n", argv[i]);
+            return 2;
+        }
+        snprintf(request, sizeof(request), "compile %s %s\n", format, path);
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        perror(socketPath);
+        return 2;
+    }
+
+    size_t length = strlen(request);
+    if(write(fd, request, length) != (ssize_t)length) {
+        perror(socketPath);
+        close(fd);
+        return 2;
+    }
+
+    // read everything, the status is the last line
+    size_t capacity = 4096, size = 0;
+    char* response = malloc(capacity);
+    ssize_t n;
+    while((n = read(fd, response + size, capacity - size - 1)) > 0) {
+        size += (size_t)n;
+        if(capacity - size < 2) {
+            capacity *= 2;
+            response = realloc(response, capacity);
+        }
+    }
+    response[size] = '\0';
+    close(fd);
+
+    int status = -1;
+    char* last = size > 1 ? response + size - 2 : response;
+    while(last > response && *last != '\n') {
+        last--;
+    }
+    if(*last == '\n') {
+        last++;
+    }
+    if(strncmp(last, SERVER_STATUS_PREFIX, strlen(SERVER_STATUS_PREFIX)) == 0) {
+        status = atoi(last + strlen(SERVER_STATUS_PREFIX));
+        *last = '\0';
+    }
+
+    fwrite(response, 1, strlen(response), stdout);
+    free(response);
+
+    if(status < 0) {
+        return 2;
+    }
+    return status > 0;
+}
@@ -0,0 +1,195 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "server.h"
+#include "../compiler/module.h"
+#include "../compiler/diagnostics.h"
+#include "../compiler/error.h"
+#include "../utils/sds.h"
+
+// longest request line accepted
+#define SERVER_MAX_REQUEST 8192
+// seconds a client has to send its request, requests are served one at a time
+#define SERVER_READ_TIMEOUT 5
+
+static uint8_t server_writeAll(int fd, const char* data, size_t len) {
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+        if(n <= 0) {
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+/**
+ * Reads the request line, without its new line
+ * @return the request, NULL if the client timed out or failed before sending it
+ */
+static sds server_readRequest(int fd) {
+    sds request = sdsempty();
+    char c;
+    ssize_t n = 0;
+    while(sdslen(request) < SERVER_MAX_REQUEST && (n = read(fd, &c, 1)) == 1 && c != '\n') {
+        request = sdscatlen(request, &c, 1);
+    }
+    if(n < 0) {
+        sdsfree(request);
+        return NULL;
+    }
+    return request;
+}
+
+static sds server_compile(ModuleCache* cache, const char* args) {
+    const char* space = strchr(args, ' ');
+    if(space == NULL) {
+        return sdscat(sdsempty(), "malformed compile request\n" SERVER_STATUS_PREFIX "-1\n");
+    }
+
+    sds formatName = sdsnewlen(args, space - args);
+    DiagnosticsFormat format;
+    uint8_t known = diagnostics_formatFromString(formatName, &format);
+    sdsfree(formatName);
+    if(!known) {
+        return sdscat(sdsempty(), "unknown diagnostics format\n" SERVER_STATUS_PREFIX "-1\n");
+    }
+
+    const char* path = space + 1;
+    module_cache_beginRequest(cache);
+    Module* module = module_cache_load(cache, path);
+    if(module == NULL) {
+        return sdscatprintf(sdsempty(), "Could not open file '%s'\n" SERVER_STATUS_PREFIX "-1\n", path);
+    }
+
+    uint32_t errorCount = 0;
+    sds response = module_cache_render(cache, module, format, &errorCount);
+    return sdscatprintf(response, SERVER_STATUS_PREFIX "%"PRIu32"\n", errorCount);
+}
+
+/**
+ * Answers a request line, clears running on shutdown
+ */
+static sds server_handle(ModuleCache* cache, const char* request, uint8_t* running) {
+    if(strncmp(request, "compile ", 8) == 0) {
+        return server_compile(cache, request + 8);
+    }
+    if(strcmp(request, "stats") == 0) {
+        return sdscatprintf(sdsempty(), "modules: %u, cache hits: %"PRIu64", misses: %"PRIu64"\n"
+                                        "interfaces: %u, in memory: %"PRIu64", loaded: %"PRIu64", built: %"PRIu64"\n"
+                                        "import graphs: %"PRIu64", modules walked: %"PRIu64"\n"
+                                        SERVER_STATUS_PREFIX "0\n",
+                            cache->modules.base.nnodes, cache->stats.hits, cache->stats.misses,
+                            cache->interfaces.base.nnodes, cache->stats.interfaceHits,
+                            cache->stats.interfaceLoads, cache->stats.interfaceBuilds,
+                            cache->stats.graphs, cache->stats.graphNodes);
+    }
+    if(strcmp(request, "shutdown") == 0) {
+        *running = 0;
+        return sdsnew(SERVER_STATUS_PREFIX "0\n");
+    }
+    return sdscatprintf(sdsempty(), "unknown request '%s'\n" SERVER_STATUS_PREFIX "-1\n", request);
+}
+
+/**
+ * Answers a request which raised an internal error, the module it compiled may be half built and is dropped
+ */
+static sds server_fail(ModuleCache* cache, const char* request) {
+    const char* space = strncmp(request, "compile ", 8) == 0 ? strchr(request + 8, ' ') : NULL;
+    if(space != NULL) {
+        module_cache_drop(cache, space + 1);
+    }
+    return sdscatprintf(sdsempty(), "internal error: %s\n" SERVER_STATUS_PREFIX "-1\n", error_lastMessage());
+}
+
+int server_run(const char* socketPath) {
+    struct sockaddr_un address;
+    if(strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path '%s' is too long\n", socketPath);
+        return 1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    // a stale socket from a previous server, anything else at that path is left alone
+    struct stat existing;
+    if(lstat(socketPath, &existing) == 0) {
+        if(!S_ISSOCK(existing.st_mode)) {
+            fprintf(stderr, "'%s' exists and is not a socket\n", socketPath);
+            close(fd);
+            return 1;
+        }
+        unlink(socketPath);
+    }
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 64) < 0) {
+        perror(socketPath);
+        close(fd);
+        return 1;
+    }
+
+    // a client going away mid-response must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    ModuleCache cache;
+    module_cache_init(&cache);
+
+    uint8_t running = 1;
+    while(running) {
+        int client = accept(fd, NULL, NULL);
+        if(client < 0) {
+            continue;
+        }
+
+        // a client which connects but never sends its request must not hold up the others
+        struct timeval timeout = {SERVER_READ_TIMEOUT, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        sds request = server_readRequest(client);
+        if(request == NULL) {
+            close(client);
+            continue;
+        }
+        sds response;
+        // an internal error fails the request, not the server
+        jmp_buf recovery;
+        jmp_buf* outerRecovery = error_enterRecovery(&recovery);
+        if(setjmp(recovery) == 0) {
+            response = server_handle(&cache, request, &running);
+        }
+        else {
+            response = server_fail(&cache, request);
+        }
+        error_enterRecovery(outerRecovery);
+
+        server_writeAll(client, response, sdslen(response));
+        sdsfree(response);
+        sdsfree(request);
+        close(client);
+    }
+
+    module_cache_deinit(&cache);
+    close(fd);
+    unlink(socketPath);
+    return 0;
+}
@@ -0,0 +1,30 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_SERVER_H
+#define TYPE_C_SERVER_H
+
+/**
+ * Compile server, keeps parsed and type-checked modules in memory between requests.
+ *
+ * Protocol, one request per connection, a single line:
+ *   compile <human|json|sarif> <absolute path>
+ *   stats
+ *   shutdown
+ * The response is the rendered diagnostics, followed by a last line
+ *   status <number of errors>
+ * A status of -1 means the request itself failed. Requests are served one at a time, a client which
+ * does not send its request within SERVER_READ_TIMEOUT seconds is dropped.
+ */
+
+#define SERVER_STATUS_PREFIX "status "
+
+/**
+ * Listens on the given Unix socket until a shutdown request is received
+ * @param socketPath
+ * @return 0 on clean shutdown, 1 if the socket could not be set up
+ */
+int server_run(const char* socketPath);
+
+#endif //TYPE_C_SERVER_H
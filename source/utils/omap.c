@@ -0,0 +1,103 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "omap.h"
+
+static unsigned omap_hash(const char *str) {
+    unsigned hash = 5381;
+    while (*str) {
+        hash = ((hash << 5) + hash) ^ *str++;
+    }
+    return hash;
+}
+
+
+/**
+ * Slot of a key, or the empty slot where it would be inserted
+ */
+static unsigned omap_slot(omap_base_t *m, const char *key, unsigned hash) {
+    /* nslots is a power of 2 and never full, probing always ends */
+    unsigned mask = m->nslots - 1;
+    unsigned slot = hash & mask;
+    while (m->slots[slot] != 0) {
+        unsigned idx = m->slots[slot] - 1;
+        if (m->hashes[idx] == hash && strcmp(m->keys[idx], key) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+static int omap_rehash(omap_base_t *m, unsigned nslots) {
+    unsigned *slots = calloc(nslots, sizeof(*slots));
+    unsigned i;
+    if (slots == NULL) return -1;
+    free(m->slots);
+    m->slots = slots;
+    m->nslots = nslots;
+    for (i = 0; i < m->length; i++) {
+        m->slots[omap_slot(m, m->keys[i], m->hashes[i])] = i + 1;
+    }
+    return 0;
+}
+
+
+static int omap_grow(omap_base_t *m, void **values, int vsize) {
+    unsigned capacity = m->capacity == 0 ? 4 : m->capacity << 1;
+    char **keys = realloc(m->keys, sizeof(*keys) * capacity);
+    if (keys == NULL) return -1;
+    m->keys = keys;
+    unsigned *hashes = realloc(m->hashes, sizeof(*hashes) * capacity);
+    if (hashes == NULL) return -1;
+    m->hashes = hashes;
+    void *newValues = realloc(*values, (size_t)vsize * capacity);
+    if (newValues == NULL) return -1;
+    *values = newValues;
+    m->capacity = capacity;
+    /* at most half of the slots are used */
+    return omap_rehash(m, capacity << 1);
+}
+
+
+void omap_deinit_(omap_base_t *m) {
+    free(m->keys);
+    free(m->hashes);
+    free(m->slots);
+}
+
+
+void *omap_get_(omap_base_t *m, const char *key, void *values, int vsize) {
+    unsigned slot;
+    if (m->length == 0) return NULL;
+    slot = omap_slot(m, key, omap_hash(key));
+    if (m->slots[slot] == 0) return NULL;
+    return (char*) values + (size_t)(m->slots[slot] - 1) * vsize;
+}
+
+
+int omap_set_(omap_base_t *m, char *key, void **values, void *value, int vsize) {
+    unsigned hash = omap_hash(key);
+    unsigned slot;
+    if (m->nslots > 0) {
+        slot = omap_slot(m, key, hash);
+        if (m->slots[slot] != 0) {
+            /* replaced in place, the entry keeps its position */
+            memcpy((char*) *values + (size_t)(m->slots[slot] - 1) * vsize, value, vsize);
+            return 0;
+        }
+    }
+    if (m->length == m->capacity) {
+        if (omap_grow(m, values, vsize) != 0) return -1;
+    }
+    slot = omap_slot(m, key, hash);
+    m->keys[m->length] = key;
+    m->hashes[m->length] = hash;
+    memcpy((char*) *values + (size_t)m->length * vsize, value, vsize);
+    m->slots[slot] = ++m->length;
+    return 0;
+}
@@ -0,0 +1,91 @@
+//
+// Created by praisethemoon on 19.10.26.
+//
+
+#ifndef TYPE_C_OMAP_H
+#define TYPE_C_OMAP_H
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Insertion-ordered map from strings to values, in the spirit of map.h and vec.h.
+ * Entries are kept densely in insertion order, keys in one array and values in another,
+ * and an open-addressing table of entry indexes gives O(1) lookups.
+ *
+ * Keys are not copied: they must outlive the map, as names within the AST do.
+ * Entries cannot be removed.
+ */
+
+typedef struct {
+    char **keys;
+    unsigned *hashes;
+    // 0 is an empty slot, otherwise the index of the entry + 1
+    unsigned *slots;
+    unsigned length, capacity, nslots;
+} omap_base_t;
+
+
+#define omap_t(T)\
+  struct { omap_base_t base; T *values; T tmp; }
+
+
+#define omap_init(m)\
+  memset((m), 0, sizeof(*(m)))
+
+
+#define omap_deinit(m)\
+  ( omap_deinit_(&(m)->base),\
+    free((m)->values),\
+    omap_init(m) )
+
+
+// nothing is stored into the map, concurrent lookups are safe
+#define omap_get(m, key)\
+  ( (__typeof__((m)->values)) omap_get_(&(m)->base, key, (m)->values, sizeof(*(m)->values)) )
+
+
+#define omap_set(m, key, value)\
+  ( (m)->tmp = (value),\
+    omap_set_(&(m)->base, key, (void**)&(m)->values, &(m)->tmp, sizeof((m)->tmp)) )
+
+
+#define omap_length(m)\
+  ((m)->base.length)
+
+
+#define omap_key(m, idx)\
+  ((m)->base.keys[(idx)])
+
+
+#define omap_value(m, idx)\
+  ((m)->values[(idx)])
+
+
+#define omap_foreach(m, key, value, iter)\
+  if  ( (m)->base.length > 0 )\
+  for ( (iter) = 0;\
+        (unsigned) (iter) < (m)->base.length &&\
+        (((key) = (m)->base.keys[(iter)]), ((value) = (m)->values[(iter)]), 1);\
+        ++(iter))
+
+
+#define omap_foreach_key(m, key, iter)\
+  if  ( (m)->base.length > 0 )\
+  for ( (iter) = 0;\
+        (unsigned) (iter) < (m)->base.length && (((key) = (m)->base.keys[(iter)]), 1);\
+        ++(iter))
+
+
+#define omap_foreach_value(m, value, iter)\
+  if  ( (m)->base.length > 0 )\
+  for ( (iter) = 0;\
+        (unsigned) (iter) < (m)->base.length && (((value) = (m)->values[(iter)]), 1);\
+        ++(iter))
+
+
+void omap_deinit_(omap_base_t *m);
+void *omap_get_(omap_base_t *m, const char *key, void *values, int vsize);
+int omap_set_(omap_base_t *m, char *key, void **values, void *value, int vsize);
+
+#endif //TYPE_C_OMAP_H
@@ -8,26 +8,39 @@
 #include "vec.h"
 
 
-int vec_expand_(char **data, int *length, int *capacity, int memsz) {
-    if (*length + 1 > *capacity) {
-        void *ptr;
-        int n = (*capacity == 0) ? 1 : *capacity << 1;
+/* Number of elements the data can hold, small vectors store it negated while inline */
+#define vec_room_(capacity) ((capacity) < 0 ? -(capacity) : (capacity))
+
+
+static int vec_grow_(char **data, int *length, int *capacity, int memsz, int n) {
+    void *ptr;
+    if (*capacity < 0) {
+        /* leaving the inline storage of a small vector */
+        ptr = malloc(n * memsz);
+        if (ptr == NULL) return -1;
+        memcpy(ptr, *data, *length * memsz);
+    } else {
         ptr = realloc(*data, n * memsz);
         if (ptr == NULL) return -1;
-        *data = ptr;
-        *capacity = n;
+    }
+    *data = ptr;
+    *capacity = n;
+    return 0;
+}
+
+
+int vec_expand_(char **data, int *length, int *capacity, int memsz) {
+    if (*length + 1 > vec_room_(*capacity)) {
+        int n = (*capacity == 0) ? 1 : vec_room_(*capacity) << 1;
+        return vec_grow_(data, length, capacity, memsz, n);
     }
     return 0;
 }
 
 
 int vec_reserve_(char **data, int *length, int *capacity, int memsz, int n) {
-    (void) length;
-    if (n > *capacity) {
-        void *ptr = realloc(*data, n * memsz);
-        if (ptr == NULL) return -1;
-        *data = ptr;
-        *capacity = n;
+    if (n > vec_room_(*capacity)) {
+        return vec_grow_(data, length, capacity, memsz, n);
     }
     return 0;
 }
@@ -44,7 +57,10 @@ int vec_reserve_po2_(
 
 
 int vec_compact_(char **data, int *length, int *capacity, int memsz) {
-    if (*length == 0) {
+    if (*capacity < 0) {
+        /* inline, nothing to release */
+        return 0;
+    } else if (*length == 0) {
         free(*data);
         *data = NULL;
         *capacity = 0;
@@ -22,12 +22,26 @@
   struct { T *data; int length, capacity; }
 
 
+/* Small vector: room for N elements within the vector itself, memory is only
+ * allocated once they are outgrown. A negative capacity means the elements are
+ * inline, so a small vector must not be moved or copied by value while it is.
+ * Every vec_* macro applies; vec_init turns it into a regular vector. */
+#define vec_small_t(T, N)\
+  struct { T *data; int length, capacity; T inline_[N]; }
+
+
 #define vec_init(v)\
   memset((v), 0, sizeof(*(v)))
 
 
+#define vec_small_init(v)\
+  ( (v)->data = (v)->inline_,\
+    (v)->length = 0,\
+    (v)->capacity = -(int) (sizeof((v)->inline_) / sizeof(*(v)->inline_)) )
+
+
 #define vec_deinit(v)\
-  ( free((v)->data),\
+  ( (v)->capacity > 0 ? free((v)->data) : (void) 0,\
     vec_init(v) )
 
 
@@ -52,7 +66,7 @@
 
 #define vec_insert(v, idx, val)\
   ( vec_insert_(vec_unpack_(v), idx) ? -1 :\
-    ((v)->data[idx] = (val)), (v)->length++, 0 )
+    ((v)->data[idx] = (val), (v)->length++, 0) )
 
 
 #define vec_sort(v, fn)\
@@ -130,7 +144,7 @@
 #define vec_foreach(v, var, iter)\
   if  ( (v)->length > 0 )\
   for ( (iter) = 0;\
-        (iter) < (v)->length && (((var) = (v)->data[(iter)]), 1);\
+        (int) (iter) < (v)->length && (((var) = (v)->data[(iter)]), 1);\
         ++(iter))
 
 
@@ -144,7 +158,7 @@
 #define vec_foreach_ptr(v, var, iter)\
   if  ( (v)->length > 0 )\
   for ( (iter) = 0;\
-        (iter) < (v)->length && (((var) = &(v)->data[(iter)]), 1);\
+        (int) (iter) < (v)->length && (((var) = &(v)->data[(iter)]), 1);\
         ++(iter))
 
 